@@ -9,6 +9,8 @@
 
 #include <stdarg.h>
 #include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
 
 // ===== ANDROID LOG PRIORITIES =====
 #define ANDROID_LOG_UNKNOWN 0
@@ -40,10 +42,38 @@
 #define ANDROID_BITMAP_FORMAT_A_8       8
 
 // ===== MAIN INITIALIZATION FUNCTION =====
-// This is the ONLY function declaration we need in this header
-// All other Android functions are declared in so_util.h or implemented directly
 void android_patch_init(void);
 
+// ===== ASSET MANAGER =====
+// Shared with android_api.c and default_dynlib.c so there is one AAsset
+// implementation
+typedef struct AAssetManager AAssetManager;
+typedef struct AAsset AAsset;
+
+AAsset *AAssetManager_open(AAssetManager *mgr, const char *filename, int mode);
+int AAsset_read(AAsset *asset, void *buf, size_t count);
+off_t AAsset_seek(AAsset *asset, off_t offset, int whence);
+int64_t AAsset_seek64(AAsset *asset, int64_t offset, int whence);
+off_t AAsset_getLength(AAsset *asset);
+int64_t AAsset_getLength64(AAsset *asset);
+off_t AAsset_getRemainingLength(AAsset *asset);
+int64_t AAsset_getRemainingLength64(AAsset *asset);
+const void *AAsset_getBuffer(AAsset *asset);
+int AAsset_isAllocated(AAsset *asset);
+int AAsset_openFileDescriptor(AAsset *asset, off_t *outStart, off_t *outLength);
+void AAsset_close(AAsset *asset);
+
+// Directory listings (files only, like Android) served by the FIOS index
+typedef struct AAssetDir AAssetDir;
+
+AAssetDir *AAssetManager_openDir(AAssetManager *mgr, const char *dirName);
+const char *AAssetDir_getNextFileName(AAssetDir *dir);
+void AAssetDir_rewind(AAssetDir *dir);
+void AAssetDir_close(AAssetDir *dir);
+
+// Per-asset counters, hottest first
+void android_asset_report(void);
+
 // ===== NOTE =====
 // All other Android function declarations are in:
 // - so_util.h (ALooper functions, Android API functions)
@@ -0,0 +1,58 @@
+/*
+ * asset_cache.h - Shared whole-asset buffers for Fluffy Diver
+ * Backs AAsset_getBuffer, AASSET_MODE_BUFFER opens and prefetched assets
+ */
+
+#ifndef __ASSET_CACHE_H__
+#define __ASSET_CACHE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define ASSET_CACHE_ALIGN 64
+
+typedef struct AssetBuffer {
+    const void *data; // 64-byte aligned, read-only while referenced
+    size_t size;
+
+    // Cache bookkeeping
+    char *name;
+    uint32_t hash;
+    int refs;
+    int prefetched; // Loaded ahead and not used yet
+    uint32_t load_us; // Time the load took, hidden from the game if prefetched
+    struct AssetBuffer *hash_next;
+    struct AssetBuffer *idle_prev; // Unreferenced buffers, oldest first
+    struct AssetBuffer *idle_next;
+} AssetBuffer;
+
+void asset_cache_init(void);
+
+// Whole asset by name, loaded on first use (NULL if it doesn't exist)
+AssetBuffer *asset_cache_acquire(const char *name);
+void asset_cache_release(AssetBuffer *buffer);
+
+// Like acquire, but only if the asset is already cached; never touches storage
+AssetBuffer *asset_cache_lookup(const char *name);
+
+// Queue name for loading on the prefetch thread (-1 if the queue is full)
+int asset_cache_prefetch(const char *name);
+
+// Prefetch name on the calling thread; bytes loaded, 0 if already cached, -1 on failure
+int asset_cache_preload(const char *name);
+
+// Prefetch an asset the caller already read into memalign(ASSET_CACHE_ALIGN)
+// data; the cache takes ownership of data either way (-1 if not inserted)
+int asset_cache_insert(const char *name, void *data, size_t size, uint32_t load_us);
+
+int asset_cache_contains(const char *name);
+
+// asset_cache_mb in bytes, referenced buffers included (0: prefetch off)
+size_t asset_cache_budget(void);
+
+// Free unreferenced buffers until at most keep_bytes of them remain
+void asset_cache_trim(size_t keep_bytes);
+
+void asset_cache_report(void);
+
+#endif // __ASSET_CACHE_H__
@@ -0,0 +1,82 @@
+/*
+ * asset_pack.h - Indexed asset pack reader for Fluffy Diver
+ * Single-file archive built by tools/pack_assets.py
+ */
+
+#ifndef __ASSET_PACK_H__
+#define __ASSET_PACK_H__
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#define ASSET_PACK_PATH "ux0:data/fluffydiver/assets.pak"
+
+#define ASSET_PACK_MAGIC 0x4B504446 // "FDPK"
+#define ASSET_PACK_VERSION 2 // Version 1 packs (no chunked entries) are still read
+
+// Entry flags
+#define ASSET_PACK_DEFLATE 0x1 // Stored as a zlib stream
+#define ASSET_PACK_CHUNKED 0x2 // Stored as zlib chunks behind a seek table
+
+#define ASSET_PACK_CHUNK_MAX (256 * 1024)
+
+// On-disk layout (little endian):
+//   header | TOC (sorted by hash, then name) | name table | aligned data
+//
+// Entries with identical contents share one copy of the data (same offset).
+//
+// Chunked entry data: uint32_t table[chunks + 1] of offsets from the start
+// of the entry (the last one is the stored size), then the chunks. Each
+// chunk holds chunk_size bytes of the asset (the last one may be shorter);
+// a chunk whose stored size equals that is kept uncompressed.
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t count;
+    uint32_t toc_offset;
+    uint32_t names_offset;
+    uint32_t names_size;
+    uint32_t data_align;
+    uint32_t chunk_size; // Version 2; 0 if no entry is chunked
+} AssetPackHeader;
+
+typedef struct {
+    uint32_t hash;        // FNV-1a of the asset name
+    uint32_t name_offset; // Into the name table
+    uint32_t offset;      // Stored data, from the start of the pack
+    uint32_t size;        // Stored size
+    uint32_t raw_size;    // Size after inflating
+    uint32_t flags;
+} AssetPackEntry;
+
+// Open the pack and load its index (-1 if missing or invalid)
+int asset_pack_init(const char *path);
+void asset_pack_close(void);
+
+// Lookup by asset name as passed to AAssetManager_open
+const AssetPackEntry *asset_pack_find(const char *name);
+const char *asset_pack_name(const AssetPackEntry *entry);
+
+// Every entry in TOC order, for listings
+uint32_t asset_pack_count(void);
+const AssetPackEntry *asset_pack_entry(uint32_t index);
+
+// Entry owning entry's data; identical files share one blob under several names
+const AssetPackEntry *asset_pack_blob(const AssetPackEntry *entry);
+
+// Whole asset, inflated if needed; dst holds entry->raw_size bytes
+int asset_pack_load(const AssetPackEntry *entry, void *dst);
+
+// Raw bytes of the pack file, for reads spanning several entries
+int asset_pack_read(void *dst, uint32_t size, uint32_t offset);
+
+// Entry contents from its stored bytes (already read with asset_pack_read)
+int asset_pack_decode(const AssetPackEntry *entry, const void *stored, void *dst);
+
+// Read-only stream over one asset; chunked entries inflate only the chunks read
+FILE *asset_pack_fopen(const AssetPackEntry *entry);
+
+void asset_pack_report(void);
+
+#endif // __ASSET_PACK_H__
@@ -0,0 +1,25 @@
+/*
+ * asset_trace.h - Boot asset trace and replay for Fluffy Diver
+ * Records the game's asset accesses and prefetches them on the next launch
+ */
+
+#ifndef __ASSET_TRACE_H__
+#define __ASSET_TRACE_H__
+
+#include <stdint.h>
+
+#define ASSET_TRACE_PATH "ux0:data/fluffydiver/boot_trace.txt"
+
+// Start recording, and replay the previous launch's trace if there is one
+void asset_trace_init(void);
+
+// Trace id for an opened asset (-1 when not recording)
+int asset_trace_open(const char *name);
+void asset_trace_read(int id, uint32_t offset, uint32_t length);
+
+// Write the trace recorded so far (done automatically when the window ends)
+void asset_trace_save(void);
+
+void asset_trace_report(void);
+
+#endif // __ASSET_TRACE_H__
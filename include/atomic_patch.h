@@ -0,0 +1,114 @@
+/*
+ * atomic_patch.h - __sync_* / __atomic_* runtime for Fluffy Diver
+ * The game imports these from libgcc/libatomic; we provide LDREX/STREX versions
+ */
+
+#ifndef __ATOMIC_PATCH_H__
+#define __ATOMIC_PATCH_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Declare one set of sized helpers (N = byte width, T = value type)
+#define ATOMIC_DECLARE_SIZED(N, T) \
+    T atomic_sync_fetch_and_add_##N(volatile void *ptr, T val); \
+    T atomic_sync_fetch_and_sub_##N(volatile void *ptr, T val); \
+    T atomic_sync_fetch_and_or_##N(volatile void *ptr, T val); \
+    T atomic_sync_fetch_and_and_##N(volatile void *ptr, T val); \
+    T atomic_sync_fetch_and_xor_##N(volatile void *ptr, T val); \
+    T atomic_sync_fetch_and_nand_##N(volatile void *ptr, T val); \
+    T atomic_sync_add_and_fetch_##N(volatile void *ptr, T val); \
+    T atomic_sync_sub_and_fetch_##N(volatile void *ptr, T val); \
+    T atomic_sync_or_and_fetch_##N(volatile void *ptr, T val); \
+    T atomic_sync_and_and_fetch_##N(volatile void *ptr, T val); \
+    T atomic_sync_xor_and_fetch_##N(volatile void *ptr, T val); \
+    T atomic_sync_nand_and_fetch_##N(volatile void *ptr, T val); \
+    T atomic_sync_val_compare_and_swap_##N(volatile void *ptr, T oldval, T newval); \
+    int atomic_sync_bool_compare_and_swap_##N(volatile void *ptr, T oldval, T newval); \
+    T atomic_sync_lock_test_and_set_##N(volatile void *ptr, T val); \
+    void atomic_sync_lock_release_##N(volatile void *ptr); \
+    T atomic_load_##N(const volatile void *ptr, int order); \
+    void atomic_store_##N(volatile void *ptr, T val, int order); \
+    T atomic_exchange_##N(volatile void *ptr, T val, int order); \
+    int atomic_compare_exchange_##N(volatile void *ptr, void *expected, T desired, \
+                                    int success, int failure); \
+    T atomic_fetch_add_##N(volatile void *ptr, T val, int order); \
+    T atomic_fetch_sub_##N(volatile void *ptr, T val, int order); \
+    T atomic_fetch_and_##N(volatile void *ptr, T val, int order); \
+    T atomic_fetch_or_##N(volatile void *ptr, T val, int order); \
+    T atomic_fetch_xor_##N(volatile void *ptr, T val, int order); \
+    T atomic_fetch_nand_##N(volatile void *ptr, T val, int order); \
+    T atomic_add_fetch_##N(volatile void *ptr, T val, int order); \
+    T atomic_sub_fetch_##N(volatile void *ptr, T val, int order); \
+    T atomic_and_fetch_##N(volatile void *ptr, T val, int order); \
+    T atomic_or_fetch_##N(volatile void *ptr, T val, int order); \
+    T atomic_xor_fetch_##N(volatile void *ptr, T val, int order); \
+    T atomic_nand_fetch_##N(volatile void *ptr, T val, int order);
+
+ATOMIC_DECLARE_SIZED(1, uint8_t)
+ATOMIC_DECLARE_SIZED(2, uint16_t)
+ATOMIC_DECLARE_SIZED(4, uint32_t)
+ATOMIC_DECLARE_SIZED(8, uint64_t)
+
+// Barriers and generic (any size) entry points
+void atomic_sync_synchronize(void);
+void atomic_thread_fence(int order);
+void atomic_signal_fence(int order);
+int atomic_is_lock_free(size_t size, const volatile void *ptr);
+void atomic_load_generic(size_t size, const volatile void *ptr, void *ret, int order);
+void atomic_store_generic(size_t size, volatile void *ptr, const void *val, int order);
+void atomic_exchange_generic(size_t size, volatile void *ptr, const void *val, void *ret, int order);
+int atomic_compare_exchange_generic(size_t size, volatile void *ptr, void *expected,
+                                    const void *desired, int success, int failure);
+
+// default_dynlib entries for one width
+#define ATOMIC_DYNLIB_SIZED(N) \
+    {"__sync_fetch_and_add_" #N, (uintptr_t)&atomic_sync_fetch_and_add_##N}, \
+    {"__sync_fetch_and_sub_" #N, (uintptr_t)&atomic_sync_fetch_and_sub_##N}, \
+    {"__sync_fetch_and_or_" #N, (uintptr_t)&atomic_sync_fetch_and_or_##N}, \
+    {"__sync_fetch_and_and_" #N, (uintptr_t)&atomic_sync_fetch_and_and_##N}, \
+    {"__sync_fetch_and_xor_" #N, (uintptr_t)&atomic_sync_fetch_and_xor_##N}, \
+    {"__sync_fetch_and_nand_" #N, (uintptr_t)&atomic_sync_fetch_and_nand_##N}, \
+    {"__sync_add_and_fetch_" #N, (uintptr_t)&atomic_sync_add_and_fetch_##N}, \
+    {"__sync_sub_and_fetch_" #N, (uintptr_t)&atomic_sync_sub_and_fetch_##N}, \
+    {"__sync_or_and_fetch_" #N, (uintptr_t)&atomic_sync_or_and_fetch_##N}, \
+    {"__sync_and_and_fetch_" #N, (uintptr_t)&atomic_sync_and_and_fetch_##N}, \
+    {"__sync_xor_and_fetch_" #N, (uintptr_t)&atomic_sync_xor_and_fetch_##N}, \
+    {"__sync_nand_and_fetch_" #N, (uintptr_t)&atomic_sync_nand_and_fetch_##N}, \
+    {"__sync_val_compare_and_swap_" #N, (uintptr_t)&atomic_sync_val_compare_and_swap_##N}, \
+    {"__sync_bool_compare_and_swap_" #N, (uintptr_t)&atomic_sync_bool_compare_and_swap_##N}, \
+    {"__sync_lock_test_and_set_" #N, (uintptr_t)&atomic_sync_lock_test_and_set_##N}, \
+    {"__sync_lock_release_" #N, (uintptr_t)&atomic_sync_lock_release_##N}, \
+    {"__atomic_load_" #N, (uintptr_t)&atomic_load_##N}, \
+    {"__atomic_store_" #N, (uintptr_t)&atomic_store_##N}, \
+    {"__atomic_exchange_" #N, (uintptr_t)&atomic_exchange_##N}, \
+    {"__atomic_compare_exchange_" #N, (uintptr_t)&atomic_compare_exchange_##N}, \
+    {"__atomic_fetch_add_" #N, (uintptr_t)&atomic_fetch_add_##N}, \
+    {"__atomic_fetch_sub_" #N, (uintptr_t)&atomic_fetch_sub_##N}, \
+    {"__atomic_fetch_and_" #N, (uintptr_t)&atomic_fetch_and_##N}, \
+    {"__atomic_fetch_or_" #N, (uintptr_t)&atomic_fetch_or_##N}, \
+    {"__atomic_fetch_xor_" #N, (uintptr_t)&atomic_fetch_xor_##N}, \
+    {"__atomic_fetch_nand_" #N, (uintptr_t)&atomic_fetch_nand_##N}, \
+    {"__atomic_add_fetch_" #N, (uintptr_t)&atomic_add_fetch_##N}, \
+    {"__atomic_sub_fetch_" #N, (uintptr_t)&atomic_sub_fetch_##N}, \
+    {"__atomic_and_fetch_" #N, (uintptr_t)&atomic_and_fetch_##N}, \
+    {"__atomic_or_fetch_" #N, (uintptr_t)&atomic_or_fetch_##N}, \
+    {"__atomic_xor_fetch_" #N, (uintptr_t)&atomic_xor_fetch_##N}, \
+    {"__atomic_nand_fetch_" #N, (uintptr_t)&atomic_nand_fetch_##N}
+
+// Complete set of default_dynlib entries
+#define ATOMIC_DYNLIB_ENTRIES \
+    ATOMIC_DYNLIB_SIZED(1), \
+    ATOMIC_DYNLIB_SIZED(2), \
+    ATOMIC_DYNLIB_SIZED(4), \
+    ATOMIC_DYNLIB_SIZED(8), \
+    {"__sync_synchronize", (uintptr_t)&atomic_sync_synchronize}, \
+    {"__atomic_thread_fence", (uintptr_t)&atomic_thread_fence}, \
+    {"__atomic_signal_fence", (uintptr_t)&atomic_signal_fence}, \
+    {"__atomic_is_lock_free", (uintptr_t)&atomic_is_lock_free}, \
+    {"__atomic_load", (uintptr_t)&atomic_load_generic}, \
+    {"__atomic_store", (uintptr_t)&atomic_store_generic}, \
+    {"__atomic_exchange", (uintptr_t)&atomic_exchange_generic}, \
+    {"__atomic_compare_exchange", (uintptr_t)&atomic_compare_exchange_generic}
+
+#endif // __ATOMIC_PATCH_H__
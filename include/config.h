@@ -41,6 +41,12 @@ typedef enum {
     VRAM_HIGH = 2
 } VramUsage;
 
+// Float math backend options
+typedef enum {
+    MATH_BACKEND_EXACT = 0, // newlib libm
+    MATH_BACKEND_FAST = 1   // math_patch.c approximations
+} MathBackend;
+
 // Configuration structure
 typedef struct {
     // Graphics settings
@@ -63,11 +69,19 @@ typedef struct {
     int overclock;
     int gpu_overrides;
     int vram_usage;
+    int math_backend;
+    int io_buffer_kb;
+    int asset_cache_mb;
+    int io_scheduler;
+    int io_prefetch_kbps;
+    int io_writebehind_kbps;
 
     // Debug settings
     int debug_logging;
     int show_fps;
     int wireframe;
+    int lock_profiler;
+    int io_stats;
 } FluffyDiverConfig;
 
 // Global configuration instance
@@ -93,9 +107,17 @@ int config_get_button_layout(void);
 int config_get_overclock(void);
 int config_get_gpu_overrides(void);
 int config_get_vram_usage(void);
+int config_get_math_backend(void);
+int config_get_io_buffer_kb(void);
+int config_get_asset_cache_mb(void);
+int config_get_io_scheduler(void);
+int config_get_io_prefetch_kbps(void);
+int config_get_io_writebehind_kbps(void);
 int config_get_debug_logging(void);
 int config_get_show_fps(void);
 int config_get_wireframe(void);
+int config_get_lock_profiler(void);
+int config_get_io_stats(void);
 
 // Setter functions
 void config_set_graphics_quality(int quality);
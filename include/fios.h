@@ -8,6 +8,9 @@
 
 #include <stdio.h>
 
+// Largest translated path the FIOS helpers handle (including the terminator)
+#define FIOS_PATH_MAX 512
+
 // FIOS initialization and cleanup
 int fios_init(void);
 void fios_cleanup(void);
@@ -15,26 +18,57 @@ void fios_cleanup(void);
 // Directory management
 void fios_create_directories(void);
 int fios_mkdir(const char *path);
-int fios_list_directory(const char *path);
+int fios_list_directory(const char *path); // Entry count, -1 if missing
 
-// Path translation
-char *fios_translate_path(const char *path);
+// Path translation (redirect rules, writes into the caller's buffer)
+int fios_translate_path(const char *path, char *out, size_t size);
 int fios_add_redirect(const char *from, const char *to);
 void fios_print_redirects(void);
 
+// Redirect rules on top of the built-in ones, one "pattern = target [priority]"
+// per line; fios_init loads FIOS_REDIRECTS_PATH. Returns the number loaded,
+// -1 if they could not be compiled (the current rules stay).
+#define FIOS_REDIRECTS_PATH "ux0:data/fluffydiver/redirects.txt"
+int fios_load_redirects(const char *path);
+
 // File operations
 int fios_file_exists(const char *path);
 long fios_file_size(const char *path);
 int fios_copy_file(const char *src, const char *dst);
 int fios_remove(const char *path);
 
-// Enhanced file operations
+// Stat cache (exists/size lookups, including negative results)
+void fios_cache_invalidate(const char *path);
+// Same for a translated path; io_patch calls it when a writable stream or
+// fd closes, so a lookup made while the file was being written is dropped
+void fios_cache_drop(const char *translated);
+void fios_cache_report(void);
+
+// Save files: rewrites under FIOS_SAVE_DIR are buffered by io_patch and
+// committed here in the background, via a temp file and a rename
+#define FIOS_SAVE_DIR "ux0:data/fluffydiver/save"
+void fios_save_init(void);
+void fios_save_recover(const char *dir);
+int fios_is_save_path(const char *translated);
+int fios_save_commit(const char *translated, void *data, size_t size); // Takes ownership of data
+void fios_save_wait(const char *translated); // NULL waits for every pending save
+
+// Enhanced file operations; streams from these are io_patch's (or the asset
+// pack's), so use the io_* stdio shims on them
 FILE *fios_fopen(const char *path, const char *mode);
 
 // Android asset compatibility
 int fios_asset_exists(const char *asset_path);
 long fios_asset_size(const char *asset_path);
 FILE *fios_asset_open(const char *asset_path, const char *mode);
+int fios_asset_stats_id(const char *asset_path); // -1 when io_stats is off
+
+// Files (not subdirectories) in an asset directory, from the FIOS directory
+// index, or from the card and the pack when the directory is redirected out
+// of the asset tree; visit may run under the index lock and must not call
+// back into FIOS
+typedef void (*FiosAssetVisit)(const char *name, void *ctx);
+int fios_asset_list(const char *asset_dir, FiosAssetVisit visit, void *ctx);
 
 // Device information
 long long fios_get_free_space(const char *path);
@@ -0,0 +1,41 @@
+/*
+ * fios_index.h - Directory index for Fluffy Diver
+ * In-memory listing of the asset tree and the asset pack
+ */
+
+#ifndef __FIOS_INDEX_H__
+#define __FIOS_INDEX_H__
+
+#include <stdint.h>
+
+#define FIOS_INDEX_ROOT "ux0:data/fluffydiver/assets"
+
+// Entry flags
+#define FIOS_INDEX_DIR   0x1
+#define FIOS_INDEX_LOOSE 0x2 // Exists on the card under FIOS_INDEX_ROOT
+#define FIOS_INDEX_PACK  0x4 // Asset pack entry, or a directory holding one
+
+// Called under the index lock; must not call back into FIOS
+typedef void (*FiosIndexVisit)(const char *name, uint32_t flags, uint32_t size, void *ctx);
+
+// Build the index (call after asset_pack_init)
+void fios_index_init(void);
+
+// A write through FIOS touched translated, or a stream or fd that wrote it
+// closed (via fios_cache_drop); the next query rebuilds
+void fios_index_invalidate(const char *translated);
+
+// Loose file or directory: 1 exists, 0 doesn't, -1 not covered by the index
+int fios_index_stat(const char *translated, int64_t *size);
+
+// Direct children of a translated directory (count, -1 if not covered or missing)
+int fios_index_list(const char *translated, FiosIndexVisit visit, void *ctx);
+
+// Direct children of dir (relative to FIOS_INDEX_ROOT, as pack names are)
+// that the asset pack holds, for directories redirected out of the root
+// (count, -1 if there is no index)
+int fios_index_list_pack(const char *dir, FiosIndexVisit visit, void *ctx);
+
+void fios_index_report(void);
+
+#endif // __FIOS_INDEX_H__
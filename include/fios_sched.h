@@ -0,0 +1,40 @@
+/*
+ * fios_sched.h - I/O request scheduler for Fluffy Diver
+ * Positioned card reads and writes, queued by priority class and served by
+ * one I/O worker
+ */
+
+#ifndef __FIOS_SCHED_H__
+#define __FIOS_SCHED_H__
+
+#include <stdint.h>
+
+typedef enum {
+    FIOS_CLASS_REALTIME,    // Audio streaming; always served first
+    FIOS_CLASS_FOREGROUND,  // Loads the game is waiting on (the default)
+    FIOS_CLASS_PREFETCH,    // Speculative reads, bandwidth capped
+    FIOS_CLASS_WRITEBEHIND, // Background save writes, bandwidth capped
+    FIOS_CLASS_COUNT
+} FiosClass;
+
+// Start the worker when io_scheduler is set (call after config_init)
+void fios_sched_init(void);
+
+// Class for requests issued by a kernel thread (0 = the calling thread)
+void fios_sched_set_thread_class(int thid, FiosClass cls);
+
+// Drop a thread's class as it exits (0 = the calling thread). Kernel thread
+// ids get reused, so a stale entry would demote whatever thread comes next.
+void fios_sched_thread_exit(int thid);
+
+// While boosted, a prefetch or write-behind thread's requests are served
+// like foreground ones; calls nest (0 = the calling thread)
+void fios_sched_boost(int thid, int on);
+
+// sceIoPread/sceIoPwrite through the queue; the caller blocks until done
+int fios_sched_pread(int fd, void *buf, uint32_t size, int64_t offset);
+int fios_sched_pwrite(int fd, const void *buf, uint32_t size, int64_t offset);
+
+void fios_sched_report(void);
+
+#endif // __FIOS_SCHED_H__
@@ -0,0 +1,39 @@
+/*
+ * fios_stats.h - Per-file I/O statistics for Fluffy Diver
+ * Counters and latency histograms fed by FIOS and the stdio/fd shims
+ */
+
+#ifndef __FIOS_STATS_H__
+#define __FIOS_STATS_H__
+
+#include <stdint.h>
+
+#define FIOS_STATS_CSV_PATH "ux0:data/fluffydiver/logs/io_stats.csv"
+
+typedef enum {
+    FIOS_OP_OPEN,
+    FIOS_OP_READ,
+    FIOS_OP_WRITE,
+    FIOS_OP_SEEK,
+    FIOS_OP_STAT,
+    FIOS_OP_COUNT
+} FiosOp;
+
+// Enabled by io_stats in config.txt (call after config_init)
+void fios_stats_init(void);
+int fios_stats_enabled(void);
+
+// Id for a file by its translated path (-1 when disabled or the table is full)
+int fios_stats_file(const char *path);
+
+// Start time for an operation, 0 when disabled
+uint64_t fios_stats_begin(void);
+
+// Count one operation that started at start (from fios_stats_begin)
+void fios_stats_record(int id, FiosOp op, uint64_t bytes, uint64_t start);
+void fios_stats_record_path(const char *path, FiosOp op, uint64_t bytes, uint64_t start);
+
+// One row per file and per directory prefix (-1 on failure)
+int fios_stats_dump(const char *csv_path);
+
+#endif // __FIOS_STATS_H__
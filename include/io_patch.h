@@ -0,0 +1,64 @@
+/*
+ * io_patch.h - Buffered stdio layer for Fluffy Diver
+ * Streams opened through fopen_hook are owned here; any other FILE*
+ * (stdout, newlib streams) is forwarded to newlib unchanged. Same for fds
+ * returned by open_hook.
+ */
+
+#ifndef __IO_PATCH_H__
+#define __IO_PATCH_H__
+
+#include <stdio.h>
+#include <stdarg.h>
+
+// Initialization (call after config_init)
+void io_patch_init(void);
+
+// Open a stream on an already-translated Vita path
+FILE *io_fopen(const char *path, const char *mode);
+
+// stdio shims (exported to the game through default_dynlib)
+int io_fclose(FILE *stream);
+size_t io_fread(void *ptr, size_t size, size_t nmemb, FILE *stream);
+size_t io_fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream);
+int io_fseek(FILE *stream, long offset, int whence);
+long io_ftell(FILE *stream);
+void io_rewind(FILE *stream);
+int io_feof(FILE *stream);
+int io_ferror(FILE *stream);
+void io_clearerr(FILE *stream);
+int io_fflush(FILE *stream);
+int io_fgetc(FILE *stream);
+int io_fputc(int c, FILE *stream);
+char *io_fgets(char *s, int size, FILE *stream);
+int io_fputs(const char *s, FILE *stream);
+int io_fprintf(FILE *stream, const char *fmt, ...);
+int io_vfprintf(FILE *stream, const char *fmt, va_list args);
+int io_fscanf(FILE *stream, const char *fmt, ...);
+int io_fileno(FILE *stream);
+int io_setvbuf(FILE *stream, char *buf, int mode, size_t size);
+
+// bionic (ARM) open() flags, as the game passes them to open_hook
+#define ANDROID_O_ACCMODE  00000003
+#define ANDROID_O_RDONLY   00000000
+#define ANDROID_O_WRONLY   00000001
+#define ANDROID_O_RDWR     00000002
+#define ANDROID_O_CREAT    00000100
+#define ANDROID_O_EXCL     00000200
+#define ANDROID_O_TRUNC    00001000
+#define ANDROID_O_APPEND   00002000
+#define ANDROID_O_NONBLOCK 00004000
+
+// Raw fd I/O (fds index io_patch's table of Vita handles)
+int io_open(const char *path, int flags, int mode);
+int io_close(int fd);
+int io_read(int fd, void *buf, size_t count);
+int io_write(int fd, const void *buf, size_t count);
+int io_pread(int fd, void *buf, size_t count, long offset);
+int io_pwrite(int fd, const void *buf, size_t count, long offset);
+long io_lseek(int fd, long offset, int whence);
+
+// Totals over every owned stream and fd, including closed ones
+void io_stdio_report(void);
+
+#endif // __IO_PATCH_H__
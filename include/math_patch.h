@@ -0,0 +1,33 @@
+/*
+ * math_patch.h - Fast float math backend for Fluffy Diver
+ * Selected with math_backend = exact|fast in config.txt
+ */
+
+#ifndef __MATH_PATCH_H__
+#define __MATH_PATCH_H__
+
+#include <stddef.h>
+
+#include "so_util.h"
+
+// Rebind the float math imports in a dynlib table to the configured backend.
+// Must run before so_resolve().
+void math_patch_apply(DynLibFunction *funcs, size_t num_funcs);
+
+// Fast backend. Bounds are the max error against libm in double precision,
+// checked over every float in the domain (atan2f/powf: 200M random pairs).
+// Outside the domain, and for NaN/Inf/subnormals, each defers to newlib.
+float math_sinf(float x);              // 0.51 ULP, |x| < 2^19
+float math_cosf(float x);              // 0.51 ULP, |x| < 2^19
+float math_tanf(float x);              // 0.80 ULP, |x| < 2^19
+float math_atanf(float x);             // 0.56 ULP
+float math_atan2f(float y, float x);   // 0.56 ULP, nonzero finite x and y
+float math_expf(float x);              // 0.51 ULP, normal results
+float math_exp2f(float x);             // 0.51 ULP, normal results
+float math_logf(float x);              // 0.50 ULP, normal x > 0
+float math_log2f(float x);             // 0.50 ULP, normal x > 0
+float math_log10f(float x);            // 0.52 ULP, normal x > 0
+float math_powf(float x, float y);     // 0.51 ULP, normal x > 0, normal results
+float math_sqrtf(float x);             // Correctly rounded (VSQRT)
+
+#endif // __MATH_PATCH_H__
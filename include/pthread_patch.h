@@ -0,0 +1,76 @@
+/*
+ * pthread_patch.h - pthread shims for Fluffy Diver
+ * Game-facing replacements for the newlib pthread port
+ */
+
+#ifndef __PTHREAD_PATCH_H__
+#define __PTHREAD_PATCH_H__
+
+#include <pthread.h>
+#include <stdint.h>
+
+// Initialization (call after config_init)
+void pthread_patch_init(void);
+
+// Mutex shims (exported to the game through default_dynlib)
+int pthread_mutex_init_fake(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr);
+int pthread_mutex_destroy_fake(pthread_mutex_t *mutex);
+int pthread_mutex_lock_fake(pthread_mutex_t *mutex);
+int pthread_mutex_trylock_fake(pthread_mutex_t *mutex);
+int pthread_mutex_unlock_fake(pthread_mutex_t *mutex);
+int pthread_mutexattr_init_fake(pthread_mutexattr_t *attr);
+int pthread_mutexattr_settype_fake(pthread_mutexattr_t *attr, int type);
+int pthread_mutexattr_destroy_fake(pthread_mutexattr_t *attr);
+
+// Condition variable shims (abstime/reltime use the bionic 32-bit timespec layout)
+int pthread_cond_init_fake(pthread_cond_t *cond, const pthread_condattr_t *attr);
+int pthread_cond_destroy_fake(pthread_cond_t *cond);
+int pthread_cond_wait_fake(pthread_cond_t *cond, pthread_mutex_t *mutex);
+int pthread_cond_timedwait_fake(pthread_cond_t *cond, pthread_mutex_t *mutex, const void *abstime);
+int pthread_cond_timedwait_monotonic_fake(pthread_cond_t *cond, pthread_mutex_t *mutex, const void *abstime);
+int pthread_cond_timedwait_relative_fake(pthread_cond_t *cond, pthread_mutex_t *mutex, const void *reltime);
+int pthread_cond_signal_fake(pthread_cond_t *cond);
+int pthread_cond_broadcast_fake(pthread_cond_t *cond);
+int pthread_condattr_init_fake(pthread_condattr_t *attr);
+int pthread_condattr_setclock_fake(pthread_condattr_t *attr, int clock_id);
+int pthread_condattr_destroy_fake(pthread_condattr_t *attr);
+
+// pthread_once shim
+int pthread_once_fake(pthread_once_t *once_control, void (*init_routine)(void));
+
+// Reader-writer lock shims
+int pthread_rwlock_init_fake(pthread_rwlock_t *rwlock, const pthread_rwlockattr_t *attr);
+int pthread_rwlock_destroy_fake(pthread_rwlock_t *rwlock);
+int pthread_rwlock_rdlock_fake(pthread_rwlock_t *rwlock);
+int pthread_rwlock_wrlock_fake(pthread_rwlock_t *rwlock);
+int pthread_rwlock_timedrdlock_fake(pthread_rwlock_t *rwlock, const void *abstime);
+int pthread_rwlock_timedwrlock_fake(pthread_rwlock_t *rwlock, const void *abstime);
+int pthread_rwlock_tryrdlock_fake(pthread_rwlock_t *rwlock);
+int pthread_rwlock_trywrlock_fake(pthread_rwlock_t *rwlock);
+int pthread_rwlock_unlock_fake(pthread_rwlock_t *rwlock);
+
+// Thread-local storage (inline per-thread block reached through TPIDRURO; pthread_tls.c)
+void tls_init(void);
+void tls_thread_exit(void); // Run the calling thread's destructors and free its block
+int pthread_key_create_fake(pthread_key_t *key, void (*destructor)(void *));
+int pthread_key_delete_fake(pthread_key_t key);
+void *pthread_getspecific_fake(pthread_key_t key);
+int pthread_setspecific_fake(pthread_key_t key, const void *value);
+
+// Thread creation with per-thread core/priority/stack policy and CPU time accounting
+int pthread_create_fake(pthread_t *thread, const pthread_attr_t *attr,
+                        void *(*start_routine)(void *), void *arg);
+int pthread_join_fake(pthread_t thread, void **value_ptr);
+int pthread_detach_fake(pthread_t thread);
+void pthread_exit_fake(void *value_ptr);
+int pthread_setname_np_fake(pthread_t thread, const char *name);
+void thread_policy_report(void);
+
+// CPU time of main() and every game thread, live or finished (CLOCK_PROCESS_CPUTIME_ID)
+uint64_t thread_cpu_time_total_us(void);
+
+// Lock contention profiler (enabled with lock_profiler = 1 in config.txt)
+int lock_profiler_enabled(void);
+void lock_profiler_report(void);
+
+#endif // __PTHREAD_PATCH_H__
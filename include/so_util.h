@@ -40,6 +40,7 @@ int so_resolve(so_module *mod, DynLibFunction *funcs, size_t num_funcs, int stri
 void so_flush_caches(so_module *mod);
 int so_initialize(so_module *mod);
 uintptr_t so_symbol(so_module *mod, const char *symbol);
+const char *so_symbolize(so_module *mod, uintptr_t addr, uintptr_t *offset);
 void hook_addr(uintptr_t addr, uintptr_t dst);
 
 // ===== SYMBOL ANALYSIS FUNCTIONS =====
@@ -74,9 +75,6 @@ int pthread_mutex_destroy_fake(pthread_mutex_t *mutex);
 int pthread_mutex_lock_fake(pthread_mutex_t *mutex);
 int pthread_mutex_unlock_fake(pthread_mutex_t *mutex);
 
-// ===== TIME FUNCTIONS =====
-int gettimeofday_vita(struct timeval *tv, void *tz);
-
 // ===== JNI FUNCTIONS =====
 int JNI_OnLoad(void *vm, void *reserved);
 
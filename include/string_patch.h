@@ -0,0 +1,18 @@
+/*
+ * string_patch.h - Word-at-a-time string functions for Fluffy Diver
+ * Exported to the game in place of newlib's byte loops
+ */
+
+#ifndef __STRING_PATCH_H__
+#define __STRING_PATCH_H__
+
+#include <stddef.h>
+
+size_t string_strlen(const char *s);
+char *string_strchr(const char *s, int c);
+int string_strcmp(const char *s1, const char *s2);
+int string_strncmp(const char *s1, const char *s2, size_t n);
+int string_strcasecmp(const char *s1, const char *s2);
+char *string_strstr(const char *haystack, const char *needle);
+
+#endif // __STRING_PATCH_H__
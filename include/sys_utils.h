@@ -0,0 +1,47 @@
+/*
+ * sys_utils.h - System utilities for Fluffy Diver
+ * Time subsystem exported to the game in place of newlib's clocks
+ */
+
+#ifndef __SYS_UTILS_H__
+#define __SYS_UTILS_H__
+
+#include <stdint.h>
+
+// Bionic struct timespec / timeval (32-bit time_t)
+typedef struct {
+    int32_t tv_sec;
+    int32_t tv_nsec;
+} AndroidTimespec;
+
+typedef struct {
+    int32_t tv_sec;
+    int32_t tv_usec;
+} AndroidTimeval;
+
+// Bionic clock ids
+#define ANDROID_CLOCK_REALTIME           0
+#define ANDROID_CLOCK_MONOTONIC          1
+#define ANDROID_CLOCK_PROCESS_CPUTIME_ID 2
+#define ANDROID_CLOCK_THREAD_CPUTIME_ID  3
+#define ANDROID_CLOCK_MONOTONIC_RAW      4
+#define ANDROID_CLOCK_REALTIME_COARSE    5
+#define ANDROID_CLOCK_MONOTONIC_COARSE   6
+#define ANDROID_CLOCK_BOOTTIME           7
+
+// Initialization (call before anything reads the clocks)
+void sys_time_init(void);
+
+// Microsecond clocks for internal use
+uint64_t sys_monotonic_us(void);
+uint64_t sys_realtime_us(void);
+
+// Time shims (exported to the game through default_dynlib)
+int sys_clock_gettime(int clock_id, AndroidTimespec *ts);
+int sys_clock_getres(int clock_id, AndroidTimespec *res);
+int sys_gettimeofday(AndroidTimeval *tv, void *tz);
+int sys_nanosleep(const AndroidTimespec *req, AndroidTimespec *rem);
+int32_t sys_time(int32_t *t);
+int32_t sys_clock(void);
+
+#endif // __SYS_UTILS_H__
@@ -14,6 +14,7 @@
 #include <pthread.h>
 #include "fios.h"
 #include "config.h"
+#include "android_patch.h"
 
 // External debug function
 extern void debugPrintf(const char *fmt, ...);
@@ -163,66 +164,31 @@ void *android_getVersionName(void *context) {
 }
 
 // ===== ANDROID ASSET MANAGER API =====
+// Thin wrappers over the AAsset implementation in android_patch.c
 
 void *android_asset_open(void *asset_manager, const char *filename, int mode) {
-    debugPrintf("Android: AssetManager.open(%s, %d) called\n", filename ? filename : "NULL", mode);
-
-    if (!filename) return NULL;
-
-    // Use FIOS for asset access
-    return fios_asset_open(filename, "rb");
+    return AAssetManager_open(asset_manager, filename, mode);
 }
 
 int android_asset_read(void *asset, void *buffer, int size) {
-    debugPrintf("Android: Asset.read(buffer=%p, size=%d) called\n", buffer, size);
-
-    if (!asset || !buffer || size <= 0) return 0;
-
-    return fread(buffer, 1, size, (FILE*)asset);
+    if (size <= 0) return 0;
+    return AAsset_read(asset, buffer, size);
 }
 
 int android_asset_seek(void *asset, int offset, int whence) {
-    debugPrintf("Android: Asset.seek(offset=%d, whence=%d) called\n", offset, whence);
-
-    if (!asset) return -1;
-
-    return fseek((FILE*)asset, offset, whence);
+    return AAsset_seek(asset, offset, whence);
 }
 
 int android_asset_getLength(void *asset) {
-    debugPrintf("Android: Asset.getLength() called\n");
-
-    if (!asset) return 0;
-
-    FILE *file = (FILE*)asset;
-    long current = ftell(file);
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, current, SEEK_SET);
-
-    return (int)length;
+    return AAsset_getLength(asset);
 }
 
 void android_asset_close(void *asset) {
-    debugPrintf("Android: Asset.close() called\n");
-
-    if (asset) {
-        fclose((FILE*)asset);
-    }
+    AAsset_close(asset);
 }
 
 int android_asset_getRemainingLength(void *asset) {
-    debugPrintf("Android: Asset.getRemainingLength() called\n");
-
-    if (!asset) return 0;
-
-    FILE *file = (FILE*)asset;
-    long current = ftell(file);
-    fseek(file, 0, SEEK_END);
-    long total = ftell(file);
-    fseek(file, current, SEEK_SET);
-
-    return (int)(total - current);
+    return AAsset_getRemainingLength(asset);
 }
 
 // ===== ANDROID DISPLAY API =====
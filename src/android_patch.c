@@ -18,6 +18,11 @@
 
 #include "config.h"
 #include "fios.h"
+#include "asset_cache.h"
+#include "asset_trace.h"
+#include "fios_stats.h"
+#include "io_patch.h"
+#include "android_patch.h"
 #include "jni_patch.h"  // Include JNI types
 
 // External debug function
@@ -130,74 +135,397 @@ int __android_log_write(int prio, const char *tag, const char *text) {
 
 // ===== ANDROID ASSET MANAGER IMPLEMENTATION =====
 
-typedef struct AAssetManager AAssetManager;
-typedef struct AAsset AAsset;
+// Read buffer per access mode for streamed assets
+#define ASSET_READ_BUFFER_RANDOM    (4 * 1024)
+#define ASSET_READ_BUFFER_STREAMING (64 * 1024)
+#define ASSET_READ_BUFFER_DEFAULT   (16 * 1024)
+
+// Per-name counters for the hottest-assets report
+#define ASSET_STATS_SLOTS 1024
+#define ASSET_REPORT_TOP 10
+
+typedef struct {
+    char *name;
+    uint32_t hash;
+    uint32_t opens;
+    uint32_t reads;
+    uint32_t buffered_reads; // Served without touching the file
+    uint64_t bytes_read;
+} AssetStats;
+
+static SceKernelLwMutexWork asset_stats_lock;
+static AssetStats asset_stats[ASSET_STATS_SLOTS];
+static int asset_stats_used = 0;
+static int asset_stats_ready = 0;
+
+// BUFFER opens share a whole-asset buffer from the asset cache; the other
+// modes stream through FIOS behind a read buffer sized for the mode.
+// getBuffer on a streamed asset switches it to the shared buffer.
+struct AAsset {
+    FILE *file;
+    AssetBuffer *buffer;
+    int mode;
+    char *name;
+    AssetStats *stats;
+    int trace_id;
+    int io_stats_id; // fios_stats id of the backing file, -1 when buffered or off
+
+    off_t length;   // Captured at open
+    off_t pos;
+
+    // Streamed assets: rb holds [rb_pos, rb_pos + rb_len) of the file
+    uint8_t *rb;
+    size_t rb_size;
+    off_t rb_pos;
+    size_t rb_len;
+    off_t file_pos; // Where the FILE's own position is
+};
+
+static uint32_t asset_name_hash(const char *name) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Counters for name; NULL once the table is full
+static AssetStats *asset_stats_get(const char *name) {
+    if (!asset_stats_ready) return NULL;
+
+    uint32_t hash = asset_name_hash(name);
+    AssetStats *found = NULL;
+
+    sceKernelLockLwMutex(&asset_stats_lock, 1, NULL);
+    for (uint32_t i = 0; i < ASSET_STATS_SLOTS; i++) {
+        AssetStats *s = &asset_stats[(hash + i) & (ASSET_STATS_SLOTS - 1)];
+        if (!s->name) {
+            // Keep the last slots free so probes always terminate
+            if (asset_stats_used >= ASSET_STATS_SLOTS - 1) break;
+            s->name = strdup(name);
+            if (!s->name) break;
+            s->hash = hash;
+            asset_stats_used++;
+            found = s;
+            break;
+        }
+        if (s->hash == hash && strcmp(s->name, name) == 0) {
+            found = s;
+            break;
+        }
+    }
+    sceKernelUnlockLwMutex(&asset_stats_lock, 1);
+
+    return found;
+}
+
+static inline void asset_count_read(AAsset *asset, size_t bytes, int buffered) {
+    AssetStats *s = asset->stats;
+    if (!s) return;
+
+    __atomic_fetch_add(&s->reads, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&s->bytes_read, bytes, __ATOMIC_RELAXED);
+    if (buffered) __atomic_fetch_add(&s->buffered_reads, 1, __ATOMIC_RELAXED);
+}
+
+static int asset_file_seek(AAsset *asset, off_t offset) {
+    if (asset->file_pos == offset) return 0;
+    uint64_t start = fios_stats_begin();
+    if (io_fseek(asset->file, offset, SEEK_SET) != 0) return -1;
+    fios_stats_record(asset->io_stats_id, FIOS_OP_SEEK, 0, start);
+    asset->file_pos = offset;
+    return 0;
+}
+
+static size_t asset_file_read(AAsset *asset, void *out, size_t count) {
+    uint64_t start = fios_stats_begin();
+    size_t n = io_fread(out, 1, count, asset->file);
+    fios_stats_record(asset->io_stats_id, FIOS_OP_READ, n, start);
+    asset->file_pos += n;
+    return n;
+}
+
+static size_t asset_stream_read(AAsset *asset, uint8_t *out, size_t count) {
+    size_t done = 0;
+    int touched_file = 0;
+
+    while (done < count) {
+        size_t left = count - done;
+
+        if (asset->pos >= asset->rb_pos && asset->pos < asset->rb_pos + (off_t)asset->rb_len) {
+            size_t off = asset->pos - asset->rb_pos;
+            size_t take = asset->rb_len - off < left ? asset->rb_len - off : left;
+            memcpy(out + done, asset->rb + off, take);
+            asset->pos += take;
+            done += take;
+            continue;
+        }
+
+        if (asset_file_seek(asset, asset->pos) < 0) break;
+        touched_file = 1;
+
+        if (!asset->rb && left < asset->rb_size) asset->rb = malloc(asset->rb_size);
+
+        // Reads at least a buffer long (or with no buffer) go straight to the caller
+        if (!asset->rb || left >= asset->rb_size) {
+            size_t n = asset_file_read(asset, out + done, left);
+            asset->pos += n;
+            done += n;
+            break;
+        }
+
+        size_t n = asset_file_read(asset, asset->rb, asset->rb_size);
+        asset->rb_pos = asset->pos;
+        asset->rb_len = n;
+        if (n == 0) break;
+    }
+
+    asset_count_read(asset, done, !touched_file);
+    return done;
+}
+
+// Move a streamed asset onto its shared buffer
+static int asset_attach_buffer(AAsset *asset) {
+    if (asset->buffer) return 0;
+
+    asset->buffer = asset_cache_acquire(asset->name);
+    if (!asset->buffer) return -1;
+
+    io_fclose(asset->file);
+    free(asset->rb);
+    asset->file = NULL;
+    asset->rb = NULL;
+    asset->rb_len = 0;
+    asset->io_stats_id = -1;
+    asset->length = asset->buffer->size;
+    return 0;
+}
 
 // Asset manager using FIOS
 AAsset *AAssetManager_open(AAssetManager *mgr, const char *filename, int mode) {
-    debugPrintf("Android: AAssetManager_open(%s, %d)\n", filename ? filename : "NULL", mode);
-
     if (!filename) return NULL;
 
-    // Use FIOS asset system
-    FILE *file = fios_asset_open(filename, "rb");
-    if (file) {
-        debugPrintf("Android: Successfully opened asset: %s\n", filename);
-        return (AAsset *)file;
+    AAsset *asset = calloc(1, sizeof(AAsset));
+    if (!asset) return NULL;
+    asset->mode = mode;
+    asset->name = strdup(filename);
+    asset->trace_id = asset_trace_open(filename);
+    asset->io_stats_id = -1;
+
+    // Prefetched assets are served from memory whatever the mode
+    if (mode == AASSET_MODE_BUFFER) {
+        asset->buffer = asset_cache_acquire(filename);
+    } else if (!(asset->buffer = asset_cache_lookup(filename))) {
+        asset->file = fios_asset_open(filename, "rb");
+        if (asset->file) asset->io_stats_id = fios_asset_stats_id(filename);
+    }
+
+    if (!asset->name || (!asset->buffer && !asset->file)) {
+        debugPrintf("Android: Failed to open asset: %s\n", filename);
+        if (asset->file) io_fclose(asset->file);
+        asset_cache_release(asset->buffer);
+        free(asset->name);
+        free(asset);
+        return NULL;
+    }
+
+    if (asset->buffer) {
+        asset->length = asset->buffer->size;
+    } else {
+        // The AAsset does its own buffering; pack streams drop theirs, loose
+        // files keep io_patch's (reads of a whole buffer bypass it)
+        io_setvbuf(asset->file, NULL, _IONBF, 0);
+        asset->rb_size = mode == AASSET_MODE_RANDOM    ? ASSET_READ_BUFFER_RANDOM :
+                         mode == AASSET_MODE_STREAMING ? ASSET_READ_BUFFER_STREAMING :
+                                                         ASSET_READ_BUFFER_DEFAULT;
+
+        // Pack entries and the FIOS stat cache answer this without a seek
+        long size = fios_asset_size(filename);
+        if (size < 0) {
+            io_fseek(asset->file, 0, SEEK_END);
+            size = io_ftell(asset->file);
+            io_fseek(asset->file, 0, SEEK_SET);
+        }
+        asset->length = size;
     }
 
-    debugPrintf("Android: Failed to open asset: %s\n", filename);
-    return NULL;
+    asset->stats = asset_stats_get(filename);
+    if (asset->stats) __atomic_fetch_add(&asset->stats->opens, 1, __ATOMIC_RELAXED);
+    return asset;
 }
 
 int AAsset_read(AAsset *asset, void *buf, size_t count) {
     if (!asset || !buf) return 0;
 
-    int bytes_read = fread(buf, 1, count, (FILE *)asset);
-    debugPrintf("Android: AAsset_read(%p, %zu) -> %d bytes\n", buf, count, bytes_read);
-    return bytes_read;
+    if (asset->trace_id >= 0 && asset->pos < asset->length) {
+        off_t left = asset->length - asset->pos;
+        asset_trace_read(asset->trace_id, asset->pos, count < (size_t)left ? count : (size_t)left);
+    }
+
+    if (!asset->buffer) return asset_stream_read(asset, buf, count);
+
+    off_t remaining = asset->length - asset->pos;
+    if (remaining <= 0) return 0;
+    if (count > (size_t)remaining) count = remaining;
+
+    memcpy(buf, (const uint8_t *)asset->buffer->data + asset->pos, count);
+    asset->pos += count;
+    asset_count_read(asset, count, 1);
+    return count;
 }
 
-off_t AAsset_seek(AAsset *asset, off_t offset, int whence) {
+// Only moves the logical position; streamed assets seek their FILE lazily
+int64_t AAsset_seek64(AAsset *asset, int64_t offset, int whence) {
     if (!asset) return -1;
 
-    int result = fseek((FILE *)asset, offset, whence);
-    debugPrintf("Android: AAsset_seek(%ld, %d) -> %d\n", offset, whence, result);
-    return result;
+    int64_t target;
+    switch (whence) {
+        case SEEK_SET: target = offset; break;
+        case SEEK_CUR: target = asset->pos + offset; break;
+        case SEEK_END: target = asset->length + offset; break;
+        default: return -1;
+    }
+
+    if (target < 0 || target > asset->length) return -1;
+    asset->pos = target;
+    return target;
 }
 
-off_t AAsset_getLength(AAsset *asset) {
-    if (!asset) return 0;
+off_t AAsset_seek(AAsset *asset, off_t offset, int whence) {
+    return (off_t)AAsset_seek64(asset, offset, whence);
+}
 
-    FILE *file = (FILE *)asset;
-    long current = ftell(file);
-    fseek(file, 0, SEEK_END);
-    long length = ftell(file);
-    fseek(file, current, SEEK_SET);
+int64_t AAsset_getLength64(AAsset *asset) {
+    return asset ? asset->length : 0;
+}
 
-    debugPrintf("Android: AAsset_getLength() -> %ld\n", length);
-    return length;
+off_t AAsset_getLength(AAsset *asset) {
+    return asset ? asset->length : 0;
+}
+
+int64_t AAsset_getRemainingLength64(AAsset *asset) {
+    return asset && asset->length > asset->pos ? asset->length - asset->pos : 0;
 }
 
 off_t AAsset_getRemainingLength(AAsset *asset) {
-    if (!asset) return 0;
+    return (off_t)AAsset_getRemainingLength64(asset);
+}
 
-    FILE *file = (FILE *)asset;
-    long current = ftell(file);
-    fseek(file, 0, SEEK_END);
-    long total = ftell(file);
-    fseek(file, current, SEEK_SET);
+const void *AAsset_getBuffer(AAsset *asset) {
+    if (!asset || asset_attach_buffer(asset) < 0) return NULL;
+    asset_trace_read(asset->trace_id, 0, asset->length);
+    return asset->buffer->data;
+}
 
-    long remaining = total - current;
-    debugPrintf("Android: AAsset_getRemainingLength() -> %ld\n", remaining);
-    return remaining;
+int AAsset_isAllocated(AAsset *asset) {
+    return asset && asset->buffer;
+}
+
+int AAsset_openFileDescriptor(AAsset *asset, off_t *outStart, off_t *outLength) {
+    // Packed assets have no file descriptor of their own
+    return -1;
 }
 
 void AAsset_close(AAsset *asset) {
-    debugPrintf("Android: AAsset_close()\n");
-    if (asset) {
-        fclose((FILE *)asset);
+    if (!asset) return;
+
+    if (asset->file) io_fclose(asset->file);
+    asset_cache_release(asset->buffer);
+    free(asset->rb);
+    free(asset->name);
+    free(asset);
+}
+
+// ===== ASSET DIRECTORIES =====
+
+// Listing snapshot taken at open from the FIOS directory index
+struct AAssetDir {
+    char *names;      // NUL-separated file names, sorted
+    size_t names_len;
+    size_t names_size;
+    size_t next;      // Offset of the next name to hand out
+    int truncated;    // Ran out of memory; the rest of the listing is dropped
+};
+
+static void asset_dir_add(const char *name, void *ctx) {
+    AAssetDir *dir = ctx;
+    size_t len = strlen(name) + 1;
+    if (dir->truncated) return;
+
+    if (dir->names_len + len > dir->names_size) {
+        size_t size = dir->names_size ? dir->names_size * 2 : 1024;
+        while (size < dir->names_len + len) size *= 2;
+        char *names = realloc(dir->names, size);
+        if (!names) {
+            dir->truncated = 1;
+            return;
+        }
+        dir->names = names;
+        dir->names_size = size;
+    }
+
+    memcpy(dir->names + dir->names_len, name, len);
+    dir->names_len += len;
+}
+
+AAssetDir *AAssetManager_openDir(AAssetManager *mgr, const char *dirName) {
+    AAssetDir *dir = calloc(1, sizeof(AAssetDir));
+    if (!dir) return NULL;
+
+    fios_asset_list(dirName ? dirName : "", asset_dir_add, dir);
+    if (dir->truncated) debugPrintf("Android: Asset listing of %s truncated\n", dirName);
+    return dir;
+}
+
+const char *AAssetDir_getNextFileName(AAssetDir *dir) {
+    if (!dir || dir->next >= dir->names_len) return NULL;
+
+    const char *name = dir->names + dir->next;
+    dir->next += strlen(name) + 1;
+    return name;
+}
+
+void AAssetDir_rewind(AAssetDir *dir) {
+    if (dir) dir->next = 0;
+}
+
+void AAssetDir_close(AAssetDir *dir) {
+    if (!dir) return;
+
+    free(dir->names);
+    free(dir);
+}
+
+static int asset_stats_compare(const void *a, const void *b) {
+    const AssetStats *x = *(const AssetStats * const *)a;
+    const AssetStats *y = *(const AssetStats * const *)b;
+    if (x->bytes_read != y->bytes_read) return x->bytes_read < y->bytes_read ? 1 : -1;
+    return (int)y->opens - (int)x->opens;
+}
+
+// Assets ranked by bytes read
+void android_asset_report(void) {
+    if (!asset_stats_ready) return;
+
+    AssetStats *ranked[ASSET_STATS_SLOTS];
+    int count = 0;
+
+    sceKernelLockLwMutex(&asset_stats_lock, 1, NULL);
+    for (int i = 0; i < ASSET_STATS_SLOTS; i++) {
+        if (asset_stats[i].name) ranked[count++] = &asset_stats[i];
     }
+    sceKernelUnlockLwMutex(&asset_stats_lock, 1);
+
+    qsort(ranked, count, sizeof(ranked[0]), asset_stats_compare);
+
+    debugPrintf("=== HOTTEST ASSETS (%d tracked) ===\n", count);
+    for (int i = 0; i < count && i < ASSET_REPORT_TOP; i++) {
+        const AssetStats *s = ranked[i];
+        debugPrintf("  %-40s %6u opens %7u reads (%u buffered) %8llu KB\n",
+                    s->name, s->opens, s->reads, s->buffered_reads, s->bytes_read / 1024);
+    }
+    debugPrintf("===================================\n");
 }
 
 // ===== ANDROID CONFIGURATION STUBS =====
@@ -617,6 +945,11 @@ void *AContentResolver_query(AContentResolver *resolver, const char *uri, const
                              // ===== INITIALIZATION FUNCTION =====
 
                              void android_patch_init() {
+                                 if (!asset_stats_ready &&
+                                     sceKernelCreateLwMutex(&asset_stats_lock, "asset_stats", 0, 0, NULL) >= 0) {
+                                     asset_stats_ready = 1;
+                                 }
+
                                  debugPrintf("Android: Android API bridge initialized (Enhanced GTA SA Vita + Successful Ports)\n");
                                  debugPrintf("Android: Comprehensive environment emulation enabled\n");
                                  debugPrintf("Android: FIOS integration active\n");
@@ -0,0 +1,492 @@
+/*
+ * asset_cache.c - Shared whole-asset buffers for Fluffy Diver
+ * An asset opened with AASSET_MODE_BUFFER (or asked for its buffer) is
+ * read once into an aligned allocation. Every open of the same name shares
+ * that buffer through a reference count, so hot assets are neither re-read
+ * nor copied.
+ *
+ * Released buffers stay cached on an LRU idle list. The byte budget
+ * (asset_cache_mb in config.txt) covers every cached buffer: referenced
+ * ones are never evicted, so idle buffers only get what they leave over,
+ * and the total exceeds the budget only while the game holds more than it
+ * by itself. A background thread on the loading core
+ * fills the same cache ahead of the game from prefetch requests and the
+ * hint list in ASSET_PREFETCH_LIST, so later opens never touch storage.
+ */
+
+#include <vitasdk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "asset_cache.h"
+#include "asset_pack.h"
+#include "config.h"
+#include "fios.h"
+#include "fios_sched.h"
+#include "io_patch.h"
+
+// External debug function
+extern void debugPrintf(const char *fmt, ...);
+
+#define ASSET_CACHE_BUCKETS 256
+
+// One asset name per line; '#' starts a comment
+#define ASSET_PREFETCH_LIST "ux0:data/fluffydiver/prefetch.txt"
+#define PREFETCH_QUEUE_SIZE 256
+#define PREFETCH_THREAD_PRIORITY 160 // Same class as the game's loaders
+#define PREFETCH_THREAD_STACK (64 * 1024)
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t prefetched;
+    uint32_t prefetch_hits; // First use of a prefetched buffer
+    uint64_t bytes_loaded;
+    uint64_t bytes_prefetched;
+    uint64_t hidden_us; // Load time of prefetched buffers that got used
+    uint32_t alias_hits; // Hits through another name for the same pack blob
+    uint64_t alias_bytes;
+} AssetCacheStats;
+
+static SceKernelLwMutexWork cache_lock;
+static AssetBuffer *cache_buckets[ASSET_CACHE_BUCKETS];
+static AssetBuffer *idle_head = NULL; // Least recently used
+static AssetBuffer *idle_tail = NULL;
+static size_t idle_bytes = 0;
+static size_t cache_budget = 0; // Referenced plus idle bytes
+static size_t cached_bytes = 0;
+static AssetCacheStats cache_stats;
+
+// Prefetch queue (names are owned by the queue)
+static SceKernelLwMutexWork prefetch_lock;
+static SceUID prefetch_sema = -1;
+static char *prefetch_queue[PREFETCH_QUEUE_SIZE];
+static int prefetch_head = 0;
+static int prefetch_count = 0;
+
+// ===== HELPERS (cache_lock held) =====
+
+// Aliases of one pack blob share a buffer, cached under the blob's first name
+static const char *cache_key(const char *name) {
+    while (*name == '/') name++;
+    const AssetPackEntry *entry = asset_pack_find(name);
+    return entry ? asset_pack_name(asset_pack_blob(entry)) : name;
+}
+
+static uint32_t asset_hash(const char *name) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static AssetBuffer *cache_lookup(const char *name, uint32_t hash) {
+    for (AssetBuffer *b = cache_buckets[hash % ASSET_CACHE_BUCKETS]; b; b = b->hash_next) {
+        if (b->hash == hash && strcmp(b->name, name) == 0) return b;
+    }
+    return NULL;
+}
+
+static void idle_unlink(AssetBuffer *b) {
+    if (b->idle_prev) b->idle_prev->idle_next = b->idle_next;
+    else idle_head = b->idle_next;
+    if (b->idle_next) b->idle_next->idle_prev = b->idle_prev;
+    else idle_tail = b->idle_prev;
+
+    b->idle_prev = b->idle_next = NULL;
+    idle_bytes -= b->size;
+}
+
+static void idle_append(AssetBuffer *b) {
+    b->idle_prev = idle_tail;
+    b->idle_next = NULL;
+    if (idle_tail) idle_tail->idle_next = b;
+    else idle_head = b;
+    idle_tail = b;
+    idle_bytes += b->size;
+}
+
+static void cache_evict(AssetBuffer *b) {
+    idle_unlink(b);
+
+    AssetBuffer **link = &cache_buckets[b->hash % ASSET_CACHE_BUCKETS];
+    while (*link != b) link = &(*link)->hash_next;
+    *link = b->hash_next;
+
+    cached_bytes -= b->size;
+    cache_stats.evictions++;
+    free((void *)b->data);
+    free(b->name);
+    free(b);
+}
+
+static void cache_trim_locked(size_t keep_bytes) {
+    while (idle_head && idle_bytes > keep_bytes) cache_evict(idle_head);
+}
+
+// Idle bytes the budget allows next to the referenced buffers
+static size_t idle_room_locked(void) {
+    size_t referenced = cached_bytes - idle_bytes;
+    return cache_budget > referenced ? cache_budget - referenced : 0;
+}
+
+// Take a reference on a cached buffer
+static void cache_ref(AssetBuffer *b) {
+    if (b->refs++ == 0) idle_unlink(b);
+    if (b->prefetched) {
+        b->prefetched = 0;
+        cache_stats.prefetch_hits++;
+        cache_stats.hidden_us += b->load_us;
+    }
+}
+
+static void cache_hit(AssetBuffer *b, const char *name) {
+    cache_ref(b);
+    cache_stats.hits++;
+
+    while (*name == '/') name++;
+    if (strcmp(name, b->name) != 0) {
+        cache_stats.alias_hits++;
+        cache_stats.alias_bytes += b->size;
+    }
+}
+
+// Insert a freshly loaded buffer, or return the copy another thread added first
+static AssetBuffer *cache_insert(AssetBuffer *fresh) {
+    AssetBuffer *b = cache_lookup(fresh->name, fresh->hash);
+    if (b) return b;
+
+    fresh->hash_next = cache_buckets[fresh->hash % ASSET_CACHE_BUCKETS];
+    cache_buckets[fresh->hash % ASSET_CACHE_BUCKETS] = fresh;
+    cached_bytes += fresh->size;
+    cache_stats.bytes_loaded += fresh->size;
+    return fresh;
+}
+
+static void buffer_free(AssetBuffer *b) {
+    free((void *)b->data);
+    free(b->name);
+    free(b);
+}
+
+// ===== LOADING =====
+
+// Aligned allocation; on failure give back every idle buffer and retry once
+static void *asset_alloc(size_t size) {
+    void *data = memalign(ASSET_CACHE_ALIGN, size ? size : 1);
+    if (data) return data;
+
+    sceKernelLockLwMutex(&cache_lock, 1, NULL);
+    cache_trim_locked(0);
+    sceKernelUnlockLwMutex(&cache_lock, 1);
+
+    return memalign(ASSET_CACHE_ALIGN, size ? size : 1);
+}
+
+static void *asset_load(const char *name, size_t *size) {
+    const AssetPackEntry *entry = asset_pack_find(name);
+    if (entry) {
+        void *data = asset_alloc(entry->raw_size);
+        if (data && asset_pack_load(entry, data) == 0) {
+            *size = entry->raw_size;
+            return data;
+        }
+        free(data);
+        return NULL;
+    }
+
+    FILE *file = fios_asset_open(name, "rb");
+    if (!file) return NULL;
+
+    io_fseek(file, 0, SEEK_END);
+    long length = io_ftell(file);
+    io_fseek(file, 0, SEEK_SET);
+
+    void *data = length >= 0 ? asset_alloc(length) : NULL;
+    if (data && io_fread(data, 1, length, file) != (size_t)length) {
+        free(data);
+        data = NULL;
+    }
+    io_fclose(file);
+
+    *size = length;
+    return data;
+}
+
+// Load name into a new, unlinked buffer
+static AssetBuffer *buffer_load(const char *name, uint32_t hash) {
+    SceUInt64 start = sceKernelGetProcessTimeWide();
+    size_t size = 0;
+    void *data = asset_load(name, &size);
+    if (!data) return NULL;
+
+    AssetBuffer *b = calloc(1, sizeof(AssetBuffer));
+    char *copy = strdup(name);
+    if (!b || !copy) {
+        free(b);
+        free(copy);
+        free(data);
+        return NULL;
+    }
+
+    b->data = data;
+    b->size = size;
+    b->name = copy;
+    b->hash = hash;
+    b->load_us = (uint32_t)(sceKernelGetProcessTimeWide() - start);
+    return b;
+}
+
+// ===== PREFETCH =====
+
+// Park a loaded buffer at the MRU end of the idle list; frees it if it
+// lost a race with another load or doesn't fit beside the referenced buffers
+static int cache_insert_prefetched(AssetBuffer *fresh) {
+    sceKernelLockLwMutex(&cache_lock, 1, NULL);
+    int inserted = fresh->size <= idle_room_locked() && cache_insert(fresh) == fresh;
+    if (inserted) {
+        fresh->prefetched = 1;
+        idle_append(fresh);
+        cache_stats.prefetched++;
+        cache_stats.bytes_prefetched += fresh->size;
+        cache_trim_locked(idle_room_locked());
+    }
+    sceKernelUnlockLwMutex(&cache_lock, 1);
+
+    if (!inserted) buffer_free(fresh);
+    return inserted ? 0 : -1;
+}
+
+static int prefetch_thread(SceSize args, void *argp) {
+    fios_sched_set_thread_class(0, FIOS_CLASS_PREFETCH);
+
+    for (;;) {
+        if (sceKernelWaitSema(prefetch_sema, 1, NULL) < 0) break;
+
+        sceKernelLockLwMutex(&prefetch_lock, 1, NULL);
+        char *name = NULL;
+        if (prefetch_count) {
+            name = prefetch_queue[prefetch_head];
+            prefetch_head = (prefetch_head + 1) % PREFETCH_QUEUE_SIZE;
+            prefetch_count--;
+        }
+        sceKernelUnlockLwMutex(&prefetch_lock, 1);
+        if (!name) continue;
+
+        asset_cache_preload(name);
+        free(name);
+    }
+
+    fios_sched_thread_exit(0);
+    return sceKernelExitDeleteThread(0);
+}
+
+int asset_cache_preload(const char *name) {
+    if (!name || !cache_budget) return -1;
+    name = cache_key(name);
+    if (asset_cache_contains(name)) return 0;
+
+    AssetBuffer *fresh = buffer_load(name, asset_hash(name));
+    if (!fresh) return -1;
+
+    size_t size = fresh->size;
+    return cache_insert_prefetched(fresh) == 0 ? (int)size : -1;
+}
+
+int asset_cache_insert(const char *name, void *data, size_t size, uint32_t load_us) {
+    AssetBuffer *b = name ? calloc(1, sizeof(AssetBuffer)) : NULL;
+    char *copy = name ? strdup(cache_key(name)) : NULL;
+    if (!b || !copy || !cache_budget) {
+        free(b);
+        free(copy);
+        free(data);
+        return -1;
+    }
+
+    b->data = data;
+    b->size = size;
+    b->name = copy;
+    b->hash = asset_hash(copy);
+    b->load_us = load_us;
+    return cache_insert_prefetched(b);
+}
+
+int asset_cache_contains(const char *name) {
+    if (!name) return 0;
+    name = cache_key(name);
+    uint32_t hash = asset_hash(name);
+
+    sceKernelLockLwMutex(&cache_lock, 1, NULL);
+    int found = cache_lookup(name, hash) != NULL;
+    sceKernelUnlockLwMutex(&cache_lock, 1);
+    return found;
+}
+
+size_t asset_cache_budget(void) {
+    return cache_budget;
+}
+
+int asset_cache_prefetch(const char *name) {
+    if (!name || prefetch_sema < 0) return -1;
+    while (*name == '/') name++;
+
+    char *copy = strdup(name);
+    if (!copy) return -1;
+
+    sceKernelLockLwMutex(&prefetch_lock, 1, NULL);
+    int queued = prefetch_count < PREFETCH_QUEUE_SIZE;
+    if (queued) {
+        prefetch_queue[(prefetch_head + prefetch_count) % PREFETCH_QUEUE_SIZE] = copy;
+        prefetch_count++;
+    }
+    sceKernelUnlockLwMutex(&prefetch_lock, 1);
+
+    if (!queued) {
+        free(copy);
+        return -1;
+    }
+
+    sceKernelSignalSema(prefetch_sema, 1);
+    return 0;
+}
+
+static void prefetch_load_hints(void) {
+    FILE *file = fopen(ASSET_PREFETCH_LIST, "r");
+    if (!file) return;
+
+    char line[FIOS_PATH_MAX];
+    int count = 0;
+    while (fgets(line, sizeof(line), file)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (!line[0] || line[0] == '#') continue;
+        if (asset_cache_prefetch(line) == 0) count++;
+    }
+    fclose(file);
+
+    debugPrintf("Assets: Queued %d prefetch hints from %s\n", count, ASSET_PREFETCH_LIST);
+}
+
+// ===== PUBLIC API =====
+
+void asset_cache_init(void) {
+    if (sceKernelCreateLwMutex(&cache_lock, "asset_cache", 0, 0, NULL) < 0 ||
+        sceKernelCreateLwMutex(&prefetch_lock, "asset_prefetch", 0, 0, NULL) < 0) {
+        debugPrintf("Assets: ERROR - Cannot create cache locks\n");
+        return;
+    }
+    memset(cache_buckets, 0, sizeof(cache_buckets));
+    memset(&cache_stats, 0, sizeof(cache_stats));
+
+    int mb = config_get_asset_cache_mb();
+    cache_budget = mb > 0 ? (size_t)mb * 1024 * 1024 : 0;
+    if (!cache_budget) {
+        debugPrintf("Assets: Buffer cache holds referenced assets only, prefetch off\n");
+        return;
+    }
+
+    // Prefetching runs on the loading core, away from rendering on core 0
+    prefetch_sema = sceKernelCreateSema("asset_prefetch", 0, 0, PREFETCH_QUEUE_SIZE, NULL);
+    SceUID thid = prefetch_sema >= 0 ?
+        sceKernelCreateThread("asset_prefetch", prefetch_thread, PREFETCH_THREAD_PRIORITY,
+                              PREFETCH_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL) : -1;
+    if (thid < 0 || sceKernelStartThread(thid, 0, NULL) < 0) {
+        debugPrintf("Assets: ERROR - Cannot start prefetch thread\n");
+        if (prefetch_sema >= 0) sceKernelDeleteSema(prefetch_sema);
+        prefetch_sema = -1;
+    }
+
+    debugPrintf("Assets: Buffer cache budget %d MB\n", mb);
+    prefetch_load_hints();
+}
+
+AssetBuffer *asset_cache_acquire(const char *name) {
+    if (!name) return NULL;
+    const char *key = cache_key(name);
+    uint32_t hash = asset_hash(key);
+
+    sceKernelLockLwMutex(&cache_lock, 1, NULL);
+    AssetBuffer *b = cache_lookup(key, hash);
+    if (b) {
+        cache_hit(b, name);
+        sceKernelUnlockLwMutex(&cache_lock, 1);
+        return b;
+    }
+    cache_stats.misses++;
+    sceKernelUnlockLwMutex(&cache_lock, 1);
+
+    // Load without the lock; another thread may load the same asset meanwhile
+    AssetBuffer *fresh = buffer_load(key, hash);
+    if (!fresh) {
+        debugPrintf("Assets: Cannot load %s\n", name);
+        return NULL;
+    }
+
+    sceKernelLockLwMutex(&cache_lock, 1, NULL);
+    b = cache_insert(fresh);
+    if (b == fresh) b->refs = 1;
+    else cache_ref(b);
+    sceKernelUnlockLwMutex(&cache_lock, 1);
+
+    if (b != fresh) buffer_free(fresh);
+    return b;
+}
+
+AssetBuffer *asset_cache_lookup(const char *name) {
+    if (!name) return NULL;
+    const char *key = cache_key(name);
+    uint32_t hash = asset_hash(key);
+
+    sceKernelLockLwMutex(&cache_lock, 1, NULL);
+    AssetBuffer *b = cache_lookup(key, hash);
+    if (b) cache_hit(b, name);
+    else cache_stats.misses++;
+    sceKernelUnlockLwMutex(&cache_lock, 1);
+    return b;
+}
+
+void asset_cache_release(AssetBuffer *buffer) {
+    if (!buffer) return;
+
+    sceKernelLockLwMutex(&cache_lock, 1, NULL);
+    if (--buffer->refs == 0) {
+        idle_append(buffer);
+        cache_trim_locked(idle_room_locked());
+    }
+    sceKernelUnlockLwMutex(&cache_lock, 1);
+}
+
+void asset_cache_trim(size_t keep_bytes) {
+    sceKernelLockLwMutex(&cache_lock, 1, NULL);
+    cache_trim_locked(keep_bytes);
+    sceKernelUnlockLwMutex(&cache_lock, 1);
+}
+
+void asset_cache_report(void) {
+    sceKernelLockLwMutex(&cache_lock, 1, NULL);
+    AssetCacheStats stats = cache_stats;
+    size_t total = cached_bytes;
+    size_t idle = idle_bytes;
+    sceKernelUnlockLwMutex(&cache_lock, 1);
+
+    uint32_t lookups = stats.hits + stats.misses;
+    debugPrintf("=== ASSET BUFFER CACHE ===\n");
+    debugPrintf("  lookups: %u, hits: %u (%u%%), misses: %u, evictions: %u\n",
+                lookups, stats.hits, lookups ? stats.hits * 100 / lookups : 0,
+                stats.misses, stats.evictions);
+    debugPrintf("  cached: %u KB (%u KB idle, budget %u KB), loaded: %llu KB\n",
+                (unsigned)(total / 1024), (unsigned)(idle / 1024),
+                (unsigned)(cache_budget / 1024), stats.bytes_loaded / 1024);
+    debugPrintf("  prefetched: %u assets, %llu KB, %u used before eviction (%llu ms of loading hidden)\n",
+                stats.prefetched, stats.bytes_prefetched / 1024, stats.prefetch_hits,
+                stats.hidden_us / 1000);
+    if (stats.alias_hits) {
+        debugPrintf("  aliases: %u hits shared another name's buffer, %llu KB not loaded twice\n",
+                    stats.alias_hits, stats.alias_bytes / 1024);
+    }
+    debugPrintf("==========================\n");
+}
@@ -0,0 +1,502 @@
+/*
+ * asset_pack.c - Indexed asset pack reader for Fluffy Diver
+ * Loose assets cost a memory card directory walk per open. The pack keeps
+ * every asset in one file: the index is loaded once at startup, opening
+ * an asset is a binary search over the sorted hashes, and reads are
+ * sceIoPread calls (through the FIOS scheduler) at the entry's offset in
+ * the single open handle.
+ *
+ * Entries may be stored deflated (zlib); those are inflated into memory
+ * when opened. Large entries are better stored chunked: a seek table maps
+ * a position to its chunk, so a stream inflates only the chunks it reads,
+ * and recently inflated chunks are kept in a small shared cache.
+ *
+ * The builder stores byte-identical files once; their entries all point at
+ * the same data. asset_pack_blob() maps each of them to the first one, so
+ * caches keyed on it hold one copy for every alias.
+ */
+
+#include <vitasdk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "asset_pack.h"
+#include "fios_sched.h"
+
+// funopen streams get a bigger buffer than newlib's default BUFSIZ
+#define ASSET_STREAM_BUFFER (16 * 1024)
+
+// Sanity bound for the index of a corrupt pack
+#define ASSET_PACK_MAX_ENTRIES (1 << 20)
+
+// Inflated chunks shared by all chunked streams
+#define ASSET_CHUNK_CACHE_SLOTS 8
+
+typedef struct {
+    const AssetPackEntry *entry;
+    uint8_t *data;    // Inflated contents for deflated entries, NULL otherwise
+    uint32_t *chunks; // Seek table for chunked entries, NULL otherwise
+    uint32_t pos;
+} AssetPackStream;
+
+typedef struct {
+    const AssetPackEntry *entry; // NULL when free
+    uint32_t index;
+    uint32_t size;
+    uint32_t stamp; // Last use, for LRU replacement
+    uint8_t *data;
+} AssetChunkSlot;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint64_t bytes_read;     // Stored bytes read for misses
+    uint64_t bytes_inflated;
+} AssetChunkStats;
+
+static SceUID pack_fd = -1;
+static AssetPackEntry *pack_toc = NULL;
+static char *pack_names = NULL;
+static uint32_t pack_count = 0;
+static uint32_t pack_chunk_size = 0;
+static uint32_t *pack_blob = NULL; // Per entry, index of the entry owning its data
+
+static SceKernelLwMutexWork chunk_lock;
+static int chunk_lock_ready = 0;
+static AssetChunkSlot chunk_slots[ASSET_CHUNK_CACHE_SLOTS];
+static uint8_t *chunk_scratch = NULL; // Stored bytes of the chunk being inflated
+static uint32_t chunk_clock = 0;
+static AssetChunkStats chunk_stats;
+
+static void chunk_cache_free(void);
+
+// ===== INDEX =====
+
+static uint32_t asset_pack_hash(const char *name) {
+    uint32_t hash = 2166136261u; // FNV-1a, matches tools/pack_assets.py
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int blob_compare(const void *a, const void *b) {
+    const AssetPackEntry *x = &pack_toc[*(const uint32_t *)a];
+    const AssetPackEntry *y = &pack_toc[*(const uint32_t *)b];
+    if (x->offset != y->offset) return x->offset < y->offset ? -1 : 1;
+    if (x->size != y->size) return x->size < y->size ? -1 : 1;
+    return *(const uint32_t *)a < *(const uint32_t *)b ? -1 : 1;
+}
+
+// Group entries by data offset and size (an empty entry may sit at the next
+// one's offset); the first of each group owns the blob
+static int blob_index_build(uint32_t count, uint64_t *saved) {
+    pack_blob = malloc((count ? count : 1) * sizeof(uint32_t));
+    uint32_t *order = malloc((count ? count : 1) * sizeof(uint32_t));
+    if (!pack_blob || !order) {
+        free(order);
+        return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) order[i] = i;
+    qsort(order, count, sizeof(uint32_t), blob_compare);
+
+    uint32_t aliases = 0;
+    *saved = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t owner = order[i];
+        const AssetPackEntry *prev = i > 0 ? &pack_toc[order[i - 1]] : NULL;
+        if (prev && prev->offset == pack_toc[owner].offset && prev->size == pack_toc[owner].size) {
+            owner = pack_blob[order[i - 1]];
+            aliases++;
+            *saved += pack_toc[order[i]].size;
+        }
+        pack_blob[order[i]] = owner;
+    }
+
+    free(order);
+    return aliases;
+}
+
+int asset_pack_init(const char *path) {
+    asset_pack_close();
+
+    if (!chunk_lock_ready) {
+        chunk_lock_ready = sceKernelCreateLwMutex(&chunk_lock, "asset_chunks", 0, 0, NULL) >= 0;
+    }
+
+    pack_fd = sceIoOpen(path, SCE_O_RDONLY, 0);
+    if (pack_fd < 0) {
+        printf("FIOS: No asset pack at %s, using loose assets\n", path);
+        pack_fd = -1;
+        return -1;
+    }
+
+    AssetPackHeader header;
+    if (asset_pack_read(&header, sizeof(header), 0) < 0 ||
+        header.magic != ASSET_PACK_MAGIC || header.version < 1 || header.version > ASSET_PACK_VERSION ||
+        header.count > ASSET_PACK_MAX_ENTRIES || (header.count && !header.names_size)) {
+        printf("FIOS: ERROR - %s is not a version %d asset pack\n", path, ASSET_PACK_VERSION);
+        asset_pack_close();
+        return -1;
+    }
+
+    if (header.version < 2) header.chunk_size = 0;
+    if (header.chunk_size > ASSET_PACK_CHUNK_MAX) {
+        printf("FIOS: ERROR - Asset pack chunk size %u is too large\n", header.chunk_size);
+        asset_pack_close();
+        return -1;
+    }
+
+    pack_toc = malloc(header.count * sizeof(AssetPackEntry));
+    pack_names = malloc(header.names_size);
+    if (!pack_toc || !pack_names ||
+        asset_pack_read(pack_toc, header.count * sizeof(AssetPackEntry), header.toc_offset) < 0 ||
+        asset_pack_read(pack_names, header.names_size, header.names_offset) < 0) {
+        printf("FIOS: ERROR - Cannot load asset pack index\n");
+        asset_pack_close();
+        return -1;
+    }
+
+    // Names are trusted only up to the table's end
+    if (header.names_size) pack_names[header.names_size - 1] = '\0';
+    for (uint32_t i = 0; i < header.count; i++) {
+        if (pack_toc[i].name_offset >= header.names_size) pack_toc[i].name_offset = header.names_size - 1;
+        if (!header.chunk_size) pack_toc[i].flags &= ~ASSET_PACK_CHUNKED;
+    }
+
+    uint64_t saved = 0;
+    int aliases = blob_index_build(header.count, &saved);
+    if (aliases < 0) {
+        printf("FIOS: ERROR - Cannot index asset pack blobs\n");
+        asset_pack_close();
+        return -1;
+    }
+
+    pack_count = header.count;
+    pack_chunk_size = header.chunk_size;
+    printf("FIOS: Asset pack loaded: %u entries, %d aliases of shared data (%llu KB saved) (%s)\n",
+           pack_count, aliases, saved / 1024, path);
+    return 0;
+}
+
+void asset_pack_close(void) {
+    if (pack_fd >= 0) sceIoClose(pack_fd);
+    pack_fd = -1;
+
+    free(pack_toc);
+    free(pack_names);
+    free(pack_blob);
+    pack_toc = NULL;
+    pack_names = NULL;
+    pack_blob = NULL;
+    pack_count = 0;
+    pack_chunk_size = 0;
+    chunk_cache_free();
+}
+
+int asset_pack_read(void *dst, uint32_t size, uint32_t offset) {
+    uint8_t *out = dst;
+    while (size) {
+        int ret = fios_sched_pread(pack_fd, out, size, offset);
+        if (ret <= 0) return -1;
+        out += ret;
+        offset += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+const AssetPackEntry *asset_pack_find(const char *name) {
+    if (!pack_count || !name) return NULL;
+
+    while (*name == '/') name++;
+    uint32_t hash = asset_pack_hash(name);
+
+    // Lower bound on the hash, then walk the (rare) collisions
+    uint32_t lo = 0, hi = pack_count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (pack_toc[mid].hash < hash) lo = mid + 1;
+        else hi = mid;
+    }
+
+    for (; lo < pack_count && pack_toc[lo].hash == hash; lo++) {
+        if (strcmp(pack_names + pack_toc[lo].name_offset, name) == 0) return &pack_toc[lo];
+    }
+    return NULL;
+}
+
+const char *asset_pack_name(const AssetPackEntry *entry) {
+    return pack_names + entry->name_offset;
+}
+
+uint32_t asset_pack_count(void) {
+    return pack_count;
+}
+
+const AssetPackEntry *asset_pack_entry(uint32_t index) {
+    return index < pack_count ? &pack_toc[index] : NULL;
+}
+
+const AssetPackEntry *asset_pack_blob(const AssetPackEntry *entry) {
+    return &pack_toc[pack_blob[entry - pack_toc]];
+}
+
+// ===== CHUNKS =====
+
+static uint32_t chunk_count(const AssetPackEntry *entry) {
+    return (entry->raw_size + pack_chunk_size - 1) / pack_chunk_size;
+}
+
+static uint32_t chunk_raw_size(const AssetPackEntry *entry, uint32_t index) {
+    uint32_t start = index * pack_chunk_size;
+    return entry->raw_size - start < pack_chunk_size ? entry->raw_size - start : pack_chunk_size;
+}
+
+// Offsets must start after the table, never shrink, end at the stored size,
+// and no chunk may be stored larger than it inflates to
+static int chunk_table_valid(const AssetPackEntry *entry, const uint32_t *table) {
+    uint32_t count = chunk_count(entry);
+    if (table[0] != (count + 1) * sizeof(uint32_t) || table[count] != entry->size) return 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (table[i + 1] < table[i] || table[i + 1] - table[i] > chunk_raw_size(entry, i)) return 0;
+    }
+    return 1;
+}
+
+static int chunk_inflate(const AssetPackEntry *entry, uint32_t index, const uint8_t *stored,
+                         uint32_t stored_size, uint8_t *dst) {
+    uint32_t raw_size = chunk_raw_size(entry, index);
+    if (stored_size == raw_size) {
+        memcpy(dst, stored, raw_size);
+        return 0;
+    }
+
+    uLongf out_size = raw_size;
+    if (uncompress(dst, &out_size, stored, stored_size) != Z_OK || out_size != raw_size) {
+        printf("FIOS: ERROR - Cannot inflate chunk %u of %s\n", index, asset_pack_name(entry));
+        return -1;
+    }
+    return 0;
+}
+
+// Inflated chunk from the cache, filling the least recently used slot on a
+// miss (chunk_lock held)
+static AssetChunkSlot *chunk_get(const AssetPackEntry *entry, const uint32_t *table, uint32_t index) {
+    AssetChunkSlot *victim = &chunk_slots[0];
+    for (int i = 0; i < ASSET_CHUNK_CACHE_SLOTS; i++) {
+        AssetChunkSlot *slot = &chunk_slots[i];
+        if (slot->entry == entry && slot->index == index) {
+            slot->stamp = ++chunk_clock;
+            chunk_stats.hits++;
+            return slot;
+        }
+        if (!slot->entry || (victim->entry && slot->stamp < victim->stamp)) victim = slot;
+    }
+
+    if (!victim->data) victim->data = malloc(pack_chunk_size);
+    if (!chunk_scratch) chunk_scratch = malloc(pack_chunk_size);
+    if (!victim->data || !chunk_scratch) return NULL;
+
+    uint32_t stored_size = table[index + 1] - table[index];
+    victim->entry = NULL;
+    if (asset_pack_read(chunk_scratch, stored_size, entry->offset + table[index]) < 0 ||
+        chunk_inflate(entry, index, chunk_scratch, stored_size, victim->data) < 0) {
+        return NULL;
+    }
+
+    victim->entry = entry;
+    victim->index = index;
+    victim->size = chunk_raw_size(entry, index);
+    victim->stamp = ++chunk_clock;
+    chunk_stats.misses++;
+    chunk_stats.bytes_read += stored_size;
+    chunk_stats.bytes_inflated += victim->size;
+    return victim;
+}
+
+static void chunk_cache_free(void) {
+    for (int i = 0; i < ASSET_CHUNK_CACHE_SLOTS; i++) {
+        free(chunk_slots[i].data);
+        chunk_slots[i].data = NULL;
+        chunk_slots[i].entry = NULL;
+    }
+    free(chunk_scratch);
+    chunk_scratch = NULL;
+}
+
+// ===== WHOLE ASSETS =====
+
+int asset_pack_decode(const AssetPackEntry *entry, const void *stored, void *dst) {
+    if (entry->flags & ASSET_PACK_CHUNKED) {
+        const uint32_t *table = stored;
+        uint32_t table_size = (chunk_count(entry) + 1) * sizeof(uint32_t);
+        if (table_size > entry->size || !chunk_table_valid(entry, table)) {
+            printf("FIOS: ERROR - Bad chunk table in asset %s\n", asset_pack_name(entry));
+            return -1;
+        }
+
+        for (uint32_t i = 0; i < chunk_count(entry); i++) {
+            if (chunk_inflate(entry, i, (const uint8_t *)stored + table[i], table[i + 1] - table[i],
+                              (uint8_t *)dst + i * pack_chunk_size) < 0) {
+                return -1;
+            }
+        }
+        return 0;
+    }
+
+    if (!(entry->flags & ASSET_PACK_DEFLATE)) {
+        if (dst != stored) memcpy(dst, stored, entry->size);
+        return 0;
+    }
+
+    uLongf raw_size = entry->raw_size;
+    if (uncompress(dst, &raw_size, stored, entry->size) != Z_OK || raw_size != entry->raw_size) {
+        printf("FIOS: ERROR - Cannot inflate asset %s\n", asset_pack_name(entry));
+        return -1;
+    }
+    return 0;
+}
+
+int asset_pack_load(const AssetPackEntry *entry, void *dst) {
+    if (!(entry->flags & (ASSET_PACK_DEFLATE | ASSET_PACK_CHUNKED))) {
+        return asset_pack_read(dst, entry->size, entry->offset);
+    }
+
+    void *packed = malloc(entry->size);
+    if (!packed) return -1;
+
+    int ret = -1;
+    if (asset_pack_read(packed, entry->size, entry->offset) == 0) {
+        ret = asset_pack_decode(entry, packed, dst);
+    }
+
+    free(packed);
+    return ret;
+}
+
+// ===== STREAMS =====
+
+static int asset_stream_read_chunked(AssetPackStream *s, char *buf, uint32_t count) {
+    uint32_t done = 0;
+
+    // One lock for the lookup and the copy, so the slot can't be refilled under us
+    sceKernelLockLwMutex(&chunk_lock, 1, NULL);
+    while (done < count) {
+        uint32_t index = s->pos / pack_chunk_size;
+        AssetChunkSlot *slot = chunk_get(s->entry, s->chunks, index);
+        if (!slot) break;
+
+        uint32_t off = s->pos - index * pack_chunk_size;
+        uint32_t take = slot->size - off < count - done ? slot->size - off : count - done;
+        memcpy(buf + done, slot->data + off, take);
+        s->pos += take;
+        done += take;
+    }
+    sceKernelUnlockLwMutex(&chunk_lock, 1);
+
+    return done ? (int)done : -1;
+}
+
+static int asset_stream_read(void *cookie, char *buf, int n) {
+    AssetPackStream *s = cookie;
+    uint32_t left = s->entry->raw_size - s->pos;
+    uint32_t count = (uint32_t)n < left ? (uint32_t)n : left;
+    if (!count) return 0;
+
+    if (s->chunks) return asset_stream_read_chunked(s, buf, count);
+
+    if (s->data) {
+        memcpy(buf, s->data + s->pos, count);
+    } else {
+        int ret = fios_sched_pread(pack_fd, buf, count, s->entry->offset + s->pos);
+        if (ret < 0) return -1;
+        count = ret;
+    }
+
+    s->pos += count;
+    return count;
+}
+
+static fpos_t asset_stream_seek(void *cookie, fpos_t offset, int whence) {
+    AssetPackStream *s = cookie;
+    long long target;
+
+    switch (whence) {
+        case SEEK_SET: target = offset; break;
+        case SEEK_CUR: target = (long long)s->pos + offset; break;
+        case SEEK_END: target = (long long)s->entry->raw_size + offset; break;
+        default: return -1;
+    }
+
+    if (target < 0 || target > s->entry->raw_size) return -1;
+    s->pos = (uint32_t)target;
+    return s->pos;
+}
+
+static int asset_stream_close(void *cookie) {
+    AssetPackStream *s = cookie;
+    free(s->data);
+    free(s->chunks);
+    free(s);
+    return 0;
+}
+
+FILE *asset_pack_fopen(const AssetPackEntry *entry) {
+    AssetPackStream *s = calloc(1, sizeof(AssetPackStream));
+    if (!s) return NULL;
+
+    // Aliases share inflated chunks
+    entry = asset_pack_blob(entry);
+    s->entry = entry;
+
+    if (entry->flags & ASSET_PACK_CHUNKED) {
+        uint32_t table_size = (chunk_count(entry) + 1) * sizeof(uint32_t);
+        s->chunks = malloc(table_size);
+        if (!chunk_lock_ready || !s->chunks || table_size > entry->size ||
+            asset_pack_read(s->chunks, table_size, entry->offset) < 0 ||
+            !chunk_table_valid(entry, s->chunks)) {
+            printf("FIOS: ERROR - Bad chunk table in asset %s\n", asset_pack_name(entry));
+            asset_stream_close(s);
+            return NULL;
+        }
+    } else if (entry->flags & ASSET_PACK_DEFLATE) {
+        s->data = malloc(entry->raw_size ? entry->raw_size : 1);
+        if (!s->data || asset_pack_load(entry, s->data) < 0) {
+            free(s->data);
+            free(s);
+            return NULL;
+        }
+    }
+
+    FILE *file = funopen(s, asset_stream_read, NULL, asset_stream_seek, asset_stream_close);
+    if (!file) {
+        asset_stream_close(s);
+        return NULL;
+    }
+
+    // Deflated entries are already in memory; the others read through a larger buffer
+    if (!s->data) setvbuf(file, NULL, _IOFBF, ASSET_STREAM_BUFFER);
+    return file;
+}
+
+void asset_pack_report(void) {
+    if (!pack_chunk_size) return;
+
+    sceKernelLockLwMutex(&chunk_lock, 1, NULL);
+    AssetChunkStats stats = chunk_stats;
+    sceKernelUnlockLwMutex(&chunk_lock, 1);
+
+    uint32_t lookups = stats.hits + stats.misses;
+    printf("=== ASSET PACK CHUNKS ===\n");
+    printf("  chunk size: %u KB, lookups: %u, hits: %u (%u%%)\n", pack_chunk_size / 1024,
+           lookups, stats.hits, lookups ? stats.hits * 100 / lookups : 0);
+    printf("  read: %llu KB stored -> %llu KB inflated\n",
+           stats.bytes_read / 1024, stats.bytes_inflated / 1024);
+    printf("=========================\n");
+}
@@ -0,0 +1,445 @@
+/*
+ * asset_trace.c - Boot asset trace and replay for Fluffy Diver
+ * The game opens the same assets in the same order at every launch. For
+ * the first ASSET_TRACE_WINDOW_MS of a run every AAsset open and read is
+ * recorded (path, offset, length, ms since startup) and then written to
+ * ASSET_TRACE_PATH.
+ *
+ * On the next launch a thread on the loading core replays that trace into
+ * the asset buffer cache ahead of the game. Pack entries that sit next to
+ * each other in the pack are fetched with one large read; loose files are
+ * read whole. The report compares when the game reached the last traced
+ * asset against the previous launch.
+ */
+
+#include <vitasdk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "asset_trace.h"
+#include "asset_cache.h"
+#include "asset_pack.h"
+#include "fios.h"
+#include "fios_sched.h"
+
+// External debug function
+extern void debugPrintf(const char *fmt, ...);
+
+#define ASSET_TRACE_WINDOW_MS (45 * 1000) // Boot plus the first level load
+#define ASSET_TRACE_EVENTS 8192
+#define ASSET_TRACE_NAMES 1024 // Power of two
+#define ASSET_TRACE_SLOTS (ASSET_TRACE_NAMES * 2)
+
+// Replay read merging: entries closer than the gap share one read, up to the span
+#define ASSET_TRACE_GAP_MAX (4 * 1024)
+#define ASSET_TRACE_SPAN_MAX (1024 * 1024)
+
+#define ASSET_TRACE_THREAD_PRIORITY 160
+#define ASSET_TRACE_THREAD_STACK (64 * 1024)
+
+typedef struct {
+    uint32_t time_ms;
+    uint32_t name_id;
+    uint32_t offset;
+    uint32_t length;
+    int ready;
+} AssetTraceEvent;
+
+typedef struct {
+    char *name;
+    uint32_t time_ms; // First access in the previous launch
+    const AssetPackEntry *entry;
+    int done;
+} AssetReplayItem;
+
+typedef struct {
+    uint32_t assets;
+    uint32_t reads;
+    uint32_t merged; // Assets that came in with another asset's read
+    uint64_t bytes;
+    uint32_t start_ms;
+    uint32_t end_ms;
+} AssetReplayStats;
+
+// Recording
+static SceKernelLwMutexWork trace_lock;
+static int trace_ready = 0;
+static volatile int trace_recording = 0;
+static int trace_saved = 0;
+static AssetTraceEvent trace_events[ASSET_TRACE_EVENTS];
+static uint32_t trace_event_count = 0;
+static char *trace_names[ASSET_TRACE_NAMES];
+static uint32_t trace_name_hash[ASSET_TRACE_NAMES];
+static int trace_last_event[ASSET_TRACE_NAMES]; // Per name, to extend sequential reads
+static int trace_name_slots[ASSET_TRACE_SLOTS]; // id + 1, 0 when free
+static uint32_t trace_name_count = 0;
+
+// Replay of the previous launch
+static AssetReplayItem *replay_items = NULL;
+static uint32_t replay_count = 0;
+static AssetReplayStats replay_stats;
+static const char *mark_name = NULL; // Last asset the previous launch reached
+static uint32_t mark_traced_ms = 0;
+static volatile uint32_t mark_now_ms = 0;
+
+static uint32_t trace_now_ms(void) {
+    return (uint32_t)(sceKernelGetProcessTimeWide() / 1000);
+}
+
+static uint32_t trace_hash(const char *name) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// ===== RECORDING =====
+
+static void trace_record(uint32_t id, uint32_t offset, uint32_t length) {
+    uint32_t now = trace_now_ms();
+    if (now > ASSET_TRACE_WINDOW_MS) {
+        trace_recording = 0;
+        return;
+    }
+
+    // Continue the name's previous read when this one starts where it ended
+    int last = __atomic_load_n(&trace_last_event[id], __ATOMIC_ACQUIRE) - 1;
+    if (last >= 0 && length) {
+        AssetTraceEvent *e = &trace_events[last];
+        if (e->offset + e->length == offset) {
+            __atomic_fetch_add(&e->length, length, __ATOMIC_RELAXED);
+            return;
+        }
+    }
+
+    uint32_t index = __atomic_fetch_add(&trace_event_count, 1, __ATOMIC_RELAXED);
+    if (index >= ASSET_TRACE_EVENTS) {
+        trace_recording = 0;
+        return;
+    }
+
+    AssetTraceEvent *e = &trace_events[index];
+    e->time_ms = now;
+    e->name_id = id;
+    e->offset = offset;
+    e->length = length;
+    __atomic_store_n(&e->ready, 1, __ATOMIC_RELEASE);
+    __atomic_store_n(&trace_last_event[id], index + 1, __ATOMIC_RELEASE);
+}
+
+int asset_trace_open(const char *name) {
+    if (!trace_ready || !name) return -1;
+    while (*name == '/') name++;
+
+    uint32_t hash = trace_hash(name);
+    int id = -1;
+    int added = 0;
+
+    sceKernelLockLwMutex(&trace_lock, 1, NULL);
+    for (uint32_t i = 0; i < ASSET_TRACE_SLOTS; i++) {
+        int *slot = &trace_name_slots[(hash + i) & (ASSET_TRACE_SLOTS - 1)];
+        if (!*slot) {
+            if (trace_name_count >= ASSET_TRACE_NAMES) break;
+            char *copy = strdup(name);
+            if (!copy) break;
+            id = trace_name_count++;
+            trace_names[id] = copy;
+            trace_name_hash[id] = hash;
+            *slot = id + 1;
+            added = 1;
+            break;
+        }
+        if (trace_name_hash[*slot - 1] == hash && strcmp(trace_names[*slot - 1], name) == 0) {
+            id = *slot - 1;
+            break;
+        }
+    }
+    sceKernelUnlockLwMutex(&trace_lock, 1);
+
+    if (added && mark_name && strcmp(name, mark_name) == 0) mark_now_ms = trace_now_ms();
+
+    if (id < 0 || !trace_recording) return -1;
+    trace_record(id, 0, 0);
+    return id;
+}
+
+void asset_trace_read(int id, uint32_t offset, uint32_t length) {
+    if (id < 0 || !trace_recording || !length) return;
+    trace_record(id, offset, length);
+}
+
+void asset_trace_save(void) {
+    if (!trace_ready) return;
+
+    sceKernelLockLwMutex(&trace_lock, 1, NULL);
+    trace_recording = 0;
+    int skip = trace_saved || !trace_event_count;
+    trace_saved = 1;
+    sceKernelUnlockLwMutex(&trace_lock, 1);
+    if (skip) return;
+
+    FILE *file = fopen(ASSET_TRACE_PATH, "w");
+    if (!file) {
+        debugPrintf("Assets: ERROR - Cannot write %s\n", ASSET_TRACE_PATH);
+        return;
+    }
+
+    uint32_t count = trace_event_count < ASSET_TRACE_EVENTS ? trace_event_count : ASSET_TRACE_EVENTS;
+    fprintf(file, "# Fluffy Diver boot asset trace: time_ms offset length name\n");
+    for (uint32_t i = 0; i < count; i++) {
+        AssetTraceEvent *e = &trace_events[i];
+        if (!__atomic_load_n(&e->ready, __ATOMIC_ACQUIRE)) continue;
+        fprintf(file, "%u %u %u %s\n", e->time_ms, e->offset, e->length, trace_names[e->name_id]);
+    }
+    fclose(file);
+
+    debugPrintf("Assets: Saved %u trace events for %u assets to %s\n",
+                count, trace_name_count, ASSET_TRACE_PATH);
+}
+
+// ===== REPLAY =====
+
+// Unique names from the previous launch's trace, in first-access order
+static int replay_load(void) {
+    FILE *file = fopen(ASSET_TRACE_PATH, "r");
+    if (!file) return -1;
+
+    replay_items = calloc(ASSET_TRACE_NAMES, sizeof(AssetReplayItem));
+    int *slots = calloc(ASSET_TRACE_SLOTS, sizeof(int));
+    if (!replay_items || !slots) {
+        free(replay_items);
+        free(slots);
+        replay_items = NULL;
+        fclose(file);
+        return -1;
+    }
+
+    char line[FIOS_PATH_MAX + 64];
+    while (replay_count < ASSET_TRACE_NAMES && fgets(line, sizeof(line), file)) {
+        unsigned int time_ms, offset, length;
+        int name_at = 0;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0] == '#' || sscanf(line, "%u %u %u %n", &time_ms, &offset, &length, &name_at) != 3 ||
+            !line[name_at]) {
+            continue;
+        }
+
+        const char *name = line + name_at;
+        uint32_t hash = trace_hash(name);
+        for (uint32_t i = 0; i < ASSET_TRACE_SLOTS; i++) {
+            int *slot = &slots[(hash + i) & (ASSET_TRACE_SLOTS - 1)];
+            if (*slot && strcmp(replay_items[*slot - 1].name, name) == 0) break;
+            if (*slot) continue;
+
+            AssetReplayItem *item = &replay_items[replay_count];
+            item->name = strdup(name);
+            if (!item->name) break;
+            item->time_ms = time_ms;
+            item->entry = asset_pack_find(name);
+            if (item->entry) item->entry = asset_pack_blob(item->entry);
+            *slot = ++replay_count;
+            break;
+        }
+    }
+
+    free(slots);
+    fclose(file);
+
+    if (replay_count) {
+        mark_name = replay_items[replay_count - 1].name;
+        mark_traced_ms = replay_items[replay_count - 1].time_ms;
+    }
+    return replay_count ? 0 : -1;
+}
+
+// By pack position; aliases of one blob end up together, earliest traced first
+static int replay_offset_compare(const void *a, const void *b) {
+    const AssetReplayItem *x = *(AssetReplayItem * const *)a;
+    const AssetReplayItem *y = *(AssetReplayItem * const *)b;
+    if (x->entry->offset != y->entry->offset) return x->entry->offset < y->entry->offset ? -1 : 1;
+    if (x->entry->size != y->entry->size) return x->entry->size < y->entry->size ? -1 : 1;
+    return x < y ? -1 : x > y;
+}
+
+// One pack read covering packed[first..last], split into cache buffers
+static void replay_span(AssetReplayItem **packed, uint32_t first, uint32_t last) {
+    uint32_t start = packed[first]->entry->offset;
+    uint32_t size = packed[last]->entry->offset + packed[last]->entry->size - start;
+
+    uint8_t *span = malloc(size ? size : 1);
+    SceUInt64 t0 = sceKernelGetProcessTimeWide();
+    if (!span || asset_pack_read(span, size, start) < 0) {
+        free(span);
+        for (uint32_t i = first; i <= last; i++) packed[i]->done = 1;
+        return;
+    }
+    uint32_t read_us = (uint32_t)(sceKernelGetProcessTimeWide() - t0);
+
+    replay_stats.reads++;
+    for (uint32_t i = first; i <= last; i++) {
+        AssetReplayItem *item = packed[i];
+        const AssetPackEntry *entry = item->entry;
+        item->done = 1;
+
+        SceUInt64 t1 = sceKernelGetProcessTimeWide();
+        void *data = memalign(ASSET_CACHE_ALIGN, entry->raw_size ? entry->raw_size : 1);
+        if (!data || asset_pack_decode(entry, span + (entry->offset - start), data) < 0) {
+            free(data);
+            continue;
+        }
+
+        // Each asset is charged its share of the read plus its own inflate
+        uint32_t load_us = (uint32_t)((uint64_t)read_us * entry->size / (size ? size : 1)) +
+                           (uint32_t)(sceKernelGetProcessTimeWide() - t1);
+        if (asset_cache_insert(item->name, data, entry->raw_size, load_us) == 0) {
+            replay_stats.assets++;
+            replay_stats.bytes += entry->raw_size;
+            if (i != first) replay_stats.merged++;
+        }
+    }
+
+    free(span);
+}
+
+static void replay_run(void) {
+    size_t budget = asset_cache_budget();
+    if (!budget) return;
+
+    // Pack entries by position, so neighbours can join one read
+    AssetReplayItem **packed = malloc(replay_count * sizeof(AssetReplayItem *));
+    uint32_t *packed_pos = malloc(replay_count * sizeof(uint32_t));
+    uint32_t packed_count = 0;
+    if (!packed || !packed_pos) {
+        free(packed);
+        free(packed_pos);
+        return;
+    }
+    for (uint32_t i = 0; i < replay_count; i++) {
+        if (replay_items[i].entry) packed[packed_count++] = &replay_items[i];
+    }
+    qsort(packed, packed_count, sizeof(AssetReplayItem *), replay_offset_compare);
+
+    // Aliases share one cache buffer, so only the first traced name is fetched
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < packed_count; i++) {
+        if (unique && packed[unique - 1]->entry == packed[i]->entry) {
+            packed[i]->done = 1;
+            continue;
+        }
+        packed[unique++] = packed[i];
+    }
+    packed_count = unique;
+    for (uint32_t i = 0; i < packed_count; i++) packed_pos[packed[i] - replay_items] = i;
+
+    replay_stats.start_ms = trace_now_ms();
+
+    // Trace order, so the first assets the game wants are ready first
+    for (uint32_t i = 0; i < replay_count && replay_stats.bytes < budget; i++) {
+        AssetReplayItem *item = &replay_items[i];
+        if (item->done) continue;
+        if (asset_cache_contains(item->name)) {
+            item->done = 1;
+            continue;
+        }
+
+        if (!item->entry) {
+            int bytes = asset_cache_preload(item->name);
+            item->done = 1;
+            if (bytes > 0) {
+                replay_stats.assets++;
+                replay_stats.reads++;
+                replay_stats.bytes += bytes;
+            }
+            continue;
+        }
+
+        uint32_t first = packed_pos[i];
+        uint32_t last = first;
+        uint32_t span = item->entry->size;
+        while (last + 1 < packed_count) {
+            const AssetReplayItem *next = packed[last + 1];
+            uint32_t end = packed[last]->entry->offset + packed[last]->entry->size;
+            if (next->done || next->entry->offset - end > ASSET_TRACE_GAP_MAX ||
+                span + (next->entry->offset - end) + next->entry->size > ASSET_TRACE_SPAN_MAX ||
+                replay_stats.bytes + span + next->entry->raw_size > budget) {
+                break;
+            }
+            span += (next->entry->offset - end) + next->entry->size;
+            last++;
+        }
+
+        replay_span(packed, first, last);
+    }
+
+    replay_stats.end_ms = trace_now_ms();
+    free(packed);
+    free(packed_pos);
+
+    debugPrintf("Assets: Replayed %u traced assets (%llu KB in %u reads) in %u ms\n",
+                replay_stats.assets, replay_stats.bytes / 1024, replay_stats.reads,
+                replay_stats.end_ms - replay_stats.start_ms);
+}
+
+static int asset_trace_thread(SceSize args, void *argp) {
+    // Replay is speculative; the game's own loads go first
+    fios_sched_set_thread_class(0, FIOS_CLASS_PREFETCH);
+    if (replay_items) replay_run();
+
+    // Save this launch's trace once the recording window has passed
+    uint32_t now = trace_now_ms();
+    if (now < ASSET_TRACE_WINDOW_MS) sceKernelDelayThread((ASSET_TRACE_WINDOW_MS - now) * 1000);
+    asset_trace_save();
+
+    fios_sched_thread_exit(0);
+    return sceKernelExitDeleteThread(0);
+}
+
+// ===== PUBLIC API =====
+
+void asset_trace_init(void) {
+    if (sceKernelCreateLwMutex(&trace_lock, "asset_trace", 0, 0, NULL) < 0) {
+        debugPrintf("Assets: ERROR - Cannot create trace lock\n");
+        return;
+    }
+    memset(&replay_stats, 0, sizeof(replay_stats));
+
+    if (replay_load() == 0) {
+        debugPrintf("Assets: Loaded boot trace of %u assets from %s\n", replay_count, ASSET_TRACE_PATH);
+    }
+
+    trace_ready = 1;
+    trace_recording = trace_now_ms() < ASSET_TRACE_WINDOW_MS;
+
+    SceUID thid = sceKernelCreateThread("asset_trace", asset_trace_thread, ASSET_TRACE_THREAD_PRIORITY,
+                                        ASSET_TRACE_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    if (thid < 0 || sceKernelStartThread(thid, 0, NULL) < 0) {
+        debugPrintf("Assets: ERROR - Cannot start trace thread, no replay\n");
+    }
+}
+
+void asset_trace_report(void) {
+    uint32_t events = trace_event_count < ASSET_TRACE_EVENTS ? trace_event_count : ASSET_TRACE_EVENTS;
+
+    debugPrintf("=== ASSET TRACE ===\n");
+    debugPrintf("  recorded: %u events for %u assets%s\n", events, trace_name_count,
+                trace_event_count > ASSET_TRACE_EVENTS ? " (buffer full)" : "");
+
+    if (!replay_count) {
+        debugPrintf("  replay: no trace from a previous launch\n");
+    } else {
+        debugPrintf("  replay: %u of %u assets, %llu KB in %u reads (%u merged), %u ms\n",
+                    replay_stats.assets, replay_count, replay_stats.bytes / 1024, replay_stats.reads,
+                    replay_stats.merged, replay_stats.end_ms - replay_stats.start_ms);
+        if (mark_now_ms) {
+            int saved = (int)mark_traced_ms - (int)mark_now_ms;
+            debugPrintf("  last traced asset opened at %u ms (previous launch %u ms): %d ms %s\n",
+                        mark_now_ms, mark_traced_ms, saved < 0 ? -saved : saved,
+                        saved >= 0 ? "earlier" : "later");
+        }
+    }
+    debugPrintf("===================\n");
+}
@@ -0,0 +1,244 @@
+/*
+ * atomic_patch.c - __sync_* / __atomic_* runtime for Fluffy Diver
+ * Android builds of the game call out to libgcc/libatomic for these; on
+ * ARMv7 the builtins below compile to LDREX/STREX (LDREXD/STREXD for 8 bytes)
+ * with DMB barriers, so engine lock-free code stays lock-free.
+ * Functions are named atomic_* here and exported under the libgcc names,
+ * since GCC does not allow redefining its own builtins.
+ */
+
+#include <vitasdk.h>
+#include <string.h>
+
+#include "atomic_patch.h"
+
+// Striped spinlocks for the generic (odd-sized) entry points
+#define ATOMIC_LOCK_STRIPES 64
+#define ATOMIC_SPIN_LIMIT 1000
+
+static volatile uint8_t atomic_locks[ATOMIC_LOCK_STRIPES];
+
+// Run OP with a compile-time memory order matching the runtime value.
+// Orders the hardware can't express more cheaply are promoted to seq_cst.
+#define ATOMIC_LOAD_ORDER(order, OP, ...) \
+    switch (order) { \
+        case __ATOMIC_RELAXED: OP(__ATOMIC_RELAXED, __VA_ARGS__); \
+        case __ATOMIC_CONSUME: \
+        case __ATOMIC_ACQUIRE: OP(__ATOMIC_ACQUIRE, __VA_ARGS__); \
+        default: OP(__ATOMIC_SEQ_CST, __VA_ARGS__); \
+    }
+
+#define ATOMIC_STORE_ORDER(order, OP, ...) \
+    switch (order) { \
+        case __ATOMIC_RELAXED: OP(__ATOMIC_RELAXED, __VA_ARGS__); \
+        case __ATOMIC_RELEASE: OP(__ATOMIC_RELEASE, __VA_ARGS__); \
+        default: OP(__ATOMIC_SEQ_CST, __VA_ARGS__); \
+    }
+
+#define ATOMIC_RMW_ORDER(order, OP, ...) \
+    switch (order) { \
+        case __ATOMIC_RELAXED: OP(__ATOMIC_RELAXED, __VA_ARGS__); \
+        case __ATOMIC_CONSUME: \
+        case __ATOMIC_ACQUIRE: OP(__ATOMIC_ACQUIRE, __VA_ARGS__); \
+        case __ATOMIC_RELEASE: OP(__ATOMIC_RELEASE, __VA_ARGS__); \
+        case __ATOMIC_ACQ_REL: OP(__ATOMIC_ACQ_REL, __VA_ARGS__); \
+        default: OP(__ATOMIC_SEQ_CST, __VA_ARGS__); \
+    }
+
+#define LOAD_BODY(o, T) return __atomic_load_n((const volatile T *)ptr, o)
+#define STORE_BODY(o, T) __atomic_store_n((volatile T *)ptr, val, o); return
+#define RMW_BODY(o, T, builtin) return builtin((volatile T *)ptr, val, o)
+
+// __sync_* are full barriers
+#define DEFINE_SYNC_OP(N, T, name, builtin) \
+    T atomic_sync_##name##_##N(volatile void *ptr, T val) { \
+        return builtin((volatile T *)ptr, val, __ATOMIC_SEQ_CST); \
+    }
+
+// __atomic_<op>_N with a runtime memory order
+#define DEFINE_ATOMIC_RMW(N, T, name, builtin) \
+    T atomic_##name##_##N(volatile void *ptr, T val, int order) { \
+        ATOMIC_RMW_ORDER(order, RMW_BODY, T, builtin) \
+    }
+
+#define DEFINE_SIZED(N, T) \
+    DEFINE_SYNC_OP(N, T, fetch_and_add, __atomic_fetch_add) \
+    DEFINE_SYNC_OP(N, T, fetch_and_sub, __atomic_fetch_sub) \
+    DEFINE_SYNC_OP(N, T, fetch_and_or, __atomic_fetch_or) \
+    DEFINE_SYNC_OP(N, T, fetch_and_and, __atomic_fetch_and) \
+    DEFINE_SYNC_OP(N, T, fetch_and_xor, __atomic_fetch_xor) \
+    DEFINE_SYNC_OP(N, T, fetch_and_nand, __atomic_fetch_nand) \
+    DEFINE_SYNC_OP(N, T, add_and_fetch, __atomic_add_fetch) \
+    DEFINE_SYNC_OP(N, T, sub_and_fetch, __atomic_sub_fetch) \
+    DEFINE_SYNC_OP(N, T, or_and_fetch, __atomic_or_fetch) \
+    DEFINE_SYNC_OP(N, T, and_and_fetch, __atomic_and_fetch) \
+    DEFINE_SYNC_OP(N, T, xor_and_fetch, __atomic_xor_fetch) \
+    DEFINE_SYNC_OP(N, T, nand_and_fetch, __atomic_nand_fetch) \
+    \
+    T atomic_sync_val_compare_and_swap_##N(volatile void *ptr, T oldval, T newval) { \
+        __atomic_compare_exchange_n((volatile T *)ptr, &oldval, newval, 0, \
+                                    __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
+        return oldval; \
+    } \
+    \
+    int atomic_sync_bool_compare_and_swap_##N(volatile void *ptr, T oldval, T newval) { \
+        return __atomic_compare_exchange_n((volatile T *)ptr, &oldval, newval, 0, \
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
+    } \
+    \
+    /* GCC documents these two as acquire / release barriers only */ \
+    T atomic_sync_lock_test_and_set_##N(volatile void *ptr, T val) { \
+        return __atomic_exchange_n((volatile T *)ptr, val, __ATOMIC_ACQUIRE); \
+    } \
+    \
+    void atomic_sync_lock_release_##N(volatile void *ptr) { \
+        __atomic_store_n((volatile T *)ptr, 0, __ATOMIC_RELEASE); \
+    } \
+    \
+    T atomic_load_##N(const volatile void *ptr, int order) { \
+        ATOMIC_LOAD_ORDER(order, LOAD_BODY, T) \
+    } \
+    \
+    void atomic_store_##N(volatile void *ptr, T val, int order) { \
+        ATOMIC_STORE_ORDER(order, STORE_BODY, T) \
+    } \
+    \
+    /* libatomic's signature (no weak flag); always strong. Relaxed/relaxed \
+       skips the barriers, anything else is seq_cst */ \
+    int atomic_compare_exchange_##N(volatile void *ptr, void *expected, T desired, \
+                                    int success, int failure) { \
+        if (success == __ATOMIC_RELAXED && failure == __ATOMIC_RELAXED) { \
+            return __atomic_compare_exchange_n((volatile T *)ptr, (T *)expected, desired, 0, \
+                                               __ATOMIC_RELAXED, __ATOMIC_RELAXED); \
+        } \
+        return __atomic_compare_exchange_n((volatile T *)ptr, (T *)expected, desired, 0, \
+                                           __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); \
+    } \
+    \
+    DEFINE_ATOMIC_RMW(N, T, exchange, __atomic_exchange_n) \
+    DEFINE_ATOMIC_RMW(N, T, fetch_add, __atomic_fetch_add) \
+    DEFINE_ATOMIC_RMW(N, T, fetch_sub, __atomic_fetch_sub) \
+    DEFINE_ATOMIC_RMW(N, T, fetch_and, __atomic_fetch_and) \
+    DEFINE_ATOMIC_RMW(N, T, fetch_or, __atomic_fetch_or) \
+    DEFINE_ATOMIC_RMW(N, T, fetch_xor, __atomic_fetch_xor) \
+    DEFINE_ATOMIC_RMW(N, T, fetch_nand, __atomic_fetch_nand) \
+    DEFINE_ATOMIC_RMW(N, T, add_fetch, __atomic_add_fetch) \
+    DEFINE_ATOMIC_RMW(N, T, sub_fetch, __atomic_sub_fetch) \
+    DEFINE_ATOMIC_RMW(N, T, and_fetch, __atomic_and_fetch) \
+    DEFINE_ATOMIC_RMW(N, T, or_fetch, __atomic_or_fetch) \
+    DEFINE_ATOMIC_RMW(N, T, xor_fetch, __atomic_xor_fetch) \
+    DEFINE_ATOMIC_RMW(N, T, nand_fetch, __atomic_nand_fetch)
+
+DEFINE_SIZED(1, uint8_t)
+DEFINE_SIZED(2, uint16_t)
+DEFINE_SIZED(4, uint32_t)
+DEFINE_SIZED(8, uint64_t)
+
+// ===== BARRIERS =====
+
+void atomic_sync_synchronize(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void atomic_thread_fence(int order) {
+    if (order != __ATOMIC_RELAXED) __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void atomic_signal_fence(int order) {
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+}
+
+// ===== GENERIC ENTRY POINTS =====
+
+// Naturally aligned 1/2/4/8 byte objects are lock-free (LDREXB/H, LDREX, LDREXD)
+int atomic_is_lock_free(size_t size, const volatile void *ptr) {
+    if (size != 1 && size != 2 && size != 4 && size != 8) return 0;
+    return ((uintptr_t)ptr & (size - 1)) == 0;
+}
+
+static volatile uint8_t *atomic_lock_for(const volatile void *ptr) {
+    return &atomic_locks[((uintptr_t)ptr >> 4) % ATOMIC_LOCK_STRIPES];
+}
+
+static void atomic_lock(volatile uint8_t *lock) {
+    int spins = 0;
+    while (__atomic_test_and_set(lock, __ATOMIC_ACQUIRE)) {
+        if (++spins >= ATOMIC_SPIN_LIMIT) {
+            sceKernelDelayThread(0);
+            spins = 0;
+        }
+    }
+}
+
+static void atomic_unlock(volatile uint8_t *lock) {
+    __atomic_clear(lock, __ATOMIC_RELEASE);
+}
+
+void atomic_load_generic(size_t size, const volatile void *ptr, void *ret, int order) {
+    if (atomic_is_lock_free(size, ptr)) {
+        switch (size) {
+            case 1: *(uint8_t *)ret = atomic_load_1(ptr, order); return;
+            case 2: *(uint16_t *)ret = atomic_load_2(ptr, order); return;
+            case 4: *(uint32_t *)ret = atomic_load_4(ptr, order); return;
+            case 8: *(uint64_t *)ret = atomic_load_8(ptr, order); return;
+        }
+    }
+
+    volatile uint8_t *lock = atomic_lock_for(ptr);
+    atomic_lock(lock);
+    memcpy(ret, (const void *)ptr, size);
+    atomic_unlock(lock);
+}
+
+void atomic_store_generic(size_t size, volatile void *ptr, const void *val, int order) {
+    if (atomic_is_lock_free(size, ptr)) {
+        switch (size) {
+            case 1: atomic_store_1(ptr, *(const uint8_t *)val, order); return;
+            case 2: atomic_store_2(ptr, *(const uint16_t *)val, order); return;
+            case 4: atomic_store_4(ptr, *(const uint32_t *)val, order); return;
+            case 8: atomic_store_8(ptr, *(const uint64_t *)val, order); return;
+        }
+    }
+
+    volatile uint8_t *lock = atomic_lock_for(ptr);
+    atomic_lock(lock);
+    memcpy((void *)ptr, val, size);
+    atomic_unlock(lock);
+}
+
+void atomic_exchange_generic(size_t size, volatile void *ptr, const void *val, void *ret, int order) {
+    if (atomic_is_lock_free(size, ptr)) {
+        switch (size) {
+            case 1: *(uint8_t *)ret = atomic_exchange_1(ptr, *(const uint8_t *)val, order); return;
+            case 2: *(uint16_t *)ret = atomic_exchange_2(ptr, *(const uint16_t *)val, order); return;
+            case 4: *(uint32_t *)ret = atomic_exchange_4(ptr, *(const uint32_t *)val, order); return;
+            case 8: *(uint64_t *)ret = atomic_exchange_8(ptr, *(const uint64_t *)val, order); return;
+        }
+    }
+
+    volatile uint8_t *lock = atomic_lock_for(ptr);
+    atomic_lock(lock);
+    memcpy(ret, (const void *)ptr, size);
+    memcpy((void *)ptr, val, size);
+    atomic_unlock(lock);
+}
+
+int atomic_compare_exchange_generic(size_t size, volatile void *ptr, void *expected,
+                                    const void *desired, int success, int failure) {
+    if (atomic_is_lock_free(size, ptr)) {
+        switch (size) {
+            case 1: return atomic_compare_exchange_1(ptr, expected, *(const uint8_t *)desired, success, failure);
+            case 2: return atomic_compare_exchange_2(ptr, expected, *(const uint16_t *)desired, success, failure);
+            case 4: return atomic_compare_exchange_4(ptr, expected, *(const uint32_t *)desired, success, failure);
+            case 8: return atomic_compare_exchange_8(ptr, expected, *(const uint64_t *)desired, success, failure);
+        }
+    }
+
+    volatile uint8_t *lock = atomic_lock_for(ptr);
+    atomic_lock(lock);
+    int equal = memcmp((const void *)ptr, expected, size) == 0;
+    if (equal) memcpy((void *)ptr, desired, size);
+    else memcpy(expected, (const void *)ptr, size);
+    atomic_unlock(lock);
+    return equal;
+}
@@ -38,11 +38,19 @@ static void config_set_defaults(void) {
     config.overclock = 0;
     config.gpu_overrides = 0;
     config.vram_usage = VRAM_NORMAL;
+    config.math_backend = MATH_BACKEND_EXACT;
+    config.io_buffer_kb = 64;
+    config.asset_cache_mb = 32;
+    config.io_scheduler = 1;
+    config.io_prefetch_kbps = 16384;
+    config.io_writebehind_kbps = 4096;
 
     // Debug settings
     config.debug_logging = 1;
     config.show_fps = 0;
     config.wireframe = 0;
+    config.lock_profiler = 0;
+    config.io_stats = 0;
 
     printf("Configuration: Set to defaults\n");
 }
@@ -117,6 +125,25 @@ static int config_parse_line(const char *line) {
         else if (strcmp(value, "normal") == 0) config.vram_usage = VRAM_NORMAL;
         else if (strcmp(value, "high") == 0) config.vram_usage = VRAM_HIGH;
     }
+    else if (strcmp(key, "math_backend") == 0) {
+        if (strcmp(value, "exact") == 0) config.math_backend = MATH_BACKEND_EXACT;
+        else if (strcmp(value, "fast") == 0) config.math_backend = MATH_BACKEND_FAST;
+    }
+    else if (strcmp(key, "io_buffer_kb") == 0) {
+        config.io_buffer_kb = atoi(value);
+    }
+    else if (strcmp(key, "asset_cache_mb") == 0) {
+        config.asset_cache_mb = atoi(value);
+    }
+    else if (strcmp(key, "io_scheduler") == 0) {
+        config.io_scheduler = atoi(value);
+    }
+    else if (strcmp(key, "io_prefetch_kbps") == 0) {
+        config.io_prefetch_kbps = atoi(value);
+    }
+    else if (strcmp(key, "io_writebehind_kbps") == 0) {
+        config.io_writebehind_kbps = atoi(value);
+    }
 
     // Debug settings
     else if (strcmp(key, "debug_logging") == 0) {
@@ -128,6 +155,12 @@ static int config_parse_line(const char *line) {
     else if (strcmp(key, "wireframe") == 0) {
         config.wireframe = atoi(value);
     }
+    else if (strcmp(key, "lock_profiler") == 0) {
+        config.lock_profiler = atoi(value);
+    }
+    else if (strcmp(key, "io_stats") == 0) {
+        config.io_stats = atoi(value);
+    }
 
     return 1;
 }
@@ -208,6 +241,13 @@ int config_save(void) {
     fprintf(file, "vram_usage = %s\n",
             config.vram_usage == VRAM_LOW ? "low" :
             config.vram_usage == VRAM_NORMAL ? "normal" : "high");
+    fprintf(file, "math_backend = %s\n",
+            config.math_backend == MATH_BACKEND_FAST ? "fast" : "exact");
+    fprintf(file, "io_buffer_kb = %d\n", config.io_buffer_kb);
+    fprintf(file, "asset_cache_mb = %d\n", config.asset_cache_mb);
+    fprintf(file, "io_scheduler = %d\n", config.io_scheduler);
+    fprintf(file, "io_prefetch_kbps = %d\n", config.io_prefetch_kbps);
+    fprintf(file, "io_writebehind_kbps = %d\n", config.io_writebehind_kbps);
     fprintf(file, "\n");
 
     // Debug settings
@@ -215,6 +255,8 @@ int config_save(void) {
     fprintf(file, "debug_logging = %d\n", config.debug_logging);
     fprintf(file, "show_fps = %d\n", config.show_fps);
     fprintf(file, "wireframe = %d\n", config.wireframe);
+    fprintf(file, "lock_profiler = %d\n", config.lock_profiler);
+    fprintf(file, "io_stats = %d\n", config.io_stats);
 
     fclose(file);
     printf("Configuration: Saved to config file\n");
@@ -309,6 +351,30 @@ int config_get_vram_usage(void) {
     return config.vram_usage;
 }
 
+int config_get_math_backend(void) {
+    return config.math_backend;
+}
+
+int config_get_io_buffer_kb(void) {
+    return config.io_buffer_kb;
+}
+
+int config_get_asset_cache_mb(void) {
+    return config.asset_cache_mb;
+}
+
+int config_get_io_scheduler(void) {
+    return config.io_scheduler;
+}
+
+int config_get_io_prefetch_kbps(void) {
+    return config.io_prefetch_kbps;
+}
+
+int config_get_io_writebehind_kbps(void) {
+    return config.io_writebehind_kbps;
+}
+
 int config_get_debug_logging(void) {
     return config.debug_logging;
 }
@@ -321,6 +387,14 @@ int config_get_wireframe(void) {
     return config.wireframe;
 }
 
+int config_get_lock_profiler(void) {
+    return config.lock_profiler;
+}
+
+int config_get_io_stats(void) {
+    return config.io_stats;
+}
+
 // Setter functions for runtime changes
 void config_set_graphics_quality(int quality) {
     config.graphics_quality = quality;
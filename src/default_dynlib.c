@@ -20,6 +20,12 @@
 
 #include "so_util.h"
 #include "fios.h"
+#include "pthread_patch.h"
+#include "atomic_patch.h"
+#include "sys_utils.h"
+#include "string_patch.h"
+#include "io_patch.h"
+#include "android_patch.h"
 
 // External debug function
 extern void debugPrintf(const char *fmt, ...);
@@ -36,13 +42,6 @@ extern void *android_getCacheDir(void *context);
 extern int android_getVersionCode(void *context);
 extern void *android_getVersionName(void *context);
 
-extern void *android_asset_open(void *asset_manager, const char *filename, int mode);
-extern int android_asset_read(void *asset, void *buffer, int size);
-extern int android_asset_seek(void *asset, int offset, int whence);
-extern int android_asset_getLength(void *asset);
-extern void android_asset_close(void *asset);
-extern int android_asset_getRemainingLength(void *asset);
-
 extern void android_getDisplayMetrics(void *context, int *width, int *height, float *density);
 extern int android_getOrientation(void *context);
 extern int android_getScreenWidth(void *context);
@@ -119,8 +118,16 @@ FILE *fopen_hook(const char *filename, const char *mode) {
 
     if (!filename) return NULL;
 
-    // Use FIOS for path translation and file access
-    return fios_fopen(filename, mode);
+    // FIOS translates the path; the stream itself is buffered by io_patch
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(filename, translated, sizeof(translated)) < 0) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    if (mode && (mode[0] != 'r' || strchr(mode, '+'))) {
+        fios_cache_invalidate(filename);
+    }
+    return io_fopen(translated, mode);
 }
 
 int open_hook(const char *pathname, int flags, mode_t mode) {
@@ -128,74 +135,25 @@ int open_hook(const char *pathname, int flags, mode_t mode) {
 
     if (!pathname) return -1;
 
-    // Translate path using FIOS
-    char *translated = fios_translate_path(pathname);
-
-    // Convert flags to Vita equivalents
-    int vita_flags = 0;
-    if (flags & 0x0001) vita_flags |= SCE_O_WRONLY;
-    if (flags & 0x0002) vita_flags |= SCE_O_RDWR;
-    if (flags & 0x0040) vita_flags |= SCE_O_CREAT;
-    if (flags & 0x0200) vita_flags |= SCE_O_TRUNC;
-    if (flags & 0x0400) vita_flags |= SCE_O_APPEND;
+    // Translate path using FIOS; io_patch maps the flags and owns the fd
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(pathname, translated, sizeof(translated)) < 0) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
 
-    if (vita_flags == 0) vita_flags = SCE_O_RDONLY;
+    // Anything that can create, truncate or write the file stales its cached
+    // stat; io_close drops it again once the writes are on the card
+    if ((flags & ANDROID_O_ACCMODE) != ANDROID_O_RDONLY || (flags & (ANDROID_O_CREAT | ANDROID_O_TRUNC))) {
+        fios_cache_invalidate(pathname);
+    }
 
-    SceUID fd = sceIoOpen(translated, vita_flags, 0777);
+    int fd = io_open(translated, flags, mode);
     debugPrintf("FIOS: open result: %d (translated: %s)\n", fd, translated);
 
     return fd;
 }
 
-// Enhanced pthread stubs with proper error handling (GTA SA Vita approach)
-int pthread_mutex_init_fake(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr) {
-    debugPrintf("pthread: mutex_init(%p, %p)\n", mutex, attr);
-    if (!mutex) return EINVAL;
-
-    // Allocate SceKernelLwMutexWork structure
-    SceKernelLwMutexWork *work = malloc(sizeof(SceKernelLwMutexWork));
-    if (!work) return ENOMEM;
-
-    int ret = sceKernelCreateLwMutex(work, "mutex", 0, 0, NULL);
-    if (ret < 0) {
-        free(work);
-        return EINVAL;
-    }
-
-    // Store the work pointer in the mutex
-    *mutex = (pthread_mutex_t)work;
-    return 0;
-}
-
-int pthread_mutex_destroy_fake(pthread_mutex_t *mutex) {
-    debugPrintf("pthread: mutex_destroy(%p)\n", mutex);
-    if (!mutex || !*mutex) return EINVAL;
-
-    SceKernelLwMutexWork *work = (SceKernelLwMutexWork *)*mutex;
-    int ret = sceKernelDeleteLwMutex(work);
-    free(work);
-    *mutex = NULL;
-    return (ret < 0) ? EINVAL : 0;
-}
-
-int pthread_mutex_lock_fake(pthread_mutex_t *mutex) {
-    debugPrintf("pthread: mutex_lock(%p)\n", mutex);
-    if (!mutex || !*mutex) return EINVAL;
-
-    SceKernelLwMutexWork *work = (SceKernelLwMutexWork *)*mutex;
-    int ret = sceKernelLockLwMutex(work, 1, NULL);
-    return (ret < 0) ? EINVAL : 0;
-}
-
-int pthread_mutex_unlock_fake(pthread_mutex_t *mutex) {
-    debugPrintf("pthread: mutex_unlock(%p)\n", mutex);
-    if (!mutex || !*mutex) return EINVAL;
-
-    SceKernelLwMutexWork *work = (SceKernelLwMutexWork *)*mutex;
-    int ret = sceKernelUnlockLwMutex(work, 1);
-    return (ret < 0) ? EINVAL : 0;
-}
-
 // JNI_OnLoad stub with proper return value
 int JNI_OnLoad(void *vm, void *reserved) {
     debugPrintf("JNI: JNI_OnLoad called (vm=%p, reserved=%p)\n", vm, reserved);
@@ -233,19 +191,6 @@ void *realloc_safe(void *ptr, size_t size) {
     return new_ptr;
 }
 
-// Time functions with proper implementation
-int gettimeofday_vita(struct timeval *tv, void *tz) {
-    if (!tv) return -1;
-
-    SceRtcTick tick;
-    sceRtcGetCurrentTick(&tick);
-
-    tv->tv_sec = tick.tick / 1000000;
-    tv->tv_usec = tick.tick % 1000000;
-
-    return 0;
-}
-
 // COMPREHENSIVE SYMBOL TABLE - ALL SUCCESSFUL PORTS COMBINED
 DynLibFunction default_dynlib[] = {
     // ===== JNI FUNCTIONS =====
@@ -276,12 +221,22 @@ DynLibFunction default_dynlib[] = {
     {"android_getVersionName", (uintptr_t)&android_getVersionName},
 
     // ===== ANDROID ASSET MANAGER =====
-    {"AAssetManager_open", (uintptr_t)&android_asset_open},
-    {"AAsset_read", (uintptr_t)&android_asset_read},
-    {"AAsset_seek", (uintptr_t)&android_asset_seek},
-    {"AAsset_getLength", (uintptr_t)&android_asset_getLength},
-    {"AAsset_close", (uintptr_t)&android_asset_close},
-    {"AAsset_getRemainingLength", (uintptr_t)&android_asset_getRemainingLength},
+    {"AAssetManager_open", (uintptr_t)&AAssetManager_open},
+    {"AAsset_read", (uintptr_t)&AAsset_read},
+    {"AAsset_seek", (uintptr_t)&AAsset_seek},
+    {"AAsset_seek64", (uintptr_t)&AAsset_seek64},
+    {"AAsset_getLength", (uintptr_t)&AAsset_getLength},
+    {"AAsset_getLength64", (uintptr_t)&AAsset_getLength64},
+    {"AAsset_getRemainingLength", (uintptr_t)&AAsset_getRemainingLength},
+    {"AAsset_getRemainingLength64", (uintptr_t)&AAsset_getRemainingLength64},
+    {"AAsset_getBuffer", (uintptr_t)&AAsset_getBuffer},
+    {"AAsset_isAllocated", (uintptr_t)&AAsset_isAllocated},
+    {"AAsset_openFileDescriptor", (uintptr_t)&AAsset_openFileDescriptor},
+    {"AAsset_close", (uintptr_t)&AAsset_close},
+    {"AAssetManager_openDir", (uintptr_t)&AAssetManager_openDir},
+    {"AAssetDir_getNextFileName", (uintptr_t)&AAssetDir_getNextFileName},
+    {"AAssetDir_rewind", (uintptr_t)&AAssetDir_rewind},
+    {"AAssetDir_close", (uintptr_t)&AAssetDir_close},
 
     // ===== ANDROID DISPLAY API =====
     {"android_getDisplayMetrics", (uintptr_t)&android_getDisplayMetrics},
@@ -344,27 +299,30 @@ DynLibFunction default_dynlib[] = {
     // ===== FILE I/O (Enhanced with FIOS) =====
     {"fopen", (uintptr_t)&fopen_hook},
     {"open", (uintptr_t)&open_hook},
-    {"fclose", (uintptr_t)&fclose},
-    {"fread", (uintptr_t)&fread},
-    {"fwrite", (uintptr_t)&fwrite},
-    {"fseek", (uintptr_t)&fseek},
-    {"ftell", (uintptr_t)&ftell},
-    {"feof", (uintptr_t)&feof},
-    {"fflush", (uintptr_t)&fflush},
-    {"ferror", (uintptr_t)&ferror},
-    {"clearerr", (uintptr_t)&clearerr},
-    {"fgetc", (uintptr_t)&fgetc},
-    {"fputc", (uintptr_t)&fputc},
-    {"fgets", (uintptr_t)&fgets},
-    {"fputs", (uintptr_t)&fputs},
-    {"fprintf", (uintptr_t)&fprintf},
-    {"fscanf", (uintptr_t)&fscanf},
-    {"fileno", (uintptr_t)&fileno},
-    {"rewind", (uintptr_t)&rewind},
-    {"read", (uintptr_t)&read},
-    {"write", (uintptr_t)&write},
-    {"close", (uintptr_t)&close},
-    {"lseek", (uintptr_t)&lseek},
+    {"fclose", (uintptr_t)&io_fclose},
+    {"fread", (uintptr_t)&io_fread},
+    {"fwrite", (uintptr_t)&io_fwrite},
+    {"fseek", (uintptr_t)&io_fseek},
+    {"ftell", (uintptr_t)&io_ftell},
+    {"feof", (uintptr_t)&io_feof},
+    {"fflush", (uintptr_t)&io_fflush},
+    {"ferror", (uintptr_t)&io_ferror},
+    {"clearerr", (uintptr_t)&io_clearerr},
+    {"fgetc", (uintptr_t)&io_fgetc},
+    {"fputc", (uintptr_t)&io_fputc},
+    {"fgets", (uintptr_t)&io_fgets},
+    {"fputs", (uintptr_t)&io_fputs},
+    {"fprintf", (uintptr_t)&io_fprintf},
+    {"vfprintf", (uintptr_t)&io_vfprintf},
+    {"fscanf", (uintptr_t)&io_fscanf},
+    {"fileno", (uintptr_t)&io_fileno},
+    {"rewind", (uintptr_t)&io_rewind},
+    {"read", (uintptr_t)&io_read},
+    {"write", (uintptr_t)&io_write},
+    {"close", (uintptr_t)&io_close},
+    {"lseek", (uintptr_t)&io_lseek},
+    {"pread", (uintptr_t)&io_pread},
+    {"pwrite", (uintptr_t)&io_pwrite},
 
     // ===== MEMORY (Enhanced with safety checks) =====
     {"malloc", (uintptr_t)&malloc_safe},
@@ -378,15 +336,15 @@ DynLibFunction default_dynlib[] = {
     {"memchr", (uintptr_t)&memchr},
 
     // ===== STRING FUNCTIONS =====
-    {"strlen", (uintptr_t)&strlen},
+    {"strlen", (uintptr_t)&string_strlen},
     {"strcpy", (uintptr_t)&strcpy},
     {"strcat", (uintptr_t)&strcat},
-    {"strcmp", (uintptr_t)&strcmp},
-    {"strncmp", (uintptr_t)&strncmp},
+    {"strcmp", (uintptr_t)&string_strcmp},
+    {"strncmp", (uintptr_t)&string_strncmp},
     {"strncpy", (uintptr_t)&strncpy},
     {"strncat", (uintptr_t)&strncat},
-    {"strstr", (uintptr_t)&strstr},
-    {"strchr", (uintptr_t)&strchr},
+    {"strstr", (uintptr_t)&string_strstr},
+    {"strchr", (uintptr_t)&string_strchr},
     {"strrchr", (uintptr_t)&strrchr},
     {"strpbrk", (uintptr_t)&strpbrk},
     {"strspn", (uintptr_t)&strspn},
@@ -395,7 +353,7 @@ DynLibFunction default_dynlib[] = {
     {"strtok_r", (uintptr_t)&strtok_r},
     {"strdup", (uintptr_t)&strdup},
     {"strndup", (uintptr_t)&strndup},
-    {"strcasecmp", (uintptr_t)&strcasecmp},
+    {"strcasecmp", (uintptr_t)&string_strcasecmp},
     {"strncasecmp", (uintptr_t)&strncasecmp},
 
     // ===== STRING CONVERSION =====
@@ -411,28 +369,51 @@ DynLibFunction default_dynlib[] = {
     {"pthread_mutex_init", (uintptr_t)&pthread_mutex_init_fake},
     {"pthread_mutex_destroy", (uintptr_t)&pthread_mutex_destroy_fake},
     {"pthread_mutex_lock", (uintptr_t)&pthread_mutex_lock_fake},
+    {"pthread_mutex_trylock", (uintptr_t)&pthread_mutex_trylock_fake},
     {"pthread_mutex_unlock", (uintptr_t)&pthread_mutex_unlock_fake},
-    {"pthread_create", (uintptr_t)&pthread_create},
-    {"pthread_join", (uintptr_t)&pthread_join},
-    {"pthread_detach", (uintptr_t)&pthread_detach},
-    {"pthread_exit", (uintptr_t)&pthread_exit},
+    {"pthread_mutexattr_init", (uintptr_t)&pthread_mutexattr_init_fake},
+    {"pthread_mutexattr_settype", (uintptr_t)&pthread_mutexattr_settype_fake},
+    {"pthread_mutexattr_destroy", (uintptr_t)&pthread_mutexattr_destroy_fake},
+    {"pthread_create", (uintptr_t)&pthread_create_fake},
+    {"pthread_join", (uintptr_t)&pthread_join_fake},
+    {"pthread_detach", (uintptr_t)&pthread_detach_fake},
+    {"pthread_exit", (uintptr_t)&pthread_exit_fake},
     {"pthread_self", (uintptr_t)&pthread_self},
     {"pthread_equal", (uintptr_t)&pthread_equal},
-    {"pthread_key_create", (uintptr_t)&pthread_key_create},
-    {"pthread_key_delete", (uintptr_t)&pthread_key_delete},
-    {"pthread_getspecific", (uintptr_t)&pthread_getspecific},
-    {"pthread_setspecific", (uintptr_t)&pthread_setspecific},
-    {"pthread_cond_init", (uintptr_t)&pthread_cond_init},
-    {"pthread_cond_destroy", (uintptr_t)&pthread_cond_destroy},
-    {"pthread_cond_wait", (uintptr_t)&pthread_cond_wait},
-    {"pthread_cond_signal", (uintptr_t)&pthread_cond_signal},
-    {"pthread_cond_broadcast", (uintptr_t)&pthread_cond_broadcast},
-    {"pthread_cond_timedwait", (uintptr_t)&pthread_cond_timedwait},
+    {"pthread_setname_np", (uintptr_t)&pthread_setname_np_fake},
+    {"pthread_key_create", (uintptr_t)&pthread_key_create_fake},
+    {"pthread_key_delete", (uintptr_t)&pthread_key_delete_fake},
+    {"pthread_getspecific", (uintptr_t)&pthread_getspecific_fake},
+    {"pthread_setspecific", (uintptr_t)&pthread_setspecific_fake},
+    {"pthread_cond_init", (uintptr_t)&pthread_cond_init_fake},
+    {"pthread_cond_destroy", (uintptr_t)&pthread_cond_destroy_fake},
+    {"pthread_cond_wait", (uintptr_t)&pthread_cond_wait_fake},
+    {"pthread_cond_signal", (uintptr_t)&pthread_cond_signal_fake},
+    {"pthread_cond_broadcast", (uintptr_t)&pthread_cond_broadcast_fake},
+    {"pthread_cond_timedwait", (uintptr_t)&pthread_cond_timedwait_fake},
+    {"pthread_cond_timedwait_monotonic_np", (uintptr_t)&pthread_cond_timedwait_monotonic_fake},
+    {"pthread_cond_timedwait_relative_np", (uintptr_t)&pthread_cond_timedwait_relative_fake},
+    {"pthread_condattr_init", (uintptr_t)&pthread_condattr_init_fake},
+    {"pthread_condattr_setclock", (uintptr_t)&pthread_condattr_setclock_fake},
+    {"pthread_condattr_destroy", (uintptr_t)&pthread_condattr_destroy_fake},
+    {"pthread_once", (uintptr_t)&pthread_once_fake},
+    {"pthread_rwlock_init", (uintptr_t)&pthread_rwlock_init_fake},
+    {"pthread_rwlock_destroy", (uintptr_t)&pthread_rwlock_destroy_fake},
+    {"pthread_rwlock_rdlock", (uintptr_t)&pthread_rwlock_rdlock_fake},
+    {"pthread_rwlock_wrlock", (uintptr_t)&pthread_rwlock_wrlock_fake},
+    {"pthread_rwlock_timedrdlock", (uintptr_t)&pthread_rwlock_timedrdlock_fake},
+    {"pthread_rwlock_timedwrlock", (uintptr_t)&pthread_rwlock_timedwrlock_fake},
+    {"pthread_rwlock_tryrdlock", (uintptr_t)&pthread_rwlock_tryrdlock_fake},
+    {"pthread_rwlock_trywrlock", (uintptr_t)&pthread_rwlock_trywrlock_fake},
+    {"pthread_rwlock_unlock", (uintptr_t)&pthread_rwlock_unlock_fake},
     {"pthread_attr_init", (uintptr_t)&pthread_attr_init},
     {"pthread_attr_destroy", (uintptr_t)&pthread_attr_destroy},
     {"pthread_attr_setdetachstate", (uintptr_t)&pthread_attr_setdetachstate},
     {"pthread_attr_setstacksize", (uintptr_t)&pthread_attr_setstacksize},
 
+    // ===== ATOMICS (libgcc / libatomic) =====
+    ATOMIC_DYNLIB_ENTRIES,
+
     // ===== MATH FUNCTIONS =====
     {"sin", (uintptr_t)&sin},
     {"cos", (uintptr_t)&cos},
@@ -460,7 +441,9 @@ DynLibFunction default_dynlib[] = {
     {"pow", (uintptr_t)&pow},
     {"sqrt", (uintptr_t)&sqrt},
     {"expf", (uintptr_t)&expf},
+    {"exp2f", (uintptr_t)&exp2f},
     {"logf", (uintptr_t)&logf},
+    {"log2f", (uintptr_t)&log2f},
     {"log10f", (uintptr_t)&log10f},
     {"powf", (uintptr_t)&powf},
     {"sqrtf", (uintptr_t)&sqrtf},
@@ -480,13 +463,16 @@ DynLibFunction default_dynlib[] = {
     {"ldexpf", (uintptr_t)&ldexpf},
 
     // ===== TIME FUNCTIONS (Enhanced) =====
-    {"time", (uintptr_t)&time},
-    {"gettimeofday", (uintptr_t)&gettimeofday_vita},
+    {"time", (uintptr_t)&sys_time},
+    {"gettimeofday", (uintptr_t)&sys_gettimeofday},
+    {"clock_gettime", (uintptr_t)&sys_clock_gettime},
+    {"clock_getres", (uintptr_t)&sys_clock_getres},
+    {"nanosleep", (uintptr_t)&sys_nanosleep},
     {"localtime", (uintptr_t)&localtime},
     {"gmtime", (uintptr_t)&gmtime},
     {"mktime", (uintptr_t)&mktime},
     {"strftime", (uintptr_t)&strftime},
-    {"clock", (uintptr_t)&clock},
+    {"clock", (uintptr_t)&sys_clock},
     {"difftime", (uintptr_t)&difftime},
 
     // ===== PROCESS/SYSTEM FUNCTIONS =====
@@ -770,7 +756,6 @@ DynLibFunction default_dynlib[] = {
     // ===== ADDITIONAL ANDROID NDK FUNCTIONS =====
     {"usleep", (uintptr_t)&usleep},
     {"sleep", (uintptr_t)&sleep},
-    {"nanosleep", (uintptr_t)&nanosleep},
 
     // Additional common Android game symbols
     {"__aeabi_memcpy", (uintptr_t)&memcpy},
@@ -8,27 +8,149 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <malloc.h>
 #include <sys/stat.h>
 #include "fios.h"
+#include "asset_pack.h"
+#include "fios_stats.h"
+#include "fios_index.h"
+#include "fios_sched.h"
+#include "io_patch.h"
+
+// Redirect rules: '*' stands for one whole path segment
+#define FIOS_REDIRECT_MAX_WILDCARDS 4
+#define FIOS_REDIRECT_MAX_NODES 0xFFFF // Trie links are 16-bit
+
+// Stat cache: 4-way set associative, keyed by the untranslated path.
+// Longer paths than FIOS_CACHE_PATH_MAX simply aren't cached.
+#define FIOS_CACHE_SETS 64
+#define FIOS_CACHE_WAYS 4
+#define FIOS_CACHE_PATH_MAX 160
+
+// File copies: the caller reads into a ring of buffers while a helper
+// thread writes them out, so read and write latency overlap
+#define FIOS_COPY_CHUNK (256 * 1024)
+#define FIOS_COPY_BUFFERS 3
+#define FIOS_COPY_THREAD_PRIORITY 160
+#define FIOS_COPY_THREAD_STACK (16 * 1024)
+
+// Save writer: closed save streams are written out by a background thread
+#define FIOS_SAVE_THREAD_PRIORITY 160
+#define FIOS_SAVE_THREAD_STACK (16 * 1024)
+#define FIOS_SAVE_WAIT_US 1000
+#define FIOS_SAVE_TMP ".fios-tmp"
+#define FIOS_SAVE_NEW ".fios-new"
 
-// FIOS configuration
-#define FIOS_BUFFER_SIZE (256 * 1024)  // 256KB buffer
-#define MAX_PATH_REDIRECTS 32
+typedef struct {
+    const char *from;
+    const char *to;
+} FiosDefaultRedirect;
+
+typedef enum {
+    REDIRECT_FILE,     // From FIOS_REDIRECTS_PATH, replaced on every load
+    REDIRECT_RUNTIME,  // fios_add_redirect
+} FiosRedirectOrigin;
+
+// A rule as configured; compiled into a FiosRedirectTable
+typedef struct {
+    char *from;
+    char *to;
+    int priority;
+    FiosRedirectOrigin origin;
+} FiosRedirectSource;
+
+typedef struct {
+    const char *from;
+    const char *to;
+    uint32_t to_len;
+    int priority;
+    int wildcards;     // '*' segments in to, filled from the pattern's in order
+} FiosRedirectRule;
+
+// Rule patterns compiled into a byte trie. Children of a node form a
+// sibling list; a '*' segment is a separate wild link. Node 0 is the root
+// and index 0 doubles as "none".
+typedef struct {
+    char c;
+    int32_t rule;      // Rule whose pattern ends here, -1 if none
+    uint16_t child;
+    uint16_t sibling;
+    uint16_t wild;
+} FiosTrieNode;
+
+// Immutable once published. Replaced tables stay allocated until
+// fios_cleanup, since a translation may still be walking one.
+typedef struct FiosRedirectTable {
+    struct FiosRedirectTable *retired;
+    uint32_t rule_count;
+    uint32_t node_count;
+    FiosRedirectRule *rules;
+    FiosTrieNode *nodes;
+} FiosRedirectTable;
+
+typedef struct {
+    const char *start;
+    size_t len;
+} FiosCapture;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t stamp;    // Last use, 0 marks an empty way
+    int exists;        // 0 for a cached "does not exist"
+    SceOff size;
+    char path[FIOS_CACHE_PATH_MAX];
+    char translated[FIOS_CACHE_PATH_MAX];
+} FiosCacheEntry;
 
-// Path redirect structure
 typedef struct {
-    char from[256];
-    char to[256];
-} PathRedirect;
+    uint32_t hits;
+    uint32_t negative_hits;
+    uint32_t misses;
+    uint32_t invalidations;
+} FiosCacheStats;
+
+// One copy in flight; everything it touches is its own
+typedef struct {
+    SceUID src_fd;
+    SceUID dst_fd;
+    uint8_t *buffers[FIOS_COPY_BUFFERS];
+    int lengths[FIOS_COPY_BUFFERS]; // 0 marks the end of the source
+    SceUID filled;  // Buffers ready to write
+    SceUID free;    // Buffers ready to read into
+    volatile int write_error;
+} FiosCopyJob;
+
+// A save file's complete contents, waiting for the writer thread
+typedef struct FiosSaveJob {
+    struct FiosSaveJob *next;
+    void *data;
+    size_t size;
+    char path[FIOS_PATH_MAX];
+} FiosSaveJob;
 
 // FIOS state
 static int fios_initialized = 0;
-static void *fios_buffer = NULL;
-static PathRedirect path_redirects[MAX_PATH_REDIRECTS];
-static int num_redirects = 0;
+static FiosRedirectTable *redirect_table = NULL; // Published with release, read with acquire
+
+static SceKernelLwMutexWork redirect_lock;  // Serializes rule changes, not translations
+static FiosRedirectSource *redirect_sources = NULL;
+static uint32_t redirect_source_count = 0;
+
+static SceKernelLwMutexWork stat_cache_lock;
+static FiosCacheEntry stat_cache[FIOS_CACHE_SETS][FIOS_CACHE_WAYS];
+static uint32_t stat_cache_clock = 0;
+static uint32_t stat_cache_generation = 0;
+static FiosCacheStats stat_cache_stats;
+
+static SceKernelLwMutexWork save_lock;
+static FiosSaveJob *save_queue = NULL;   // Oldest first
+static FiosSaveJob *save_current = NULL; // Being written right now
+static SceUID save_sema = -1;
+static SceUID save_thread = -1;
 
 // Asset path mappings for Fluffy Diver
-static const PathRedirect default_redirects[] = {
+static const FiosDefaultRedirect default_redirects[] = {
     // Android asset paths -> Vita paths
     {"/android_asset/", "ux0:data/fluffydiver/assets/"},
     {"assets/", "ux0:data/fluffydiver/assets/"},
@@ -57,29 +179,36 @@ int fios_init(void) {
 
     printf("FIOS: Initializing file I/O system...\n");
 
-    // Allocate buffer for FIOS operations
-    fios_buffer = malloc(FIOS_BUFFER_SIZE);
-    if (!fios_buffer) {
-        printf("FIOS: ERROR - Failed to allocate buffer\n");
+    // Path redirects: the built-in rules, then any from the data directory
+    if (sceKernelCreateLwMutex(&redirect_lock, "fios_redirects", 0, 0, NULL) < 0) {
+        printf("FIOS: ERROR - Failed to create redirect lock\n");
         return -1;
     }
-
-    // Initialize path redirects
-    num_redirects = 0;
-
-    // Add default redirects
-    int default_count = sizeof(default_redirects) / sizeof(default_redirects[0]);
-    for (int i = 0; i < default_count && num_redirects < MAX_PATH_REDIRECTS; i++) {
-        strcpy(path_redirects[num_redirects].from, default_redirects[i].from);
-        strcpy(path_redirects[num_redirects].to, default_redirects[i].to);
-        num_redirects++;
+    if (fios_load_redirects(FIOS_REDIRECTS_PATH) < 0 && fios_load_redirects(NULL) < 0) {
+        sceKernelDeleteLwMutex(&redirect_lock);
+        return -1;
     }
+    fios_print_redirects();
 
-    printf("FIOS: Added %d default path redirects\n", num_redirects);
+    // Stat cache
+    if (sceKernelCreateLwMutex(&stat_cache_lock, "fios_stat_cache", 0, 0, NULL) < 0) {
+        printf("FIOS: ERROR - Failed to create stat cache lock\n");
+        return -1;
+    }
+    memset(stat_cache, 0, sizeof(stat_cache));
+    memset(&stat_cache_stats, 0, sizeof(stat_cache_stats));
 
     // Create necessary directories
     fios_create_directories();
 
+    // Finish saves a crash interrupted, then start the writer
+    fios_save_recover(FIOS_SAVE_DIR);
+    fios_save_init();
+
+    // Packed assets take priority over loose files when present
+    asset_pack_init(ASSET_PACK_PATH);
+    fios_index_init();
+
     fios_initialized = 1;
     printf("FIOS: Initialization complete\n");
     return 0;
@@ -95,7 +224,7 @@ void fios_create_directories(void) {
         "ux0:data/fluffydiver/data",
         "ux0:data/fluffydiver/cache",
         "ux0:data/fluffydiver/sdcard",
-        "ux0:data/fluffydiver/save",
+        FIOS_SAVE_DIR,
         "ux0:data/fluffydiver/logs",
         NULL
     };
@@ -106,124 +235,992 @@ void fios_create_directories(void) {
     }
 }
 
-// Translate Android path to Vita path
-char *fios_translate_path(const char *path) {
-    if (!path) {
+// ===== PATH REDIRECTS =====
+//
+// FIOS_REDIRECTS_PATH holds one rule per line, on top of the built-in ones:
+//
+//     # pattern = target [priority]
+//     assets/music/ = ur0:data/fluffydiver/music/ 10
+//     assets/levels/*/textures/ = ur0:data/fluffydiver/textures/*/
+//
+// A path is rewritten by the matching rule with the highest priority (0 if
+// not given), then the longest match, then the last rule listed. A '*'
+// matches one whole path segment, and each '*' in the target is replaced by
+// the segment the pattern's '*' at the same position matched. Rules are
+// checked when loaded; a bad rule is skipped with a warning.
+//
+// Every change compiles all rules into a new table that is published with
+// one pointer store, so a translation always sees one complete rule set.
+
+static void fios_cache_publish(FiosRedirectTable *table);
+
+// '*' segments in a pattern or target, -1 if a '*' shares its segment
+static int fios_redirect_wildcards(const char *pattern) {
+    int count = 0;
+    for (const char *p = pattern; *p; p++) {
+        if (*p != '*') continue;
+        if ((p != pattern && p[-1] != '/') || (p[1] && p[1] != '/')) return -1;
+        count++;
+    }
+    return count;
+}
+
+// NULL if the rule is usable, otherwise why not
+static const char *fios_redirect_check(const char *from, const char *to) {
+    size_t from_len = strlen(from);
+    size_t to_len = strlen(to);
+    if (from_len == 0) return "empty pattern";
+    if (from_len >= FIOS_PATH_MAX || to_len >= FIOS_PATH_MAX) return "path too long";
+
+    int from_wildcards = fios_redirect_wildcards(from);
+    int to_wildcards = fios_redirect_wildcards(to);
+    if (from_wildcards < 0 || to_wildcards < 0) return "'*' must be a whole path segment";
+    if (from_wildcards > FIOS_REDIRECT_MAX_WILDCARDS) return "too many '*' segments";
+    if (to_wildcards > from_wildcards) return "target has more '*' segments than the pattern";
+    return NULL;
+}
+
+// A target on a device must have its fixed directory part in place, or
+// every path the rule catches would fail to open
+static int fios_redirect_target_exists(const char *to) {
+    if (!strchr(to, ':')) return 1; // Rewrites part of a path
+
+    size_t len = strcspn(to, "*");
+    while (len && to[len - 1] != '/') len--;
+    if (len == 0) return 1; // Device root
+
+    char dir[FIOS_PATH_MAX];
+    memcpy(dir, to, len - 1);
+    dir[len - 1] = '\0';
+
+    SceIoStat stat;
+    return sceIoGetstat(dir, &stat) >= 0 && SCE_S_ISDIR(stat.st_mode);
+}
+
+static void fios_redirect_sources_free(FiosRedirectSource *sources, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        free(sources[i].from);
+        free(sources[i].to);
+    }
+    free(sources);
+}
+
+static void fios_redirect_add_rule(FiosRedirectTable *table, char **strings, const char *from,
+                                   const char *to, int priority) {
+    uint32_t index = table->rule_count++;
+    FiosRedirectRule *rule = &table->rules[index];
+
+    size_t from_len = strlen(from);
+    size_t to_len = strlen(to);
+    rule->from = memcpy(*strings, from, from_len + 1);
+    rule->to = memcpy(*strings + from_len + 1, to, to_len + 1);
+    *strings += from_len + to_len + 2;
+    rule->to_len = to_len;
+    rule->priority = priority;
+    rule->wildcards = fios_redirect_wildcards(to);
+
+    uint32_t node = 0;
+    for (const char *p = from; *p; p++) {
+        FiosTrieNode *parent = &table->nodes[node];
+        uint16_t n = *p == '*' ? parent->wild : parent->child;
+        while (n && *p != '*' && table->nodes[n].c != *p) n = table->nodes[n].sibling;
+
+        if (!n) {
+            n = (uint16_t)table->node_count++;
+            table->nodes[n].c = *p == '*' ? 0 : *p;
+            table->nodes[n].rule = -1;
+            if (*p == '*') {
+                parent->wild = n;
+            } else {
+                table->nodes[n].sibling = parent->child;
+                parent->child = n;
+            }
+        }
+        node = n;
+    }
+
+    // The same pattern twice: higher priority wins, the later rule on a tie
+    int32_t previous = table->nodes[node].rule;
+    if (previous < 0 || table->rules[previous].priority <= priority) {
+        table->nodes[node].rule = index;
+    }
+}
+
+// Built-in rules first, then sources in order; NULL if they don't fit
+static FiosRedirectTable *fios_redirect_compile(const FiosRedirectSource *sources, uint32_t count) {
+    uint32_t default_count = sizeof(default_redirects) / sizeof(default_redirects[0]);
+    uint32_t rule_count = default_count + count;
+    size_t max_nodes = 1;
+    size_t strings = 0;
+
+    for (uint32_t i = 0; i < rule_count; i++) {
+        const char *from = i < default_count ? default_redirects[i].from : sources[i - default_count].from;
+        const char *to = i < default_count ? default_redirects[i].to : sources[i - default_count].to;
+        max_nodes += strlen(from);
+        strings += strlen(from) + strlen(to) + 2;
+    }
+    if (max_nodes > FIOS_REDIRECT_MAX_NODES) {
+        printf("FIOS: ERROR - Redirect rules too large (%u trie nodes)\n", (unsigned)max_nodes);
         return NULL;
     }
 
-    static char translated_path[512];
-    strcpy(translated_path, path);
+    FiosRedirectTable *table = calloc(1, sizeof(FiosRedirectTable) + rule_count * sizeof(FiosRedirectRule) +
+                                             max_nodes * sizeof(FiosTrieNode) + strings);
+    if (!table) {
+        printf("FIOS: ERROR - Out of memory compiling redirect rules\n");
+        return NULL;
+    }
+    table->rules = (FiosRedirectRule *)(table + 1);
+    table->nodes = (FiosTrieNode *)(table->rules + rule_count);
+    table->nodes[0].rule = -1;
+    table->node_count = 1;
+
+    char *next_string = (char *)(table->nodes + max_nodes);
+    for (uint32_t i = 0; i < default_count; i++) {
+        fios_redirect_add_rule(table, &next_string, default_redirects[i].from, default_redirects[i].to, 0);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        fios_redirect_add_rule(table, &next_string, sources[i].from, sources[i].to, sources[i].priority);
+    }
+    return table;
+}
 
-    // Apply path redirects
-    for (int i = 0; i < num_redirects; i++) {
-        const char *from = path_redirects[i].from;
-        const char *to = path_redirects[i].to;
+// Compile sources and make them the current rules. On success the array
+// replaces redirect_sources; freeing the old one is up to the caller.
+// Caller holds redirect_lock.
+static int fios_redirect_publish_locked(FiosRedirectSource *sources, uint32_t count) {
+    FiosRedirectTable *table = fios_redirect_compile(sources, count);
+    if (!table) {
+        return -1;
+    }
 
-        char *match = strstr(translated_path, from);
-        if (match == translated_path) { // Must match at beginning
-            // Replace the path
-            char temp[512];
-            strcpy(temp, to);
-            strcat(temp, path + strlen(from));
-            strcpy(translated_path, temp);
-            break;
+    // Cached stat results were looked up under the old translations
+    table->retired = redirect_table;
+    fios_cache_publish(table);
+
+    redirect_sources = sources;
+    redirect_source_count = count;
+    return 0;
+}
+
+typedef struct {
+    int32_t rule;
+    size_t len;  // Path bytes the pattern covered
+    FiosCapture captures[FIOS_REDIRECT_MAX_WILDCARDS];
+} FiosRedirectMatch;
+
+static int fios_redirect_better(const FiosRedirectTable *table, int32_t rule, size_t len,
+                                const FiosRedirectMatch *best) {
+    if (best->rule < 0) return 1;
+    int priority = table->rules[rule].priority;
+    int best_priority = table->rules[best->rule].priority;
+    if (priority != best_priority) return priority > best_priority;
+    if (len != best->len) return len > best->len;
+    return rule > best->rule;
+}
+
+// Literal bytes are followed in a loop; only a '*' segment recurses, so the
+// depth is bounded by FIOS_REDIRECT_MAX_WILDCARDS
+static void fios_redirect_match(const FiosRedirectTable *table, uint32_t node, const char *path, size_t pos,
+                                FiosCapture *captures, int depth, FiosRedirectMatch *best) {
+    for (;;) {
+        const FiosTrieNode *n = &table->nodes[node];
+        if (n->rule >= 0 && fios_redirect_better(table, n->rule, pos, best)) {
+            best->rule = n->rule;
+            best->len = pos;
+            memcpy(best->captures, captures, depth * sizeof(FiosCapture));
         }
+        if (!path[pos]) return;
+
+        // Patterns only have '*' right after a '/', so pos starts a segment here
+        if (n->wild && path[pos] != '/' && depth < FIOS_REDIRECT_MAX_WILDCARDS) {
+            size_t end = pos;
+            while (path[end] && path[end] != '/') end++;
+            captures[depth].start = path + pos;
+            captures[depth].len = end - pos;
+            fios_redirect_match(table, n->wild, path, end, captures, depth + 1, best);
+        }
+
+        uint16_t child = n->child;
+        while (child && table->nodes[child].c != path[pos]) child = table->nodes[child].sibling;
+        if (!child) return;
+        node = child;
+        pos++;
+    }
+}
+
+// Translate Android path to Vita path with the current redirect rules;
+// paths no rule matches are copied unchanged. Writes into out (no shared
+// state), returns the translated length or -1 if it doesn't fit.
+int fios_translate_path(const char *path, char *out, size_t size) {
+    if (!path || !out || size == 0) {
+        return -1;
+    }
+
+    const FiosRedirectTable *table = __atomic_load_n(&redirect_table, __ATOMIC_ACQUIRE);
+    FiosRedirectMatch best;
+    best.rule = -1;
+    best.len = 0;
+    if (table) {
+        FiosCapture captures[FIOS_REDIRECT_MAX_WILDCARDS];
+        fios_redirect_match(table, 0, path, 0, captures, 0, &best);
+    }
+
+    const FiosRedirectRule *rule = best.rule >= 0 ? &table->rules[best.rule] : NULL;
+    const char *rest = path + best.len;
+    size_t rest_len = strlen(rest);
+    size_t prefix_len = rule ? rule->to_len : 0;
+    for (int i = 0; rule && i < rule->wildcards; i++) {
+        prefix_len += best.captures[i].len - 1;
     }
 
-    // Convert forward slashes to appropriate separators if needed
-    // (Vita handles forward slashes fine, so we don't need to convert)
+    if (prefix_len + rest_len >= size) {
+        out[0] = '\0';
+        return -1;
+    }
+
+    if (rule && !rule->wildcards) {
+        memcpy(out, rule->to, prefix_len);
+    } else if (rule) {
+        char *dst = out;
+        int capture = 0;
+        for (const char *p = rule->to; *p; p++) {
+            if (*p == '*') {
+                memcpy(dst, best.captures[capture].start, best.captures[capture].len);
+                dst += best.captures[capture++].len;
+            } else {
+                *dst++ = *p;
+            }
+        }
+    }
+    memcpy(out + prefix_len, rest, rest_len + 1);
 
-    return translated_path;
+    // Vita handles forward slashes fine, so no separator conversion
+    return (int)(prefix_len + rest_len);
 }
 
-// Add custom path redirect
+// Add custom path redirect at priority 0. It wins over an earlier rule for
+// the same pattern at that priority.
 int fios_add_redirect(const char *from, const char *to) {
-    if (num_redirects >= MAX_PATH_REDIRECTS) {
-        printf("FIOS: ERROR - Maximum path redirects reached\n");
+    const char *reason = from && to ? fios_redirect_check(from, to) : "missing path";
+    if (reason) {
+        printf("FIOS: ERROR - Invalid redirect %s -> %s: %s\n", from ? from : "(null)", to ? to : "(null)", reason);
+        return -1;
+    }
+    if (!__atomic_load_n(&redirect_table, __ATOMIC_ACQUIRE)) {
+        printf("FIOS: ERROR - Redirect added before fios_init: %s -> %s\n", from, to);
         return -1;
     }
 
-    strcpy(path_redirects[num_redirects].from, from);
-    strcpy(path_redirects[num_redirects].to, to);
-    num_redirects++;
+    sceKernelLockLwMutex(&redirect_lock, 1, NULL);
+    FiosRedirectSource *old_sources = redirect_sources;
+    uint32_t old_count = redirect_source_count;
+    FiosRedirectSource *sources = malloc((old_count + 1) * sizeof(FiosRedirectSource));
+    char *from_copy = strdup(from);
+    char *to_copy = strdup(to);
+    int result = -1;
+    if (sources && from_copy && to_copy) {
+        if (old_count) memcpy(sources, old_sources, old_count * sizeof(FiosRedirectSource));
+        sources[old_count].from = from_copy;
+        sources[old_count].to = to_copy;
+        sources[old_count].priority = 0;
+        sources[old_count].origin = REDIRECT_RUNTIME;
+        result = fios_redirect_publish_locked(sources, old_count + 1);
+    }
+    if (result == 0) {
+        free(old_sources);
+    } else {
+        free(sources);
+        free(from_copy);
+        free(to_copy);
+    }
+    sceKernelUnlockLwMutex(&redirect_lock, 1);
 
-    printf("FIOS: Added redirect: %s -> %s\n", from, to);
-    return 0;
+    if (result == 0) {
+        printf("FIOS: Added redirect: %s -> %s\n", from, to);
+    }
+    return result;
 }
 
-// Check if file exists (with path translation)
-int fios_file_exists(const char *path) {
-    char *translated = fios_translate_path(path);
+// One "pattern = target [priority]" line; 0 on success, or -1 with *reason set
+static int fios_redirect_parse(char *text, char *from, char *to, int *priority, const char **reason) {
+    // Both buffers are FIOS_PATH_MAX (512) bytes
+    int end = 0;
+    if (sscanf(text, "%511s = %511s %n", from, to, &end) != 2 || end == 0) {
+        *reason = "expected \"pattern = target [priority]\"";
+        return -1;
+    }
 
-    SceIoStat stat;
-    int result = sceIoGetstat(translated, &stat) >= 0;
+    *priority = 0;
+    char *tail = text + end;
+    if (*tail) {
+        char *stop;
+        long value = strtol(tail, &stop, 10);
+        stop += strspn(stop, " \t");
+        if (stop == tail || *stop || value < -1000000 || value > 1000000) {
+            *reason = "priority must be a number";
+            return -1;
+        }
+        *priority = (int)value;
+    }
+
+    *reason = fios_redirect_check(from, to);
+    if (!*reason && !fios_redirect_target_exists(to)) {
+        *reason = "target directory does not exist";
+    }
+    return *reason ? -1 : 0;
+}
+
+// Replace the rules from the previous load with the ones in path (NULL or a
+// missing file: none). Returns the number loaded, -1 if the set could not
+// be compiled (the current rules stay).
+int fios_load_redirects(const char *path) {
+    FiosRedirectSource *parsed = NULL;
+    uint32_t parsed_count = 0;
+    uint32_t parsed_capacity = 0;
+    int rejected = 0;
+    int failed = 0;
+
+    FILE *file = path ? fopen(path, "r") : NULL;
+    if (file) {
+        char line[2 * FIOS_PATH_MAX + 32];
+        int line_number = 0;
+
+        while (!failed && fgets(line, sizeof(line), file)) {
+            line_number++;
+            if (!strchr(line, '\n') && !feof(file)) {
+                printf("FIOS: WARNING - %s:%d: line too long, rule skipped\n", path, line_number);
+                int c;
+                while ((c = fgetc(file)) != EOF && c != '\n') {
+                }
+                rejected++;
+                continue;
+            }
+
+            line[strcspn(line, "\r\n")] = '\0';
+            char *text = line + strspn(line, " \t");
+            if (*text == '\0' || *text == '#' || *text == ';') {
+                continue;
+            }
+
+            char from[FIOS_PATH_MAX];
+            char to[FIOS_PATH_MAX];
+            int priority;
+            const char *reason;
+            if (fios_redirect_parse(text, from, to, &priority, &reason) < 0) {
+                printf("FIOS: WARNING - %s:%d: %s, rule skipped\n", path, line_number, reason);
+                rejected++;
+                continue;
+            }
+
+            if (parsed_count == parsed_capacity) {
+                uint32_t capacity = parsed_capacity ? parsed_capacity * 2 : 16;
+                FiosRedirectSource *grown = realloc(parsed, capacity * sizeof(FiosRedirectSource));
+                if (!grown) {
+                    failed = 1;
+                    break;
+                }
+                parsed = grown;
+                parsed_capacity = capacity;
+            }
+
+            FiosRedirectSource *source = &parsed[parsed_count];
+            source->from = strdup(from);
+            source->to = strdup(to);
+            source->priority = priority;
+            source->origin = REDIRECT_FILE;
+            parsed_count++;
+            if (!source->from || !source->to) failed = 1;
+        }
+        fclose(file);
+    }
+
+    if (failed) {
+        printf("FIOS: ERROR - Out of memory reading %s\n", path);
+        fios_redirect_sources_free(parsed, parsed_count);
+        return -1;
+    }
 
-    if (result) {
+    sceKernelLockLwMutex(&redirect_lock, 1, NULL);
+
+    // The file's rules, then the runtime ones, so fios_add_redirect still wins ties
+    uint32_t count = parsed_count;
+    for (uint32_t i = 0; i < redirect_source_count; i++) {
+        if (redirect_sources[i].origin == REDIRECT_RUNTIME) count++;
+    }
+
+    int result = -1;
+    FiosRedirectSource *old_sources = redirect_sources;
+    uint32_t old_count = redirect_source_count;
+    FiosRedirectSource *sources = malloc((count + 1) * sizeof(FiosRedirectSource));
+    if (sources) {
+        if (parsed_count) memcpy(sources, parsed, parsed_count * sizeof(FiosRedirectSource));
+        uint32_t n = parsed_count;
+        for (uint32_t i = 0; i < old_count; i++) {
+            if (old_sources[i].origin == REDIRECT_RUNTIME) sources[n++] = old_sources[i];
+        }
+
+        result = fios_redirect_publish_locked(sources, count);
+        if (result < 0) free(sources);
+    }
+
+    if (result == 0) {
+        // The old file rules are gone; the runtime ones moved to the new array
+        for (uint32_t i = 0; i < old_count; i++) {
+            if (old_sources[i].origin != REDIRECT_FILE) continue;
+            free(old_sources[i].from);
+            free(old_sources[i].to);
+        }
+        free(old_sources);
+        free(parsed);
+    } else {
+        fios_redirect_sources_free(parsed, parsed_count);
+    }
+    sceKernelUnlockLwMutex(&redirect_lock, 1);
+
+    if (result < 0) {
+        return -1;
+    }
+    if (file) {
+        printf("FIOS: Loaded %u redirect rules from %s (%d rejected)\n", parsed_count, path, rejected);
+    }
+    return (int)parsed_count;
+}
+
+// ===== STAT CACHE =====
+
+static uint32_t fios_hash_path(const char *path) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    while (*path) {
+        hash ^= (uint8_t)*path++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Stat a path through the cache. Returns 1 if it exists, 0 if not.
+static int fios_cached_stat(const char *path, SceOff *size) {
+    uint32_t hash = fios_hash_path(path);
+    FiosCacheEntry *set = stat_cache[hash & (FIOS_CACHE_SETS - 1)];
+    int cacheable = fios_initialized && strlen(path) < FIOS_CACHE_PATH_MAX;
+    uint32_t generation = 0;
+
+    if (cacheable) {
+        sceKernelLockLwMutex(&stat_cache_lock, 1, NULL);
+        for (int i = 0; i < FIOS_CACHE_WAYS; i++) {
+            FiosCacheEntry *e = &set[i];
+            if (e->stamp && e->hash == hash && strcmp(e->path, path) == 0) {
+                e->stamp = ++stat_cache_clock;
+                int exists = e->exists;
+                *size = e->size;
+                stat_cache_stats.hits++;
+                if (!exists) stat_cache_stats.negative_hits++;
+                sceKernelUnlockLwMutex(&stat_cache_lock, 1);
+                return exists;
+            }
+        }
+        stat_cache_stats.misses++;
+        generation = stat_cache_generation;
+        sceKernelUnlockLwMutex(&stat_cache_lock, 1);
+    }
+
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(path, translated, sizeof(translated)) < 0) {
+        *size = -1;
+        return 0;
+    }
+
+    // The directory index answers for the asset tree without touching the card
+    int64_t indexed_size;
+    int exists = fios_index_stat(translated, &indexed_size);
+    if (exists >= 0) {
+        *size = indexed_size;
+    } else {
+        if (fios_is_save_path(translated)) {
+            fios_save_wait(translated);
+        }
+
+        SceIoStat stat;
+        exists = sceIoGetstat(translated, &stat) >= 0;
+        *size = exists ? stat.st_size : -1;
+    }
+
+    if (exists) {
         printf("FIOS: File exists: %s -> %s\n", path, translated);
     }
 
-    return result;
+    if (!cacheable || strlen(translated) >= FIOS_CACHE_PATH_MAX) {
+        return exists;
+    }
+
+    sceKernelLockLwMutex(&stat_cache_lock, 1, NULL);
+    // Anything invalidated (or any rule change) while we were in
+    // sceIoGetstat may be stale; the generation was read before translating
+    if (generation == stat_cache_generation) {
+        FiosCacheEntry *victim = &set[0];
+        for (int i = 0; i < FIOS_CACHE_WAYS; i++) {
+            FiosCacheEntry *e = &set[i];
+            if (e->stamp && e->hash == hash && strcmp(e->path, path) == 0) {
+                victim = e;
+                break;
+            }
+            if (e->stamp < victim->stamp) victim = e;
+        }
+
+        victim->hash = hash;
+        victim->stamp = ++stat_cache_clock;
+        victim->exists = exists;
+        victim->size = *size;
+        strcpy(victim->path, path);
+        strcpy(victim->translated, translated);
+    }
+    sceKernelUnlockLwMutex(&stat_cache_lock, 1);
+
+    return exists;
+}
+
+// Drop cached entries for a translated path and anything beneath it
+void fios_cache_drop(const char *translated) {
+    if (!fios_initialized) {
+        return;
+    }
+
+    size_t len = strlen(translated);
+    fios_index_invalidate(translated);
+
+    sceKernelLockLwMutex(&stat_cache_lock, 1, NULL);
+    stat_cache_generation++;
+    for (int s = 0; s < FIOS_CACHE_SETS; s++) {
+        for (int i = 0; i < FIOS_CACHE_WAYS; i++) {
+            FiosCacheEntry *e = &stat_cache[s][i];
+            if (e->stamp && strncmp(e->translated, translated, len) == 0) {
+                e->stamp = 0;
+                stat_cache_stats.invalidations++;
+            }
+        }
+    }
+    sceKernelUnlockLwMutex(&stat_cache_lock, 1);
+}
+
+// Empty the cache and make table the current redirect rules in one step.
+// The generation moves before any translation can see the new rules, so a
+// fill that started under the old ones is dropped, and a lookup that
+// misses after this reads the new generation and the new table together.
+static void fios_cache_publish(FiosRedirectTable *table) {
+    if (!fios_initialized) {
+        __atomic_store_n(&redirect_table, table, __ATOMIC_RELEASE);
+        return;
+    }
+
+    sceKernelLockLwMutex(&stat_cache_lock, 1, NULL);
+    stat_cache_generation++;
+    for (int s = 0; s < FIOS_CACHE_SETS; s++) {
+        for (int i = 0; i < FIOS_CACHE_WAYS; i++) {
+            if (stat_cache[s][i].stamp) stat_cache_stats.invalidations++;
+            stat_cache[s][i].stamp = 0;
+        }
+    }
+    __atomic_store_n(&redirect_table, table, __ATOMIC_RELEASE);
+    sceKernelUnlockLwMutex(&stat_cache_lock, 1);
+}
+
+// Forget cached results for path (untranslated); call before creating,
+// truncating or deleting it outside of FIOS
+void fios_cache_invalidate(const char *path) {
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(path, translated, sizeof(translated)) >= 0) {
+        fios_cache_drop(translated);
+    }
+}
+
+// Print stat cache counters (for debugging)
+void fios_cache_report(void) {
+    sceKernelLockLwMutex(&stat_cache_lock, 1, NULL);
+    FiosCacheStats stats = stat_cache_stats;
+    sceKernelUnlockLwMutex(&stat_cache_lock, 1);
+
+    uint32_t lookups = stats.hits + stats.misses;
+    printf("FIOS: Stat cache: %u lookups, %u hits (%u negative), %u misses, %u invalidations\n",
+           lookups, stats.hits, stats.negative_hits, stats.misses, stats.invalidations);
+    printf("FIOS: Stat cache saved %u sceIoGetstat calls (%u%% hit rate)\n",
+           stats.hits, lookups ? stats.hits * 100 / lookups : 0);
+}
+
+// Check if file exists (with path translation)
+int fios_file_exists(const char *path) {
+    SceOff size;
+    uint64_t start = fios_stats_begin();
+    int exists = fios_cached_stat(path, &size);
+    fios_stats_record_path(path, FIOS_OP_STAT, 0, start);
+    return exists;
 }
 
 // Get file size (with path translation)
 long fios_file_size(const char *path) {
-    char *translated = fios_translate_path(path);
-
-    SceIoStat stat;
-    if (sceIoGetstat(translated, &stat) < 0) {
+    SceOff size;
+    uint64_t start = fios_stats_begin();
+    int exists = fios_cached_stat(path, &size);
+    fios_stats_record_path(path, FIOS_OP_STAT, 0, start);
+    if (!exists) {
         return -1;
     }
 
-    return stat.st_size;
+    return size;
+}
+
+// ===== FILE COPY =====
+
+static int fios_copy_writer(SceSize args, void *argp) {
+    FiosCopyJob *job = *(FiosCopyJob **)argp;
+
+    for (int slot = 0;; slot = (slot + 1) % FIOS_COPY_BUFFERS) {
+        sceKernelWaitSema(job->filled, 1, NULL);
+        int length = job->lengths[slot];
+        if (length == 0) break;
+
+        // After a failure keep draining, so the reader never blocks on a full ring
+        if (!job->write_error && sceIoWrite(job->dst_fd, job->buffers[slot], length) != length) {
+            job->write_error = 1;
+        }
+        sceKernelSignalSema(job->free, 1);
+    }
+
+    return sceKernelExitDeleteThread(0);
+}
+
+// Plain read/write loop on the job's first buffer
+static long long fios_copy_serial(FiosCopyJob *job) {
+    long long copied = 0;
+    int bytes_read;
+
+    while ((bytes_read = sceIoRead(job->src_fd, job->buffers[0], FIOS_COPY_CHUNK)) > 0) {
+        if (sceIoWrite(job->dst_fd, job->buffers[0], bytes_read) != bytes_read) return -1;
+        copied += bytes_read;
+    }
+    return bytes_read < 0 ? -1 : copied;
+}
+
+static long long fios_copy_pipelined(FiosCopyJob *job) {
+    job->filled = sceKernelCreateSema("fios_copy_filled", 0, 0, FIOS_COPY_BUFFERS, NULL);
+    job->free = sceKernelCreateSema("fios_copy_free", 0, FIOS_COPY_BUFFERS, FIOS_COPY_BUFFERS, NULL);
+    SceUID writer = -1;
+    if (job->filled >= 0 && job->free >= 0) {
+        writer = sceKernelCreateThread("fios_copy", fios_copy_writer, FIOS_COPY_THREAD_PRIORITY,
+                                       FIOS_COPY_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    }
+    if (writer >= 0 && sceKernelStartThread(writer, sizeof(job), &job) < 0) {
+        sceKernelDeleteThread(writer);
+        writer = -1;
+    }
+
+    long long copied = -1;
+    if (writer < 0) {
+        copied = fios_copy_serial(job);
+    } else {
+        int bytes_read = 0;
+        copied = 0;
+        for (int slot = 0;; slot = (slot + 1) % FIOS_COPY_BUFFERS) {
+            sceKernelWaitSema(job->free, 1, NULL);
+
+            bytes_read = job->write_error ? 0 : sceIoRead(job->src_fd, job->buffers[slot], FIOS_COPY_CHUNK);
+            job->lengths[slot] = bytes_read > 0 ? bytes_read : 0;
+            sceKernelSignalSema(job->filled, 1);
+            if (bytes_read <= 0) break;
+
+            copied += bytes_read;
+        }
+
+        sceKernelWaitThreadEnd(writer, NULL, NULL);
+        if (bytes_read < 0 || job->write_error) copied = -1;
+    }
+
+    if (job->filled >= 0) sceKernelDeleteSema(job->filled);
+    if (job->free >= 0) sceKernelDeleteSema(job->free);
+    return copied;
 }
 
 // Copy file with path translation
 int fios_copy_file(const char *src, const char *dst) {
-    char *src_translated = fios_translate_path(src);
-    char *dst_translated = fios_translate_path(dst);
+    char src_translated[FIOS_PATH_MAX];
+    char dst_translated[FIOS_PATH_MAX];
+    if (fios_translate_path(src, src_translated, sizeof(src_translated)) < 0 ||
+        fios_translate_path(dst, dst_translated, sizeof(dst_translated)) < 0) {
+        printf("FIOS: ERROR - Path too long: %s -> %s\n", src, dst);
+        return -1;
+    }
 
     printf("FIOS: Copying file: %s -> %s\n", src_translated, dst_translated);
 
-    SceUID src_fd = sceIoOpen(src_translated, SCE_O_RDONLY, 0);
-    if (src_fd < 0) {
-        printf("FIOS: ERROR - Cannot open source file: 0x%08X\n", src_fd);
+    FiosCopyJob job;
+    memset(&job, 0, sizeof(job));
+    job.filled = job.free = -1;
+    for (int i = 0; i < FIOS_COPY_BUFFERS; i++) {
+        job.buffers[i] = memalign(64, FIOS_COPY_CHUNK);
+        if (!job.buffers[i]) {
+            printf("FIOS: ERROR - Failed to allocate copy buffers\n");
+            for (int j = 0; j < i; j++) free(job.buffers[j]);
+            return -1;
+        }
+    }
+
+    long long copied = -1;
+    SceUInt64 start = sceKernelGetProcessTimeWide();
+
+    job.src_fd = sceIoOpen(src_translated, SCE_O_RDONLY, 0);
+    if (job.src_fd < 0) {
+        printf("FIOS: ERROR - Cannot open source file: 0x%08X\n", job.src_fd);
+    } else {
+        fios_cache_drop(dst_translated);
+        job.dst_fd = sceIoOpen(dst_translated, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+        if (job.dst_fd < 0) {
+            printf("FIOS: ERROR - Cannot create destination file: 0x%08X\n", job.dst_fd);
+        } else {
+            copied = fios_copy_pipelined(&job);
+            sceIoClose(job.dst_fd);
+            if (copied < 0) printf("FIOS: ERROR - Copy failed\n");
+        }
+        sceIoClose(job.src_fd);
+    }
+
+    for (int i = 0; i < FIOS_COPY_BUFFERS; i++) free(job.buffers[i]);
+    if (copied < 0) return -1;
+
+    SceUInt64 elapsed = sceKernelGetProcessTimeWide() - start;
+    printf("FIOS: File copied successfully, %lld bytes in %llu ms (%.1f MB/s)\n", copied, elapsed / 1000,
+           elapsed ? copied / (elapsed / 1000000.0) / (1024 * 1024) : 0.0);
+    return (int)copied;
+}
+
+// ===== SAVE WRITER =====
+//
+// A save is written to <path>.fios-tmp and synced, then renamed to
+// <path>.fios-new; a .fios-new file is always complete. Vita's rename won't
+// replace an existing file, so the old save is removed before .fios-new
+// takes its name. A crash at any point leaves either the old save, or a
+// .fios-new that fios_save_recover moves into place on the next boot. The
+// suffixes are ours alone so recovery never touches the game's own files.
+
+int fios_is_save_path(const char *translated) {
+    return strncmp(translated, FIOS_SAVE_DIR "/", sizeof(FIOS_SAVE_DIR)) == 0;
+}
+
+static int fios_save_finish(const char *path, const char *done) {
+    sceIoRemove(path);
+    int result = sceIoRename(done, path);
+    fios_cache_drop(path);
+    if (result < 0) {
+        printf("FIOS: ERROR - Cannot rename %s: 0x%08X\n", done, result);
         return -1;
     }
+    return 0;
+}
 
-    SceUID dst_fd = sceIoOpen(dst_translated, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
-    if (dst_fd < 0) {
-        printf("FIOS: ERROR - Cannot create destination file: 0x%08X\n", dst_fd);
-        sceIoClose(src_fd);
+static int fios_save_write(const char *path, const void *data, size_t size) {
+    char tmp[FIOS_PATH_MAX + sizeof(FIOS_SAVE_TMP)];
+    char done[FIOS_PATH_MAX + sizeof(FIOS_SAVE_NEW)];
+    snprintf(tmp, sizeof(tmp), "%s" FIOS_SAVE_TMP, path);
+    snprintf(done, sizeof(done), "%s" FIOS_SAVE_NEW, path);
+
+    SceUID fd = sceIoOpen(tmp, SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC, 0777);
+    if (fd < 0) {
+        printf("FIOS: ERROR - Cannot create %s: 0x%08X\n", tmp, fd);
         return -1;
     }
 
-    // Copy data using our buffer
-    int bytes_copied = 0;
-    int bytes_read;
+    // One sequential write, queued behind anything the game is waiting on
+    size_t written = 0;
+    while (written < size) {
+        int result = fios_sched_pwrite(fd, (const uint8_t *)data + written, size - written, written);
+        if (result <= 0) break;
+        written += result;
+    }
+    sceIoSyncByFd(fd, 0);
+    sceIoClose(fd);
 
-    while ((bytes_read = sceIoRead(src_fd, fios_buffer, FIOS_BUFFER_SIZE)) > 0) {
-        int bytes_written = sceIoWrite(dst_fd, fios_buffer, bytes_read);
-        if (bytes_written != bytes_read) {
-            printf("FIOS: ERROR - Write failed\n");
-            sceIoClose(src_fd);
-            sceIoClose(dst_fd);
-            return -1;
+    int result = written == size ? sceIoRename(tmp, done) : -1;
+    if (result < 0) {
+        printf("FIOS: ERROR - Save failed, keeping the previous %s\n", path);
+        sceIoRemove(tmp);
+        return -1;
+    }
+
+    return fios_save_finish(path, done);
+}
+
+static int fios_save_writer(SceSize args, void *argp) {
+    fios_sched_set_thread_class(0, FIOS_CLASS_WRITEBEHIND);
+
+    while (sceKernelWaitSema(save_sema, 1, NULL) >= 0) {
+        sceKernelLockLwMutex(&save_lock, 1, NULL);
+        FiosSaveJob *job = save_queue;
+        if (job) {
+            save_queue = job->next;
+            save_current = job;
         }
-        bytes_copied += bytes_written;
+        sceKernelUnlockLwMutex(&save_lock, 1);
+        if (!job) continue;
+
+        SceUInt64 start = sceKernelGetProcessTimeWide();
+        if (fios_save_write(job->path, job->data, job->size) == 0) {
+            printf("FIOS: Saved %s (%u bytes, %llu ms)\n", job->path, (unsigned)job->size,
+                   (sceKernelGetProcessTimeWide() - start) / 1000);
+        }
+
+        sceKernelLockLwMutex(&save_lock, 1, NULL);
+        save_current = NULL;
+        sceKernelUnlockLwMutex(&save_lock, 1);
+
+        free(job->data);
+        free(job);
+    }
+
+    fios_sched_thread_exit(0);
+    return sceKernelExitDeleteThread(0);
+}
+
+void fios_save_init(void) {
+    if (save_thread >= 0) {
+        return;
+    }
+
+    if (sceKernelCreateLwMutex(&save_lock, "fios_save", 0, 0, NULL) < 0) {
+        printf("FIOS: ERROR - Failed to create save lock, saves are written in place\n");
+        return;
     }
 
-    sceIoClose(src_fd);
-    sceIoClose(dst_fd);
+    save_sema = sceKernelCreateSema("fios_save_jobs", 0, 0, 0x7FFFFFFF, NULL);
+    if (save_sema >= 0) {
+        save_thread = sceKernelCreateThread("fios_save", fios_save_writer, FIOS_SAVE_THREAD_PRIORITY,
+                                            FIOS_SAVE_THREAD_STACK, 0, SCE_KERNEL_CPU_MASK_USER_1, NULL);
+    }
+    if (save_thread >= 0 && sceKernelStartThread(save_thread, 0, NULL) < 0) {
+        sceKernelDeleteThread(save_thread);
+        save_thread = -1;
+    }
+
+    if (save_thread < 0) {
+        printf("FIOS: ERROR - Failed to start save writer, saves are written in place\n");
+        if (save_sema >= 0) sceKernelDeleteSema(save_sema);
+        save_sema = -1;
+        sceKernelDeleteLwMutex(&save_lock);
+    }
+}
 
-    printf("FIOS: File copied successfully, %d bytes\n", bytes_copied);
-    return bytes_copied;
+static int fios_has_suffix(const char *path, size_t len, const char *suffix) {
+    size_t n = strlen(suffix);
+    return len > n && strcmp(path + len - n, suffix) == 0;
+}
+
+// Complete .fios-new files left by a crash and drop unfinished .fios-tmp files
+void fios_save_recover(const char *dir) {
+    SceUID d = sceIoDopen(dir);
+    if (d < 0) {
+        return;
+    }
+
+    SceIoDirent entry;
+    while (sceIoDread(d, &entry) > 0) {
+        char path[FIOS_PATH_MAX];
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entry.d_name) >= (int)sizeof(path)) continue;
+
+        if (SCE_S_ISDIR(entry.d_stat.st_mode)) {
+            fios_save_recover(path);
+            continue;
+        }
+
+        size_t len = strlen(path);
+        if (fios_has_suffix(path, len, FIOS_SAVE_NEW)) {
+            char done[FIOS_PATH_MAX];
+            strcpy(done, path);
+            path[len - strlen(FIOS_SAVE_NEW)] = '\0';
+            if (fios_save_finish(path, done) == 0) {
+                printf("FIOS: Recovered interrupted save %s\n", path);
+            }
+        } else if (fios_has_suffix(path, len, FIOS_SAVE_TMP)) {
+            printf("FIOS: Removing unfinished save %s\n", path);
+            sceIoRemove(path);
+        }
+    }
+
+    sceIoDclose(d);
+}
+
+// Takes ownership of data. Without the writer thread the save is written here.
+int fios_save_commit(const char *translated, void *data, size_t size) {
+    FiosSaveJob *job = save_thread >= 0 ? malloc(sizeof(FiosSaveJob)) : NULL;
+    if (!job || strlen(translated) >= sizeof(job->path)) {
+        free(job);
+        int result = fios_save_write(translated, data, size);
+        free(data);
+        return result;
+    }
+
+    strcpy(job->path, translated);
+    job->data = data;
+    job->size = size;
+    job->next = NULL;
+
+    // A newer version of a save that hasn't been started replaces the queued one
+    void *superseded = NULL;
+    sceKernelLockLwMutex(&save_lock, 1, NULL);
+    FiosSaveJob **tail = &save_queue;
+    for (; *tail; tail = &(*tail)->next) {
+        if (strcmp((*tail)->path, translated) == 0) {
+            superseded = (*tail)->data;
+            (*tail)->data = data;
+            (*tail)->size = size;
+            break;
+        }
+    }
+    if (!*tail) *tail = job;
+    sceKernelUnlockLwMutex(&save_lock, 1);
+
+    if (superseded) {
+        free(superseded);
+        free(job);
+    } else {
+        sceKernelSignalSema(save_sema, 1);
+    }
+    return 0;
+}
+
+// Block until queued saves of translated (or of everything, for NULL) are on
+// the card. The writer's I/O runs at foreground priority meanwhile, so the
+// write-behind rate cap doesn't hold up the caller.
+void fios_save_wait(const char *translated) {
+    if (save_thread < 0) {
+        return;
+    }
+
+    int boosted = 0;
+    for (;;) {
+        sceKernelLockLwMutex(&save_lock, 1, NULL);
+        int pending = save_current && (!translated || strcmp(save_current->path, translated) == 0);
+        for (FiosSaveJob *job = save_queue; job && !pending; job = job->next) {
+            pending = !translated || strcmp(job->path, translated) == 0;
+        }
+        sceKernelUnlockLwMutex(&save_lock, 1);
+
+        if (!pending) break;
+        if (!boosted) {
+            fios_sched_boost(save_thread, 1);
+            boosted = 1;
+        }
+        sceKernelDelayThread(FIOS_SAVE_WAIT_US);
+    }
+
+    if (boosted) fios_sched_boost(save_thread, 0);
 }
 
 // Create directory with path translation
 int fios_mkdir(const char *path) {
-    char *translated = fios_translate_path(path);
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(path, translated, sizeof(translated)) < 0) {
+        printf("FIOS: ERROR - Path too long: %s\n", path);
+        return -1;
+    }
 
+    fios_cache_drop(translated);
     int result = sceIoMkdir(translated, 0777);
     if (result < 0 && result != -17) { // EEXIST
         printf("FIOS: ERROR - Cannot create directory %s: 0x%08X\n", translated, result);
@@ -236,8 +1233,17 @@ int fios_mkdir(const char *path) {
 
 // Remove file with path translation
 int fios_remove(const char *path) {
-    char *translated = fios_translate_path(path);
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(path, translated, sizeof(translated)) < 0) {
+        printf("FIOS: ERROR - Path too long: %s\n", path);
+        return -1;
+    }
 
+    if (fios_is_save_path(translated)) {
+        fios_save_wait(translated);
+    }
+
+    fios_cache_drop(translated);
     int result = sceIoRemove(translated);
     if (result < 0) {
         printf("FIOS: ERROR - Cannot remove file %s: 0x%08X\n", translated, result);
@@ -248,12 +1254,33 @@ int fios_remove(const char *path) {
     return 0;
 }
 
-// List directory contents
+static void fios_count_loose(const char *name, uint32_t flags, uint32_t size, void *ctx) {
+    if (flags & FIOS_INDEX_LOOSE) (*(int *)ctx)++;
+}
+
+// Count directory entries
 int fios_list_directory(const char *path) {
-    char *translated = fios_translate_path(path);
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(path, translated, sizeof(translated)) < 0) {
+        printf("FIOS: ERROR - Path too long: %s\n", path);
+        return -1;
+    }
 
     printf("FIOS: Listing directory: %s -> %s\n", path, translated);
 
+    // Directories in the asset tree come from the index
+    int64_t size;
+    int indexed = fios_index_stat(translated, &size);
+    int count = 0;
+    if (indexed == 0 || (indexed > 0 && fios_index_list(translated, fios_count_loose, &count) < 0)) {
+        printf("FIOS: ERROR - Cannot open directory: %s\n", translated);
+        return -1;
+    }
+    if (indexed > 0) {
+        printf("FIOS: Directory contains %d entries\n", count);
+        return count;
+    }
+
     SceUID dir = sceIoDopen(translated);
     if (dir < 0) {
         printf("FIOS: ERROR - Cannot open directory: 0x%08X\n", dir);
@@ -261,12 +1288,7 @@ int fios_list_directory(const char *path) {
     }
 
     SceIoDirent entry;
-    int count = 0;
-
     while (sceIoDread(dir, &entry) > 0) {
-        printf("FIOS:   %s %s\n",
-               SCE_S_ISDIR(entry.d_stat.st_mode) ? "[DIR]" : "[FILE]",
-               entry.d_name);
         count++;
     }
 
@@ -277,7 +1299,11 @@ int fios_list_directory(const char *path) {
 
 // Get free space on device
 long long fios_get_free_space(const char *path) {
-    char *translated = fios_translate_path(path);
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(path, translated, sizeof(translated)) < 0) {
+        printf("FIOS: ERROR - Path too long: %s\n", path);
+        return -1;
+    }
 
     SceIoDevInfo info;
     int result = sceIoDevctl(translated, 0x3001, NULL, 0, &info, sizeof(info));
@@ -294,9 +1320,13 @@ long long fios_get_free_space(const char *path) {
 
 // Print current path redirects (for debugging)
 void fios_print_redirects(void) {
-    printf("FIOS: Current path redirects (%d):\n", num_redirects);
-    for (int i = 0; i < num_redirects; i++) {
-        printf("FIOS:   %s -> %s\n", path_redirects[i].from, path_redirects[i].to);
+    const FiosRedirectTable *table = __atomic_load_n(&redirect_table, __ATOMIC_ACQUIRE);
+    uint32_t count = table ? table->rule_count : 0;
+
+    printf("FIOS: Current path redirects (%u):\n", count);
+    for (uint32_t i = 0; i < count; i++) {
+        const FiosRedirectRule *rule = &table->rules[i];
+        printf("FIOS:   %s -> %s (priority %d)\n", rule->from, rule->to, rule->priority);
     }
 }
 
@@ -306,24 +1336,42 @@ void fios_cleanup(void) {
         return;
     }
 
-    if (fios_buffer) {
-        free(fios_buffer);
-        fios_buffer = NULL;
-    }
+    asset_pack_close();
+    fios_save_wait(NULL);
 
-    num_redirects = 0;
     fios_initialized = 0;
+    FiosRedirectTable *table = __atomic_exchange_n(&redirect_table, NULL, __ATOMIC_ACQ_REL);
+    while (table) {
+        FiosRedirectTable *retired = table->retired;
+        free(table);
+        table = retired;
+    }
+    fios_redirect_sources_free(redirect_sources, redirect_source_count);
+    redirect_sources = NULL;
+    redirect_source_count = 0;
+    sceKernelDeleteLwMutex(&redirect_lock);
+    sceKernelDeleteLwMutex(&stat_cache_lock);
 
     printf("FIOS: System cleaned up\n");
 }
 
 // Enhanced file operations for Android compatibility
 
-// Android-style fopen wrapper
+// Android-style fopen wrapper. The stream is io_patch's, so its card reads
+// go through the I/O scheduler; io_fopen also waits for pending saves and
+// records the open.
 FILE *fios_fopen(const char *path, const char *mode) {
-    char *translated = fios_translate_path(path);
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(path, translated, sizeof(translated)) < 0) {
+        printf("FIOS: ERROR - Path too long: %s\n", path);
+        return NULL;
+    }
 
-    FILE *file = fopen(translated, mode);
+    if (mode[0] != 'r' || strchr(mode, '+')) {
+        fios_cache_drop(translated);
+    }
+
+    FILE *file = io_fopen(translated, mode);
     if (file) {
         printf("FIOS: Opened file: %s -> %s (mode: %s)\n", path, translated, mode);
     } else {
@@ -333,21 +1381,109 @@ FILE *fios_fopen(const char *path, const char *mode) {
     return file;
 }
 
-// Android asset manager style access
+// Android asset manager style access (asset pack first, then loose files)
 int fios_asset_exists(const char *asset_path) {
-    char full_path[512];
+    if (asset_pack_find(asset_path)) {
+        return 1;
+    }
+
+    char full_path[FIOS_PATH_MAX];
     snprintf(full_path, sizeof(full_path), "assets/%s", asset_path);
     return fios_file_exists(full_path);
 }
 
 long fios_asset_size(const char *asset_path) {
-    char full_path[512];
+    const AssetPackEntry *entry = asset_pack_find(asset_path);
+    if (entry) {
+        return entry->raw_size;
+    }
+
+    char full_path[FIOS_PATH_MAX];
     snprintf(full_path, sizeof(full_path), "assets/%s", asset_path);
     return fios_file_size(full_path);
 }
 
 FILE *fios_asset_open(const char *asset_path, const char *mode) {
-    char full_path[512];
+    const AssetPackEntry *entry = asset_pack_find(asset_path);
+    if (entry && mode[0] == 'r' && !strchr(mode, '+')) {
+        uint64_t start = fios_stats_begin();
+        FILE *file = asset_pack_fopen(entry);
+        fios_stats_record(fios_asset_stats_id(asset_path), FIOS_OP_OPEN, 0, start);
+        return file;
+    }
+
+    char full_path[FIOS_PATH_MAX];
     snprintf(full_path, sizeof(full_path), "assets/%s", asset_path);
     return fios_fopen(full_path, mode);
 }
+
+typedef struct {
+    FiosAssetVisit visit;
+    void *ctx;
+    int count;
+} FiosAssetList;
+
+static void fios_asset_list_file(const char *name, uint32_t flags, uint32_t size, void *ctx) {
+    FiosAssetList *list = ctx;
+    if (flags & FIOS_INDEX_DIR) return;
+    list->visit(name, list->ctx);
+    list->count++;
+}
+
+// I/O statistics id for an asset: pack entries count as ASSET_PACK_PATH/name
+int fios_asset_stats_id(const char *asset_path) {
+    if (!fios_stats_enabled()) return -1;
+
+    char full_path[FIOS_PATH_MAX];
+    if (asset_pack_find(asset_path)) {
+        snprintf(full_path, sizeof(full_path), "%s/%s", ASSET_PACK_PATH, asset_path);
+        return fios_stats_file(full_path);
+    }
+
+    char translated[FIOS_PATH_MAX];
+    snprintf(full_path, sizeof(full_path), "assets/%s", asset_path);
+    if (fios_translate_path(full_path, translated, sizeof(translated)) < 0) return -1;
+    return fios_stats_file(translated);
+}
+
+// Files in an asset directory, loose or packed; visit gets names relative to asset_dir
+int fios_asset_list(const char *asset_dir, FiosAssetVisit visit, void *ctx) {
+    char full_path[FIOS_PATH_MAX];
+    char translated[FIOS_PATH_MAX];
+    snprintf(full_path, sizeof(full_path), "assets/%s", asset_dir ? asset_dir : "");
+    if (fios_translate_path(full_path, translated, sizeof(translated)) < 0) {
+        return -1;
+    }
+
+    FiosAssetList list = { visit, ctx, 0 };
+    if (fios_index_list(translated, fios_asset_list_file, &list) >= 0) {
+        return list.count;
+    }
+
+    // Redirected out of the asset tree (or missing): the card's directory,
+    // plus what the pack holds for asset_dir, which asset opens try first
+    char dir[FIOS_PATH_MAX];
+    size_t len = strlen(full_path + sizeof("assets/") - 1);
+    memcpy(dir, full_path + sizeof("assets/") - 1, len + 1);
+    while (len && dir[len - 1] == '/') dir[--len] = '\0';
+
+    SceUID d = sceIoDopen(translated);
+    if (d >= 0) {
+        SceIoDirent entry;
+        while (sceIoDread(d, &entry) > 0) {
+            if (SCE_S_ISDIR(entry.d_stat.st_mode)) continue;
+
+            // Files the pack also has are listed with the pack's entries
+            char name[FIOS_PATH_MAX];
+            snprintf(name, sizeof(name), "%s%s%s", dir, len ? "/" : "", entry.d_name);
+            if (asset_pack_find(name)) continue;
+
+            visit(entry.d_name, ctx);
+            list.count++;
+        }
+        sceIoDclose(d);
+    }
+
+    fios_index_list_pack(dir, fios_asset_list_file, &list);
+    return list.count;
+}
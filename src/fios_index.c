@@ -0,0 +1,363 @@
+/*
+ * fios_index.c - Directory index for Fluffy Diver
+ * One recursive walk of the loose asset tree plus the asset pack's table of
+ * contents, kept as a sorted array of paths relative to FIOS_INDEX_ROOT.
+ * Stat lookups, fios_list_directory and AAssetDir listings under the root
+ * are answered from memory instead of sceIoGetstat/sceIoDopen walks.
+ *
+ * Names compare case-insensitively, like the memory card does, so a path
+ * the game spells differently from the card still finds its entry.
+ *
+ * Writes through FIOS under the root only mark the index stale, once when
+ * the file is opened for writing and again when that stream or fd closes
+ * (a query in between may have indexed it half written); the next query
+ * walks the tree again.
+ */
+
+#include <vitasdk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "asset_pack.h"
+#include "fios.h"
+#include "fios_index.h"
+
+typedef struct {
+    uint32_t name;  // Offset into index_names
+    uint32_t size;
+    uint32_t flags;
+} FiosIndexEntry;
+
+typedef enum {
+    INDEX_STALE,
+    INDEX_READY,
+    INDEX_FAILED,   // Out of memory; every query falls back to the card
+} FiosIndexState;
+
+static int index_initialized = 0;
+static SceKernelLwMutexWork index_lock;
+static FiosIndexState index_state = INDEX_STALE;
+static int index_root_exists = 0;
+
+static FiosIndexEntry *index_entries = NULL;
+static uint32_t index_count = 0;
+static uint32_t index_capacity = 0;
+static char *index_names = NULL;
+static uint32_t index_names_used = 0;
+static uint32_t index_names_capacity = 0;
+
+static uint32_t index_builds = 0;
+static uint32_t index_invalidations = 0;
+static uint32_t index_hits = 0;
+
+// ===== BUILD =====
+
+static int fios_index_add(const char *name, size_t len, uint32_t flags, uint32_t size) {
+    if (index_count == index_capacity) {
+        uint32_t capacity = index_capacity ? index_capacity * 2 : 1024;
+        FiosIndexEntry *entries = realloc(index_entries, capacity * sizeof(FiosIndexEntry));
+        if (!entries) return -1;
+        index_entries = entries;
+        index_capacity = capacity;
+    }
+
+    if (index_names_used + len + 1 > index_names_capacity) {
+        uint32_t capacity = index_names_capacity ? index_names_capacity * 2 : 32 * 1024;
+        while (capacity < index_names_used + len + 1) capacity *= 2;
+        char *names = realloc(index_names, capacity);
+        if (!names) return -1;
+        index_names = names;
+        index_names_capacity = capacity;
+    }
+
+    FiosIndexEntry *e = &index_entries[index_count++];
+    e->name = index_names_used;
+    e->size = size;
+    e->flags = flags;
+    memcpy(index_names + index_names_used, name, len);
+    index_names[index_names_used + len] = '\0';
+    index_names_used += len + 1;
+    return 0;
+}
+
+// rel is the path of dir relative to the root ("" for the root itself)
+static int fios_index_walk(const char *dir, const char *rel) {
+    SceUID d = sceIoDopen(dir);
+    if (d < 0) return 0;
+
+    int result = 0;
+    SceIoDirent entry;
+    while (result == 0 && sceIoDread(d, &entry) > 0) {
+        char path[FIOS_PATH_MAX];
+        char child[FIOS_PATH_MAX];
+        if (snprintf(path, sizeof(path), "%s/%s", dir, entry.d_name) >= (int)sizeof(path)) continue;
+        snprintf(child, sizeof(child), "%s%s%s", rel, *rel ? "/" : "", entry.d_name);
+
+        if (SCE_S_ISDIR(entry.d_stat.st_mode)) {
+            result = fios_index_add(child, strlen(child), FIOS_INDEX_DIR | FIOS_INDEX_LOOSE, 0);
+            if (result == 0) result = fios_index_walk(path, child);
+        } else {
+            result = fios_index_add(child, strlen(child), FIOS_INDEX_LOOSE, (uint32_t)entry.d_stat.st_size);
+        }
+    }
+
+    sceIoDclose(d);
+    return result;
+}
+
+static int fios_index_add_pack(void) {
+    uint32_t count = asset_pack_count();
+    for (uint32_t i = 0; i < count; i++) {
+        const AssetPackEntry *entry = asset_pack_entry(i);
+        const char *name = asset_pack_name(entry);
+        if (fios_index_add(name, strlen(name), FIOS_INDEX_PACK, entry->raw_size) < 0) return -1;
+
+        // Directories only the pack knows about
+        for (const char *slash = strchr(name, '/'); slash; slash = strchr(slash + 1, '/')) {
+            if (fios_index_add(name, slash - name, FIOS_INDEX_DIR | FIOS_INDEX_PACK, 0) < 0) return -1;
+        }
+    }
+    return 0;
+}
+
+static int fios_index_compare(const void *a, const void *b) {
+    const FiosIndexEntry *ea = a;
+    const FiosIndexEntry *eb = b;
+    return strcasecmp(index_names + ea->name, index_names + eb->name);
+}
+
+static void fios_index_build_locked(void) {
+    SceUInt64 start = sceKernelGetProcessTimeWide();
+    index_count = 0;
+    index_names_used = 0;
+
+    SceIoStat root;
+    index_root_exists = sceIoGetstat(FIOS_INDEX_ROOT, &root) >= 0;
+
+    if ((index_root_exists && fios_index_walk(FIOS_INDEX_ROOT, "") < 0) || fios_index_add_pack() < 0) {
+        printf("FIOS: ERROR - Out of memory building the directory index\n");
+        free(index_entries);
+        free(index_names);
+        index_entries = NULL;
+        index_names = NULL;
+        index_count = index_capacity = 0;
+        index_names_used = index_names_capacity = 0;
+        index_state = INDEX_FAILED;
+        return;
+    }
+
+    qsort(index_entries, index_count, sizeof(FiosIndexEntry), fios_index_compare);
+
+    // A file both loose and packed (and directories met more than once) merge into one entry
+    uint32_t unique = 0;
+    for (uint32_t i = 0; i < index_count; i++) {
+        FiosIndexEntry *e = &index_entries[i];
+        FiosIndexEntry *last = unique ? &index_entries[unique - 1] : NULL;
+        if (last && strcasecmp(index_names + last->name, index_names + e->name) == 0) {
+            if (!(last->flags & FIOS_INDEX_LOOSE)) last->size = e->size;
+            last->flags |= e->flags;
+            continue;
+        }
+        index_entries[unique++] = *e;
+    }
+    index_count = unique;
+
+    index_state = INDEX_READY;
+    index_builds++;
+    printf("FIOS: Directory index: %u entries in %llu ms\n", index_count,
+           (sceKernelGetProcessTimeWide() - start) / 1000);
+}
+
+// ===== QUERIES =====
+
+// Path relative to the root, or NULL outside it. Any spelling of the root
+// counts, so an invalidation can't miss the index over case alone.
+static const char *fios_index_relative(const char *translated) {
+    size_t root_len = sizeof(FIOS_INDEX_ROOT) - 1;
+    if (strncasecmp(translated, FIOS_INDEX_ROOT, root_len) != 0) return NULL;
+    if (translated[root_len] == '\0') return translated + root_len;
+    if (translated[root_len] != '/') return NULL;
+    return translated + root_len + 1;
+}
+
+// Caller holds index_lock
+static int fios_index_ready_locked(void) {
+    if (index_state == INDEX_STALE) fios_index_build_locked();
+    return index_state == INDEX_READY;
+}
+
+// First entry not sorting before name (len bytes of it)
+static uint32_t fios_index_lower_bound(const char *name, size_t len) {
+    uint32_t lo = 0, hi = index_count;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (strncasecmp(index_names + index_entries[mid].name, name, len) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+static const FiosIndexEntry *fios_index_find(const char *rel, size_t len) {
+    uint32_t i = fios_index_lower_bound(rel, len);
+    if (i < index_count) {
+        const char *name = index_names + index_entries[i].name;
+        if (strncasecmp(name, rel, len) == 0 && name[len] == '\0') return &index_entries[i];
+    }
+    return NULL;
+}
+
+void fios_index_init(void) {
+    if (index_initialized) {
+        return;
+    }
+
+    if (sceKernelCreateLwMutex(&index_lock, "fios_index", 0, 0, NULL) < 0) {
+        printf("FIOS: ERROR - Failed to create directory index lock\n");
+        return;
+    }
+
+    sceKernelLockLwMutex(&index_lock, 1, NULL);
+    index_state = INDEX_STALE;
+    fios_index_build_locked();
+    sceKernelUnlockLwMutex(&index_lock, 1);
+    index_initialized = 1;
+}
+
+void fios_index_invalidate(const char *translated) {
+    if (!index_initialized) {
+        return;
+    }
+
+    // Anything at or below the root, or a parent of it (a directory removal)
+    size_t len = strlen(translated);
+    if (!fios_index_relative(translated) && strncasecmp(FIOS_INDEX_ROOT, translated, len) != 0) {
+        return;
+    }
+
+    sceKernelLockLwMutex(&index_lock, 1, NULL);
+    if (index_state == INDEX_READY) {
+        index_state = INDEX_STALE;
+        index_invalidations++;
+    }
+    sceKernelUnlockLwMutex(&index_lock, 1);
+}
+
+int fios_index_stat(const char *translated, int64_t *size) {
+    const char *rel = index_initialized ? fios_index_relative(translated) : NULL;
+    if (!rel) {
+        return -1;
+    }
+
+    size_t len = strlen(rel);
+    while (len && rel[len - 1] == '/') len--;
+
+    int exists = -1;
+    sceKernelLockLwMutex(&index_lock, 1, NULL);
+    if (fios_index_ready_locked()) {
+        if (len == 0) {
+            exists = index_root_exists;
+            *size = 0;
+        } else {
+            const FiosIndexEntry *e = fios_index_find(rel, len);
+            exists = e && (e->flags & FIOS_INDEX_LOOSE);
+            *size = exists ? e->size : -1;
+        }
+        index_hits++;
+    }
+    sceKernelUnlockLwMutex(&index_lock, 1);
+
+    return exists;
+}
+
+// Copy rel without trailing slashes into prefix, then add one '/' unless
+// rel is the root. Returns the prefix length, -1 if it doesn't fit.
+static int fios_index_prefix(const char *rel, char *prefix, size_t size) {
+    size_t len = strlen(rel);
+    while (len && rel[len - 1] == '/') len--;
+    if (len + 2 > size) {
+        return -1;
+    }
+    memcpy(prefix, rel, len);
+    if (len) prefix[len++] = '/';
+    prefix[len] = '\0';
+    return (int)len;
+}
+
+// Visit the direct children of prefix that have any of the flags in mask.
+// Caller holds index_lock with the index ready.
+static int fios_index_children_locked(const char *prefix, size_t len, uint32_t mask,
+                                      FiosIndexVisit visit, void *ctx) {
+    int count = 0;
+    // Everything below the directory sorts together; direct children have no further '/'
+    for (uint32_t i = fios_index_lower_bound(prefix, len); i < index_count; i++) {
+        const char *name = index_names + index_entries[i].name;
+        if (strncasecmp(name, prefix, len) != 0) break;
+        if (strchr(name + len, '/') || !(index_entries[i].flags & mask)) continue;
+
+        if (visit) visit(name + len, index_entries[i].flags, index_entries[i].size, ctx);
+        count++;
+    }
+    return count;
+}
+
+int fios_index_list(const char *translated, FiosIndexVisit visit, void *ctx) {
+    const char *rel = index_initialized ? fios_index_relative(translated) : NULL;
+    if (!rel) {
+        return -1;
+    }
+
+    char prefix[FIOS_PATH_MAX];
+    int len = fios_index_prefix(rel, prefix, sizeof(prefix));
+    if (len < 0) {
+        return -1;
+    }
+
+    int count = -1;
+    sceKernelLockLwMutex(&index_lock, 1, NULL);
+    const FiosIndexEntry *dir = NULL;
+    if (fios_index_ready_locked() && (len == 0 || ((dir = fios_index_find(prefix, len - 1)) &&
+                                                    (dir->flags & FIOS_INDEX_DIR)))) {
+        count = fios_index_children_locked(prefix, len, FIOS_INDEX_DIR | FIOS_INDEX_LOOSE | FIOS_INDEX_PACK,
+                                           visit, ctx);
+        index_hits++;
+    }
+    sceKernelUnlockLwMutex(&index_lock, 1);
+
+    return count;
+}
+
+int fios_index_list_pack(const char *dir, FiosIndexVisit visit, void *ctx) {
+    if (!index_initialized) {
+        return -1;
+    }
+
+    char prefix[FIOS_PATH_MAX];
+    while (*dir == '/') dir++;
+    int len = fios_index_prefix(dir, prefix, sizeof(prefix));
+    if (len < 0) {
+        return -1;
+    }
+
+    int count = -1;
+    sceKernelLockLwMutex(&index_lock, 1, NULL);
+    if (fios_index_ready_locked()) {
+        count = fios_index_children_locked(prefix, len, FIOS_INDEX_PACK, visit, ctx);
+        index_hits++;
+    }
+    sceKernelUnlockLwMutex(&index_lock, 1);
+
+    return count;
+}
+
+void fios_index_report(void) {
+    if (!index_initialized) {
+        return;
+    }
+
+    sceKernelLockLwMutex(&index_lock, 1, NULL);
+    printf("FIOS: Directory index: %u entries, %u queries, %u builds, %u invalidations\n",
+           index_count, index_hits, index_builds, index_invalidations);
+    sceKernelUnlockLwMutex(&index_lock, 1);
+}
@@ -0,0 +1,384 @@
+/*
+ * fios_sched.c - I/O request scheduler for Fluffy Diver
+ * Audio streaming, level loads, prefetch and save writes used to reach the
+ * memory card in whatever order their threads got there, so a 1 MB prefetch
+ * read could sit in front of a 16 KB music refill. With io_scheduler set,
+ * positioned reads and writes are queued per class and one I/O worker
+ * issues them:
+ *
+ *   - realtime requests always go next
+ *   - the others go earliest deadline first (submission time plus a
+ *     per-class budget), so old background work still makes progress
+ *   - prefetch and write-behind draw from token buckets refilled at
+ *     io_prefetch_kbps / io_writebehind_kbps and wait while empty, even
+ *     with the card idle, leaving headroom for requests yet to arrive
+ *
+ * Requests are served in FIOS_SCHED_SLICE pieces and the worker picks again
+ * between pieces, so a refill waits for at most one slice already on the
+ * card. A request's class comes from the thread that issues it.
+ *
+ * A thread someone is blocked on (the save writer while fios_save_wait
+ * runs) can be boosted: its prefetch or write-behind requests are then
+ * scheduled with the foreground budget and skip the token bucket.
+ */
+
+#include <vitasdk.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "config.h"
+#include "fios_sched.h"
+
+#define FIOS_SCHED_SLICE (64 * 1024)
+#define FIOS_SCHED_THREADS 64
+#define FIOS_SCHED_THREAD_PRIORITY 64 // Above audio (80); it sleeps in the card driver
+#define FIOS_SCHED_THREAD_STACK (16 * 1024)
+
+typedef struct FiosRequest {
+    struct FiosRequest *next;
+    int fd;
+    int write;
+    uint8_t *buf;
+    uint32_t size;
+    uint32_t done;
+    int64_t offset;
+    int result;     // Bytes transferred, or the first error
+    int complete;
+    FiosClass cls;
+    int thid;
+    uint64_t submitted;
+    uint64_t deadline;
+} FiosRequest; // Lives on the issuing thread's stack
+
+typedef struct {
+    FiosRequest *head;
+    FiosRequest *tail;
+
+    // Token bucket, in bytes (rate 0 = uncapped)
+    uint32_t rate;
+    uint32_t burst;
+    int64_t tokens;
+    uint64_t refilled;
+
+    uint32_t requests;
+    uint32_t missed;  // Completed after their deadline
+    uint32_t throttled;
+    uint32_t boosted; // Slices served at foreground priority
+    uint32_t max_us;
+    uint64_t bytes;
+    uint64_t total_us;
+} FiosClassQueue;
+
+typedef struct {
+    int thid;
+    FiosClass cls;
+    int boost;  // Outstanding fios_sched_boost calls
+} FiosThreadClass;
+
+static const char *const fios_class_names[FIOS_CLASS_COUNT] = {
+    "realtime", "foreground", "prefetch", "write-behind"
+};
+
+// Budget from submission to completion
+static const uint32_t fios_class_deadline_us[FIOS_CLASS_COUNT] = {
+    10 * 1000, 50 * 1000, 500 * 1000, 2000 * 1000
+};
+
+static int sched_running = 0;
+static SceKernelLwMutexWork sched_lock;
+static SceKernelLwCondWork sched_work_cond;
+static SceKernelLwCondWork sched_done_cond;
+static FiosClassQueue sched_queues[FIOS_CLASS_COUNT];
+static FiosThreadClass sched_threads[FIOS_SCHED_THREADS];
+static uint32_t sched_slices = 0;
+
+// Caller holds sched_lock
+static FiosThreadClass *fios_sched_thread_slot_locked(int thid) {
+    for (int i = 0; i < FIOS_SCHED_THREADS; i++) {
+        if (sched_threads[i].thid == thid) return &sched_threads[i];
+    }
+    return NULL;
+}
+
+// ===== WORKER =====
+
+// A background request whose thread somebody is waiting on
+static int fios_sched_boosted_locked(const FiosRequest *req) {
+    if (req->cls <= FIOS_CLASS_FOREGROUND) return 0;
+    const FiosThreadClass *slot = fios_sched_thread_slot_locked(req->thid);
+    return slot && slot->boost > 0;
+}
+
+static void fios_sched_refill_locked(uint64_t now) {
+    for (int cls = 0; cls < FIOS_CLASS_COUNT; cls++) {
+        FiosClassQueue *q = &sched_queues[cls];
+        if (!q->rate) continue;
+
+        // Advance the refill clock only by what was credited, so no fraction is lost
+        uint64_t gained = (now - q->refilled) * q->rate / 1000000;
+        if (gained) {
+            q->tokens += gained;
+            q->refilled += gained * 1000000 / q->rate;
+        }
+        if (q->tokens >= q->burst) {
+            q->tokens = q->burst;
+            q->refilled = now;
+        }
+    }
+}
+
+// Next request to serve; NULL with *wait_us set when only throttled work is queued
+static FiosRequest *fios_sched_pick_locked(SceUInt32 *wait_us) {
+    if (sched_queues[FIOS_CLASS_REALTIME].head) {
+        return sched_queues[FIOS_CLASS_REALTIME].head;
+    }
+
+    FiosRequest *best = NULL;
+    uint64_t best_deadline = 0;
+    uint64_t refill_us = 0;
+    for (int cls = FIOS_CLASS_FOREGROUND; cls < FIOS_CLASS_COUNT; cls++) {
+        FiosClassQueue *q = &sched_queues[cls];
+        if (!q->head) continue;
+
+        int boosted = fios_sched_boosted_locked(q->head);
+        if (q->rate && q->tokens <= 0 && !boosted) {
+            uint64_t us = ((uint64_t)(1 - q->tokens) * 1000000 + q->rate - 1) / q->rate;
+            if (!refill_us || us < refill_us) refill_us = us;
+            continue;
+        }
+
+        uint64_t deadline = boosted ? q->head->submitted + fios_class_deadline_us[FIOS_CLASS_FOREGROUND]
+                                    : q->head->deadline;
+        if (!best || deadline < best_deadline) {
+            best = q->head;
+            best_deadline = deadline;
+        }
+    }
+
+    if (!best && refill_us) {
+        *wait_us = refill_us > 1000000 ? 1000000 : (SceUInt32)refill_us;
+    }
+    return best;
+}
+
+static void fios_sched_finish_locked(FiosRequest *req, int result) {
+    FiosClassQueue *q = &sched_queues[req->cls];
+    uint64_t now = sceKernelGetProcessTimeWide();
+    uint64_t elapsed = now - req->submitted;
+
+    q->head = req->next;
+    if (!q->head) q->tail = NULL;
+
+    q->requests++;
+    q->bytes += req->done;
+    q->total_us += elapsed;
+    if (elapsed > q->max_us) q->max_us = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+    if (now > req->deadline) q->missed++;
+
+    req->result = result;
+    req->complete = 1;
+    sceKernelSignalLwCondAll(&sched_done_cond);
+}
+
+static int fios_sched_worker(SceSize args, void *argp) {
+    sceKernelLockLwMutex(&sched_lock, 1, NULL);
+    for (;;) {
+        fios_sched_refill_locked(sceKernelGetProcessTimeWide());
+
+        SceUInt32 wait_us = 0;
+        FiosRequest *req = fios_sched_pick_locked(&wait_us);
+        if (!req) {
+            if (wait_us) {
+                for (int cls = FIOS_CLASS_PREFETCH; cls < FIOS_CLASS_COUNT; cls++) {
+                    if (sched_queues[cls].head) sched_queues[cls].throttled++;
+                }
+            }
+            // A timeout just means a bucket has refilled
+            sceKernelWaitLwCond(&sched_work_cond, wait_us ? &wait_us : NULL);
+            continue;
+        }
+
+        // The request stays at the head of its queue while it is on the card
+        uint32_t chunk = req->size - req->done;
+        if (chunk > FIOS_SCHED_SLICE) chunk = FIOS_SCHED_SLICE;
+        uint8_t *buf = req->buf + req->done;
+        int64_t offset = req->offset + req->done;
+        sceKernelUnlockLwMutex(&sched_lock, 1);
+
+        int ret = req->write ? sceIoPwrite(req->fd, buf, chunk, offset)
+                             : sceIoPread(req->fd, buf, chunk, offset);
+
+        sceKernelLockLwMutex(&sched_lock, 1, NULL);
+        sched_slices++;
+        // Boosted slices are the waiter's I/O, not the class's background budget
+        FiosClassQueue *q = &sched_queues[req->cls];
+        if (fios_sched_boosted_locked(req)) q->boosted++;
+        else if (q->rate) q->tokens -= ret > 0 ? ret : (int)chunk;
+
+        if (ret < 0) {
+            fios_sched_finish_locked(req, req->done ? (int)req->done : ret);
+        } else {
+            req->done += ret;
+            // A short transfer is end of file (or a full card); hand back what there is
+            if (req->done == req->size || (uint32_t)ret < chunk) {
+                fios_sched_finish_locked(req, (int)req->done);
+            }
+        }
+    }
+    return 0;
+}
+
+// ===== SUBMISSION =====
+
+static int fios_sched_submit(int fd, int write, void *buf, uint32_t size, int64_t offset) {
+    if (!sched_running || size == 0) {
+        return write ? sceIoPwrite(fd, buf, size, offset) : sceIoPread(fd, buf, size, offset);
+    }
+
+    FiosRequest req;
+    memset(&req, 0, sizeof(req));
+    req.fd = fd;
+    req.write = write;
+    req.buf = buf;
+    req.size = size;
+    req.offset = offset;
+    req.thid = sceKernelGetThreadId();
+
+    sceKernelLockLwMutex(&sched_lock, 1, NULL);
+    FiosThreadClass *slot = fios_sched_thread_slot_locked(req.thid);
+    req.cls = slot ? slot->cls : FIOS_CLASS_FOREGROUND;
+    req.submitted = sceKernelGetProcessTimeWide();
+    req.deadline = req.submitted + fios_class_deadline_us[req.cls];
+
+    FiosClassQueue *q = &sched_queues[req.cls];
+    if (q->tail) q->tail->next = &req;
+    else q->head = &req;
+    q->tail = &req;
+    sceKernelSignalLwCond(&sched_work_cond);
+
+    while (!req.complete) {
+        sceKernelWaitLwCond(&sched_done_cond, NULL);
+    }
+    sceKernelUnlockLwMutex(&sched_lock, 1);
+
+    return req.result;
+}
+
+void fios_sched_init(void) {
+    if (sched_running || !config_get_io_scheduler()) {
+        return;
+    }
+
+    if (sceKernelCreateLwMutex(&sched_lock, "fios_sched", 0, 0, NULL) < 0 ||
+        sceKernelCreateLwCond(&sched_work_cond, "fios_sched_work", 0, &sched_lock, NULL) < 0 ||
+        sceKernelCreateLwCond(&sched_done_cond, "fios_sched_done", 0, &sched_lock, NULL) < 0) {
+        printf("FIOS: ERROR - Failed to create I/O scheduler locks\n");
+        return;
+    }
+
+    memset(sched_queues, 0, sizeof(sched_queues));
+    memset(sched_threads, 0, sizeof(sched_threads));
+    // 0 KB/s (or less) leaves a class uncapped
+    int prefetch_kbps = config_get_io_prefetch_kbps();
+    int writebehind_kbps = config_get_io_writebehind_kbps();
+    sched_queues[FIOS_CLASS_PREFETCH].rate = prefetch_kbps > 0 ? prefetch_kbps * 1024 : 0;
+    sched_queues[FIOS_CLASS_WRITEBEHIND].rate = writebehind_kbps > 0 ? writebehind_kbps * 1024 : 0;
+
+    uint64_t now = sceKernelGetProcessTimeWide();
+    for (int cls = 0; cls < FIOS_CLASS_COUNT; cls++) {
+        FiosClassQueue *q = &sched_queues[cls];
+        if (!q->rate) continue;
+        // About 100 ms of transfer, and never less than one slice
+        q->burst = q->rate / 10 > FIOS_SCHED_SLICE ? q->rate / 10 : FIOS_SCHED_SLICE;
+        q->tokens = q->burst;
+        q->refilled = now;
+    }
+
+    // Any core: the worker mostly sleeps in the card driver
+    SceUID thid = sceKernelCreateThread("fios_sched", fios_sched_worker, FIOS_SCHED_THREAD_PRIORITY,
+                                        FIOS_SCHED_THREAD_STACK, 0, 0, NULL);
+    if (thid < 0 || sceKernelStartThread(thid, 0, NULL) < 0) {
+        printf("FIOS: ERROR - Failed to start I/O scheduler thread\n");
+        return;
+    }
+
+    sched_running = 1;
+    printf("FIOS: I/O scheduler started (prefetch %u KB/s, write-behind %u KB/s, 0 = uncapped)\n",
+           sched_queues[FIOS_CLASS_PREFETCH].rate / 1024, sched_queues[FIOS_CLASS_WRITEBEHIND].rate / 1024);
+}
+
+void fios_sched_set_thread_class(int thid, FiosClass cls) {
+    if (!sched_running || cls >= FIOS_CLASS_COUNT) {
+        return;
+    }
+    if (thid == 0) {
+        thid = sceKernelGetThreadId();
+    }
+
+    sceKernelLockLwMutex(&sched_lock, 1, NULL);
+    FiosThreadClass *slot = fios_sched_thread_slot_locked(thid);
+    if (cls == FIOS_CLASS_FOREGROUND) {
+        if (slot) slot->thid = 0;
+    } else {
+        if (!slot) {
+            slot = fios_sched_thread_slot_locked(0);
+            if (slot) slot->boost = 0;
+        }
+        if (slot) {
+            slot->thid = thid;
+            slot->cls = cls;
+        } else {
+            printf("FIOS: WARNING - I/O class table full, thread 0x%x stays foreground\n", thid);
+        }
+    }
+    sceKernelUnlockLwMutex(&sched_lock, 1);
+}
+
+void fios_sched_thread_exit(int thid) {
+    fios_sched_set_thread_class(thid, FIOS_CLASS_FOREGROUND);
+}
+
+void fios_sched_boost(int thid, int on) {
+    if (!sched_running) {
+        return;
+    }
+    if (thid == 0) {
+        thid = sceKernelGetThreadId();
+    }
+
+    // Foreground threads have no slot and nothing to boost
+    sceKernelLockLwMutex(&sched_lock, 1, NULL);
+    FiosThreadClass *slot = fios_sched_thread_slot_locked(thid);
+    if (slot) {
+        slot->boost += on ? 1 : -1;
+        if (slot->boost < 0) slot->boost = 0;
+        // The worker may be sleeping until the thread's bucket refills
+        sceKernelSignalLwCond(&sched_work_cond);
+    }
+    sceKernelUnlockLwMutex(&sched_lock, 1);
+}
+
+int fios_sched_pread(int fd, void *buf, uint32_t size, int64_t offset) {
+    return fios_sched_submit(fd, 0, buf, size, offset);
+}
+
+int fios_sched_pwrite(int fd, const void *buf, uint32_t size, int64_t offset) {
+    return fios_sched_submit(fd, 1, (void *)buf, size, offset);
+}
+
+void fios_sched_report(void) {
+    if (!sched_running) {
+        return;
+    }
+
+    sceKernelLockLwMutex(&sched_lock, 1, NULL);
+    printf("FIOS: I/O scheduler: %u slices\n", sched_slices);
+    for (int cls = 0; cls < FIOS_CLASS_COUNT; cls++) {
+        const FiosClassQueue *q = &sched_queues[cls];
+        if (!q->requests) continue;
+        printf("FIOS:   %-12s %6u requests %8llu KB  avg %6llu us  max %7u us  %u late  %u throttled  %u boosted\n",
+               fios_class_names[cls], q->requests, q->bytes / 1024, q->total_us / q->requests,
+               q->max_us, q->missed, q->throttled, q->boosted);
+    }
+    sceKernelUnlockLwMutex(&sched_lock, 1);
+}
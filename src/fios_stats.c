@@ -0,0 +1,241 @@
+/*
+ * fios_stats.c - Per-file I/O statistics for Fluffy Diver
+ * When io_stats is set in config.txt, every FIOS entry point and the
+ * stdio/fd shims count their operations per file: opens, reads, writes,
+ * seeks, stat calls, bytes moved, and a log2 histogram of how long each
+ * call took. The dump adds the same counters summed per directory prefix,
+ * so a slow level load can be traced to the files and folders behind it.
+ *
+ * Files get an id when first seen; after that recording is a handful of
+ * relaxed atomic adds, so it is safe from any thread.
+ */
+
+#include <vitasdk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "config.h"
+#include "fios.h"
+#include "fios_stats.h"
+
+// External debug function
+extern void debugPrintf(const char *fmt, ...);
+
+#define FIOS_STATS_FILES 1024 // Power of two
+#define FIOS_STATS_DIRS 512   // Power of two, dump time only
+
+// Bucket 0 is under 1 us, bucket i covers [2^(i-1), 2^i) us, the last is open ended
+#define FIOS_STATS_BUCKETS 16
+
+typedef struct {
+    char *path;
+    uint32_t hash;
+    uint32_t ops[FIOS_OP_COUNT];
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint64_t total_us;
+    uint32_t max_us;
+    uint32_t histogram[FIOS_STATS_BUCKETS];
+} FiosFileStats;
+
+static const char *const fios_op_names[FIOS_OP_COUNT] = {
+    "opens", "reads", "writes", "seeks", "stats"
+};
+
+static int stats_enabled = 0;
+static SceKernelLwMutexWork stats_lock;
+static FiosFileStats *stats_files = NULL; // Open addressing on the path hash
+static uint32_t stats_file_count = 0;
+
+static uint32_t fios_stats_hash(const char *s, size_t len) {
+    uint32_t hash = 2166136261u; // FNV-1a
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)s[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static int fios_stats_bucket(uint32_t us) {
+    int bucket = 0;
+    while (us && bucket < FIOS_STATS_BUCKETS - 1) {
+        us >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+static void fios_stats_add(FiosFileStats *dst, const FiosFileStats *src) {
+    for (int op = 0; op < FIOS_OP_COUNT; op++) dst->ops[op] += src->ops[op];
+    dst->bytes_read += src->bytes_read;
+    dst->bytes_written += src->bytes_written;
+    dst->total_us += src->total_us;
+    if (src->max_us > dst->max_us) dst->max_us = src->max_us;
+    for (int b = 0; b < FIOS_STATS_BUCKETS; b++) dst->histogram[b] += src->histogram[b];
+}
+
+// ===== RECORDING =====
+
+void fios_stats_init(void) {
+    if (!config_get_io_stats()) return;
+
+    stats_files = calloc(FIOS_STATS_FILES, sizeof(FiosFileStats));
+    if (!stats_files || sceKernelCreateLwMutex(&stats_lock, "fios_stats", 0, 0, NULL) < 0) {
+        debugPrintf("FIOS: ERROR - Cannot set up I/O statistics\n");
+        free(stats_files);
+        stats_files = NULL;
+        return;
+    }
+
+    stats_enabled = 1;
+    debugPrintf("FIOS: I/O statistics enabled (%s)\n", FIOS_STATS_CSV_PATH);
+}
+
+int fios_stats_enabled(void) {
+    return stats_enabled;
+}
+
+int fios_stats_file(const char *path) {
+    if (!stats_enabled || !path) return -1;
+
+    uint32_t hash = fios_stats_hash(path, strlen(path));
+    int id = -1;
+
+    sceKernelLockLwMutex(&stats_lock, 1, NULL);
+    for (uint32_t i = 0; i < FIOS_STATS_FILES; i++) {
+        uint32_t slot = (hash + i) & (FIOS_STATS_FILES - 1);
+        FiosFileStats *f = &stats_files[slot];
+        if (!f->path) {
+            // Keep one slot free so probes always terminate
+            if (stats_file_count >= FIOS_STATS_FILES - 1) break;
+            f->path = strdup(path);
+            if (!f->path) break;
+            f->hash = hash;
+            stats_file_count++;
+            id = slot;
+            break;
+        }
+        if (f->hash == hash && strcmp(f->path, path) == 0) {
+            id = slot;
+            break;
+        }
+    }
+    sceKernelUnlockLwMutex(&stats_lock, 1);
+
+    return id;
+}
+
+uint64_t fios_stats_begin(void) {
+    return stats_enabled ? sceKernelGetProcessTimeWide() : 0;
+}
+
+void fios_stats_record(int id, FiosOp op, uint64_t bytes, uint64_t start) {
+    if (id < 0 || !stats_enabled) return;
+
+    FiosFileStats *f = &stats_files[id];
+    uint64_t elapsed = start ? sceKernelGetProcessTimeWide() - start : 0;
+    uint32_t us = elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed;
+
+    __atomic_fetch_add(&f->ops[op], 1, __ATOMIC_RELAXED);
+    if (op == FIOS_OP_READ) __atomic_fetch_add(&f->bytes_read, bytes, __ATOMIC_RELAXED);
+    if (op == FIOS_OP_WRITE) __atomic_fetch_add(&f->bytes_written, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&f->total_us, us, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&f->histogram[fios_stats_bucket(us)], 1, __ATOMIC_RELAXED);
+
+    uint32_t max = __atomic_load_n(&f->max_us, __ATOMIC_RELAXED);
+    while (us > max && !__atomic_compare_exchange_n(&f->max_us, &max, us, 1,
+                                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void fios_stats_record_path(const char *path, FiosOp op, uint64_t bytes, uint64_t start) {
+    if (!stats_enabled || !path) return;
+
+    char translated[FIOS_PATH_MAX];
+    if (fios_translate_path(path, translated, sizeof(translated)) < 0) return;
+    fios_stats_record(fios_stats_file(translated), op, bytes, start);
+}
+
+// ===== CSV DUMP =====
+
+static void fios_stats_row(FILE *csv, const char *kind, const char *path, size_t path_len,
+                           const FiosFileStats *s) {
+    fprintf(csv, "%s,\"%.*s\"", kind, (int)path_len, path);
+    for (int op = 0; op < FIOS_OP_COUNT; op++) fprintf(csv, ",%u", s->ops[op]);
+    fprintf(csv, ",%llu,%llu,%llu,%u", s->bytes_read, s->bytes_written, s->total_us, s->max_us);
+    for (int b = 0; b < FIOS_STATS_BUCKETS; b++) fprintf(csv, ",%u", s->histogram[b]);
+    fprintf(csv, "\n");
+}
+
+// Sum every file into each directory prefix of its path ("ux0:", "ux0:data/", ...)
+static FiosFileStats *fios_stats_dirs(uint32_t *count) {
+    FiosFileStats *dirs = calloc(FIOS_STATS_DIRS, sizeof(FiosFileStats));
+    if (!dirs) return NULL;
+
+    for (uint32_t i = 0; i < FIOS_STATS_FILES; i++) {
+        const FiosFileStats *f = &stats_files[i];
+        if (!f->path) continue;
+
+        for (const char *p = f->path; *p; p++) {
+            if (*p != '/' && *p != ':') continue;
+
+            size_t len = p - f->path + 1;
+            uint32_t hash = fios_stats_hash(f->path, len);
+            for (uint32_t j = 0; j < FIOS_STATS_DIRS; j++) {
+                FiosFileStats *d = &dirs[(hash + j) & (FIOS_STATS_DIRS - 1)];
+                if (!d->path) {
+                    if (*count >= FIOS_STATS_DIRS - 1) break;
+                    d->path = strndup(f->path, len);
+                    if (!d->path) break;
+                    d->hash = hash;
+                    (*count)++;
+                }
+                if (d->hash == hash && strlen(d->path) == len && memcmp(d->path, f->path, len) == 0) {
+                    fios_stats_add(d, f);
+                    break;
+                }
+            }
+        }
+    }
+    return dirs;
+}
+
+int fios_stats_dump(const char *csv_path) {
+    if (!stats_enabled) return -1;
+
+    FILE *csv = fopen(csv_path, "w");
+    if (!csv) {
+        debugPrintf("FIOS: ERROR - Cannot write %s\n", csv_path);
+        return -1;
+    }
+
+    fprintf(csv, "kind,path");
+    for (int op = 0; op < FIOS_OP_COUNT; op++) fprintf(csv, ",%s", fios_op_names[op]);
+    fprintf(csv, ",bytes_read,bytes_written,total_us,max_us");
+    for (int b = 0; b < FIOS_STATS_BUCKETS - 1; b++) fprintf(csv, ",lt%uus", 1u << b);
+    fprintf(csv, ",ge%uus\n", 1u << (FIOS_STATS_BUCKETS - 2));
+
+    // Snapshot the table so new files can't move under the walk
+    sceKernelLockLwMutex(&stats_lock, 1, NULL);
+    uint32_t files = stats_file_count;
+    uint32_t dir_count = 0;
+    FiosFileStats *dirs = fios_stats_dirs(&dir_count);
+    for (uint32_t i = 0; i < FIOS_STATS_FILES; i++) {
+        const FiosFileStats *f = &stats_files[i];
+        if (f->path) fios_stats_row(csv, "file", f->path, strlen(f->path), f);
+    }
+    sceKernelUnlockLwMutex(&stats_lock, 1);
+
+    for (uint32_t i = 0; dirs && i < FIOS_STATS_DIRS; i++) {
+        if (!dirs[i].path) continue;
+        fios_stats_row(csv, "dir", dirs[i].path, strlen(dirs[i].path), &dirs[i]);
+        free(dirs[i].path);
+    }
+    free(dirs);
+    fclose(csv);
+
+    debugPrintf("FIOS: Wrote I/O statistics for %u files and %u directories to %s\n",
+                files, dir_count, csv_path);
+    return 0;
+}
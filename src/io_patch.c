@@ -1,5 +1,1407 @@
-// IO patches would go here
+/*
+ * io_patch.c - Buffered stdio layer for Fluffy Diver
+ * Asset parsing in the game issues lots of tiny fread/fgetc/fseek calls.
+ * Through newlib each small buffer refill or seek is a Vita I/O syscall, so
+ * streams opened by the game get their own FILE implementation here:
+ *
+ *  - one large buffer per stream (io_buffer_kb in config.txt)
+ *  - reads grow their window while access stays sequential, and stay small
+ *    after a random seek so scattered lookups don't drag in whole buffers
+ *  - seeks that land inside the buffered range never reach the kernel
+ *  - positioned sceIoPread/sceIoPwrite, so there is no separate lseek call,
+ *    queued by the issuing thread's I/O class (fios_sched.c)
+ *
+ * Owned streams are tagged with a magic word and a self pointer. Anything
+ * else passed to these shims (stdout, streams opened internally through
+ * newlib) is forwarded to newlib untouched.
+ *
+ * Raw open() gets the same treatment: the returned fd indexes a table of
+ * Vita handles, so read/write/lseek/close from the game reach the right
+ * file instead of newlib's unrelated POSIX layer. Each fd keeps its own
+ * position and a readahead buffer for small reads.
+ *
+ * Both layers also feed fios_stats (io_stats in config.txt) per file.
+ *
+ * Streams that rewrite a save file (fopen "w" under FIOS_SAVE_DIR) never
+ * touch the card while open: the whole file builds up in the stream's
+ * buffer and fclose hands it to FIOS, which writes it out on its own thread
+ * and swaps it in with a rename.
+ */
+
 #include <vitasdk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <malloc.h>
+#include <errno.h>
+
+#include "config.h"
+#include "io_patch.h"
+#include "fios.h"
+#include "fios_stats.h"
+#include "fios_sched.h"
+
+// External debug function
+extern void debugPrintf(const char *fmt, ...);
+
+#define IO_MAGIC 0x494F464C // "IOFL"
+#define IO_MIN_WINDOW (16 * 1024)
+#define IO_BUFFER_ALIGN 64
+#define IO_SCANF_WINDOW 4096
+#define IO_PRINTF_STACK 512
+#define IO_NAME_LEN 64
+
+// Streams with fewer calls than this are left out of the close log
+#define IO_REPORT_MIN_CALLS 256
+
+typedef struct {
+    uint32_t calls;        // stdio calls made by the game
+    uint32_t reads;        // sceIoPread calls
+    uint32_t writes;       // sceIoPwrite/sceIoWrite calls
+    uint32_t other;        // sceIoLseek calls
+    uint32_t seeks_elided; // seeks served from the buffer
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+} IoStats;
+
+typedef struct IoFile {
+    uint32_t magic;
+    struct IoFile *self;
+    SceKernelLwMutexWork lock;
+
+    SceUID fd;
+    int readable;
+    int writable;
+    int append;
+
+    uint8_t *buf;
+    size_t buf_size;
+    int64_t buf_pos;  // File offset of buf[0]
+    size_t buf_len;   // Valid (read) or pending (write) bytes in buf
+    size_t buf_off;   // Cursor within buf
+    int dirty;        // buf holds unwritten data
+
+    size_t window;    // Current read size
+    int64_t next_seq; // Where a sequential refill would start
+    int64_t size;     // Cached size for read-only streams, -1 if unknown
+
+    int eof;
+    int error;
+
+    IoStats stats;
+    int stats_id;     // fios_stats file id, -1 when disabled
+    char name[IO_NAME_LEN];
+    int fileno;       // Borrowed fd handed out by io_fileno, -1 if none
+    char *save_path;  // Save rewrite held in buf until fclose, NULL otherwise
+    char *drop_path;  // Writable: dropped from the FIOS caches at fclose
+    int save_failed;  // Part of the save never reached buf; fclose drops it
+    struct IoFile *prev;
+    struct IoFile *next;
+} IoFile;
+
+// fds 0-2 stay with newlib (stdout/stderr logging)
+#define IO_FD_BASE 3
+#define IO_MAX_FDS 64
+
+typedef struct {
+    int used;
+    int borrowed;     // Handle owned by a stream (io_fileno)
+    SceUID uid;
+    int newlib_fd;    // newlib fd of a foreign stream (io_fileno), -1 otherwise
+    int readable;
+    int writable;
+    int append;
+    int64_t pos;
+    char *drop_path;  // Can create or change the file: dropped from the FIOS caches at close
+
+    uint8_t *ra;      // Readahead, allocated on the first small read
+    int64_t ra_pos;
+    size_t ra_len;
+
+    SceKernelLwMutexWork lock;
+    IoStats stats;
+    int stats_id;     // fios_stats file id, -1 when disabled
+} IoFd;
+
+static size_t io_buffer_size = 64 * 1024;
+
+// Open streams (for fflush(NULL) and the report) and totals from closed ones
+static SceKernelLwMutexWork io_list_lock;
+static IoFile *io_open_files = NULL;
+static IoStats io_closed_totals;
+static uint32_t io_streams_opened = 0;
+
+static SceKernelLwMutexWork io_fd_table_lock;
+static IoFd io_fds[IO_MAX_FDS];
+static IoStats io_fd_totals;
+static uint32_t io_fds_opened = 0;
+
+static inline IoFd *io_fd_get(int fd);
+static int io_fd_alloc(SceUID uid, int readable, int writable, int append, int borrowed);
+static int io_fd_foreign(int newlib_fd);
+static void io_fd_release(IoFd *d);
+static void io_fd_release_foreign(int newlib_fd);
+
+// ===== INITIALIZATION =====
+
+void io_patch_init(void) {
+    int kb = config_get_io_buffer_kb();
+    if (kb < 4) kb = 4;
+    if (kb > 1024) kb = 1024;
+    io_buffer_size = (size_t)kb * 1024;
+
+    if (sceKernelCreateLwMutex(&io_list_lock, "io_streams", 0, 0, NULL) < 0) {
+        debugPrintf("io: ERROR - Cannot create stream list lock\n");
+    }
+    memset(&io_closed_totals, 0, sizeof(io_closed_totals));
+
+    if (sceKernelCreateLwMutex(&io_fd_table_lock, "io_fd_table", 0, 0, NULL) < 0) {
+        debugPrintf("io: ERROR - Cannot create fd table lock\n");
+    }
+    for (int i = 0; i < IO_MAX_FDS; i++) {
+        sceKernelCreateLwMutex(&io_fds[i].lock, "io_fd", 0, 0, NULL);
+    }
+    memset(&io_fd_totals, 0, sizeof(io_fd_totals));
+
+    debugPrintf("io: Buffered stdio ready (%d KB per stream)\n", kb);
+}
+
+// ===== HELPERS =====
+
+static inline IoFile *io_owned(FILE *stream) {
+    IoFile *f = (IoFile *)stream;
+    return (f && f->magic == IO_MAGIC && f->self == f) ? f : NULL;
+}
+
+// Vita errors in the 0x8001xxxx range carry a POSIX errno in the low byte
+static void io_set_errno(int sce_error) {
+    errno = ((uint32_t)sce_error & 0xFFFFFF00) == 0x80010000 ? (sce_error & 0xFF) : EIO;
+}
+
+static void io_stats_add(IoStats *dst, const IoStats *src) {
+    dst->calls += src->calls;
+    dst->reads += src->reads;
+    dst->writes += src->writes;
+    dst->other += src->other;
+    dst->seeks_elided += src->seeks_elided;
+    dst->bytes_read += src->bytes_read;
+    dst->bytes_written += src->bytes_written;
+}
+
+static inline int64_t io_position(const IoFile *f) {
+    return f->buf_pos + f->buf_off;
+}
+
+static int io_flush_locked(IoFile *f) {
+    if (!f->dirty) return 0;
+
+    // A short write carries on from where it stopped; one that writes
+    // nothing (a full card) fails the flush
+    size_t written = 0;
+    while (written < f->buf_len) {
+        size_t left = f->buf_len - written;
+        SceSSize ret = f->append ? sceIoWrite(f->fd, f->buf + written, left)
+                                 : fios_sched_pwrite(f->fd, f->buf + written, left, f->buf_pos + written);
+        f->stats.writes++;
+        if (ret <= 0) {
+            if (ret < 0) io_set_errno(ret);
+            else errno = ENOSPC;
+            f->error = 1;
+            break;
+        }
+        written += ret;
+        f->stats.bytes_written += ret;
+    }
+    f->dirty = 0;
+
+    if (f->append) {
+        f->buf_pos = sceIoLseek(f->fd, 0, SCE_SEEK_CUR);
+        f->stats.other++;
+    } else {
+        f->buf_pos += written;
+    }
+
+    int failed = written < f->buf_len;
+    f->buf_len = f->buf_off = 0;
+    return failed ? EOF : 0;
+}
+
+// Refill at the current position; the window doubles while reads stay sequential
+static int io_refill(IoFile *f) {
+    int64_t pos = io_position(f);
+
+    if (pos == f->next_seq) {
+        f->window = f->window * 2 > f->buf_size ? f->buf_size : f->window * 2;
+    } else {
+        f->window = IO_MIN_WINDOW > f->buf_size ? f->buf_size : IO_MIN_WINDOW;
+    }
+
+    SceSSize ret = fios_sched_pread(f->fd, f->buf, f->window, pos);
+    f->stats.reads++;
+    f->buf_pos = pos;
+    f->buf_off = 0;
+
+    if (ret < 0) {
+        io_set_errno(ret);
+        f->buf_len = 0;
+        f->error = 1;
+        return -1;
+    }
+
+    f->buf_len = ret;
+    f->next_seq = pos + ret;
+    if (ret == 0) f->eof = 1;
+    return ret;
+}
+
+// Make at least want bytes (or everything up to EOF) available after the cursor
+static void io_fill_at_least(IoFile *f, size_t want) {
+    size_t avail = f->buf_len - f->buf_off;
+    if (avail >= want) return;
+
+    memmove(f->buf, f->buf + f->buf_off, avail);
+    f->buf_pos += f->buf_off;
+    f->buf_off = 0;
+    f->buf_len = avail;
+
+    SceSSize ret = fios_sched_pread(f->fd, f->buf + avail, f->buf_size - avail, f->buf_pos + avail);
+    f->stats.reads++;
+    if (ret < 0) {
+        io_set_errno(ret);
+        f->error = 1;
+        return;
+    }
+
+    f->buf_len += ret;
+    f->next_seq = f->buf_pos + f->buf_len;
+}
+
+static size_t io_read_locked(IoFile *f, void *dst, size_t n) {
+    if (!f->readable) {
+        errno = EBADF;
+        f->error = 1;
+        return 0;
+    }
+    if (io_flush_locked(f) < 0) return 0;
+
+    uint8_t *out = dst;
+    size_t done = 0;
+
+    while (done < n) {
+        size_t avail = f->buf_len - f->buf_off;
+        if (avail) {
+            size_t take = avail < n - done ? avail : n - done;
+            memcpy(out + done, f->buf + f->buf_off, take);
+            f->buf_off += take;
+            done += take;
+            continue;
+        }
+
+        // Reads at least a buffer long go straight into the caller's memory
+        size_t left = n - done;
+        if (left >= f->buf_size) {
+            int64_t pos = io_position(f);
+            SceSSize ret = fios_sched_pread(f->fd, out + done, left, pos);
+            f->stats.reads++;
+
+            if (ret < 0) {
+                io_set_errno(ret);
+                f->error = 1;
+                break;
+            }
+            if (ret == 0) {
+                f->eof = 1;
+                break;
+            }
+
+            done += ret;
+            f->buf_pos = pos + ret;
+            f->buf_len = f->buf_off = 0;
+            f->next_seq = f->buf_pos;
+            continue;
+        }
+
+        if (io_refill(f) <= 0) break;
+    }
+
+    f->stats.bytes_read += done;
+    return done;
+}
+
+// Save streams: buf holds the whole file, buf_off is the position
+static size_t io_save_write_locked(IoFile *f, const void *src, size_t n) {
+    size_t end = f->buf_off + n;
+    if (end > f->buf_size) {
+        size_t grown = f->buf_size * 2 > end ? f->buf_size * 2 : end;
+        uint8_t *buf = realloc(f->buf, grown);
+        if (!buf) {
+            errno = ENOMEM;
+            f->error = 1;
+            f->save_failed = 1;
+            return 0;
+        }
+        f->buf = buf;
+        f->buf_size = grown;
+    }
+
+    // A seek past the end leaves a hole that reads back as zeros
+    if (f->buf_off > f->buf_len) memset(f->buf + f->buf_len, 0, f->buf_off - f->buf_len);
+    memcpy(f->buf + f->buf_off, src, n);
+    f->buf_off = end;
+    if (end > f->buf_len) f->buf_len = end;
+    f->stats.bytes_written += n;
+    return n;
+}
+
+static size_t io_write_locked(IoFile *f, const void *src, size_t n) {
+    if (!f->writable) {
+        errno = EBADF;
+        f->error = 1;
+        return 0;
+    }
+    if (f->save_path) return io_save_write_locked(f, src, n);
+
+    const uint8_t *in = src;
+    size_t done = 0;
+
+    while (done < n) {
+        if (!f->dirty) {
+            // Drop any read-ahead; writing starts at the logical position
+            f->buf_pos = io_position(f);
+            f->buf_len = f->buf_off = 0;
+            f->dirty = 1;
+        }
+
+        size_t left = n - done;
+        if (f->buf_len == 0 && left >= f->buf_size) {
+            SceSSize ret = f->append ? sceIoWrite(f->fd, in + done, left)
+                                     : fios_sched_pwrite(f->fd, in + done, left, f->buf_pos);
+            f->stats.writes++;
+            f->dirty = 0;
+
+            if (ret <= 0) {
+                if (ret < 0) io_set_errno(ret);
+                else errno = ENOSPC;
+                f->error = 1;
+                break;
+            }
+
+            done += ret;
+            f->stats.bytes_written += ret;
+            if (f->append) {
+                f->buf_pos = sceIoLseek(f->fd, 0, SCE_SEEK_CUR);
+                f->stats.other++;
+            } else {
+                f->buf_pos += ret;
+            }
+            continue;
+        }
+
+        size_t space = f->buf_size - f->buf_len;
+        if (space == 0) {
+            if (io_flush_locked(f) < 0) break;
+            continue;
+        }
+
+        size_t take = space < left ? space : left;
+        memcpy(f->buf + f->buf_len, in + done, take);
+        f->buf_len += take;
+        f->buf_off = f->buf_len;
+        done += take;
+    }
+
+    return done;
+}
+
+static int64_t io_size_locked(IoFile *f) {
+    if (f->save_path) return f->buf_len;
+    if (f->size >= 0) return f->size;
+    if (io_flush_locked(f) < 0) return -1;
+
+    int64_t size = sceIoLseek(f->fd, 0, SCE_SEEK_END);
+    f->stats.other++;
+    if (size < 0) {
+        io_set_errno((int)size);
+        return -1;
+    }
+
+    // Only streams nobody can write through keep a stable size
+    if (!f->writable) f->size = size;
+    return size;
+}
+
+// ===== OPEN / CLOSE =====
+
+static int io_parse_mode(const char *mode, IoFile *f) {
+    int flags;
+
+    switch (mode[0]) {
+        case 'r':
+            flags = SCE_O_RDONLY;
+            f->readable = 1;
+            break;
+        case 'w':
+            flags = SCE_O_WRONLY | SCE_O_CREAT | SCE_O_TRUNC;
+            f->writable = 1;
+            break;
+        case 'a':
+            flags = SCE_O_WRONLY | SCE_O_CREAT | SCE_O_APPEND;
+            f->writable = 1;
+            f->append = 1;
+            break;
+        default:
+            return -1;
+    }
+
+    if (strchr(mode, '+')) {
+        flags = (flags & ~SCE_O_RDWR) | SCE_O_RDWR;
+        f->readable = 1;
+        f->writable = 1;
+    }
+    return flags;
+}
+
+FILE *io_fopen(const char *path, const char *mode) {
+    if (!path || !mode) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    IoFile *f = calloc(1, sizeof(IoFile));
+    if (!f) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    int flags = io_parse_mode(mode, f);
+    if (flags < 0) {
+        free(f);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    // Anything but a plain rewrite of a save waits for pending saves of it
+    if (fios_is_save_path(path)) {
+        if (mode[0] == 'w' && !f->readable) f->save_path = strdup(path);
+        if (!f->save_path) fios_save_wait(path);
+    }
+
+    uint64_t start = fios_stats_begin();
+    f->fd = f->save_path ? -1 : sceIoOpen(path, flags, 0777);
+    f->stats_id = fios_stats_file(path);
+    fios_stats_record(f->stats_id, FIOS_OP_OPEN, 0, start);
+    if (f->fd < 0 && !f->save_path) {
+        io_set_errno(f->fd);
+        free(f);
+        return NULL;
+    }
+
+    f->buf_size = io_buffer_size;
+    f->buf = memalign(IO_BUFFER_ALIGN, f->buf_size);
+    // Lookups made while the stream is open go stale once it's written (saves drop theirs on commit)
+    if (f->writable && !f->save_path) f->drop_path = strdup(path);
+    if (!f->buf || (f->writable && !f->save_path && !f->drop_path) ||
+        sceKernelCreateLwMutex(&f->lock, "io_stream", 0, 0, NULL) < 0) {
+        if (f->fd >= 0) sceIoClose(f->fd);
+        free(f->save_path);
+        free(f->drop_path);
+        free(f->buf);
+        free(f);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    f->window = IO_MIN_WINDOW;
+    f->next_seq = -1;
+    f->size = -1;
+    f->fileno = -1;
+    f->magic = IO_MAGIC;
+    f->self = f;
+
+    // Keep the tail of the path; that's the part that identifies the file
+    size_t len = strlen(path);
+    snprintf(f->name, sizeof(f->name), "%s", len >= IO_NAME_LEN ? path + len - (IO_NAME_LEN - 1) : path);
+
+    sceKernelLockLwMutex(&io_list_lock, 1, NULL);
+    f->next = io_open_files;
+    if (io_open_files) io_open_files->prev = f;
+    io_open_files = f;
+    io_streams_opened++;
+    sceKernelUnlockLwMutex(&io_list_lock, 1);
+
+    return (FILE *)f;
+}
+
+int io_fclose(FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) {
+        io_fd_release_foreign(fileno(stream));
+        return fclose(stream);
+    }
+
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    int ret = io_flush_locked(f);
+    if (f->save_path) {
+        // Only a save with missing data is dropped, keeping the previous one.
+        // Other errors (a read on the write-only stream) lose nothing.
+        if (f->save_failed) {
+            debugPrintf("io: %s: save dropped after a failed write, keeping the previous file\n", f->name);
+            ret = EOF;
+        } else {
+            if (fios_save_commit(f->save_path, f->buf, f->buf_len) < 0) ret = EOF;
+            f->buf = NULL; // Owned by FIOS now
+        }
+    } else if (sceIoClose(f->fd) < 0) {
+        ret = EOF;
+    }
+    f->stats.calls++;
+    f->magic = 0;
+    sceKernelUnlockLwMutex(&f->lock, 1);
+
+    sceKernelLockLwMutex(&io_list_lock, 1, NULL);
+    if (f->prev) f->prev->next = f->next;
+    else io_open_files = f->next;
+    if (f->next) f->next->prev = f->prev;
+    io_stats_add(&io_closed_totals, &f->stats);
+    sceKernelUnlockLwMutex(&io_list_lock, 1);
+
+    const IoStats *s = &f->stats;
+    if (s->calls >= IO_REPORT_MIN_CALLS) {
+        uint32_t syscalls = s->reads + s->writes + s->other;
+        debugPrintf("io: %s: %u calls, %u syscalls (%u saved), %u seeks elided, %llu KB read\n",
+                    f->name, s->calls, syscalls, s->calls > syscalls ? s->calls - syscalls : 0,
+                    s->seeks_elided, s->bytes_read / 1024);
+    }
+
+    if (f->fileno >= 0) {
+        IoFd *d = io_fd_get(f->fileno);
+        if (d && d->borrowed && d->uid == f->fd) io_fd_release(d);
+    }
+
+    if (f->drop_path) fios_cache_drop(f->drop_path);
+
+    sceKernelDeleteLwMutex(&f->lock);
+    free(f->save_path);
+    free(f->drop_path);
+    free(f->buf);
+    free(f);
+    return ret;
+}
+
+// ===== STDIO SHIMS =====
+
+size_t io_fread(void *ptr, size_t size, size_t nmemb, FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) return fread(ptr, size, nmemb, stream);
+    if (size == 0 || nmemb == 0) return 0;
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+    size_t bytes = io_read_locked(f, ptr, size * nmemb);
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    fios_stats_record(f->stats_id, FIOS_OP_READ, bytes, start);
+    return bytes / size;
+}
+
+size_t io_fwrite(const void *ptr, size_t size, size_t nmemb, FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) return fwrite(ptr, size, nmemb, stream);
+    if (size == 0 || nmemb == 0) return 0;
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+    size_t bytes = io_write_locked(f, ptr, size * nmemb);
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    fios_stats_record(f->stats_id, FIOS_OP_WRITE, bytes, start);
+    return bytes / size;
+}
+
+int io_fseek(FILE *stream, long offset, int whence) {
+    IoFile *f = io_owned(stream);
+    if (!f) return fseek(stream, offset, whence);
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+
+    int64_t target;
+    switch (whence) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = io_position(f) + offset;
+            break;
+        case SEEK_END: {
+            int64_t size = io_size_locked(f);
+            target = size < 0 ? -1 : size + offset;
+            break;
+        }
+        default:
+            target = -1;
+            break;
+    }
+
+    if (target < 0) {
+        sceKernelUnlockLwMutex(&f->lock, 1);
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (f->save_path) {
+        f->buf_off = target;
+    } else if (!f->dirty && target >= f->buf_pos && target <= f->buf_pos + (int64_t)f->buf_len) {
+        f->buf_off = target - f->buf_pos;
+        f->stats.seeks_elided++;
+    } else {
+        if (io_flush_locked(f) < 0) {
+            sceKernelUnlockLwMutex(&f->lock, 1);
+            return -1;
+        }
+        f->buf_pos = target;
+        f->buf_len = f->buf_off = 0;
+    }
+
+    f->eof = 0;
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    fios_stats_record(f->stats_id, FIOS_OP_SEEK, 0, start);
+    return 0;
+}
+
+long io_ftell(FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) return ftell(stream);
+
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+    long pos = (long)io_position(f);
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    return pos;
+}
+
+void io_rewind(FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) {
+        rewind(stream);
+        return;
+    }
+
+    io_fseek(stream, 0, SEEK_SET);
+    f->error = 0;
+}
+
+int io_feof(FILE *stream) {
+    IoFile *f = io_owned(stream);
+    return f ? f->eof : feof(stream);
+}
+
+int io_ferror(FILE *stream) {
+    IoFile *f = io_owned(stream);
+    return f ? f->error : ferror(stream);
+}
+
+void io_clearerr(FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) {
+        clearerr(stream);
+        return;
+    }
+
+    f->eof = 0;
+    f->error = 0;
+}
+
+int io_fflush(FILE *stream) {
+    if (!stream) {
+        int ret = fflush(NULL);
+
+        sceKernelLockLwMutex(&io_list_lock, 1, NULL);
+        for (IoFile *f = io_open_files; f; f = f->next) {
+            sceKernelLockLwMutex(&f->lock, 1, NULL);
+            if (io_flush_locked(f) < 0) ret = EOF;
+            sceKernelUnlockLwMutex(&f->lock, 1);
+        }
+        sceKernelUnlockLwMutex(&io_list_lock, 1);
+        return ret;
+    }
+
+    IoFile *f = io_owned(stream);
+    if (!f) return fflush(stream);
+
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+    int ret = io_flush_locked(f);
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    return ret;
+}
+
+int io_fgetc(FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) return fgetc(stream);
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+
+    int c;
+    if (f->readable && !f->dirty && f->buf_off < f->buf_len) {
+        c = f->buf[f->buf_off++];
+        f->stats.bytes_read++;
+    } else {
+        unsigned char byte;
+        c = io_read_locked(f, &byte, 1) == 1 ? byte : EOF;
+    }
+
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    fios_stats_record(f->stats_id, FIOS_OP_READ, c != EOF, start);
+    return c;
+}
+
+int io_fputc(int c, FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) return fputc(c, stream);
+
+    unsigned char byte = (unsigned char)c;
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+
+    int ret;
+    if (f->dirty && f->buf_len < f->buf_size) {
+        f->buf[f->buf_len++] = byte;
+        f->buf_off = f->buf_len;
+        ret = byte;
+    } else {
+        ret = io_write_locked(f, &byte, 1) == 1 ? byte : EOF;
+    }
+
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    fios_stats_record(f->stats_id, FIOS_OP_WRITE, ret != EOF, start);
+    return ret;
+}
+
+char *io_fgets(char *s, int size, FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) return fgets(s, size, stream);
+    if (!s || size <= 0) return NULL;
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+
+    size_t n = 0;
+    size_t limit = (size_t)size - 1;
+
+    if (!f->readable || io_flush_locked(f) < 0) {
+        f->error = 1;
+        limit = 0;
+    }
+
+    while (n < limit) {
+        if (f->buf_off == f->buf_len && io_refill(f) <= 0) break;
+
+        size_t avail = f->buf_len - f->buf_off;
+        if (avail > limit - n) avail = limit - n;
+
+        const uint8_t *start = f->buf + f->buf_off;
+        const uint8_t *nl = memchr(start, '\n', avail);
+        size_t take = nl ? (size_t)(nl - start) + 1 : avail;
+
+        memcpy(s + n, start, take);
+        f->buf_off += take;
+        n += take;
+        if (nl) break;
+    }
+
+    f->stats.bytes_read += n;
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    fios_stats_record(f->stats_id, FIOS_OP_READ, n, start);
+
+    if (n == 0 && size > 1) return NULL;
+    s[n] = '\0';
+    return s;
+}
+
+int io_fputs(const char *s, FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) return fputs(s, stream);
+
+    size_t len = strlen(s);
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+    size_t written = io_write_locked(f, s, len);
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    fios_stats_record(f->stats_id, FIOS_OP_WRITE, written, start);
+    return written == len ? (int)len : EOF;
+}
+
+int io_vfprintf(FILE *stream, const char *fmt, va_list args) {
+    IoFile *f = io_owned(stream);
+    if (!f) return vfprintf(stream, fmt, args);
+
+    char stack_buf[IO_PRINTF_STACK];
+    char *text = stack_buf;
+
+    va_list copy;
+    va_copy(copy, args);
+    int len = vsnprintf(stack_buf, sizeof(stack_buf), fmt, args);
+    if (len >= (int)sizeof(stack_buf)) {
+        text = malloc(len + 1);
+        if (text) vsnprintf(text, len + 1, fmt, copy);
+    }
+    va_end(copy);
+
+    if (len < 0 || !text) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+    size_t written = io_write_locked(f, text, len);
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    fios_stats_record(f->stats_id, FIOS_OP_WRITE, written, start);
+
+    if (text != stack_buf) free(text);
+    return written == (size_t)len ? len : -1;
+}
+
+int io_fprintf(FILE *stream, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    int ret = io_vfprintf(stream, fmt, args);
+    va_end(args);
+    return ret;
+}
+
+// Scans the buffered bytes through a memory stream, then advances by what
+// vfscanf consumed. A single conversion longer than IO_SCANF_WINDOW can be
+// cut short; the game only scans small text files this way.
+int io_fscanf(FILE *stream, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+
+    IoFile *f = io_owned(stream);
+    if (!f) {
+        int ret = vfscanf(stream, fmt, args);
+        va_end(args);
+        return ret;
+    }
+
+    uint64_t start = fios_stats_begin();
+    long scanned = 0;
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    f->stats.calls++;
+
+    int ret = EOF;
+    if (f->readable && io_flush_locked(f) == 0) {
+        io_fill_at_least(f, IO_SCANF_WINDOW);
+
+        size_t avail = f->buf_len - f->buf_off;
+        FILE *mem = avail ? fmemopen(f->buf + f->buf_off, avail, "r") : NULL;
+        if (mem) {
+            ret = vfscanf(mem, fmt, args);
+            long used = ftell(mem);
+            fclose(mem);
+
+            if (used > 0) {
+                f->buf_off += used;
+                f->stats.bytes_read += used;
+                scanned = used;
+            }
+        }
+
+        if (ret == EOF) f->eof = 1;
+    }
+
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    fios_stats_record(f->stats_id, FIOS_OP_READ, scanned, start);
+    va_end(args);
+    return ret;
+}
+
+// Owned streams keep their io_buffer_kb buffer, which reads at least as
+// large bypass anyway; only foreign streams take the request
+int io_setvbuf(FILE *stream, char *buf, int mode, size_t size) {
+    if (!io_owned(stream)) return setvbuf(stream, buf, mode, size);
+    return 0;
+}
+
+// Hands out a table fd sharing the stream's handle, so the game can mix
+// fileno() with read/lseek. newlib's own fds would collide with table fds,
+// so foreign streams get a table fd that forwards to newlib.
+int io_fileno(FILE *stream) {
+    IoFile *f = io_owned(stream);
+    if (!f) {
+        int newlib_fd = fileno(stream);
+        if (newlib_fd < IO_FD_BASE) return newlib_fd;
+
+        int fd = io_fd_foreign(newlib_fd);
+        if (fd < 0) errno = EMFILE;
+        return fd;
+    }
+
+    if (f->save_path) {
+        // The file doesn't exist on the card until fclose
+        errno = EBADF;
+        return -1;
+    }
+
+    sceKernelLockLwMutex(&f->lock, 1, NULL);
+    if (f->fileno < 0) {
+        f->fileno = io_fd_alloc(f->fd, f->readable, f->writable, f->append, 1);
+        if (f->fileno < 0) errno = EMFILE;
+        else io_fd_get(f->fileno)->stats_id = f->stats_id;
+    }
+    int fd = f->fileno;
+    sceKernelUnlockLwMutex(&f->lock, 1);
+    return fd;
+}
+
+// ===== FILE DESCRIPTORS =====
+
+static int io_translate_flags(int flags) {
+    int vita_flags;
+
+    switch (flags & ANDROID_O_ACCMODE) {
+        case ANDROID_O_WRONLY: vita_flags = SCE_O_WRONLY; break;
+        case ANDROID_O_RDWR:   vita_flags = SCE_O_RDWR; break;
+        default:               vita_flags = SCE_O_RDONLY; break;
+    }
+
+    if (flags & ANDROID_O_CREAT) vita_flags |= SCE_O_CREAT;
+    if (flags & ANDROID_O_EXCL) vita_flags |= SCE_O_EXCL;
+    if (flags & ANDROID_O_TRUNC) vita_flags |= SCE_O_TRUNC;
+    if (flags & ANDROID_O_APPEND) vita_flags |= SCE_O_APPEND;
+    if (flags & ANDROID_O_NONBLOCK) vita_flags |= SCE_O_NBLOCK;
+    return vita_flags;
+}
+
+static inline IoFd *io_fd_get(int fd) {
+    if (fd < IO_FD_BASE || fd >= IO_FD_BASE + IO_MAX_FDS) return NULL;
+    IoFd *d = &io_fds[fd - IO_FD_BASE];
+    return d->used ? d : NULL;
+}
+
+static int io_fd_alloc_locked(SceUID uid, int readable, int writable, int append, int borrowed) {
+    for (int i = 0; i < IO_MAX_FDS; i++) {
+        IoFd *d = &io_fds[i];
+        if (d->used) continue;
+
+        d->used = 1;
+        d->borrowed = borrowed;
+        d->uid = uid;
+        d->newlib_fd = -1;
+        d->readable = readable;
+        d->writable = writable;
+        d->append = append;
+        d->pos = 0;
+        d->ra_pos = 0;
+        d->ra_len = 0;
+        memset(&d->stats, 0, sizeof(d->stats));
+        d->stats_id = -1;
+        io_fds_opened++;
+        return IO_FD_BASE + i;
+    }
+    return -1;
+}
+
+static int io_fd_alloc(SceUID uid, int readable, int writable, int append, int borrowed) {
+    sceKernelLockLwMutex(&io_fd_table_lock, 1, NULL);
+    int fd = io_fd_alloc_locked(uid, readable, writable, append, borrowed);
+    sceKernelUnlockLwMutex(&io_fd_table_lock, 1);
+    return fd;
+}
+
+// One table fd per foreign stream, reused by later fileno() calls
+static int io_fd_foreign(int newlib_fd) {
+    sceKernelLockLwMutex(&io_fd_table_lock, 1, NULL);
+    for (int i = 0; i < IO_MAX_FDS; i++) {
+        if (io_fds[i].used && io_fds[i].newlib_fd == newlib_fd) {
+            sceKernelUnlockLwMutex(&io_fd_table_lock, 1);
+            return IO_FD_BASE + i;
+        }
+    }
+
+    int fd = io_fd_alloc_locked(-1, 1, 1, 0, 1);
+    if (fd >= 0) io_fds[fd - IO_FD_BASE].newlib_fd = newlib_fd;
+    sceKernelUnlockLwMutex(&io_fd_table_lock, 1);
+    return fd;
+}
+
+static void io_fd_release_locked(IoFd *d) {
+    io_stats_add(&io_fd_totals, &d->stats);
+    free(d->ra);
+    d->ra = NULL;
+    free(d->drop_path);
+    d->drop_path = NULL;
+    d->used = 0;
+}
+
+static void io_fd_release(IoFd *d) {
+    sceKernelLockLwMutex(&io_fd_table_lock, 1, NULL);
+    io_fd_release_locked(d);
+    sceKernelUnlockLwMutex(&io_fd_table_lock, 1);
+}
+
+// The stream is going away; its newlib fd may be reused by the next open
+static void io_fd_release_foreign(int newlib_fd) {
+    if (newlib_fd < IO_FD_BASE) return;
+
+    sceKernelLockLwMutex(&io_fd_table_lock, 1, NULL);
+    for (int i = 0; i < IO_MAX_FDS; i++) {
+        if (io_fds[i].used && io_fds[i].newlib_fd == newlib_fd) io_fd_release_locked(&io_fds[i]);
+    }
+    sceKernelUnlockLwMutex(&io_fd_table_lock, 1);
+}
+
+// newlib has no positioned I/O here; move the shared offset and put it back
+static int io_fd_foreign_at(IoFd *d, void *buf, size_t count, long offset, int is_write) {
+    sceKernelLockLwMutex(&d->lock, 1, NULL);
+    int ret = -1;
+    off_t saved = lseek(d->newlib_fd, 0, SEEK_CUR);
+    if (saved >= 0 && lseek(d->newlib_fd, offset, SEEK_SET) >= 0) {
+        ret = is_write ? write(d->newlib_fd, buf, count) : read(d->newlib_fd, buf, count);
+        int err = errno;
+        lseek(d->newlib_fd, saved, SEEK_SET);
+        errno = err;
+    }
+    sceKernelUnlockLwMutex(&d->lock, 1);
+    return ret;
+}
+
+// Serves what it can from the readahead buffer, refilling it for small reads
+static SceSSize io_fd_read_at(IoFd *d, void *dst, size_t n, int64_t pos) {
+    uint8_t *out = dst;
+    size_t done = 0;
+
+    if (!d->readable) {
+        errno = EBADF;
+        return -1;
+    }
+
+    while (done < n) {
+        int64_t at = pos + done;
+        size_t left = n - done;
+
+        if (d->ra_len && at >= d->ra_pos && at < d->ra_pos + (int64_t)d->ra_len) {
+            size_t off = at - d->ra_pos;
+            size_t take = d->ra_len - off < left ? d->ra_len - off : left;
+            memcpy(out + done, d->ra + off, take);
+            done += take;
+            continue;
+        }
+
+        if (!d->ra && left < io_buffer_size) d->ra = memalign(IO_BUFFER_ALIGN, io_buffer_size);
+
+        // Large reads (or no buffer) go straight to the caller's memory
+        if (!d->ra || left >= io_buffer_size) {
+            SceSSize ret = fios_sched_pread(d->uid, out + done, left, at);
+            d->stats.reads++;
+            if (ret < 0) {
+                if (done) break;
+                io_set_errno(ret);
+                return -1;
+            }
+            done += ret;
+            break;
+        }
+
+        SceSSize ret = fios_sched_pread(d->uid, d->ra, io_buffer_size, at);
+        d->stats.reads++;
+        if (ret < 0) {
+            d->ra_len = 0;
+            if (done) break;
+            io_set_errno(ret);
+            return -1;
+        }
+
+        d->ra_pos = at;
+        d->ra_len = ret;
+        if (ret == 0) break;
+    }
+
+    d->stats.bytes_read += done;
+    return done;
+}
+
+// Write-through; drops the readahead if the write overlaps it
+static SceSSize io_fd_write_at(IoFd *d, const void *src, size_t n, int64_t pos) {
+    if (!d->writable) {
+        errno = EBADF;
+        return -1;
+    }
+
+    SceSSize ret = d->append ? sceIoWrite(d->uid, src, n) : fios_sched_pwrite(d->uid, src, n, pos);
+    d->stats.writes++;
+    if (ret < 0) {
+        io_set_errno(ret);
+        return -1;
+    }
+
+    if (d->append || (pos < d->ra_pos + (int64_t)d->ra_len && pos + ret > d->ra_pos)) {
+        d->ra_len = 0;
+    }
+    d->stats.bytes_written += ret;
+    return ret;
+}
+
+int io_open(const char *path, int flags, int mode) {
+    if (!path) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    if (fios_is_save_path(path)) fios_save_wait(path);
+
+    int vita_flags = io_translate_flags(flags);
+    uint64_t start = fios_stats_begin();
+    SceUID uid = sceIoOpen(path, vita_flags, mode ? mode : 0777);
+    int stats_id = fios_stats_file(path);
+    fios_stats_record(stats_id, FIOS_OP_OPEN, 0, start);
+    if (uid < 0) {
+        io_set_errno(uid);
+        return -1;
+    }
+
+    // Anything that can create or change the file drops it from the FIOS caches at close
+    int access = flags & ANDROID_O_ACCMODE;
+    char *drop_path = NULL;
+    if (access != ANDROID_O_RDONLY || (flags & (ANDROID_O_CREAT | ANDROID_O_TRUNC))) {
+        drop_path = strdup(path);
+        if (!drop_path) {
+            sceIoClose(uid);
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+
+    int fd = io_fd_alloc(uid, access != ANDROID_O_WRONLY, access != 0,
+                         (flags & ANDROID_O_APPEND) != 0, 0);
+    if (fd < 0) {
+        sceIoClose(uid);
+        free(drop_path);
+        errno = EMFILE;
+        return -1;
+    }
+    IoFd *d = io_fd_get(fd);
+    d->stats_id = stats_id;
+    d->drop_path = drop_path;
+    return fd;
+}
+
+int io_close(int fd) {
+    IoFd *d = io_fd_get(fd);
+    if (!d) {
+        if (fd >= 0 && fd < IO_FD_BASE) return close(fd);
+        errno = EBADF;
+        return -1;
+    }
+
+    sceKernelLockLwMutex(&d->lock, 1, NULL);
+    d->stats.calls++;
+    // A borrowed handle (or newlib fd) belongs to its stream; fclose closes it
+    int ret = d->borrowed ? 0 : sceIoClose(d->uid);
+    char *drop_path = d->drop_path;
+    d->drop_path = NULL;
+    sceKernelUnlockLwMutex(&d->lock, 1);
+
+    io_fd_release(d);
+    if (drop_path) {
+        fios_cache_drop(drop_path);
+        free(drop_path);
+    }
+
+    if (ret < 0) {
+        io_set_errno(ret);
+        return -1;
+    }
+    return 0;
+}
+
+int io_read(int fd, void *buf, size_t count) {
+    IoFd *d = io_fd_get(fd);
+    if (!d) {
+        if (fd >= 0 && fd < IO_FD_BASE) return read(fd, buf, count);
+        errno = EBADF;
+        return -1;
+    }
+    if (d->newlib_fd >= 0) return read(d->newlib_fd, buf, count);
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&d->lock, 1, NULL);
+    d->stats.calls++;
+    SceSSize ret = io_fd_read_at(d, buf, count, d->pos);
+    if (ret > 0) d->pos += ret;
+    sceKernelUnlockLwMutex(&d->lock, 1);
+    fios_stats_record(d->stats_id, FIOS_OP_READ, ret > 0 ? ret : 0, start);
+    return ret;
+}
+
+int io_write(int fd, const void *buf, size_t count) {
+    IoFd *d = io_fd_get(fd);
+    if (!d) {
+        if (fd >= 0 && fd < IO_FD_BASE) return write(fd, buf, count);
+        errno = EBADF;
+        return -1;
+    }
+    if (d->newlib_fd >= 0) return write(d->newlib_fd, buf, count);
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&d->lock, 1, NULL);
+    d->stats.calls++;
+    SceSSize ret = io_fd_write_at(d, buf, count, d->pos);
+    if (ret > 0) {
+        if (d->append) {
+            d->pos = sceIoLseek(d->uid, 0, SCE_SEEK_CUR);
+            d->stats.other++;
+        } else {
+            d->pos += ret;
+        }
+    }
+    sceKernelUnlockLwMutex(&d->lock, 1);
+    fios_stats_record(d->stats_id, FIOS_OP_WRITE, ret > 0 ? ret : 0, start);
+    return ret;
+}
+
+int io_pread(int fd, void *buf, size_t count, long offset) {
+    IoFd *d = io_fd_get(fd);
+    if (!d || offset < 0) {
+        errno = d ? EINVAL : EBADF;
+        return -1;
+    }
+    if (d->newlib_fd >= 0) return io_fd_foreign_at(d, buf, count, offset, 0);
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&d->lock, 1, NULL);
+    d->stats.calls++;
+    SceSSize ret = io_fd_read_at(d, buf, count, offset);
+    sceKernelUnlockLwMutex(&d->lock, 1);
+    fios_stats_record(d->stats_id, FIOS_OP_READ, ret > 0 ? ret : 0, start);
+    return ret;
+}
+
+int io_pwrite(int fd, const void *buf, size_t count, long offset) {
+    IoFd *d = io_fd_get(fd);
+    if (!d || offset < 0) {
+        errno = d ? EINVAL : EBADF;
+        return -1;
+    }
+    if (d->newlib_fd >= 0) return io_fd_foreign_at(d, (void *)buf, count, offset, 1);
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&d->lock, 1, NULL);
+    d->stats.calls++;
+    SceSSize ret = io_fd_write_at(d, buf, count, offset);
+    sceKernelUnlockLwMutex(&d->lock, 1);
+    fios_stats_record(d->stats_id, FIOS_OP_WRITE, ret > 0 ? ret : 0, start);
+    return ret;
+}
+
+// The position lives in the table (all I/O is positioned), so only
+// SEEK_END has to ask the kernel
+long io_lseek(int fd, long offset, int whence) {
+    IoFd *d = io_fd_get(fd);
+    if (!d) {
+        if (fd >= 0 && fd < IO_FD_BASE) return lseek(fd, offset, whence);
+        errno = EBADF;
+        return -1;
+    }
+    if (d->newlib_fd >= 0) return lseek(d->newlib_fd, offset, whence);
+
+    uint64_t start = fios_stats_begin();
+    sceKernelLockLwMutex(&d->lock, 1, NULL);
+    d->stats.calls++;
+
+    int64_t target;
+    switch (whence) {
+        case SEEK_SET:
+            target = offset;
+            break;
+        case SEEK_CUR:
+            target = d->pos + offset;
+            break;
+        case SEEK_END: {
+            int64_t size = sceIoLseek(d->uid, 0, SCE_SEEK_END);
+            d->stats.other++;
+            if (size < 0) {
+                sceKernelUnlockLwMutex(&d->lock, 1);
+                io_set_errno((int)size);
+                return -1;
+            }
+            target = size + offset;
+            break;
+        }
+        default:
+            target = -1;
+            break;
+    }
+
+    if (target < 0) {
+        sceKernelUnlockLwMutex(&d->lock, 1);
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (whence != SEEK_END) d->stats.seeks_elided++;
+    d->pos = target;
+    sceKernelUnlockLwMutex(&d->lock, 1);
+    fios_stats_record(d->stats_id, FIOS_OP_SEEK, 0, start);
+    return (long)target;
+}
+
+// ===== REPORT =====
+
+static void io_report_totals(const char *label, const IoStats *total) {
+    uint32_t syscalls = total->reads + total->writes + total->other;
+
+    debugPrintf("  %s calls: %u, syscalls: %u (reads %u, writes %u, seeks %u)\n",
+                label, total->calls, syscalls, total->reads, total->writes, total->other);
+    debugPrintf("  %s syscalls saved: %u, seeks elided: %u\n", label,
+                total->calls > syscalls ? total->calls - syscalls : 0, total->seeks_elided);
+    debugPrintf("  %s read: %llu KB, written: %llu KB\n", label,
+                total->bytes_read / 1024, total->bytes_written / 1024);
+}
+
+void io_stdio_report(void) {
+    IoStats total;
+    int open_count = 0;
+
+    sceKernelLockLwMutex(&io_list_lock, 1, NULL);
+    total = io_closed_totals;
+    for (IoFile *f = io_open_files; f; f = f->next) {
+        io_stats_add(&total, &f->stats);
+        open_count++;
+    }
+    uint32_t opened = io_streams_opened;
+    sceKernelUnlockLwMutex(&io_list_lock, 1);
+
+    IoStats fd_total;
+    int fds_open = 0;
+
+    sceKernelLockLwMutex(&io_fd_table_lock, 1, NULL);
+    fd_total = io_fd_totals;
+    for (int i = 0; i < IO_MAX_FDS; i++) {
+        if (!io_fds[i].used) continue;
+        io_stats_add(&fd_total, &io_fds[i].stats);
+        fds_open++;
+    }
+    uint32_t fds_opened = io_fds_opened;
+    sceKernelUnlockLwMutex(&io_fd_table_lock, 1);
 
-// This file is a placeholder for future I/O patches
-// Currently empty but included in the build
+    debugPrintf("=== STDIO REPORT ===\n");
+    debugPrintf("  streams: %u opened, %d still open\n", opened, open_count);
+    io_report_totals("stream", &total);
+    debugPrintf("  fds: %u opened, %d still open\n", fds_opened, fds_open);
+    io_report_totals("fd", &fd_total);
+    debugPrintf("====================\n");
+}
@@ -29,6 +29,16 @@
 #include "dialog.h"
 #include "fios.h"
 #include "android_patch.h"
+#include "pthread_patch.h"
+#include "sys_utils.h"
+#include "math_patch.h"
+#include "io_patch.h"
+#include "asset_cache.h"
+#include "asset_pack.h"
+#include "asset_trace.h"
+#include "fios_stats.h"
+#include "fios_index.h"
+#include "fios_sched.h"
 
 // GTA SA Vita exact memory configuration
 int sceLibcHeapSize = 240 * 1024 * 1024;
@@ -284,6 +294,11 @@ int main(int argc, char *argv[]) {
     debugPrintf("Initializing pthread...\n");
     int pthread_ret = pthread_init();
     debugPrintf("pthread_init returned: %d\n", pthread_ret);
+    sys_time_init();
+    pthread_patch_init();
+    io_patch_init();
+    fios_stats_init();
+    fios_sched_init();
 
     // Initialize VitaGL with proper configuration
     debugPrintf("Initializing VitaGL...\n");
@@ -307,6 +322,7 @@ int main(int argc, char *argv[]) {
     debugPrintf("Resolving symbols...\n");
     extern DynLibFunction default_dynlib[];
     extern size_t default_dynlib_size;
+    math_patch_apply(default_dynlib, default_dynlib_size);
     if (so_resolve(&fluffydiver_mod, default_dynlib, default_dynlib_size, 0) < 0) {
         fatal_error("Failed to resolve symbols");
     }
@@ -319,6 +335,8 @@ int main(int argc, char *argv[]) {
         fatal_error("Failed to initialize FIOS");
     }
     debugPrintf("FIOS initialized\n");
+    asset_cache_init();
+    asset_trace_init();
 
     // Initialize JNI environment
     debugPrintf("Initializing JNI...\n");
@@ -362,12 +380,33 @@ int main(int argc, char *argv[]) {
     debugPrintf("Entering game main loop...\n");
 
     // Simple control loop for testing
+    uint32_t prev_buttons = 0;
     while (1) {
         SceCtrlData pad;
         sceCtrlPeekBufferPositive(0, &pad, 1);
 
+        // SELECT+L writes the I/O statistics so far (io_stats = 1)
+        uint32_t stats_combo = SCE_CTRL_SELECT | SCE_CTRL_LTRIGGER;
+        if ((pad.buttons & stats_combo) == stats_combo && (prev_buttons & stats_combo) != stats_combo) {
+            fios_stats_dump(FIOS_STATS_CSV_PATH);
+        }
+        prev_buttons = pad.buttons;
+
         if ((pad.buttons & SCE_CTRL_START) && (pad.buttons & SCE_CTRL_SELECT)) {
             debugPrintf("Exit requested\n");
+            lock_profiler_report();
+            thread_policy_report();
+            io_stdio_report();
+            fios_cache_report();
+            fios_index_report();
+            fios_sched_report();
+            asset_pack_report();
+            asset_cache_report();
+            asset_trace_save();
+            asset_trace_report();
+            android_asset_report();
+            fios_stats_dump(FIOS_STATS_CSV_PATH);
+            fios_save_wait(NULL);
             break;
         }
 
@@ -0,0 +1,352 @@
+/*
+ * math_patch.c - Fast float math backend for Fluffy Diver
+ * The game calls libm one scalar at a time through softfp imports, so the
+ * wins come from short straight-line kernels rather than vectorization:
+ * each function reduces its argument, evaluates a small polynomial in VFP
+ * double precision (which keeps results within ~1 ULP without the
+ * extra-precision tricks newlib needs in float), and rounds once.
+ * Special values and out-of-domain inputs fall through to newlib.
+ */
+
+#include <vitasdk.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "so_util.h"
+#include "config.h"
+#include "math_patch.h"
+
+// External debug function
+extern void debugPrintf(const char *fmt, ...);
+
+#define LOG2_TABLE_BITS 4
+#define LOG2_TABLE_SIZE (1 << LOG2_TABLE_BITS)
+#define LOG2_TABLE_BASE 0x3f330000 // ~0.7, so each exponent's mantissa is centered on 1.0
+
+#define EXP2_TABLE_BITS 5
+#define EXP2_TABLE_SIZE (1 << EXP2_TABLE_BITS)
+
+// Round-to-nearest-integer shift (adding it leaves the integer in the low mantissa bits)
+#define ROUND_SHIFT 0x1.8p52
+
+#define INV_LN2 1.4426950408889634
+#define LN2 0.69314718055994530942
+#define LOG10_2 0.30102999566398119521
+#define PI 3.14159265358979323846
+#define PI_2 1.57079632679489661923
+#define PI_4 0.78539816339744830962
+
+// pi/2 split so k * PIO2_HI is exact for |k| < 2^20
+#define PIO2_HI 0x1.921fb544p0
+#define PIO2_LO 0x1.0b4611a626331p-34
+#define TRIG_MAX_ABS 0x1p19f
+
+// 1/c and -log2(1/c) for the centre c of each mantissa sub-interval
+static struct {
+    double invc;
+    double log2c;
+} log2_table[LOG2_TABLE_SIZE];
+
+// Bits of 2^(i/N), pre-biased so the exponent can be added in directly
+static uint64_t exp2_table[EXP2_TABLE_SIZE];
+
+static int math_tables_ready = 0;
+
+static inline uint32_t asuint(float f) {
+    uint32_t i;
+    memcpy(&i, &f, sizeof(i));
+    return i;
+}
+
+static inline float asfloat(uint32_t i) {
+    float f;
+    memcpy(&f, &i, sizeof(f));
+    return f;
+}
+
+static inline uint64_t asuint64(double d) {
+    uint64_t i;
+    memcpy(&i, &d, sizeof(i));
+    return i;
+}
+
+static inline double asdouble(uint64_t i) {
+    double d;
+    memcpy(&d, &i, sizeof(d));
+    return d;
+}
+
+// ===== TABLES =====
+
+// Built once from newlib so the constants can't drift from the real functions
+static void math_tables_init(void) {
+    for (int i = 0; i < LOG2_TABLE_SIZE; i++) {
+        uint32_t lo = LOG2_TABLE_BASE + ((uint32_t)i << (23 - LOG2_TABLE_BITS));
+        double c = asfloat(lo + (1u << (22 - LOG2_TABLE_BITS)));
+        if (asfloat(lo) <= 1.0f && 1.0f < asfloat(lo + (1u << (23 - LOG2_TABLE_BITS)))) {
+            c = 1.0; // log(1) must come out exactly 0
+        }
+        log2_table[i].invc = 1.0 / c;
+        log2_table[i].log2c = -log2(log2_table[i].invc);
+    }
+
+    for (int i = 0; i < EXP2_TABLE_SIZE; i++) {
+        exp2_table[i] = asuint64(exp2((double)i / EXP2_TABLE_SIZE)) - ((uint64_t)i << (52 - EXP2_TABLE_BITS));
+    }
+
+    math_tables_ready = 1;
+}
+
+// ===== EXP / LOG CORES =====
+
+// log2(x) for normal positive x; |r| < 0.032 so a degree-7 series is exact to ~1e-13
+static inline double log2_core(uint32_t ix) {
+    uint32_t tmp = ix - LOG2_TABLE_BASE;
+    int i = (tmp >> (23 - LOG2_TABLE_BITS)) % LOG2_TABLE_SIZE;
+    int k = (int32_t)tmp >> 23;
+    double z = asfloat(ix - (tmp & 0xff800000u));
+
+    double r = z * log2_table[i].invc - 1.0;
+    double p = r * (1.0 + r * (-1.0 / 2 + r * (1.0 / 3 + r * (-1.0 / 4 + r * (1.0 / 5 +
+               r * (-1.0 / 6 + r * (1.0 / 7)))))));
+    return (double)k + log2_table[i].log2c + p * INV_LN2;
+}
+
+// 2^t for -126 < t < 128; |r| <= 1/64 so a degree-4 polynomial is exact to ~1e-12
+static inline float exp2_core(double t) {
+    double kd = t * EXP2_TABLE_SIZE + ROUND_SHIFT;
+    uint64_t ki = asuint64(kd);
+    kd -= ROUND_SHIFT;
+
+    double r = (t * EXP2_TABLE_SIZE - kd) * (LN2 / EXP2_TABLE_SIZE);
+    double s = asdouble(exp2_table[ki % EXP2_TABLE_SIZE] + (ki << (52 - EXP2_TABLE_BITS)));
+    double p = 1.0 + r * (1.0 + r * (1.0 / 2 + r * (1.0 / 6 + r * (1.0 / 24))));
+    return (float)(s * p);
+}
+
+// Normal, positive and finite
+static inline int is_normal_positive(uint32_t ix) {
+    return ix - 0x00800000u < 0x7f800000u - 0x00800000u;
+}
+
+float math_expf(float x) {
+    // Results below FLT_MIN and overflow (with errno) are newlib's problem
+    if (!(x > -87.33654f && x < 88.72283f)) return expf(x);
+    return exp2_core((double)x * INV_LN2);
+}
+
+float math_exp2f(float x) {
+    if (!(x > -126.0f && x < 128.0f)) return exp2f(x);
+    return exp2_core(x);
+}
+
+float math_logf(float x) {
+    uint32_t ix = asuint(x);
+    if (!is_normal_positive(ix)) return logf(x);
+    return (float)(log2_core(ix) * LN2);
+}
+
+float math_log2f(float x) {
+    uint32_t ix = asuint(x);
+    if (!is_normal_positive(ix)) return log2f(x);
+    return (float)log2_core(ix);
+}
+
+float math_log10f(float x) {
+    uint32_t ix = asuint(x);
+    if (!is_normal_positive(ix)) return log10f(x);
+    return (float)(log2_core(ix) * LOG10_2);
+}
+
+float math_powf(float x, float y) {
+    uint32_t ix = asuint(x);
+    if (!is_normal_positive(ix) || !isfinite(y)) return powf(x, y);
+
+    double t = (double)y * log2_core(ix);
+    if (!(t > -126.0 && t < 128.0)) return powf(x, y);
+    return exp2_core(t);
+}
+
+float math_sqrtf(float x) {
+    return __builtin_sqrtf(x);
+}
+
+// ===== TRIGONOMETRY =====
+
+// Minimax kernels on [-pi/4, pi/4] (musl __sindf/__cosdf/__tandf)
+static inline double sin_kernel(double x) {
+    const double S1 = -0x15555554cbac77.0p-55;
+    const double S2 = 0x111110896efbb2.0p-59;
+    const double S3 = -0x1a00f9e2cae774.0p-65;
+    const double S4 = 0x16cd878c3b46a7.0p-71;
+
+    double z = x * x;
+    double w = z * z;
+    double s = z * x;
+    return (x + s * (S1 + z * S2)) + s * w * (S3 + z * S4);
+}
+
+static inline double cos_kernel(double x) {
+    const double C0 = -0x1ffffffd0c5e81.0p-54;
+    const double C1 = 0x155553e1053a42.0p-57;
+    const double C2 = -0x16c087e80f1e27.0p-62;
+    const double C3 = 0x199342e0ee5069.0p-68;
+
+    double z = x * x;
+    double w = z * z;
+    return ((1.0 + z * C0) + w * C1) + (w * z) * (C2 + z * C3);
+}
+
+static inline double tan_kernel(double x, int odd) {
+    const double T0 = 0x15554d3418c99f.0p-54;
+    const double T1 = 0x1112fd38999f72.0p-55;
+    const double T2 = 0x1b54c91d865afe.0p-57;
+    const double T3 = 0x191df3908c33ce.0p-58;
+    const double T4 = 0x185dadfcecf44e.0p-61;
+    const double T5 = 0x1362b9bf971bcd.0p-59;
+
+    double z = x * x;
+    double w = z * z;
+    double s = z * x;
+    double r = (x + s * (T0 + z * T1)) + (s * w) * ((T2 + z * T3) + w * (T4 + z * T5));
+    return odd ? -1.0 / r : r;
+}
+
+// x = k * pi/2 + r with |r| <= pi/4; returns r and the quadrant
+static inline double trig_reduce(float x, unsigned *quadrant) {
+    double xd = x;
+    double kd = xd * (2.0 / PI) + ROUND_SHIFT;
+    *quadrant = (unsigned)asuint64(kd);
+    kd -= ROUND_SHIFT;
+    return (xd - kd * PIO2_HI) - kd * PIO2_LO;
+}
+
+float math_sinf(float x) {
+    if (!(fabsf(x) < TRIG_MAX_ABS)) return sinf(x);
+
+    unsigned q;
+    double r = trig_reduce(x, &q);
+    switch (q & 3) {
+        case 0: return (float)sin_kernel(r);
+        case 1: return (float)cos_kernel(r);
+        case 2: return (float)-sin_kernel(r);
+        default: return (float)-cos_kernel(r);
+    }
+}
+
+float math_cosf(float x) {
+    if (!(fabsf(x) < TRIG_MAX_ABS)) return cosf(x);
+
+    unsigned q;
+    double r = trig_reduce(x, &q);
+    switch (q & 3) {
+        case 0: return (float)cos_kernel(r);
+        case 1: return (float)-sin_kernel(r);
+        case 2: return (float)-cos_kernel(r);
+        default: return (float)sin_kernel(r);
+    }
+}
+
+float math_tanf(float x) {
+    if (!(fabsf(x) < TRIG_MAX_ABS)) return tanf(x);
+
+    unsigned q;
+    double r = trig_reduce(x, &q);
+    return (float)tan_kernel(r, q & 1);
+}
+
+// atan(ax) for ax >= 0 (fdlibm atanf reduction, evaluated in double)
+static double atan_core(double ax) {
+    const double A0 = 3.3333328366e-01;
+    const double A1 = -1.9999158382e-01;
+    const double A2 = 1.4253635705e-01;
+    const double A3 = -1.0648017377e-01;
+    const double A4 = 6.1687607318e-02;
+
+    double base, t;
+    if (ax < 0.4375) {
+        base = 0.0;
+        t = ax;
+    } else if (ax < 0.6875) {
+        base = 4.63647609000806116214e-01; // atan(0.5)
+        t = (2.0 * ax - 1.0) / (2.0 + ax);
+    } else if (ax < 1.1875) {
+        base = PI_4;
+        t = (ax - 1.0) / (ax + 1.0);
+    } else if (ax < 2.4375) {
+        base = 9.82793723247329067985e-01; // atan(1.5)
+        t = (ax - 1.5) / (1.0 + 1.5 * ax);
+    } else {
+        base = PI_2;
+        t = -1.0 / ax;
+    }
+
+    double z = t * t;
+    double w = z * z;
+    double s1 = z * (A0 + w * (A2 + w * A4));
+    double s2 = w * (A1 + w * A3);
+    return base + (t - t * (s1 + s2));
+}
+
+float math_atanf(float x) {
+    if (isnan(x)) return atanf(x);
+
+    double a = atan_core(fabs((double)x));
+    return (float)(x < 0 ? -a : a);
+}
+
+float math_atan2f(float y, float x) {
+    // Zeros and infinities carry sign rules; leave them to newlib
+    if (!isfinite(x) || !isfinite(y) || x == 0.0f || y == 0.0f) return atan2f(y, x);
+
+    double a = atan_core(fabs((double)y / (double)x));
+    if (x < 0) a = PI - a;
+    return (float)(y < 0 ? -a : a);
+}
+
+// ===== BACKEND SELECTION =====
+
+typedef struct {
+    const char *symbol;
+    uintptr_t fast;
+} MathBinding;
+
+static const MathBinding math_bindings[] = {
+    {"sinf", (uintptr_t)&math_sinf},
+    {"cosf", (uintptr_t)&math_cosf},
+    {"tanf", (uintptr_t)&math_tanf},
+    {"atanf", (uintptr_t)&math_atanf},
+    {"atan2f", (uintptr_t)&math_atan2f},
+    {"expf", (uintptr_t)&math_expf},
+    {"exp2f", (uintptr_t)&math_exp2f},
+    {"logf", (uintptr_t)&math_logf},
+    {"log2f", (uintptr_t)&math_log2f},
+    {"log10f", (uintptr_t)&math_log10f},
+    {"powf", (uintptr_t)&math_powf},
+    {"sqrtf", (uintptr_t)&math_sqrtf},
+};
+
+void math_patch_apply(DynLibFunction *funcs, size_t num_funcs) {
+    if (config_get_math_backend() != MATH_BACKEND_FAST) {
+        debugPrintf("math: Using exact (newlib) backend\n");
+        return;
+    }
+
+    if (!math_tables_ready) math_tables_init();
+
+    int bound = 0;
+    int count = sizeof(math_bindings) / sizeof(math_bindings[0]);
+    for (size_t i = 0; i < num_funcs; i++) {
+        for (int j = 0; j < count; j++) {
+            if (strcmp(funcs[i].symbol, math_bindings[j].symbol) == 0) {
+                funcs[i].func = math_bindings[j].fast;
+                bound++;
+                break;
+            }
+        }
+    }
+
+    debugPrintf("math: Using fast backend (%d imports rebound)\n", bound);
+}
@@ -1,5 +1,1136 @@
-// Pthread patches would go here
+/*
+ * pthread_patch.c - pthread shims for Fluffy Diver
+ * Mutexes are backed by SceKernelLwMutex (GTA SA Vita approach), with an
+ * optional contention profiler to track down lock convoys between game threads.
+ *
+ * All shims follow the same layout: the first word of the game's (bionic)
+ * object holds a pointer to a heap-allocated shim, created lazily when the
+ * word still holds a static initializer value.
+ */
+
 #include <vitasdk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "so_util.h"
+#include "config.h"
+#include "pthread_patch.h"
+#include "sys_utils.h"
+#include "fios_sched.h"
+
+// External debug function
+extern void debugPrintf(const char *fmt, ...);
+
+// Game module (for symbolizing lock creators)
+extern so_module fluffydiver_mod;
+
+// Bionic static initializers / attribute values (32-bit ABI)
+#define BIONIC_MUTEX_RECURSIVE_INITIALIZER 0x4000
+#define BIONIC_MUTEX_TYPE_RECURSIVE 1
+#define BIONIC_COND_CLOCK_MONOTONIC 0x2
+#define BIONIC_ONCE_RUNNING 1
+#define BIONIC_ONCE_DONE 2
+
+// Anything below this in an object's first word is a static initializer, not a shim pointer
+#define SHIM_INITIALIZER_MAX 0xFFFF
+
+// Android's default thread stack; newlib's default is far smaller
+#define THREAD_DEFAULT_STACK_SIZE (1024 * 1024)
+#define THREAD_NAME_LEN 32
+
+// Profiler report limits
+#define LOCK_SITE_BUCKETS 64
+#define LOCK_REPORT_SITES 10
+#define LOCK_REPORT_MUTEXES 3
+
+// Shim mutex - the game's pthread_mutex_t holds a pointer to this.
+// The LwMutex work area must stay the first member.
+typedef struct FakeMutex {
+    SceKernelLwMutexWork work;
+
+    // Profiler data (only touched while the mutex is held)
+    uintptr_t creator;
+    uint32_t acquisitions;
+    uint32_t contended;
+    uint64_t wait_us;
+    uint64_t max_hold_us;
+    uint64_t locked_at;
+    uint32_t depth;
+
+    struct FakeMutex *prev;
+    struct FakeMutex *next;
+} FakeMutex;
+
+// Aggregated statistics for all mutexes created from one call site
+typedef struct LockSite {
+    uintptr_t creator;
+    uint32_t mutexes;
+    uint32_t acquisitions;
+    uint32_t contended;
+    uint64_t wait_us;
+    uint64_t max_hold_us;
+    struct LockSite *next;
+} LockSite;
+
+// Shim condition variable - sequence counters, all guarded by lock.
+// total_seq counts waiters that have registered, wakeup_seq the wakeups
+// handed out and woken_seq the wakeups claimed. A waiter may only claim a
+// wakeup issued after it registered (wakeup_seq moved past its snapshot), so
+// a thread that starts waiting after a signal can't steal it from an older one.
+typedef struct FakeCond {
+    uint32_t total_seq;
+    uint32_t wakeup_seq;
+    uint32_t woken_seq;
+    int monotonic;
+    SceKernelLwMutexWork lock;
+    SceKernelLwCondWork cond;
+} FakeCond;
+
+// Shim rwlock - state > 0 is the reader count, -1 means write-locked.
+// Readers and writers only enter the kernel when they have to wait. While
+// the lock is read-held new readers always get in, as with bionic's default
+// reader preference, so a thread taking the read lock recursively can't
+// deadlock behind a queued writer. Once the readers drain, a waiting writer
+// goes before any new reader.
+typedef struct FakeRwlock {
+    volatile int32_t state;
+    volatile uint32_t waiters;
+    volatile uint32_t writers_waiting;
+    SceKernelLwMutexWork lock;
+    SceKernelLwCondWork cond;
+} FakeRwlock;
+
+// Thread placement policy, matched against the start routine symbol or the thread name
+typedef struct {
+    const char *pattern;  // Case-insensitive substring
+    int cpu_mask;         // 0 = leave to the scheduler
+    int priority;         // 0 = inherit
+    size_t stack_size;    // 0 = THREAD_DEFAULT_STACK_SIZE
+    FiosClass io_class;   // Queue for the thread's card reads and writes
+} ThreadPolicy;
+
+// Core 0 is shared by main() and the vitaGL garbage collector
+static const ThreadPolicy thread_policies[] = {
+    // Audio mixing must never wait behind loading
+    {"audio", SCE_KERNEL_CPU_MASK_USER_2, 80, 256 * 1024, FIOS_CLASS_REALTIME},
+    {"sound", SCE_KERNEL_CPU_MASK_USER_2, 80, 256 * 1024, FIOS_CLASS_REALTIME},
+    {"mixer", SCE_KERNEL_CPU_MASK_USER_2, 80, 256 * 1024, FIOS_CLASS_REALTIME},
+
+    // Rendering stays next to the GL context
+    {"render", SCE_KERNEL_CPU_MASK_USER_0, 127, 0, FIOS_CLASS_FOREGROUND},
+    {"draw", SCE_KERNEL_CPU_MASK_USER_0, 127, 0, FIOS_CLASS_FOREGROUND},
+
+    // Loading and decoding get their own core at a lower priority
+    {"load", SCE_KERNEL_CPU_MASK_USER_1, 160, 0, FIOS_CLASS_FOREGROUND},
+    {"stream", SCE_KERNEL_CPU_MASK_USER_1, 160, 0, FIOS_CLASS_FOREGROUND},
+    {"decode", SCE_KERNEL_CPU_MASK_USER_1, 160, 0, FIOS_CLASS_FOREGROUND},
+    {"worker", SCE_KERNEL_CPU_MASK_USER_1, 160, 0, FIOS_CLASS_FOREGROUND},
+};
+
+// Per-thread bookkeeping for threads created by the game
+typedef struct ThreadRecord {
+    void *(*start_routine)(void *);
+    void *arg;
+    pthread_t handle;
+    SceUID thid;
+    char name[THREAD_NAME_LEN];
+    const ThreadPolicy *policy;
+    uint64_t cpu_time_us;
+    int exited;
+    int detached;
+    struct ThreadRecord *next;
+} ThreadRecord;
+
+// Thread registry. Records are freed once the thread has exited and been
+// joined or detached; their CPU time is folded into the reaped totals.
+static SceKernelLwMutexWork thread_lock;
+static ThreadRecord *thread_records = NULL;
+static uint32_t threads_reaped = 0;
+static uint64_t reaped_cpu_us = 0;
+static SceUID main_thid = 0;
+
+// Profiler state
+static int profiler_enabled = 0;
+static SceKernelLwMutexWork profiler_lock;
+static FakeMutex *live_mutexes = NULL;
+static LockSite *lock_sites[LOCK_SITE_BUCKETS];
+
+// ===== INITIALIZATION =====
+
+void pthread_patch_init(void) {
+    main_thid = sceKernelGetThreadId();
+
+    if (sceKernelCreateLwMutex(&thread_lock, "thread_registry", 0, 0, NULL) < 0) {
+        debugPrintf("pthread: ERROR - Cannot create thread registry lock\n");
+    }
+
+    tls_init();
+
+    profiler_enabled = config_get_lock_profiler();
+    if (!profiler_enabled) {
+        return;
+    }
+
+    if (sceKernelCreateLwMutex(&profiler_lock, "lock_profiler", 0, 0, NULL) < 0) {
+        debugPrintf("pthread: ERROR - Cannot create profiler lock, profiling disabled\n");
+        profiler_enabled = 0;
+        return;
+    }
+
+    memset(lock_sites, 0, sizeof(lock_sites));
+    debugPrintf("pthread: Lock contention profiler enabled\n");
+}
+
+int lock_profiler_enabled(void) {
+    return profiler_enabled;
+}
+
+// ===== PROFILER HELPERS =====
+
+static LockSite *lock_site_get(uintptr_t creator) {
+    int bucket = (creator >> 2) % LOCK_SITE_BUCKETS;
+
+    for (LockSite *site = lock_sites[bucket]; site; site = site->next) {
+        if (site->creator == creator) return site;
+    }
+
+    LockSite *site = calloc(1, sizeof(LockSite));
+    if (!site) return NULL;
+
+    site->creator = creator;
+    site->next = lock_sites[bucket];
+    lock_sites[bucket] = site;
+    return site;
+}
+
+static void lock_site_add(LockSite *site, const FakeMutex *m) {
+    site->acquisitions += m->acquisitions;
+    site->contended += m->contended;
+    site->wait_us += m->wait_us;
+    if (m->max_hold_us > site->max_hold_us) site->max_hold_us = m->max_hold_us;
+}
+
+static void profiler_track(FakeMutex *m, uintptr_t creator) {
+    m->creator = creator;
+
+    sceKernelLockLwMutex(&profiler_lock, 1, NULL);
+    LockSite *site = lock_site_get(creator);
+    if (site) site->mutexes++;
+
+    m->prev = NULL;
+    m->next = live_mutexes;
+    if (live_mutexes) live_mutexes->prev = m;
+    live_mutexes = m;
+    sceKernelUnlockLwMutex(&profiler_lock, 1);
+}
+
+// Fold a dying mutex into its call site so its history survives destroy
+static void profiler_untrack(FakeMutex *m) {
+    sceKernelLockLwMutex(&profiler_lock, 1, NULL);
+    LockSite *site = lock_site_get(m->creator);
+    if (site) lock_site_add(site, m);
+
+    if (m->prev) m->prev->next = m->next;
+    else live_mutexes = m->next;
+    if (m->next) m->next->prev = m->prev;
+    sceKernelUnlockLwMutex(&profiler_lock, 1);
+}
+
+static void profiler_print_site(const LockSite *site) {
+    uintptr_t offset = 0;
+    const char *name = so_symbolize(&fluffydiver_mod, site->creator, &offset);
+
+    debugPrintf("  %s+0x%X (0x%08X): %u mutexes, %u locks, %u contended (%u%%), wait %llu us, max hold %llu us\n",
+                name ? name : "???", offset, site->creator,
+                site->mutexes, site->acquisitions, site->contended,
+                site->acquisitions ? (site->contended * 100) / site->acquisitions : 0,
+                site->wait_us, site->max_hold_us);
+
+    // Hottest live mutexes from this site
+    const FakeMutex *hot[LOCK_REPORT_MUTEXES] = {NULL};
+    for (const FakeMutex *m = live_mutexes; m; m = m->next) {
+        if (m->creator != site->creator || m->acquisitions == 0) continue;
+
+        for (int i = 0; i < LOCK_REPORT_MUTEXES; i++) {
+            if (!hot[i] || m->wait_us > hot[i]->wait_us) {
+                memmove(&hot[i + 1], &hot[i], (LOCK_REPORT_MUTEXES - i - 1) * sizeof(hot[0]));
+                hot[i] = m;
+                break;
+            }
+        }
+    }
+
+    for (int i = 0; i < LOCK_REPORT_MUTEXES && hot[i]; i++) {
+        debugPrintf("    mutex %p: %u locks, %u contended, wait %llu us, max hold %llu us\n",
+                    hot[i], hot[i]->acquisitions, hot[i]->contended,
+                    hot[i]->wait_us, hot[i]->max_hold_us);
+    }
+}
+
+void lock_profiler_report(void) {
+    if (!profiler_enabled) {
+        return;
+    }
+
+    sceKernelLockLwMutex(&profiler_lock, 1, NULL);
+
+    // Sites only hold destroyed mutexes until now; merge live ones into a snapshot
+    int num_sites = 0;
+    for (int b = 0; b < LOCK_SITE_BUCKETS; b++) {
+        for (LockSite *site = lock_sites[b]; site; site = site->next) num_sites++;
+    }
+
+    LockSite *snapshot = calloc(num_sites ? num_sites : 1, sizeof(LockSite));
+    if (!snapshot) {
+        sceKernelUnlockLwMutex(&profiler_lock, 1);
+        return;
+    }
+
+    int n = 0;
+    for (int b = 0; b < LOCK_SITE_BUCKETS; b++) {
+        for (LockSite *site = lock_sites[b]; site; site = site->next) {
+            snapshot[n] = *site;
+            for (const FakeMutex *m = live_mutexes; m; m = m->next) {
+                if (m->creator == site->creator) lock_site_add(&snapshot[n], m);
+            }
+            n++;
+        }
+    }
+
+    // Sort by total wait time, hottest first
+    for (int i = 1; i < n; i++) {
+        LockSite key = snapshot[i];
+        int j = i - 1;
+        while (j >= 0 && snapshot[j].wait_us < key.wait_us) {
+            snapshot[j + 1] = snapshot[j];
+            j--;
+        }
+        snapshot[j + 1] = key;
+    }
+
+    debugPrintf("=== LOCK CONTENTION REPORT (%d creation sites) ===\n", n);
+    for (int i = 0; i < n && i < LOCK_REPORT_SITES; i++) {
+        profiler_print_site(&snapshot[i]);
+    }
+    debugPrintf("=================================================\n");
+
+    sceKernelUnlockLwMutex(&profiler_lock, 1);
+    free(snapshot);
+}
+
+
+// ===== SHARED HELPERS =====
+
+// Publish a lazily created shim; returns the winner if another thread raced us
+static void *shim_publish(void *word, void *shim) {
+    uintptr_t *slot = (uintptr_t *)word;
+    uintptr_t expected = __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+
+    if (expected > SHIM_INITIALIZER_MAX) return (void *)expected;
+    if (__atomic_compare_exchange_n(slot, &expected, (uintptr_t)shim, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        return shim;
+    }
+    return (void *)expected;
+}
+
+// Convert an absolute deadline to a relative kernel timeout; ETIMEDOUT if already passed
+static int abstime_to_timeout(const AndroidTimespec *abstime, int monotonic, SceUInt *timeout) {
+    if (!abstime || abstime->tv_nsec < 0 || abstime->tv_nsec >= 1000000000) return EINVAL;
+
+    uint64_t now = monotonic ? sys_monotonic_us() : sys_realtime_us();
+    uint64_t deadline = (uint64_t)abstime->tv_sec * 1000000ULL + abstime->tv_nsec / 1000;
+    if (abstime->tv_sec < 0 || deadline <= now) return ETIMEDOUT;
+
+    uint64_t rel = deadline - now;
+    *timeout = rel > 0xFFFFFFFFULL ? 0xFFFFFFFF : (SceUInt)rel;
+    return 0;
+}
+
+// ===== MUTEX SHIMS =====
+
+static FakeMutex *mutex_create(int recursive) {
+    FakeMutex *m = calloc(1, sizeof(FakeMutex));
+    if (!m) return NULL;
+
+    int attr = recursive ? SCE_KERNEL_MUTEX_ATTR_RECURSIVE : 0;
+    if (sceKernelCreateLwMutex(&m->work, "mutex", attr, 0, NULL) < 0) {
+        free(m);
+        return NULL;
+    }
+    return m;
+}
+
+static void mutex_free(FakeMutex *m) {
+    sceKernelDeleteLwMutex(&m->work);
+    free(m);
+}
+
+// Resolve the shim behind a game mutex, creating it for PTHREAD_MUTEX_INITIALIZER
+static FakeMutex *mutex_get(pthread_mutex_t *mutex, uintptr_t caller) {
+    uintptr_t word = __atomic_load_n((uintptr_t *)mutex, __ATOMIC_ACQUIRE);
+    if (word > SHIM_INITIALIZER_MAX) return (FakeMutex *)word;
+
+    FakeMutex *m = mutex_create(word == BIONIC_MUTEX_RECURSIVE_INITIALIZER);
+    if (!m) return NULL;
+
+    FakeMutex *winner = shim_publish(mutex, m);
+    if (winner != m) {
+        mutex_free(m);
+        return winner;
+    }
+
+    if (profiler_enabled) profiler_track(m, caller);
+    return m;
+}
+
+static void mutex_acquired(FakeMutex *m, uint64_t now) {
+    if (m->depth++ == 0) m->locked_at = now;
+    m->acquisitions++;
+}
+
+// Enhanced pthread stubs with proper error handling (GTA SA Vita approach)
+int pthread_mutex_init_fake(pthread_mutex_t *mutex, const pthread_mutexattr_t *attr) {
+    debugPrintf("pthread: mutex_init(%p, %p)\n", mutex, attr);
+    if (!mutex) return EINVAL;
+
+    int recursive = attr && (*(const int32_t *)attr & 0x3) == BIONIC_MUTEX_TYPE_RECURSIVE;
+    FakeMutex *m = mutex_create(recursive);
+    if (!m) return ENOMEM;
+
+    if (profiler_enabled) {
+        profiler_track(m, (uintptr_t)__builtin_return_address(0));
+    }
+
+    // Store the shim pointer in the mutex
+    *mutex = (pthread_mutex_t)m;
+    return 0;
+}
+
+int pthread_mutex_destroy_fake(pthread_mutex_t *mutex) {
+    debugPrintf("pthread: mutex_destroy(%p)\n", mutex);
+    if (!mutex) return EINVAL;
+
+    // Never-used statically initialized mutex: nothing to free
+    if ((uintptr_t)*mutex <= SHIM_INITIALIZER_MAX) return 0;
+
+    FakeMutex *m = (FakeMutex *)*mutex;
+    if (profiler_enabled && m->creator) {
+        profiler_untrack(m);
+    }
+
+    int ret = sceKernelDeleteLwMutex(&m->work);
+    free(m);
+    *mutex = NULL;
+    return (ret < 0) ? EINVAL : 0;
+}
+
+int pthread_mutex_lock_fake(pthread_mutex_t *mutex) {
+    if (!mutex) return EINVAL;
+
+    FakeMutex *m = mutex_get(mutex, (uintptr_t)__builtin_return_address(0));
+    if (!m) return ENOMEM;
+
+    if (!m->creator) {
+        int ret = sceKernelLockLwMutex(&m->work, 1, NULL);
+        return (ret < 0) ? EINVAL : 0;
+    }
+
+    // Profiled path: an uncontended lock costs one extra timestamp
+    if (sceKernelTryLockLwMutex(&m->work, 1) >= 0) {
+        mutex_acquired(m, sceKernelGetProcessTimeWide());
+        return 0;
+    }
+
+    uint64_t start = sceKernelGetProcessTimeWide();
+    int ret = sceKernelLockLwMutex(&m->work, 1, NULL);
+    if (ret < 0) return EINVAL;
+
+    uint64_t now = sceKernelGetProcessTimeWide();
+    mutex_acquired(m, now);
+    m->contended++;
+    m->wait_us += now - start;
+    return 0;
+}
+
+int pthread_mutex_trylock_fake(pthread_mutex_t *mutex) {
+    if (!mutex) return EINVAL;
+
+    FakeMutex *m = mutex_get(mutex, (uintptr_t)__builtin_return_address(0));
+    if (!m) return ENOMEM;
+
+    if (sceKernelTryLockLwMutex(&m->work, 1) < 0) return EBUSY;
+
+    if (m->creator) {
+        mutex_acquired(m, sceKernelGetProcessTimeWide());
+    }
+    return 0;
+}
+
+int pthread_mutex_unlock_fake(pthread_mutex_t *mutex) {
+    if (!mutex || (uintptr_t)*mutex <= SHIM_INITIALIZER_MAX) return EINVAL;
+
+    FakeMutex *m = (FakeMutex *)*mutex;
+
+    if (m->creator && --m->depth == 0) {
+        uint64_t hold = sceKernelGetProcessTimeWide() - m->locked_at;
+        if (hold > m->max_hold_us) m->max_hold_us = hold;
+    }
+
+    int ret = sceKernelUnlockLwMutex(&m->work, 1);
+    return (ret < 0) ? EINVAL : 0;
+}
+
+// Bionic pthread_mutexattr_t is a single int holding the mutex type
+int pthread_mutexattr_init_fake(pthread_mutexattr_t *attr) {
+    if (!attr) return EINVAL;
+    *(int32_t *)attr = 0;
+    return 0;
+}
+
+int pthread_mutexattr_settype_fake(pthread_mutexattr_t *attr, int type) {
+    if (!attr || type < 0 || type > 2) return EINVAL;
+    *(int32_t *)attr = (*(int32_t *)attr & ~0x3) | type;
+    return 0;
+}
+
+int pthread_mutexattr_destroy_fake(pthread_mutexattr_t *attr) {
+    return attr ? 0 : EINVAL;
+}
+
+// ===== CONDITION VARIABLE SHIMS =====
+
+static FakeCond *cond_create(int monotonic) {
+    FakeCond *c = calloc(1, sizeof(FakeCond));
+    if (!c) return NULL;
+
+    c->monotonic = monotonic;
+    if (sceKernelCreateLwMutex(&c->lock, "cond_lock", 0, 0, NULL) < 0) {
+        free(c);
+        return NULL;
+    }
+    if (sceKernelCreateLwCond(&c->cond, "cond", 0, &c->lock, NULL) < 0) {
+        sceKernelDeleteLwMutex(&c->lock);
+        free(c);
+        return NULL;
+    }
+    return c;
+}
+
+static void cond_free(FakeCond *c) {
+    sceKernelDeleteLwCond(&c->cond);
+    sceKernelDeleteLwMutex(&c->lock);
+    free(c);
+}
+
+static FakeCond *cond_get(pthread_cond_t *cond) {
+    uintptr_t word = __atomic_load_n((uintptr_t *)cond, __ATOMIC_ACQUIRE);
+    if (word > SHIM_INITIALIZER_MAX) return (FakeCond *)word;
+
+    FakeCond *c = cond_create(0);
+    if (!c) return NULL;
+
+    FakeCond *winner = shim_publish(cond, c);
+    if (winner != c) cond_free(c);
+    return winner;
+}
+
+// An uncontended LwMutex is a user-space CAS, so signalling with nobody
+// waiting still stays out of the kernel
+static void cond_wake(FakeCond *c, int all) {
+    sceKernelLockLwMutex(&c->lock, 1, NULL);
+    if (c->total_seq != c->wakeup_seq) {
+        c->wakeup_seq = all ? c->total_seq : c->wakeup_seq + 1;
+        // Waiters re-check their snapshot, so only eligible ones claim the
+        // wakeup; the rest go straight back to sleep
+        sceKernelSignalLwCondAll(&c->cond);
+    }
+    sceKernelUnlockLwMutex(&c->lock, 1);
+}
+
+static int cond_wait_common(pthread_cond_t *cond, pthread_mutex_t *mutex, SceUInt *timeout) {
+    FakeCond *c = cond_get(cond);
+    if (!c) return ENOMEM;
+
+    uint64_t deadline = timeout ? sceKernelGetProcessTimeWide() + *timeout : 0;
+
+    // Register before releasing the mutex so a signal after our predicate check can't be lost
+    sceKernelLockLwMutex(&c->lock, 1, NULL);
+    c->total_seq++;
+    uint32_t seq = c->wakeup_seq;
+
+    int ret = pthread_mutex_unlock_fake(mutex);
+    if (ret != 0) {
+        c->total_seq--;
+        sceKernelUnlockLwMutex(&c->lock, 1);
+        return ret;
+    }
+
+    for (;;) {
+        if (c->wakeup_seq != seq && c->woken_seq != c->wakeup_seq) {
+            ret = 0;
+            break;
+        }
+
+        SceUInt remaining = 0;
+        if (timeout) {
+            uint64_t now = sceKernelGetProcessTimeWide();
+            if (now >= deadline) {
+                // Keep the counters balanced: total - wakeup stays the number of sleepers
+                c->wakeup_seq++;
+                ret = ETIMEDOUT;
+                break;
+            }
+            remaining = (SceUInt)(deadline - now);
+        }
+        sceKernelWaitLwCond(&c->cond, timeout ? &remaining : NULL);
+    }
+    c->woken_seq++;
+    sceKernelUnlockLwMutex(&c->lock, 1);
+
+    pthread_mutex_lock_fake(mutex);
+    return ret;
+}
+
+int pthread_cond_init_fake(pthread_cond_t *cond, const pthread_condattr_t *attr) {
+    if (!cond) return EINVAL;
+
+    int monotonic = attr && (*(const int32_t *)attr & BIONIC_COND_CLOCK_MONOTONIC);
+    FakeCond *c = cond_create(monotonic);
+    if (!c) return ENOMEM;
+
+    *cond = (pthread_cond_t)c;
+    return 0;
+}
+
+int pthread_cond_destroy_fake(pthread_cond_t *cond) {
+    if (!cond) return EINVAL;
+    if ((uintptr_t)*cond <= SHIM_INITIALIZER_MAX) return 0;
+
+    FakeCond *c = (FakeCond *)*cond;
+    sceKernelLockLwMutex(&c->lock, 1, NULL);
+    int busy = c->total_seq != c->woken_seq;
+    sceKernelUnlockLwMutex(&c->lock, 1);
+    if (busy) return EBUSY;
+
+    cond_free(c);
+    *cond = NULL;
+    return 0;
+}
+
+int pthread_cond_wait_fake(pthread_cond_t *cond, pthread_mutex_t *mutex) {
+    if (!cond || !mutex) return EINVAL;
+    return cond_wait_common(cond, mutex, NULL);
+}
+
+int pthread_cond_timedwait_fake(pthread_cond_t *cond, pthread_mutex_t *mutex, const void *abstime) {
+    if (!cond || !mutex) return EINVAL;
+
+    FakeCond *c = cond_get(cond);
+    if (!c) return ENOMEM;
+
+    SceUInt timeout;
+    int ret = abstime_to_timeout(abstime, c->monotonic, &timeout);
+    if (ret != 0) return ret;
+
+    return cond_wait_common(cond, mutex, &timeout);
+}
+
+int pthread_cond_timedwait_monotonic_fake(pthread_cond_t *cond, pthread_mutex_t *mutex, const void *abstime) {
+    if (!cond || !mutex) return EINVAL;
+
+    SceUInt timeout;
+    int ret = abstime_to_timeout(abstime, 1, &timeout);
+    if (ret != 0) return ret;
+
+    return cond_wait_common(cond, mutex, &timeout);
+}
+
+int pthread_cond_timedwait_relative_fake(pthread_cond_t *cond, pthread_mutex_t *mutex, const void *reltime) {
+    const AndroidTimespec *rel = reltime;
+    if (!cond || !mutex || !rel || rel->tv_sec < 0 || rel->tv_nsec < 0) return EINVAL;
+
+    uint64_t us = (uint64_t)rel->tv_sec * 1000000ULL + rel->tv_nsec / 1000;
+    SceUInt timeout = us > 0xFFFFFFFFULL ? 0xFFFFFFFF : (SceUInt)us;
+    return cond_wait_common(cond, mutex, &timeout);
+}
+
+int pthread_cond_signal_fake(pthread_cond_t *cond) {
+    if (!cond) return EINVAL;
+    if ((uintptr_t)*cond <= SHIM_INITIALIZER_MAX) return 0; // No one has ever waited
+
+    cond_wake((FakeCond *)*cond, 0);
+    return 0;
+}
+
+int pthread_cond_broadcast_fake(pthread_cond_t *cond) {
+    if (!cond) return EINVAL;
+    if ((uintptr_t)*cond <= SHIM_INITIALIZER_MAX) return 0;
+
+    cond_wake((FakeCond *)*cond, 1);
+    return 0;
+}
+
+// Bionic pthread_condattr_t is a single int; bit 1 selects CLOCK_MONOTONIC
+int pthread_condattr_init_fake(pthread_condattr_t *attr) {
+    if (!attr) return EINVAL;
+    *(int32_t *)attr = 0;
+    return 0;
+}
+
+int pthread_condattr_setclock_fake(pthread_condattr_t *attr, int clock_id) {
+    if (!attr || clock_id < 0 || clock_id > 1) return EINVAL;
+    if (clock_id) *(int32_t *)attr |= BIONIC_COND_CLOCK_MONOTONIC;
+    else *(int32_t *)attr &= ~BIONIC_COND_CLOCK_MONOTONIC;
+    return 0;
+}
+
+int pthread_condattr_destroy_fake(pthread_condattr_t *attr) {
+    return attr ? 0 : EINVAL;
+}
+
+// ===== PTHREAD_ONCE SHIM =====
+
+int pthread_once_fake(pthread_once_t *once_control, void (*init_routine)(void)) {
+    if (!once_control || !init_routine) return EINVAL;
+
+    volatile int32_t *state = (volatile int32_t *)once_control;
+
+    // Fast path: a single acquire load once initialization has finished
+    if (__atomic_load_n(state, __ATOMIC_ACQUIRE) == BIONIC_ONCE_DONE) return 0;
+
+    int32_t expected = 0;
+    if (__atomic_compare_exchange_n(state, &expected, BIONIC_ONCE_RUNNING, 0,
+                                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+        init_routine();
+        __atomic_store_n(state, BIONIC_ONCE_DONE, __ATOMIC_RELEASE);
+        return 0;
+    }
+
+    // Another thread is running the initializer
+    while (__atomic_load_n(state, __ATOMIC_ACQUIRE) != BIONIC_ONCE_DONE) {
+        sceKernelDelayThread(100);
+    }
+    return 0;
+}
+
+// ===== RWLOCK SHIMS =====
+
+static FakeRwlock *rwlock_create(void) {
+    FakeRwlock *rw = calloc(1, sizeof(FakeRwlock));
+    if (!rw) return NULL;
+
+    if (sceKernelCreateLwMutex(&rw->lock, "rwlock", 0, 0, NULL) < 0) {
+        free(rw);
+        return NULL;
+    }
+    if (sceKernelCreateLwCond(&rw->cond, "rwlock_cond", 0, &rw->lock, NULL) < 0) {
+        sceKernelDeleteLwMutex(&rw->lock);
+        free(rw);
+        return NULL;
+    }
+    return rw;
+}
+
+static void rwlock_free(FakeRwlock *rw) {
+    sceKernelDeleteLwCond(&rw->cond);
+    sceKernelDeleteLwMutex(&rw->lock);
+    free(rw);
+}
+
+static FakeRwlock *rwlock_get(pthread_rwlock_t *rwlock) {
+    uintptr_t word = __atomic_load_n((uintptr_t *)rwlock, __ATOMIC_ACQUIRE);
+    if (word > SHIM_INITIALIZER_MAX) return (FakeRwlock *)word;
+
+    FakeRwlock *rw = rwlock_create();
+    if (!rw) return NULL;
+
+    FakeRwlock *winner = shim_publish(rwlock, rw);
+    if (winner != rw) rwlock_free(rw);
+    return winner;
+}
+
+static int rwlock_try_read(FakeRwlock *rw) {
+    int32_t state = __atomic_load_n(&rw->state, __ATOMIC_SEQ_CST);
+    while (state >= 0) {
+        if (state == 0 && __atomic_load_n(&rw->writers_waiting, __ATOMIC_SEQ_CST) > 0) return 0;
+        if (__atomic_compare_exchange_n(&rw->state, &state, state + 1, 1,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int rwlock_try_write(FakeRwlock *rw) {
+    int32_t expected = 0;
+    return __atomic_compare_exchange_n(&rw->state, &expected, -1, 0,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+// Slow path: register as a waiter under the internal lock so releases can't miss us
+static int rwlock_wait(FakeRwlock *rw, int write, SceUInt *timeout) {
+    int (*try_acquire)(FakeRwlock *) = write ? rwlock_try_write : rwlock_try_read;
+    uint64_t deadline = timeout ? sceKernelGetProcessTimeWide() + *timeout : 0;
+    int ret = 0;
+
+    sceKernelLockLwMutex(&rw->lock, 1, NULL);
+    __atomic_add_fetch(&rw->waiters, 1, __ATOMIC_SEQ_CST);
+    if (write) __atomic_add_fetch(&rw->writers_waiting, 1, __ATOMIC_SEQ_CST);
+    while (!try_acquire(rw)) {
+        SceUInt remaining = 0;
+        if (timeout) {
+            uint64_t now = sceKernelGetProcessTimeWide();
+            if (now >= deadline) {
+                ret = ETIMEDOUT;
+                break;
+            }
+            remaining = (SceUInt)(deadline - now);
+        }
+        sceKernelWaitLwCond(&rw->cond, timeout ? &remaining : NULL);
+    }
+    // The last waiting writer giving up lets parked readers back in
+    if (write && __atomic_sub_fetch(&rw->writers_waiting, 1, __ATOMIC_SEQ_CST) == 0 && ret != 0) {
+        sceKernelSignalLwCondAll(&rw->cond);
+    }
+    __atomic_sub_fetch(&rw->waiters, 1, __ATOMIC_SEQ_CST);
+    sceKernelUnlockLwMutex(&rw->lock, 1);
+    return ret;
+}
+
+static int rwlock_lock(pthread_rwlock_t *rwlock, int write, const void *abstime) {
+    if (!rwlock) return EINVAL;
+
+    FakeRwlock *rw = rwlock_get(rwlock);
+    if (!rw) return ENOMEM;
+
+    if (write ? rwlock_try_write(rw) : rwlock_try_read(rw)) return 0;
+
+    if (!abstime) return rwlock_wait(rw, write, NULL);
+
+    SceUInt timeout;
+    int ret = abstime_to_timeout(abstime, 0, &timeout);
+    if (ret != 0) return ret;
+    return rwlock_wait(rw, write, &timeout);
+}
+
+int pthread_rwlock_init_fake(pthread_rwlock_t *rwlock, const pthread_rwlockattr_t *attr) {
+    if (!rwlock) return EINVAL;
+
+    FakeRwlock *rw = rwlock_create();
+    if (!rw) return ENOMEM;
+
+    *rwlock = (pthread_rwlock_t)rw;
+    return 0;
+}
+
+int pthread_rwlock_destroy_fake(pthread_rwlock_t *rwlock) {
+    if (!rwlock) return EINVAL;
+    if ((uintptr_t)*rwlock <= SHIM_INITIALIZER_MAX) return 0;
+
+    FakeRwlock *rw = (FakeRwlock *)*rwlock;
+    if (rw->state != 0 || rw->waiters > 0) return EBUSY;
+
+    rwlock_free(rw);
+    *rwlock = NULL;
+    return 0;
+}
+
+int pthread_rwlock_rdlock_fake(pthread_rwlock_t *rwlock) {
+    return rwlock_lock(rwlock, 0, NULL);
+}
+
+int pthread_rwlock_wrlock_fake(pthread_rwlock_t *rwlock) {
+    return rwlock_lock(rwlock, 1, NULL);
+}
+
+int pthread_rwlock_timedrdlock_fake(pthread_rwlock_t *rwlock, const void *abstime) {
+    return rwlock_lock(rwlock, 0, abstime);
+}
+
+int pthread_rwlock_timedwrlock_fake(pthread_rwlock_t *rwlock, const void *abstime) {
+    return rwlock_lock(rwlock, 1, abstime);
+}
+
+int pthread_rwlock_tryrdlock_fake(pthread_rwlock_t *rwlock) {
+    if (!rwlock) return EINVAL;
+
+    FakeRwlock *rw = rwlock_get(rwlock);
+    if (!rw) return ENOMEM;
+    return rwlock_try_read(rw) ? 0 : EBUSY;
+}
+
+int pthread_rwlock_trywrlock_fake(pthread_rwlock_t *rwlock) {
+    if (!rwlock) return EINVAL;
+
+    FakeRwlock *rw = rwlock_get(rwlock);
+    if (!rw) return ENOMEM;
+    return rwlock_try_write(rw) ? 0 : EBUSY;
+}
+
+int pthread_rwlock_unlock_fake(pthread_rwlock_t *rwlock) {
+    if (!rwlock || (uintptr_t)*rwlock <= SHIM_INITIALIZER_MAX) return EINVAL;
+
+    FakeRwlock *rw = (FakeRwlock *)*rwlock;
+    int32_t state = __atomic_load_n(&rw->state, __ATOMIC_RELAXED);
+    int32_t released;
+
+    if (state == -1) {
+        __atomic_store_n(&rw->state, 0, __ATOMIC_SEQ_CST);
+        released = 1;
+    } else if (state > 0) {
+        released = __atomic_sub_fetch(&rw->state, 1, __ATOMIC_SEQ_CST) == 0;
+    } else {
+        return EPERM;
+    }
+
+    // Only enter the kernel when the lock became free and someone is parked on it
+    if (released && __atomic_load_n(&rw->waiters, __ATOMIC_SEQ_CST) > 0) {
+        sceKernelLockLwMutex(&rw->lock, 1, NULL);
+        sceKernelSignalLwCondAll(&rw->cond);
+        sceKernelUnlockLwMutex(&rw->lock, 1);
+    }
+    return 0;
+}
+
+// ===== THREAD CREATION POLICY =====
+
+static const ThreadPolicy *thread_policy_match(const char *name) {
+    if (!name || !name[0]) return NULL;
+
+    int count = sizeof(thread_policies) / sizeof(thread_policies[0]);
+    for (int i = 0; i < count; i++) {
+        if (strcasestr(name, thread_policies[i].pattern)) return &thread_policies[i];
+    }
+    return NULL;
+}
+
+static void thread_policy_apply(ThreadRecord *rec, SceUID thid) {
+    const ThreadPolicy *policy = rec->policy;
+    if (!policy) return;
+
+    if (policy->cpu_mask) sceKernelChangeThreadCpuAffinityMask(thid, policy->cpu_mask);
+    if (policy->priority) sceKernelChangeThreadPriority(thid, policy->priority);
+    fios_sched_set_thread_class(thid, policy->io_class);
+}
+
+// Caller holds thread_lock
+static ThreadRecord *thread_record_find_locked(pthread_t thread) {
+    for (ThreadRecord *rec = thread_records; rec; rec = rec->next) {
+        if (pthread_equal(rec->handle, thread)) return rec;
+    }
+    return NULL;
+}
+
+// Caller holds thread_lock
+static void thread_record_free_locked(ThreadRecord *rec) {
+    for (ThreadRecord **link = &thread_records; *link; link = &(*link)->next) {
+        if (*link == rec) {
+            *link = rec->next;
+            break;
+        }
+    }
+    if (rec->exited) {
+        threads_reaped++;
+        reaped_cpu_us += rec->cpu_time_us;
+    }
+    free(rec);
+}
+
+static uint64_t thread_cpu_time_us(SceUID thid) {
+    SceKernelThreadInfo info;
+    memset(&info, 0, sizeof(info));
+    info.size = sizeof(info);
+    if (sceKernelGetThreadInfo(thid, &info) < 0) return 0;
+    return info.runClocks.quad;
+}
+
+// Snapshot CPU time while the kernel thread still exists. Nobody will join
+// a detached thread, so its record goes now; rec is invalid afterwards.
+static void thread_record_exit(ThreadRecord *rec) {
+    uint64_t cpu_us = thread_cpu_time_us(rec->thid);
+
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    if (rec->policy) fios_sched_thread_exit(rec->thid);
+    rec->cpu_time_us = cpu_us;
+    rec->exited = 1;
+    if (rec->detached) thread_record_free_locked(rec);
+    sceKernelUnlockLwMutex(&thread_lock, 1);
+}
+
+static void *thread_trampoline(void *arg) {
+    ThreadRecord *rec = arg;
+
+    // The policy may have changed through pthread_setname_np before we ran
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    rec->thid = sceKernelGetThreadId();
+    rec->handle = pthread_self();
+    thread_policy_apply(rec, rec->thid);
+    sceKernelUnlockLwMutex(&thread_lock, 1);
+
+    void *ret = rec->start_routine(rec->arg);
+
+    tls_thread_exit();
+    thread_record_exit(rec);
+    return ret;
+}
+
+int pthread_create_fake(pthread_t *thread, const pthread_attr_t *attr,
+                        void *(*start_routine)(void *), void *arg) {
+    if (!thread || !start_routine) return EINVAL;
+
+    ThreadRecord *rec = calloc(1, sizeof(ThreadRecord));
+    if (!rec) return EAGAIN;
+
+    rec->start_routine = start_routine;
+    rec->arg = arg;
+
+    uintptr_t offset = 0;
+    const char *symbol = so_symbolize(&fluffydiver_mod, (uintptr_t)start_routine, &offset);
+    snprintf(rec->name, sizeof(rec->name), "%s", symbol ? symbol : "thread");
+    rec->policy = thread_policy_match(symbol);
+
+    // Build our own attributes so the policy stack size applies without touching the game's
+    size_t stack_size = THREAD_DEFAULT_STACK_SIZE;
+    int detach_state = PTHREAD_CREATE_JOINABLE;
+    if (attr) {
+        size_t requested = 0;
+        if (pthread_attr_getstacksize(attr, &requested) == 0 && requested > stack_size) {
+            stack_size = requested;
+        }
+        pthread_attr_getdetachstate(attr, &detach_state);
+    }
+    if (rec->policy && rec->policy->stack_size > stack_size) {
+        stack_size = rec->policy->stack_size;
+    }
+
+    pthread_attr_t local_attr;
+    pthread_attr_init(&local_attr);
+    pthread_attr_setstacksize(&local_attr, stack_size);
+    pthread_attr_setdetachstate(&local_attr, detach_state);
+
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    rec->next = thread_records;
+    thread_records = rec;
+    sceKernelUnlockLwMutex(&thread_lock, 1);
+
+    int ret = pthread_create(thread, &local_attr, thread_trampoline, rec);
+    pthread_attr_destroy(&local_attr);
+
+    if (ret != 0) {
+        debugPrintf("pthread: create(%s) failed: %d\n", rec->name, ret);
+        sceKernelLockLwMutex(&thread_lock, 1, NULL);
+        thread_record_free_locked(rec);
+        sceKernelUnlockLwMutex(&thread_lock, 1);
+        return ret;
+    }
+
+    // Set the handle before returning so create-then-setname finds the record
+    // even if the new thread hasn't been scheduled yet. A detached thread only
+    // owns its record from here on, so it can't free it under us.
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    rec->handle = *thread;
+    debugPrintf("pthread: created %s (stack %u KB, policy %s)\n", rec->name,
+                (unsigned)(stack_size / 1024), rec->policy ? rec->policy->pattern : "none");
+    if (detach_state == PTHREAD_CREATE_DETACHED) {
+        if (rec->exited) thread_record_free_locked(rec);
+        else rec->detached = 1;
+    }
+    sceKernelUnlockLwMutex(&thread_lock, 1);
+    return 0;
+}
+
+int pthread_join_fake(pthread_t thread, void **value_ptr) {
+    int ret = pthread_join(thread, value_ptr);
+    if (ret != 0) return ret;
+
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    ThreadRecord *rec = thread_record_find_locked(thread);
+    if (rec) thread_record_free_locked(rec);
+    sceKernelUnlockLwMutex(&thread_lock, 1);
+    return 0;
+}
+
+int pthread_detach_fake(pthread_t thread) {
+    int ret = pthread_detach(thread);
+    if (ret != 0) return ret;
+
+    // Still running: the thread frees its own record on the way out
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    ThreadRecord *rec = thread_record_find_locked(thread);
+    if (rec) {
+        if (rec->exited) thread_record_free_locked(rec);
+        else rec->detached = 1;
+    }
+    sceKernelUnlockLwMutex(&thread_lock, 1);
+    return 0;
+}
+
+void pthread_exit_fake(void *value_ptr) {
+    tls_thread_exit();
+
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    ThreadRecord *rec = thread_record_find_locked(pthread_self());
+    sceKernelUnlockLwMutex(&thread_lock, 1);
+    if (rec) thread_record_exit(rec); // Only this thread can free its live record
+
+    pthread_exit(value_ptr);
+}
+
+// Names usually arrive after creation, so name-based policies are applied here
+int pthread_setname_np_fake(pthread_t thread, const char *name) {
+    if (!name) return EINVAL;
+
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    ThreadRecord *rec = thread_record_find_locked(thread);
+    if (rec && !rec->exited) {
+        snprintf(rec->name, sizeof(rec->name), "%s", name);
+
+        // Not started yet: the trampoline applies the policy once the thread id is known
+        const ThreadPolicy *policy = thread_policy_match(name);
+        if (policy && policy != rec->policy) {
+            rec->policy = policy;
+            if (rec->thid) thread_policy_apply(rec, rec->thid);
+            debugPrintf("pthread: %s now uses policy %s\n", rec->name, policy->pattern);
+        }
+    }
+    sceKernelUnlockLwMutex(&thread_lock, 1);
+    return 0;
+}
+
+// Loader service threads (FIOS, prefetch, save writer) aren't counted
+uint64_t thread_cpu_time_total_us(void) {
+    uint64_t total = main_thid ? thread_cpu_time_us(main_thid) : 0;
+
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    for (ThreadRecord *rec = thread_records; rec; rec = rec->next) {
+        if (rec->exited) total += rec->cpu_time_us;
+        else if (rec->thid) total += thread_cpu_time_us(rec->thid);
+    }
+    total += reaped_cpu_us;
+    sceKernelUnlockLwMutex(&thread_lock, 1);
+    return total;
+}
+
+void thread_policy_report(void) {
+    debugPrintf("=== GAME THREAD REPORT ===\n");
+
+    sceKernelLockLwMutex(&thread_lock, 1, NULL);
+    for (ThreadRecord *rec = thread_records; rec; rec = rec->next) {
+        uint64_t cpu_us = rec->exited ? rec->cpu_time_us : thread_cpu_time_us(rec->thid);
+        debugPrintf("  %-31s thid 0x%08X mask 0x%05X prio %3d cpu %llu ms%s\n",
+                    rec->name, rec->thid,
+                    rec->policy ? rec->policy->cpu_mask : 0,
+                    rec->policy ? rec->policy->priority : 0,
+                    cpu_us / 1000, rec->exited ? " (exited)" : "");
+    }
+    if (threads_reaped) {
+        debugPrintf("  %u finished threads, cpu %llu ms\n", threads_reaped, reaped_cpu_us / 1000);
+    }
+    sceKernelUnlockLwMutex(&thread_lock, 1);
 
-// This file is a placeholder for future pthread patches
-// Currently empty but included in the build
+    debugPrintf("==========================\n");
+}
@@ -0,0 +1,191 @@
+/*
+ * pthread_tls.c - pthread TLS key shims for Fluffy Diver
+ * Keys are served from a per-thread block stored in a kernel TLS slot. The
+ * slot's offset from TPIDRURO is measured once, so getspecific/setspecific
+ * are an MRC plus a couple of loads. Split from pthread_patch.c so the key
+ * code builds on its own (tools/bench_tls.c).
+ */
+
+#include <vitasdk.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "pthread_patch.h"
+
+// External debug function
+extern void debugPrintf(const char *fmt, ...);
+
+// Thread-local storage: the first TLS_INLINE_KEYS keys live inline in the
+// per-thread block, the rest in an overflow table allocated on first use
+#define TLS_KERNEL_SLOT 0x40
+#define TLS_INLINE_KEYS 32
+#define TLS_MAX_KEYS 256
+#define TLS_DESTRUCTOR_ITERATIONS 4
+
+// Key table entry. seq is odd while the key is allocated and changes on every
+// create/delete, so values left behind by a deleted key are never returned.
+typedef struct {
+    uint32_t seq;
+    void (*destructor)(void *);
+} TlsKey;
+
+typedef struct {
+    uint32_t seq;
+    void *value;
+} TlsSlot;
+
+// Per-thread TLS block, reached through the kernel TLS slot
+typedef struct {
+    TlsSlot slots[TLS_INLINE_KEYS];
+    TlsSlot *overflow;
+} TlsBlock;
+
+// TLS state
+static TlsKey tls_keys[TLS_MAX_KEYS];
+static uintptr_t tls_tp_offset = 0;
+static int tls_tp_valid = 0;
+
+// ===== THREAD-LOCAL STORAGE =====
+
+// TPIDRURO, the user read-only thread pointer
+static inline uintptr_t thread_pointer(void) {
+#ifdef __arm__
+    uintptr_t tp;
+    __asm__ volatile("mrc p15, 0, %0, c13, c0, 3" : "=r"(tp));
+    return tp;
+#else
+    return 0;
+#endif
+}
+
+// The kernel TLS area sits at a fixed offset from the thread pointer, so the
+// offset is measured once and every later lookup is a single MRC plus a load
+void tls_init(void) {
+    void *addr = sceKernelGetTLSAddr(TLS_KERNEL_SLOT);
+    uintptr_t tp = thread_pointer();
+
+    if (addr && tp) {
+        tls_tp_offset = (uintptr_t)addr - tp;
+        tls_tp_valid = 1;
+    } else {
+        debugPrintf("pthread: TLS fast path unavailable, using sceKernelGetTLSAddr\n");
+    }
+}
+
+static inline TlsBlock **tls_block_ptr(void) {
+    if (__builtin_expect(tls_tp_valid, 1)) {
+        return (TlsBlock **)(thread_pointer() + tls_tp_offset);
+    }
+    return (TlsBlock **)sceKernelGetTLSAddr(TLS_KERNEL_SLOT);
+}
+
+static TlsSlot *tls_slot(TlsBlock *blk, uint32_t k, int create) {
+    if (k < TLS_INLINE_KEYS) return &blk->slots[k];
+
+    if (!blk->overflow) {
+        if (!create) return NULL;
+        blk->overflow = calloc(TLS_MAX_KEYS - TLS_INLINE_KEYS, sizeof(TlsSlot));
+        if (!blk->overflow) return NULL;
+    }
+    return &blk->overflow[k - TLS_INLINE_KEYS];
+}
+
+// Run destructors for the calling thread and release its block
+void tls_thread_exit(void) {
+    TlsBlock **ptr = tls_block_ptr();
+    TlsBlock *blk = *ptr;
+    if (!blk) return;
+
+    // Destructors may set values again, so repeat a bounded number of times
+    for (int pass = 0; pass < TLS_DESTRUCTOR_ITERATIONS; pass++) {
+        int called = 0;
+
+        for (uint32_t k = 0; k < TLS_MAX_KEYS; k++) {
+            TlsSlot *slot = tls_slot(blk, k, 0);
+            if (!slot) break;
+            if (!slot->value) continue;
+
+            uint32_t seq = __atomic_load_n(&tls_keys[k].seq, __ATOMIC_ACQUIRE);
+            void (*destructor)(void *) = tls_keys[k].destructor;
+            void *value = slot->value;
+            slot->value = NULL;
+
+            if (slot->seq == seq && (seq & 1) && destructor) {
+                destructor(value);
+                called = 1;
+            }
+        }
+
+        if (!called) break;
+    }
+
+    *ptr = NULL;
+    free(blk->overflow);
+    free(blk);
+}
+
+int pthread_key_create_fake(pthread_key_t *key, void (*destructor)(void *)) {
+    if (!key) return EINVAL;
+
+    for (uint32_t k = 0; k < TLS_MAX_KEYS; k++) {
+        uint32_t seq = __atomic_load_n(&tls_keys[k].seq, __ATOMIC_RELAXED);
+        if (seq & 1) continue;
+
+        // Claim first; no thread can hold a value for the new sequence until
+        // the key is handed out, so setting the destructor afterwards is safe
+        if (__atomic_compare_exchange_n(&tls_keys[k].seq, &seq, seq + 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            tls_keys[k].destructor = destructor;
+            *key = (pthread_key_t)(uintptr_t)k;
+            return 0;
+        }
+    }
+    return EAGAIN;
+}
+
+int pthread_key_delete_fake(pthread_key_t key) {
+    uint32_t k = (uint32_t)(uintptr_t)key;
+    if (k >= TLS_MAX_KEYS) return EINVAL;
+
+    uint32_t seq = __atomic_load_n(&tls_keys[k].seq, __ATOMIC_RELAXED);
+    if (!(seq & 1)) return EINVAL;
+
+    // Bumping the sequence orphans every thread's value without touching them
+    __atomic_store_n(&tls_keys[k].seq, seq + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+void *pthread_getspecific_fake(pthread_key_t key) {
+    uint32_t k = (uint32_t)(uintptr_t)key;
+    TlsBlock *blk = *tls_block_ptr();
+    if (!blk || k >= TLS_MAX_KEYS) return NULL;
+
+    TlsSlot *slot = tls_slot(blk, k, 0);
+    if (!slot || slot->seq != __atomic_load_n(&tls_keys[k].seq, __ATOMIC_RELAXED)) return NULL;
+    return slot->value;
+}
+
+int pthread_setspecific_fake(pthread_key_t key, const void *value) {
+    uint32_t k = (uint32_t)(uintptr_t)key;
+    if (k >= TLS_MAX_KEYS) return EINVAL;
+
+    uint32_t seq = __atomic_load_n(&tls_keys[k].seq, __ATOMIC_RELAXED);
+    if (!(seq & 1)) return EINVAL;
+
+    TlsBlock **ptr = tls_block_ptr();
+    TlsBlock *blk = *ptr;
+    if (!blk) {
+        if (!value) return 0;
+        blk = calloc(1, sizeof(TlsBlock));
+        if (!blk) return ENOMEM;
+        *ptr = blk;
+    }
+
+    TlsSlot *slot = tls_slot(blk, k, value != NULL);
+    if (!slot) return value ? ENOMEM : 0;
+
+    slot->seq = seq;
+    slot->value = (void *)value;
+    return 0;
+}
@@ -453,6 +453,42 @@ uintptr_t so_symbol(so_module *mod, const char *symbol_name) {
     return 0;
 }
 
+// Reverse lookup: name of the dynsym entry containing addr (or the nearest one below it)
+const char *so_symbolize(so_module *mod, uintptr_t addr, uintptr_t *offset) {
+    if (!mod->dynsym || !mod->dynstr || !mod->hash) return NULL;
+
+    uintptr_t base = (uintptr_t)mod->base;
+    if (addr < base || addr >= base + mod->size) return NULL;
+
+    uint32_t *hash = (uint32_t*)mod->hash;
+    uint32_t nchain = hash[1];
+    Elf32_Sym *syms = (Elf32_Sym*)mod->dynsym;
+
+    uint32_t rel = addr - base;
+    int best = -1;
+    uint32_t best_value = 0;
+
+    for (uint32_t i = 1; i < nchain; i++) {
+        // Thumb functions have bit 0 set in st_value
+        uint32_t value = syms[i].st_value & ~1;
+        if (value == 0 || value > rel) continue;
+
+        if (rel < value + syms[i].st_size) {
+            best = i;
+            best_value = value;
+            break;
+        }
+        if (best < 0 || value > best_value) {
+            best = i;
+            best_value = value;
+        }
+    }
+
+    if (best < 0) return NULL;
+    if (offset) *offset = rel - best_value;
+    return (char*)mod->dynstr + syms[best].st_name;
+}
+
 void hook_addr(uintptr_t addr, uintptr_t dst) {
     if (addr == 0) {
         debugPrintf("[SO] WARNING: Trying to hook NULL address\n");
@@ -0,0 +1,199 @@
+/*
+ * string_patch.c - Word-at-a-time string functions for Fluffy Diver
+ * Asset and script code in the game is string-heavy, and newlib's versions
+ * walk one byte at a time. These read aligned 32-bit words and test four
+ * bytes at once (SWAR). An aligned word never straddles a page, so reading
+ * the bytes around the terminator can't fault even though it touches
+ * memory past the end of the string.
+ *
+ * NEON isn't used: strings in the game are short, and moving a NEON
+ * result back into an ARM register on the Cortex-A9 stalls for longer
+ * than a short scan takes.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <strings.h>
+
+#include "string_patch.h"
+
+#define ONES  0x01010101u
+#define HIGHS 0x80808080u
+
+// Nonzero if any byte of v is zero; the lowest flagged byte is always the first zero
+#define HAS_ZERO(v) (((v) - ONES) & ~(v) & HIGHS)
+
+typedef uint32_t __attribute__((__may_alias__)) word_t;
+
+// Index (0-3) of the lowest flagged byte in a HAS_ZERO-style mask (little endian)
+static inline unsigned first_byte(uint32_t mask) {
+    return __builtin_ctz(mask) >> 3;
+}
+
+// Mask with the bytes below the start offset forced nonzero
+static inline uint32_t head_mask(uintptr_t addr) {
+    return (1u << ((addr & 3) * 8)) - 1;
+}
+
+// ASCII lowercase of all four bytes at once
+static inline uint32_t lower_word(uint32_t v) {
+    uint32_t low7 = v & ~HIGHS;
+    uint32_t ge_a = low7 + (0x80 - 'A') * ONES;
+    uint32_t gt_z = low7 + (0x80 - 'Z' - 1) * ONES;
+    uint32_t upper = (ge_a ^ gt_z) & ~v & HIGHS;
+    return v | (upper >> 2);
+}
+
+static inline int lower_byte(unsigned char c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+// ===== LENGTH / SEARCH =====
+
+size_t string_strlen(const char *s) {
+    const word_t *w = (const word_t *)((uintptr_t)s & ~(uintptr_t)3);
+    uint32_t v = *w | head_mask((uintptr_t)s);
+
+    while (!HAS_ZERO(v)) v = *++w;
+    return (const char *)w + first_byte(HAS_ZERO(v)) - s;
+}
+
+char *string_strchr(const char *s, int c) {
+    unsigned char ch = (unsigned char)c;
+    uint32_t pattern = ch * ONES;
+    const word_t *w = (const word_t *)((uintptr_t)s & ~(uintptr_t)3);
+
+    // Bytes before s are forced to neither zero nor ch
+    uint32_t head = head_mask((uintptr_t)s);
+    uint32_t v = *w;
+    uint32_t hits = (HAS_ZERO(v | head) | HAS_ZERO((v ^ pattern) | head));
+
+    while (!hits) {
+        v = *++w;
+        hits = HAS_ZERO(v) | HAS_ZERO(v ^ pattern);
+    }
+
+    const char *p = (const char *)w + first_byte(hits);
+    return (unsigned char)*p == ch ? (char *)p : NULL;
+}
+
+// ===== COMPARISON =====
+
+int string_strcmp(const char *s1, const char *s2) {
+    const unsigned char *a = (const unsigned char *)s1;
+    const unsigned char *b = (const unsigned char *)s2;
+
+    // Align a, bailing out on a terminator or mismatch
+    while ((uintptr_t)a & 3) {
+        if (*a != *b || !*a) return *a - *b;
+        a++;
+        b++;
+    }
+
+    const word_t *wa = (const word_t *)a;
+    unsigned shift = ((uintptr_t)b & 3) * 8;
+
+    if (shift == 0) {
+        const word_t *wb = (const word_t *)b;
+        while (*wa == *wb && !HAS_ZERO(*wa)) {
+            wa++;
+            wb++;
+        }
+    } else {
+        // b is misaligned: build each word from two aligned loads. The next
+        // load only happens once the live bytes of the current one are known
+        // to be nonzero, so it stays inside the string.
+        const word_t *wb = (const word_t *)((uintptr_t)b & ~(uintptr_t)3);
+        uint32_t lo = *wb++;
+
+        while (!HAS_ZERO(lo | ((1u << shift) - 1))) {
+            uint32_t hi = *wb++;
+            uint32_t vb = (lo >> shift) | (hi << (32 - shift));
+            if (*wa != vb || HAS_ZERO(*wa)) break;
+            wa++;
+            lo = hi;
+        }
+    }
+
+    // Finish the mismatching or terminating word byte by byte
+    b += (const unsigned char *)wa - a;
+    a = (const unsigned char *)wa;
+    while (*a == *b && *a) {
+        a++;
+        b++;
+    }
+    return *a - *b;
+}
+
+int string_strncmp(const char *s1, const char *s2, size_t n) {
+    const unsigned char *a = (const unsigned char *)s1;
+    const unsigned char *b = (const unsigned char *)s2;
+
+    if ((((uintptr_t)a ^ (uintptr_t)b) & 3) == 0) {
+        while (n && ((uintptr_t)a & 3)) {
+            if (*a != *b || !*a) return *a - *b;
+            a++;
+            b++;
+            n--;
+        }
+
+        while (n >= 4) {
+            uint32_t va = *(const word_t *)a;
+            if (va != *(const word_t *)b || HAS_ZERO(va)) break;
+            a += 4;
+            b += 4;
+            n -= 4;
+        }
+    }
+
+    for (; n; n--, a++, b++) {
+        if (*a != *b || !*a) return *a - *b;
+    }
+    return 0;
+}
+
+int string_strcasecmp(const char *s1, const char *s2) {
+    const unsigned char *a = (const unsigned char *)s1;
+    const unsigned char *b = (const unsigned char *)s2;
+
+    if ((((uintptr_t)a ^ (uintptr_t)b) & 3) == 0) {
+        while ((uintptr_t)a & 3) {
+            int d = lower_byte(*a) - lower_byte(*b);
+            if (d || !*a) return d;
+            a++;
+            b++;
+        }
+
+        for (;;) {
+            uint32_t va = *(const word_t *)a;
+            if (HAS_ZERO(va) || lower_word(va) != lower_word(*(const word_t *)b)) break;
+            a += 4;
+            b += 4;
+        }
+    }
+
+    for (;; a++, b++) {
+        int d = lower_byte(*a) - lower_byte(*b);
+        if (d || !*a) return d;
+    }
+}
+
+// Short needles (the common case: extensions, path fragments, tokens) scan
+// for the first byte with the word-wise strchr. Long needles go to newlib,
+// whose two-way search avoids the quadratic worst case.
+#define STRSTR_SHORT_NEEDLE 32
+
+char *string_strstr(const char *haystack, const char *needle) {
+    if (!needle[0]) return (char *)haystack;
+    if (!needle[1]) return string_strchr(haystack, needle[0]);
+
+    size_t rest = string_strlen(needle + 1);
+    if (rest >= STRSTR_SHORT_NEEDLE) return strstr(haystack, needle);
+
+    for (const char *p = haystack; (p = string_strchr(p, needle[0])) != NULL; p++) {
+        if (p[1] == needle[1] && string_strncmp(p + 1, needle + 1, rest) == 0) {
+            return (char *)p;
+        }
+    }
+    return NULL;
+}
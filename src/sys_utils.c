@@ -1,5 +1,184 @@
-// System utilities would go here
+/*
+ * sys_utils.c - System utilities for Fluffy Diver
+ * Time subsystem: every clock is derived from sceKernelGetProcessTimeWide()
+ * (a cheap microsecond counter), with the RTC read once at startup to get
+ * the offset to Unix time. Frame timers call these several times per frame,
+ * so the hot path has no syscalls beyond the counter read and no divisions.
+ */
+
 #include <vitasdk.h>
+#include <string.h>
+#include <errno.h>
+
+#include "sys_utils.h"
+#include "pthread_patch.h"
+
+// External debug function
+extern void debugPrintf(const char *fmt, ...);
+
+// Unix epoch in RTC ticks (microseconds since 0001-01-01)
+#define RTC_UNIX_EPOCH_US 62135596800000000ULL
+
+// Resolution of the process time counter
+#define SYS_CLOCK_RES_NS 1000
+
+// floor(2^64 / 10^6), for dividing by a million with a multiply
+#define US_PER_SEC_RECIPROCAL 18446744073709ULL
+
+// Unix time minus process time, sampled once
+static uint64_t realtime_offset_us = 0;
+
+// ===== INITIALIZATION =====
+
+void sys_time_init(void) {
+    SceRtcTick tick;
+    sceRtcGetCurrentTick(&tick);
+    uint64_t process_us = sceKernelGetProcessTimeWide();
+
+    realtime_offset_us = tick.tick - RTC_UNIX_EPOCH_US - process_us;
+    debugPrintf("sys: Time base ready (unix %llu s)\n",
+                (unsigned long long)((process_us + realtime_offset_us) / 1000000ULL));
+}
+
+// ===== CLOCK SOURCES =====
+
+uint64_t sys_monotonic_us(void) {
+    return sceKernelGetProcessTimeWide();
+}
+
+uint64_t sys_realtime_us(void) {
+    return sceKernelGetProcessTimeWide() + realtime_offset_us;
+}
+
+static uint64_t thread_cputime_us(void) {
+    SceKernelThreadInfo info;
+    memset(&info, 0, sizeof(info));
+    info.size = sizeof(info);
+    if (sceKernelGetThreadInfo(sceKernelGetThreadId(), &info) < 0) return 0;
+    return info.runClocks.quad;
+}
+
+// High 64 bits of a 64x64 product from 32-bit halves (UMULL/UMLAL on ARMv7)
+static inline uint64_t mulhi64(uint64_t a, uint64_t b) {
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+
+    uint64_t lo_lo = a_lo * b_lo;
+    uint64_t hi_lo = a_hi * b_lo;
+    uint64_t lo_hi = a_lo * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi; // Can't overflow
+    return a_hi * b_hi + (hi_lo >> 32) + (cross >> 32);
+}
+
+// Split microseconds into seconds + remainder without a 64-bit division
+// (a libgcc call on ARMv7). floor(2^64 / 10^6) undershoots the quotient by
+// at most one, so a single correction step makes it exact for any input.
+static inline void us_split(uint64_t us, uint32_t *sec, uint32_t *rem_us) {
+    uint64_t s = mulhi64(us, US_PER_SEC_RECIPROCAL);
+    uint64_t rem = us - s * 1000000ULL;
+
+    if (rem >= 1000000) {
+        s++;
+        rem -= 1000000;
+    }
+
+    *sec = (uint32_t)s;
+    *rem_us = (uint32_t)rem;
+}
+
+// ===== TIME SHIMS =====
+
+int sys_clock_gettime(int clock_id, AndroidTimespec *ts) {
+    if (!ts) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    uint64_t us;
+    switch (clock_id) {
+        case ANDROID_CLOCK_MONOTONIC:
+        case ANDROID_CLOCK_MONOTONIC_RAW:
+        case ANDROID_CLOCK_MONOTONIC_COARSE:
+        case ANDROID_CLOCK_BOOTTIME:
+            us = sys_monotonic_us();
+            break;
+        case ANDROID_CLOCK_REALTIME:
+        case ANDROID_CLOCK_REALTIME_COARSE:
+            us = sys_realtime_us();
+            break;
+        case ANDROID_CLOCK_PROCESS_CPUTIME_ID:
+            // No per-process counter is exposed to user mode, so sum runClocks
+            // over main() and the game's threads (see thread_cpu_time_total_us)
+            us = thread_cpu_time_total_us();
+            break;
+        case ANDROID_CLOCK_THREAD_CPUTIME_ID:
+            us = thread_cputime_us();
+            break;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+
+    uint32_t sec, rem_us;
+    us_split(us, &sec, &rem_us);
+    ts->tv_sec = (int32_t)sec;
+    ts->tv_nsec = (int32_t)(rem_us * 1000);
+    return 0;
+}
+
+int sys_clock_getres(int clock_id, AndroidTimespec *res) {
+    if (clock_id < ANDROID_CLOCK_REALTIME || clock_id > ANDROID_CLOCK_BOOTTIME) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (res) {
+        res->tv_sec = 0;
+        res->tv_nsec = SYS_CLOCK_RES_NS;
+    }
+    return 0;
+}
+
+int sys_gettimeofday(AndroidTimeval *tv, void *tz) {
+    if (!tv) return 0;
+
+    uint32_t sec, rem_us;
+    us_split(sys_realtime_us(), &sec, &rem_us);
+    tv->tv_sec = (int32_t)sec;
+    tv->tv_usec = (int32_t)rem_us;
+    return 0;
+}
+
+int sys_nanosleep(const AndroidTimespec *req, AndroidTimespec *rem) {
+    if (!req || req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= 1000000000) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    // Round up so callers never wake early
+    uint64_t us = (uint64_t)req->tv_sec * 1000000ULL + ((uint32_t)req->tv_nsec + 999) / 1000;
+    while (us > 0) {
+        SceUInt chunk = us > 0x7FFFFFFFULL ? 0x7FFFFFFF : (SceUInt)us;
+        sceKernelDelayThread(chunk);
+        us -= chunk;
+    }
+
+    // The delay is never interrupted, so there is nothing left to report
+    if (rem) {
+        rem->tv_sec = 0;
+        rem->tv_nsec = 0;
+    }
+    return 0;
+}
+
+int32_t sys_time(int32_t *t) {
+    uint32_t sec, rem_us;
+    us_split(sys_realtime_us(), &sec, &rem_us);
+    if (t) *t = (int32_t)sec;
+    return (int32_t)sec;
+}
 
-// pthread_init is already declared in pthread.h, so we don't need to redefine it
-// This file is just a placeholder for any future system utilities
+// Bionic CLOCKS_PER_SEC is 1000000, so clock() is process time in microseconds
+int32_t sys_clock(void) {
+    return (int32_t)sys_monotonic_us();
+}
@@ -0,0 +1,237 @@
+/*
+ * bench_clock.c - Time shim benchmark for Fluffy Diver (Linux host)
+ * Measures the per-call cost of the clock_gettime/gettimeofday/time shims in
+ * src/sys_utils.c next to the host's own calls, then checks that:
+ *
+ *   - every timespec/timeval lands between two raw counter reads taken
+ *     around it (so the seconds/remainder split is exact)
+ *   - CLOCK_MONOTONIC never steps back, within a thread or across
+ *     --threads threads publishing the latest value they saw
+ *
+ * Build: cc -O2 -Iinclude -Itools/host -o bench_clock tools/bench_clock.c src/sys_utils.c -lpthread
+ * Usage: bench_clock [--threads N] [--iterations N]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "vitasdk.h"
+#include "sys_utils.h"
+
+#define MAX_THREADS 16
+
+typedef struct {
+    const char *label;
+    int (*call)(void);
+} Case;
+
+static int thread_count = 4;
+static int iterations = 5000000;
+static int failures = 0;
+
+static pthread_barrier_t start_barrier;
+static volatile uint64_t latest_us = 0;
+
+// ===== LOADER STUBS =====
+
+void debugPrintf(const char *fmt, ...) {
+}
+
+uint64_t thread_cpu_time_total_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+// ===== CALLS UNDER TEST =====
+
+static int shim_monotonic(void) {
+    AndroidTimespec ts;
+    sys_clock_gettime(ANDROID_CLOCK_MONOTONIC, &ts);
+    return ts.tv_nsec;
+}
+
+static int shim_realtime(void) {
+    AndroidTimespec ts;
+    sys_clock_gettime(ANDROID_CLOCK_REALTIME, &ts);
+    return ts.tv_nsec;
+}
+
+static int shim_thread_cputime(void) {
+    AndroidTimespec ts;
+    sys_clock_gettime(ANDROID_CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_nsec;
+}
+
+static int shim_gettimeofday(void) {
+    AndroidTimeval tv;
+    sys_gettimeofday(&tv, NULL);
+    return tv.tv_usec;
+}
+
+static int shim_time(void) {
+    return sys_time(NULL);
+}
+
+static int host_monotonic(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int)ts.tv_nsec;
+}
+
+static int host_gettimeofday(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int)tv.tv_usec;
+}
+
+static const Case cases[] = {
+    {"host clock_gettime", host_monotonic},
+    {"host gettimeofday", host_gettimeofday},
+    {"shim MONOTONIC", shim_monotonic},
+    {"shim REALTIME", shim_realtime},
+    {"shim THREAD_CPUTIME", shim_thread_cputime},
+    {"shim gettimeofday", shim_gettimeofday},
+    {"shim time", shim_time},
+};
+#define CASE_COUNT (sizeof(cases) / sizeof(cases[0]))
+
+// ===== BENCHMARK =====
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void check(int ok, const char *what) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+static void run_case(const Case *c) {
+    volatile int sink = 0;
+    uint64_t start = now_ns();
+    for (int i = 0; i < iterations; i++) sink += c->call();
+    uint64_t centi_ns = (now_ns() - start) * 100 / iterations;
+
+    printf("  %-24s %6llu.%02llu\n", c->label, (unsigned long long)(centi_ns / 100),
+           (unsigned long long)(centi_ns % 100));
+}
+
+// ===== CORRECTNESS =====
+
+static uint64_t timespec_us(const AndroidTimespec *ts) {
+    return (uint64_t)(uint32_t)ts->tv_sec * 1000000 + ts->tv_nsec / 1000;
+}
+
+static void check_conversion(void) {
+    int bad_monotonic = 0, bad_realtime = 0, bad_timeval = 0;
+
+    for (int i = 0; i < iterations / 10; i++) {
+        AndroidTimespec ts;
+        AndroidTimeval tv;
+
+        uint64_t before = sys_monotonic_us();
+        sys_clock_gettime(ANDROID_CLOCK_MONOTONIC, &ts);
+        uint64_t after = sys_monotonic_us();
+        uint64_t us = timespec_us(&ts);
+        if (ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000 || us < before || us > after) bad_monotonic++;
+
+        before = sys_realtime_us();
+        sys_clock_gettime(ANDROID_CLOCK_REALTIME, &ts);
+        after = sys_realtime_us();
+        us = timespec_us(&ts);
+        if (ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000 || us < before || us > after) bad_realtime++;
+
+        before = sys_realtime_us();
+        sys_gettimeofday(&tv, NULL);
+        after = sys_realtime_us();
+        us = (uint64_t)(uint32_t)tv.tv_sec * 1000000 + tv.tv_usec;
+        if (tv.tv_usec < 0 || tv.tv_usec >= 1000000 || us < before || us > after) bad_timeval++;
+    }
+
+    check(bad_monotonic == 0, "MONOTONIC timespec matches the counter");
+    check(bad_realtime == 0, "REALTIME timespec matches the counter");
+    check(bad_timeval == 0, "gettimeofday matches the counter");
+
+    struct timeval host;
+    gettimeofday(&host, NULL);
+    int32_t shim = sys_time(NULL);
+    check(shim >= host.tv_sec - 1 && shim <= host.tv_sec + 1, "time() agrees with the host clock");
+
+    AndroidTimespec ts;
+    check(sys_clock_gettime(ANDROID_CLOCK_PROCESS_CPUTIME_ID, &ts) == 0 && ts.tv_nsec < 1000000000,
+          "PROCESS_CPUTIME returns a valid timespec");
+    check(sys_clock_gettime(42, &ts) == -1, "unknown clock rejected");
+}
+
+// Each read must be at least the latest value any thread published before it
+static void *monotonic_main(void *arg) {
+    intptr_t backwards = 0;
+    uint64_t last = 0;
+
+    pthread_barrier_wait(&start_barrier);
+    for (int i = 0; i < iterations / 10; i++) {
+        uint64_t seen = __atomic_load_n(&latest_us, __ATOMIC_ACQUIRE);
+        AndroidTimespec ts;
+        sys_clock_gettime(ANDROID_CLOCK_MONOTONIC, &ts);
+        uint64_t us = timespec_us(&ts);
+
+        if (us < last || us < seen) backwards++;
+        last = us;
+
+        while (seen < us && !__atomic_compare_exchange_n(&latest_us, &seen, us, 1,
+                                                         __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        }
+    }
+    return (void *)backwards;
+}
+
+static void check_monotonic(void) {
+    pthread_t threads[MAX_THREADS];
+    intptr_t backwards = 0;
+
+    pthread_barrier_init(&start_barrier, NULL, thread_count);
+    for (int i = 0; i < thread_count; i++) pthread_create(&threads[i], NULL, monotonic_main, NULL);
+    for (int i = 0; i < thread_count; i++) {
+        void *ret;
+        pthread_join(threads[i], &ret);
+        backwards += (intptr_t)ret;
+    }
+    pthread_barrier_destroy(&start_barrier);
+    check(backwards == 0, "MONOTONIC never steps back across threads");
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        int value = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--threads") == 0) thread_count = value;
+        else if (strcmp(argv[i], "--iterations") == 0) iterations = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (thread_count <= 0 || thread_count > MAX_THREADS || iterations < 10) {
+        fprintf(stderr, "invalid thread or iteration count\n");
+        return 1;
+    }
+
+    sys_time_init();
+
+    printf("%d calls per case\n", iterations);
+    printf("  %-24s %9s\n", "", "ns/call");
+    for (size_t i = 0; i < CASE_COUNT; i++) run_case(&cases[i]);
+
+    printf("\nChecks\n");
+    check_conversion();
+    check_monotonic();
+
+    printf("%s\n", failures ? "FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
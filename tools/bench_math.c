@@ -0,0 +1,282 @@
+/*
+ * bench_math.c - Fast math backend harness for Fluffy Diver (Linux host)
+ * Checks the src/math_patch.c kernels against libm in double precision and
+ * times them next to the host's float libm:
+ *
+ *   - accuracy: unary functions walk every --stride'th float bit pattern
+ *     (--stride 1 is exhaustive) and report the worst error in ULPs of the
+ *     float result; atan2f and powf use --pairs random argument pairs.
+ *     A function fails if it exceeds the bound documented in math_patch.h.
+ *   - throughput: ns per call over a buffer of in-domain inputs. glibc's
+ *     float libm is far quicker than newlib's, so host speedups understate
+ *     the gain on the Vita.
+ *
+ * The fast backend is switched on through math_patch_apply(), exactly as the
+ * loader does before so_resolve().
+ *
+ * Build: cc -O2 -Iinclude -Itools/host -o bench_math tools/bench_math.c src/math_patch.c -lm
+ * Usage: bench_math [--stride N] [--pairs N] [--calls N]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vitasdk.h"
+#include "config.h"
+#include "math_patch.h"
+
+#define BENCH_INPUTS 4096
+
+typedef struct {
+    const char *name;
+    float (*fast)(float);
+    float (*host)(float);
+    double (*ref)(double);
+    float lo, hi;   // Domain the bound applies to (open interval on both ends)
+    double bound;   // Documented max error in ULPs
+} Unary;
+
+typedef struct {
+    const char *name;
+    float (*fast)(float, float);
+    float (*host)(float, float);
+    double (*ref)(double, double);
+    double bound;
+} Binary;
+
+static uint32_t stride = 61;
+static uint32_t pairs = 20000000;
+static uint32_t calls = 20000000;
+static int failures = 0;
+
+static const Unary unary[] = {
+    {"sinf", math_sinf, sinf, sin, -0x1p19f, 0x1p19f, 0.51},
+    {"cosf", math_cosf, cosf, cos, -0x1p19f, 0x1p19f, 0.51},
+    {"tanf", math_tanf, tanf, tan, -0x1p19f, 0x1p19f, 0.80},
+    {"atanf", math_atanf, atanf, atan, -INFINITY, INFINITY, 0.56},
+    {"expf", math_expf, expf, exp, -87.33654f, 88.72283f, 0.51},
+    {"exp2f", math_exp2f, exp2f, exp2, -126.0f, 128.0f, 0.51},
+    {"logf", math_logf, logf, log, 0.0f, INFINITY, 0.50},
+    {"log2f", math_log2f, log2f, log2, 0.0f, INFINITY, 0.50},
+    {"log10f", math_log10f, log10f, log10, 0.0f, INFINITY, 0.52},
+    {"sqrtf", math_sqrtf, sqrtf, sqrt, 0.0f, INFINITY, 0.50},
+};
+#define UNARY_COUNT (sizeof(unary) / sizeof(unary[0]))
+
+static const Binary binary[] = {
+    {"atan2f", math_atan2f, atan2f, atan2, 0.56},
+    {"powf", math_powf, powf, pow, 0.51},
+};
+#define BINARY_COUNT (sizeof(binary) / sizeof(binary[0]))
+
+// ===== LOADER STUBS =====
+
+void debugPrintf(const char *fmt, ...) {
+}
+
+int config_get_math_backend(void) {
+    return MATH_BACKEND_FAST;
+}
+
+// ===== HELPERS =====
+
+static float asfloat(uint32_t i) {
+    float f;
+    memcpy(&f, &i, sizeof(f));
+    return f;
+}
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15ULL;
+
+static uint32_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)(rng_state >> 16);
+}
+
+// Error of a float result in ULPs of the correctly rounded float
+static double ulp_error(float got, double want) {
+    if (isnan(want)) return isnan(got) ? 0.0 : INFINITY;
+    if (isinf(want) || isinf(got)) return (float)want == got ? 0.0 : INFINITY;
+
+    int exp;
+    frexp(want, &exp);
+    if (exp < -125) exp = -125; // Subnormal results share FLT_MIN's ULP
+    return fabs((double)got - want) / ldexp(1.0, exp - 24);
+}
+
+// Normal, finite and inside (lo, hi)
+static int in_domain(float x, float lo, float hi) {
+    return isnormal(x) && x > lo && x < hi;
+}
+
+// Result stays a normal float, as math_patch.h's bounds assume
+static int result_normal(double r) {
+    return isnormal((float)r) && fabs(r) >= 0x1p-126;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// ===== ACCURACY =====
+
+static void accuracy_unary(const Unary *f) {
+    double worst = 0.0;
+    float worst_x = 0.0f;
+    uint64_t tested = 0;
+
+    for (uint64_t bits = 0; bits <= 0xFFFFFFFFULL; bits += stride) {
+        float x = asfloat((uint32_t)bits);
+        if (!in_domain(x, f->lo, f->hi)) continue;
+
+        double want = f->ref(x);
+        if (!result_normal(want) && want != 0.0) continue;
+
+        double err = ulp_error(f->fast(x), want);
+        tested++;
+        if (err > worst) {
+            worst = err;
+            worst_x = x;
+        }
+    }
+
+    int ok = worst <= f->bound;
+    printf("  %-7s %12llu %9.3f %9.2f  %-14a %s\n", f->name, (unsigned long long)tested, worst,
+           f->bound, worst_x, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+static void accuracy_binary(const Binary *f) {
+    double worst = 0.0;
+    float worst_x = 0.0f, worst_y = 0.0f;
+    uint64_t tested = 0;
+
+    while (tested < pairs) {
+        float x = asfloat(rng_next());
+        float y = asfloat(rng_next());
+        if (!isnormal(x) || !isnormal(y)) continue;
+
+        // powf's bound covers positive bases; keep y small enough that a
+        // useful share of results are neither 0 nor overflow
+        if (f->fast == math_powf) {
+            x = fabsf(x);
+            y = ldexpf(y, -ilogbf(y) + (int)(rng_next() % 10) - 3);
+        }
+
+        double want = f->ref(x, y);
+        if (!result_normal(want)) continue;
+
+        double err = ulp_error(f->fast(x, y), want);
+        tested++;
+        if (err > worst) {
+            worst = err;
+            worst_x = x;
+            worst_y = y;
+        }
+    }
+
+    int ok = worst <= f->bound;
+    printf("  %-7s %12llu %9.3f %9.2f  %a, %a %s\n", f->name, (unsigned long long)tested, worst,
+           f->bound, worst_x, worst_y, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// ===== THROUGHPUT =====
+
+static float unary_inputs[BENCH_INPUTS];
+static float binary_inputs[BENCH_INPUTS][2];
+
+static double time_unary(float (*fn)(float)) {
+    volatile float sink = 0.0f;
+    float acc = 0.0f;
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < calls; i++) acc += fn(unary_inputs[i % BENCH_INPUTS]);
+    sink = acc;
+    (void)sink;
+    return (double)(now_ns() - start) / calls;
+}
+
+static double time_binary(float (*fn)(float, float)) {
+    volatile float sink = 0.0f;
+    float acc = 0.0f;
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < calls; i++) {
+        acc += fn(binary_inputs[i % BENCH_INPUTS][0], binary_inputs[i % BENCH_INPUTS][1]);
+    }
+    sink = acc;
+    (void)sink;
+    return (double)(now_ns() - start) / calls;
+}
+
+static void throughput(void) {
+    printf("\nThroughput (%u calls)\n", calls);
+    printf("  %-7s %9s %9s %8s\n", "", "host ns", "fast ns", "speedup");
+
+    for (size_t i = 0; i < UNARY_COUNT; i++) {
+        const Unary *f = &unary[i];
+        // Inputs a game would pass: angles within a few turns, moderate magnitudes
+        float lo = fmaxf(f->lo, -64.0f), hi = fminf(f->hi, 1024.0f);
+        if (lo <= 0.0f && f->lo == 0.0f) lo = 0x1p-20f;
+        for (int j = 0; j < BENCH_INPUTS; j++) {
+            unary_inputs[j] = lo + (hi - lo) * (rng_next() / 4294967296.0f);
+        }
+
+        double host = time_unary(f->host);
+        double fast = time_unary(f->fast);
+        printf("  %-7s %9.2f %9.2f %7.2fx\n", f->name, host, fast, host / fast);
+    }
+
+    for (size_t i = 0; i < BINARY_COUNT; i++) {
+        const Binary *f = &binary[i];
+        for (int j = 0; j < BENCH_INPUTS; j++) {
+            binary_inputs[j][0] = 0.01f + 100.0f * (rng_next() / 4294967296.0f);
+            binary_inputs[j][1] = -4.0f + 8.0f * (rng_next() / 4294967296.0f);
+        }
+
+        double host = time_binary(f->host);
+        double fast = time_binary(f->fast);
+        printf("  %-7s %9.2f %9.2f %7.2fx\n", f->name, host, fast, host / fast);
+    }
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        long value = atol(argv[i + 1]);
+        if (strcmp(argv[i], "--stride") == 0) stride = (uint32_t)value;
+        else if (strcmp(argv[i], "--pairs") == 0) pairs = (uint32_t)value;
+        else if (strcmp(argv[i], "--calls") == 0) calls = (uint32_t)value;
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (stride == 0 || calls == 0) {
+        fprintf(stderr, "stride and calls must be positive\n");
+        return 1;
+    }
+
+    // Builds the lookup tables and rebinds this table, as the loader does
+    DynLibFunction probe[] = {{"sinf", (uintptr_t)&sinf}};
+    math_patch_apply(probe, 1);
+    if (probe[0].func != (uintptr_t)&math_sinf) {
+        fprintf(stderr, "math_patch_apply did not select the fast backend\n");
+        return 1;
+    }
+
+    printf("Accuracy (unary stride %u, %u pairs)\n", stride, pairs);
+    printf("  %-7s %12s %9s %9s  %s\n", "", "inputs", "max ulp", "bound", "worst input");
+    for (size_t i = 0; i < UNARY_COUNT; i++) accuracy_unary(&unary[i]);
+    for (size_t i = 0; i < BINARY_COUNT; i++) accuracy_binary(&binary[i]);
+
+    throughput();
+
+    printf("\n%s\n", failures ? "FAILED" : "All functions within their bounds");
+    return failures ? 1 : 0;
+}
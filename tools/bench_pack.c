@@ -0,0 +1,209 @@
+/*
+ * bench_pack.c - Asset pack read benchmark for Fluffy Diver (Linux host)
+ * Compares reading every asset as a loose file against reading it from a
+ * pack built by pack_assets.py through src/asset_pack.c: whole with
+ * asset_pack_load, and with random 4 KB reads through asset_pack_fopen
+ * streams, so chunked entries go through the game's seek table and chunk
+ * cache. Every byte read from the pack is compared with the loose file.
+ *
+ * Host storage is far faster than a memory card, so besides the measured
+ * rate the benchmark models a device that reads at --storage-mbps: time =
+ * bytes read / storage rate + time spent outside the reads (inflating and
+ * copying). Drop the page cache (echo 3 > /proc/sys/vm/drop_caches) for
+ * cold-read numbers.
+ *
+ * Build: cc -O2 -Iinclude -Itools/host -o bench_pack tools/bench_pack.c src/asset_pack.c -lz
+ * Usage: bench_pack [--storage-mbps N] [--random N] ASSETS_DIR PACK
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "vitasdk.h"
+#include "asset_pack.h"
+#include "fios_sched.h"
+
+#define RANDOM_READ_SIZE 4096
+
+typedef struct {
+    const char *label;
+    double seconds;  // Wall time, including host reads
+    double io;       // Time inside host reads
+    uint64_t stored; // Bytes read from storage
+    uint64_t raw;    // Asset bytes delivered
+} BenchResult;
+
+// Reads by asset_pack.c are charged here while a pack case runs
+static BenchResult *pack_charge = NULL;
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// ===== LOADER STUBS =====
+
+SceUID sceIoOpen(const char *file, int flags, int mode) {
+    int fd = open(file, O_RDONLY);
+    return fd < 0 ? (SceUID)0x80010002 : fd;
+}
+
+int sceIoClose(SceUID fd) {
+    return close(fd);
+}
+
+// The pack's only way to storage; scheduling is bench_sched's subject
+int fios_sched_pread(int fd, void *buf, uint32_t size, int64_t offset) {
+    double t = now();
+    ssize_t ret = pread(fd, buf, size, offset);
+    if (pack_charge && ret > 0) {
+        pack_charge->io += now() - t;
+        pack_charge->stored += ret;
+    }
+    return ret < 0 ? -1 : (int)ret;
+}
+
+// ===== BENCHMARK =====
+
+static int read_at(int fd, void *dst, size_t size, off_t offset) {
+    uint8_t *out = dst;
+    while (size) {
+        ssize_t ret = pread(fd, out, size, offset);
+        if (ret <= 0) return -1;
+        out += ret;
+        offset += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+static void print_result(const BenchResult *r, double storage_mbps) {
+    double mb = r->raw / (1024.0 * 1024.0);
+    double cpu = r->seconds > r->io ? r->seconds - r->io : 0;
+    double modelled = r->stored / (storage_mbps * 1024 * 1024) + cpu;
+    printf("  %-18s %8.1f MB/s measured  %8.1f MB/s at %.0f MB/s storage  (%llu KB read, %.0f ms cpu)\n",
+           r->label, r->seconds > 0 ? mb / r->seconds : 0, modelled > 0 ? mb / modelled : 0, storage_mbps,
+           (unsigned long long)(r->stored / 1024), cpu * 1000);
+}
+
+// Random 4 KB reads from one asset, through a pack stream and the loose file
+static int random_reads(const AssetPackEntry *e, const uint8_t *loose_data, int fd, int count,
+                        BenchResult *loose, BenchResult *packed) {
+    FILE *stream = asset_pack_fopen(e);
+    if (!stream) return -1;
+
+    for (int n = 0; n < count; n++) {
+        uint32_t pos = (uint32_t)rand() % (e->raw_size - RANDOM_READ_SIZE);
+        uint8_t out[RANDOM_READ_SIZE];
+
+        double t = now();
+        read_at(fd, out, RANDOM_READ_SIZE, pos);
+        double elapsed = now() - t;
+        loose->seconds += elapsed;
+        loose->io += elapsed;
+        loose->stored += RANDOM_READ_SIZE;
+        loose->raw += RANDOM_READ_SIZE;
+
+        pack_charge = packed;
+        t = now();
+        int ok = fseek(stream, pos, SEEK_SET) == 0 && fread(out, 1, RANDOM_READ_SIZE, stream) == RANDOM_READ_SIZE;
+        packed->seconds += now() - t;
+        pack_charge = NULL;
+        packed->raw += RANDOM_READ_SIZE;
+
+        if (!ok || memcmp(out, loose_data + pos, RANDOM_READ_SIZE) != 0) {
+            fprintf(stderr, "%s: stream read differs at %u\n", asset_pack_name(e), pos);
+            fclose(stream);
+            return -1;
+        }
+    }
+
+    fclose(stream);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    double storage_mbps = 20; // Roughly a Vita memory card
+    int random_count = 64;    // Per asset
+    int arg = 1;
+
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++) {
+        if (strcmp(argv[arg], "--storage-mbps") == 0 && arg + 1 < argc) storage_mbps = atof(argv[++arg]);
+        else if (strcmp(argv[arg], "--random") == 0 && arg + 1 < argc) random_count = atoi(argv[++arg]);
+        else break;
+    }
+    if (argc - arg != 2 || storage_mbps <= 0) {
+        fprintf(stderr, "usage: %s [--storage-mbps N] [--random N] ASSETS_DIR PACK\n", argv[0]);
+        return 1;
+    }
+    const char *assets_dir = argv[arg];
+    const char *pack_path = argv[arg + 1];
+
+    if (asset_pack_init(pack_path) < 0) return 1;
+
+    BenchResult loose = {.label = "loose files"};
+    BenchResult packed = {.label = "pack, whole"};
+    BenchResult loose_random = {.label = "loose, random 4K"};
+    BenchResult packed_random = {.label = "pack, random 4K"};
+    uint32_t count = asset_pack_count(), chunked = 0;
+    srand(1);
+
+    for (uint32_t i = 0; i < count; i++) {
+        const AssetPackEntry *e = asset_pack_entry(i);
+        char path[4096];
+        snprintf(path, sizeof(path), "%s/%s", assets_dir, asset_pack_name(e));
+
+        uint8_t *a = malloc(e->raw_size + 1), *b = malloc(e->raw_size + 1);
+        int fd = open(path, O_RDONLY);
+        if (!a || !b || fd < 0) {
+            fprintf(stderr, "%s: missing\n", path);
+            return 1;
+        }
+
+        double t = now();
+        if (read_at(fd, a, e->raw_size, 0) < 0) return 1;
+        double elapsed = now() - t;
+        loose.seconds += elapsed;
+        loose.io += elapsed;
+        loose.stored += e->raw_size;
+        loose.raw += e->raw_size;
+
+        pack_charge = &packed;
+        t = now();
+        int ret = asset_pack_load(e, b);
+        packed.seconds += now() - t;
+        pack_charge = NULL;
+        if (ret < 0 || memcmp(a, b, e->raw_size) != 0) {
+            fprintf(stderr, "%s: pack contents differ\n", asset_pack_name(e));
+            return 1;
+        }
+        packed.raw += e->raw_size;
+
+        // Random reads only make sense where a seek table exists to compare against
+        if ((e->flags & ASSET_PACK_CHUNKED) && e->raw_size > RANDOM_READ_SIZE) {
+            chunked++;
+            if (random_reads(e, a, fd, random_count, &loose_random, &packed_random) < 0) return 1;
+        }
+
+        free(a);
+        free(b);
+        close(fd);
+    }
+
+    printf("%u assets, %llu KB (%u chunked)\n", count, (unsigned long long)(loose.raw / 1024), chunked);
+    print_result(&loose, storage_mbps);
+    print_result(&packed, storage_mbps);
+    if (chunked) {
+        print_result(&loose_random, storage_mbps);
+        print_result(&packed_random, storage_mbps);
+        asset_pack_report();
+    }
+
+    asset_pack_close();
+    return 0;
+}
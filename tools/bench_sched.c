@@ -0,0 +1,238 @@
+/*
+ * bench_sched.c - FIOS I/O scheduler benchmark for Fluffy Diver (Linux host)
+ * Runs the game's mix of card traffic against a simulated memory card,
+ * first with every thread calling the device directly (arrival order, as
+ * without io_scheduler) and then through src/fios_sched.c:
+ *
+ *   - audio: a 16 KB music refill every 20 ms (realtime)
+ *   - loader: 256 KB reads with 10 ms of parsing in between (foreground)
+ *   - prefetch: two threads reading 1 MB assets back to back (prefetch)
+ *   - save: a 256 KB write every 500 ms (write-behind)
+ *
+ * A last run boosts each save while it is on the card, as fios_save_wait
+ * does for the save writer while the game waits on a save.
+ *
+ * The device serves one request at a time, in arrival order, and takes
+ * --access-us plus size / --storage-mbps per request. A refill that takes
+ * longer than --refill-budget-us counts as late (an audible gap once the
+ * stream's buffer runs dry).
+ *
+ * Build: cc -O2 -Iinclude -Itools/host -o bench_sched tools/bench_sched.c src/fios_sched.c -lpthread
+ * Usage: bench_sched [--seconds N] [--storage-mbps N] [--access-us N]
+ *                    [--prefetch-kbps N] [--writebehind-kbps N] [--refill-budget-us N]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vitasdk.h"
+#include "fios_sched.h"
+
+#define MAX_SAMPLES 100000
+
+typedef struct {
+    const char *label;
+    FiosClass cls;
+    uint32_t size;
+    uint32_t period_us; // Time from one request's start to the next (0 = back to back)
+    uint32_t think_us;  // Pause after each request
+    int write;
+} Workload;
+
+typedef struct {
+    const Workload *work;
+    uint8_t *buf;
+    uint32_t *samples;
+    uint32_t count;
+    uint64_t bytes;
+} WorkerState;
+
+static const Workload workloads[] = {
+    {"audio", FIOS_CLASS_REALTIME, 16 * 1024, 20 * 1000, 0, 0},
+    {"loader", FIOS_CLASS_FOREGROUND, 256 * 1024, 0, 10 * 1000, 0},
+    {"prefetch", FIOS_CLASS_PREFETCH, 1024 * 1024, 0, 0, 0},
+    {"prefetch", FIOS_CLASS_PREFETCH, 1024 * 1024, 0, 0, 0},
+    {"save", FIOS_CLASS_WRITEBEHIND, 256 * 1024, 500 * 1000, 0, 1},
+};
+#define WORKLOAD_COUNT (sizeof(workloads) / sizeof(workloads[0]))
+
+static int bench_seconds = 5;
+static int storage_mbps = 20;
+static int access_us = 300;
+static int prefetch_kbps = 16384;
+static int writebehind_kbps = 4096;
+static int refill_budget_us = 10000;
+
+static volatile int bench_stop = 0;
+static int saves_awaited = 0; // Boost write-behind requests, as fios_save_wait does
+
+// ===== SIMULATED DEVICE =====
+
+// Ticket lock: requests reach the card strictly in arrival order
+static pthread_mutex_t device_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t device_cond = PTHREAD_COND_INITIALIZER;
+static uint64_t device_next_ticket = 0;
+static uint64_t device_serving = 0;
+
+static void device_sleep_us(uint64_t us) {
+    struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+    while (nanosleep(&ts, &ts) != 0) {
+    }
+}
+
+static SceSSize device_access(SceSize size) {
+    pthread_mutex_lock(&device_lock);
+    uint64_t ticket = device_next_ticket++;
+    while (device_serving != ticket) pthread_cond_wait(&device_cond, &device_lock);
+    pthread_mutex_unlock(&device_lock);
+
+    device_sleep_us(access_us + (uint64_t)size * 1000000 / ((uint64_t)storage_mbps * 1024 * 1024));
+
+    pthread_mutex_lock(&device_lock);
+    device_serving++;
+    pthread_cond_broadcast(&device_cond);
+    pthread_mutex_unlock(&device_lock);
+    return size;
+}
+
+SceSSize sceIoPread(SceUID fd, void *data, SceSize size, SceOff offset) {
+    return device_access(size);
+}
+
+SceSSize sceIoPwrite(SceUID fd, const void *data, SceSize size, SceOff offset) {
+    return device_access(size);
+}
+
+// ===== FIOS STUBS =====
+
+int config_get_io_scheduler(void) {
+    return 1;
+}
+
+int config_get_io_prefetch_kbps(void) {
+    return prefetch_kbps;
+}
+
+int config_get_io_writebehind_kbps(void) {
+    return writebehind_kbps;
+}
+
+// ===== WORKLOAD =====
+
+static void *worker_main(void *arg) {
+    WorkerState *w = arg;
+    const Workload *work = w->work;
+    fios_sched_set_thread_class(0, work->cls);
+
+    uint64_t next = sceKernelGetProcessTimeWide();
+    while (!bench_stop) {
+        int boost = saves_awaited && work->cls == FIOS_CLASS_WRITEBEHIND;
+        if (boost) fios_sched_boost(0, 1);
+
+        uint64_t start = sceKernelGetProcessTimeWide();
+        int ret = work->write ? fios_sched_pwrite(0, w->buf, work->size, 0)
+                              : fios_sched_pread(0, w->buf, work->size, 0);
+        uint64_t elapsed = sceKernelGetProcessTimeWide() - start;
+        if (boost) fios_sched_boost(0, 0);
+
+        if (ret > 0) w->bytes += ret;
+        if (w->count < MAX_SAMPLES) w->samples[w->count++] = (uint32_t)elapsed;
+
+        if (work->think_us) device_sleep_us(work->think_us);
+        if (work->period_us) {
+            next += work->period_us;
+            uint64_t now = sceKernelGetProcessTimeWide();
+            if (next > now) device_sleep_us(next - now);
+            else next = now;
+        }
+    }
+    return NULL;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void run(const char *label) {
+    WorkerState state[WORKLOAD_COUNT];
+    pthread_t threads[WORKLOAD_COUNT];
+
+    memset(state, 0, sizeof(state));
+    bench_stop = 0;
+    for (size_t i = 0; i < WORKLOAD_COUNT; i++) {
+        state[i].work = &workloads[i];
+        state[i].buf = calloc(1, workloads[i].size);
+        state[i].samples = malloc(MAX_SAMPLES * sizeof(uint32_t));
+        if (!state[i].buf || !state[i].samples) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        pthread_create(&threads[i], NULL, worker_main, &state[i]);
+    }
+
+    device_sleep_us((uint64_t)bench_seconds * 1000000);
+    bench_stop = 1;
+    for (size_t i = 0; i < WORKLOAD_COUNT; i++) pthread_join(threads[i], NULL);
+
+    printf("\n%s\n", label);
+    printf("  %-9s %6s %9s %9s %9s %9s %6s\n", "thread", "reqs", "KB/s", "avg us", "p99 us", "max us", "late");
+    for (size_t i = 0; i < WORKLOAD_COUNT; i++) {
+        WorkerState *w = &state[i];
+        uint32_t late = 0;
+        uint64_t total = 0;
+        for (uint32_t j = 0; j < w->count; j++) {
+            total += w->samples[j];
+            if (w->work->cls == FIOS_CLASS_REALTIME && w->samples[j] > (uint32_t)refill_budget_us) late++;
+        }
+        qsort(w->samples, w->count, sizeof(uint32_t), compare_u32);
+
+        char late_col[16] = "-";
+        if (w->work->cls == FIOS_CLASS_REALTIME) snprintf(late_col, sizeof(late_col), "%u", late);
+
+        uint32_t n = w->count ? w->count : 1;
+        printf("  %-9s %6u %9llu %9llu %9u %9u %6s\n", w->work->label, w->count,
+               (unsigned long long)(w->bytes / 1024 / bench_seconds), (unsigned long long)(total / n),
+               w->count ? w->samples[(w->count - 1) * 99 / 100] : 0, w->count ? w->samples[w->count - 1] : 0,
+               late_col);
+
+        free(w->buf);
+        free(w->samples);
+    }
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        int value = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--seconds") == 0) bench_seconds = value;
+        else if (strcmp(argv[i], "--storage-mbps") == 0) storage_mbps = value;
+        else if (strcmp(argv[i], "--access-us") == 0) access_us = value;
+        else if (strcmp(argv[i], "--prefetch-kbps") == 0) prefetch_kbps = value;
+        else if (strcmp(argv[i], "--writebehind-kbps") == 0) writebehind_kbps = value;
+        else if (strcmp(argv[i], "--refill-budget-us") == 0) refill_budget_us = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (bench_seconds <= 0 || storage_mbps <= 0 || access_us < 0) {
+        fprintf(stderr, "invalid device model\n");
+        return 1;
+    }
+
+    printf("Device: %d MB/s, %d us per request; %d s per run\n", storage_mbps, access_us, bench_seconds);
+
+    run("Direct (arrival order)");
+
+    fios_sched_init();
+    run("Scheduled");
+
+    saves_awaited = 1;
+    run("Scheduled, saves awaited");
+    fios_sched_report();
+    return 0;
+}
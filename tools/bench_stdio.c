@@ -0,0 +1,574 @@
+/*
+ * bench_stdio.c - Buffered stdio benchmark for Fluffy Diver (Linux host)
+ * Replays one read pattern against a simulated memory card twice: through
+ * host stdio with newlib's 1 KB BUFSIZ (what the game's FILE* traffic used
+ * before) and through the owned streams in src/io_patch.c. For each run it
+ * reports the card calls issued, the bytes moved, the card time those calls
+ * would cost at --access-us plus size / --storage-mbps each, and the host
+ * time spent in stdio itself. Both runs must return the same bytes and
+ * results for every operation.
+ *
+ * The default pattern mimics asset parsing: seek to an asset, read a header
+ * field by field, a run of fgetc and fgets, a short seek back, then the
+ * payload in chunks with the occasional large read. --trace replays a
+ * recorded pattern instead, one operation per line:
+ *
+ *   seek OFFSET WHENCE   (WHENCE: 0 set, 1 cur, 2 end)
+ *   read N
+ *   getc
+ *   gets N
+ *   tell
+ *
+ * The newlib stand-in is glibc stdio over fopencookie, so its seek and
+ * refill behaviour is glibc's; newlib also refills in BUFSIZ steps.
+ *
+ * A last check writes through io_patch to a second file whose writes come
+ * back short and which then fills up, as a full card does: the short
+ * writes must be completed, the full card must surface as an error, and
+ * closing the stream must drop the file from the FIOS caches.
+ *
+ * Build: cc -O2 -Iinclude -Itools/host -o bench_stdio tools/bench_stdio.c src/io_patch.c -lpthread
+ * Usage: bench_stdio [--file-kb N] [--assets N] [--buffer-kb N] [--newlib-buffer N]
+ *                    [--storage-mbps N] [--access-us N] [--trace FILE]
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vitasdk.h"
+#include "config.h"
+#include "fios.h"
+#include "fios_sched.h"
+#include "fios_stats.h"
+#include "io_patch.h"
+
+#define CARD_PATH "ux0:data/fluffydiver/assets.bin"
+#define CARD_MAX_HANDLES 8
+#define SINK_PATH "ux0:data/fluffydiver/sink.bin"
+#define SINK_HANDLE CARD_MAX_HANDLES
+#define SINK_MAX_WRITE 1000 // Bytes per write call; the rest comes back short
+#define GETS_MAX 1024
+#define SCE_ERROR_ENOENT ((int)0x80010002)
+#define SCE_ERROR_EBADF ((int)0x80010009)
+#define SCE_ERROR_EINVAL ((int)0x80010016)
+
+typedef enum {
+    OP_SEEK,
+    OP_READ,
+    OP_GETC,
+    OP_GETS,
+    OP_TELL,
+} OpKind;
+
+typedef struct {
+    OpKind kind;
+    int whence;
+    long arg; // Seek offset, read length or fgets size
+} Op;
+
+typedef struct {
+    uint32_t opens;
+    uint32_t reads;
+    uint32_t seeks;
+    uint64_t bytes;
+    uint64_t card_us; // Modeled, not slept
+} CardStats;
+
+// One pair of stdio entry points per implementation
+typedef struct {
+    const char *label;
+    FILE *(*open)(void);
+    int (*close)(FILE *f);
+    size_t (*read)(void *ptr, size_t size, size_t nmemb, FILE *f);
+    int (*seek)(FILE *f, long offset, int whence);
+    long (*tell)(FILE *f);
+    int (*getc)(FILE *f);
+    char *(*gets)(char *s, int size, FILE *f);
+    int (*eof)(FILE *f);
+} Stdio;
+
+static int file_kb = 8192;
+static int asset_count = 20000;
+static int io_buffer_kb = 64;
+static int newlib_buffer = 1024;
+static int storage_mbps = 20;
+static int access_us = 300;
+static const char *trace_path = NULL;
+static int failures = 0;
+
+static uint8_t *card_data;
+static size_t card_size;
+static CardStats card;
+
+static uint8_t sink_data[64 * 1024];
+static size_t sink_capacity; // Free space; writes beyond it return 0
+static size_t sink_size;
+static int sink_drops; // fios_cache_drop calls for SINK_PATH
+
+// ===== LOADER STUBS =====
+
+void debugPrintf(const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    printf("    ");
+    vprintf(fmt, args);
+    va_end(args);
+}
+
+int config_get_io_buffer_kb(void) {
+    return io_buffer_kb;
+}
+
+int fios_is_save_path(const char *translated) {
+    return 0;
+}
+
+int fios_save_commit(const char *translated, void *data, size_t size) {
+    free(data);
+    return 0;
+}
+
+void fios_save_wait(const char *translated) {
+}
+
+void fios_cache_drop(const char *translated) {
+    if (strcmp(translated, SINK_PATH) == 0) sink_drops++;
+}
+
+int fios_stats_file(const char *path) {
+    return -1;
+}
+
+uint64_t fios_stats_begin(void) {
+    return 0;
+}
+
+void fios_stats_record(int id, FiosOp op, uint64_t bytes, uint64_t start) {
+}
+
+// Straight to the card; scheduling is bench_sched's subject
+int fios_sched_pread(int fd, void *buf, uint32_t size, int64_t offset) {
+    return sceIoPread(fd, buf, size, offset);
+}
+
+int fios_sched_pwrite(int fd, const void *buf, uint32_t size, int64_t offset) {
+    return sceIoPwrite(fd, buf, size, offset);
+}
+
+// ===== SIMULATED CARD =====
+
+// Read-only file of text lines; handles carry their own position
+static int64_t card_pos[CARD_MAX_HANDLES];
+static int card_open[CARD_MAX_HANDLES];
+
+static void card_init(void) {
+    card_size = (size_t)file_kb * 1024;
+    card_data = malloc(card_size);
+    if (!card_data) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    uint32_t seed = 12345;
+    size_t line = 0;
+    for (size_t i = 0; i < card_size; i++) {
+        seed = seed * 1103515245 + 12345;
+        // Lines of 8-120 bytes, with some binary bytes mixed in
+        if (line >= 120 || (line >= 8 && (seed >> 16) % 40 == 0)) {
+            card_data[i] = '\n';
+            line = 0;
+        } else {
+            card_data[i] = (seed >> 24) < 16 ? (uint8_t)(seed >> 8) : (uint8_t)('a' + (seed >> 16) % 26);
+            line++;
+        }
+    }
+}
+
+static void card_charge(size_t bytes) {
+    card.card_us += access_us + (uint64_t)bytes * 1000000 / ((uint64_t)storage_mbps * 1024 * 1024);
+}
+
+static int card_valid(SceUID fd) {
+    return fd >= 0 && fd < CARD_MAX_HANDLES && card_open[fd];
+}
+
+static SceSSize card_copy(void *data, SceSize size, SceOff offset) {
+    if (offset >= (SceOff)card_size) return 0;
+    size_t n = card_size - offset < size ? card_size - offset : size;
+    memcpy(data, card_data + offset, n);
+    card.reads++;
+    card.bytes += n;
+    card_charge(n);
+    return (SceSSize)n;
+}
+
+SceUID sceIoOpen(const char *file, int flags, int mode) {
+    if (strcmp(file, SINK_PATH) == 0 && (flags & SCE_O_WRONLY)) {
+        sink_size = 0;
+        return SINK_HANDLE;
+    }
+    if (strcmp(file, CARD_PATH) != 0 || (flags & SCE_O_WRONLY)) return SCE_ERROR_ENOENT;
+    for (int i = 0; i < CARD_MAX_HANDLES; i++) {
+        if (!card_open[i]) {
+            card_open[i] = 1;
+            card_pos[i] = 0;
+            card.opens++;
+            card_charge(0);
+            return i;
+        }
+    }
+    return SCE_ERROR_EINVAL;
+}
+
+int sceIoClose(SceUID fd) {
+    if (fd == SINK_HANDLE) return 0;
+    if (!card_valid(fd)) return SCE_ERROR_EBADF;
+    card_open[fd] = 0;
+    return 0;
+}
+
+SceSSize sceIoRead(SceUID fd, void *data, SceSize size) {
+    if (!card_valid(fd)) return SCE_ERROR_EBADF;
+    SceSSize ret = card_copy(data, size, card_pos[fd]);
+    card_pos[fd] += ret;
+    return ret;
+}
+
+SceSSize sceIoPread(SceUID fd, void *data, SceSize size, SceOff offset) {
+    if (!card_valid(fd)) return SCE_ERROR_EBADF;
+    return card_copy(data, size, offset);
+}
+
+SceSSize sceIoWrite(SceUID fd, const void *data, SceSize size) {
+    return SCE_ERROR_EBADF;
+}
+
+SceSSize sceIoPwrite(SceUID fd, const void *data, SceSize size, SceOff offset) {
+    if (fd != SINK_HANDLE) return SCE_ERROR_EBADF;
+    if (offset >= (SceOff)sink_capacity) return 0;
+
+    size_t n = size < SINK_MAX_WRITE ? size : SINK_MAX_WRITE;
+    if (n > sink_capacity - offset) n = sink_capacity - offset;
+    memcpy(sink_data + offset, data, n);
+    if (offset + n > sink_size) sink_size = offset + n;
+    return (SceSSize)n;
+}
+
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence) {
+    if (!card_valid(fd)) return SCE_ERROR_EBADF;
+    SceOff base = whence == SCE_SEEK_SET ? 0 : whence == SCE_SEEK_CUR ? card_pos[fd] : (SceOff)card_size;
+    if (base + offset < 0) return SCE_ERROR_EINVAL;
+    card_pos[fd] = base + offset;
+    card.seeks++;
+    card_charge(0);
+    return card_pos[fd];
+}
+
+// ===== NEWLIB STAND-IN =====
+
+static ssize_t cookie_read(void *cookie, char *buf, size_t size) {
+    SceSSize ret = sceIoRead((SceUID)(intptr_t)cookie, buf, size);
+    return ret < 0 ? -1 : ret;
+}
+
+static int cookie_seek(void *cookie, off64_t *offset, int whence) {
+    SceOff ret = sceIoLseek((SceUID)(intptr_t)cookie, *offset, whence);
+    if (ret < 0) return -1;
+    *offset = ret;
+    return 0;
+}
+
+static int cookie_close(void *cookie) {
+    return sceIoClose((SceUID)(intptr_t)cookie) < 0 ? -1 : 0;
+}
+
+static FILE *newlib_open(void) {
+    SceUID fd = sceIoOpen(CARD_PATH, SCE_O_RDONLY, 0777);
+    if (fd < 0) return NULL;
+
+    cookie_io_functions_t funcs = {
+        .read = cookie_read,
+        .seek = cookie_seek,
+        .close = cookie_close,
+    };
+    FILE *f = fopencookie((void *)(intptr_t)fd, "r", funcs);
+    if (f) setvbuf(f, NULL, _IOFBF, newlib_buffer);
+    return f;
+}
+
+static FILE *shim_open(void) {
+    return io_fopen(CARD_PATH, "rb");
+}
+
+static const Stdio implementations[] = {
+    {"newlib-sized stdio", newlib_open, fclose, fread, fseek, ftell, fgetc, fgets, feof},
+    {"io_patch", shim_open, io_fclose, io_fread, io_fseek, io_ftell, io_fgetc, io_fgets, io_feof},
+};
+#define IMPL_COUNT (sizeof(implementations) / sizeof(implementations[0]))
+
+// ===== READ PATTERN =====
+
+static Op *ops;
+static size_t op_count, op_capacity;
+
+static void op_add(OpKind kind, int whence, long arg) {
+    if (op_count == op_capacity) {
+        op_capacity = op_capacity ? op_capacity * 2 : 4096;
+        ops = realloc(ops, op_capacity * sizeof(Op));
+        if (!ops) {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+    }
+    ops[op_count++] = (Op){.kind = kind, .whence = whence, .arg = arg};
+}
+
+static uint32_t rng_state = 0xC0FFEE;
+
+static uint32_t rng_below(uint32_t n) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state % n;
+}
+
+static void pattern_generate(void) {
+    for (int a = 0; a < asset_count; a++) {
+        op_add(OP_SEEK, SEEK_SET, (long)(rng_below((uint32_t)card_size) & ~3u));
+
+        for (int i = 0; i < 4; i++) op_add(OP_READ, 0, 4);
+        for (int i = 8 + (int)rng_below(24); i > 0; i--) op_add(OP_GETC, 0, 0);
+        for (int i = 2 + (int)rng_below(4); i > 0; i--) op_add(OP_GETS, 0, 128);
+
+        op_add(OP_SEEK, SEEK_CUR, -(long)rng_below(64));
+        op_add(OP_READ, 0, 4);
+        op_add(OP_TELL, 0, 0);
+
+        for (int i = 1 + (int)rng_below(16); i > 0; i--) op_add(OP_READ, 0, 512 + rng_below(3585));
+        if (rng_below(8) == 0) op_add(OP_READ, 0, 64 * 1024 + rng_below(192 * 1024));
+    }
+
+    // Finish by reading off the end, so EOF handling is compared too
+    op_add(OP_SEEK, SEEK_END, -100);
+    op_add(OP_READ, 0, 4096);
+    op_add(OP_GETC, 0, 0);
+}
+
+static int pattern_load(const char *path) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+
+    char line[256], name[16];
+    long arg;
+    int whence, lineno = 0;
+    while (fgets(line, sizeof(line), in)) {
+        lineno++;
+        if (line[0] == '\n' || line[0] == '#') continue;
+
+        if (sscanf(line, "seek %ld %d", &arg, &whence) == 2 && whence >= 0 && whence <= 2) {
+            op_add(OP_SEEK, whence, arg);
+        } else if (sscanf(line, "read %ld", &arg) == 1 && arg > 0) {
+            op_add(OP_READ, 0, arg);
+        } else if (sscanf(line, "gets %ld", &arg) == 1 && arg > 0 && arg <= GETS_MAX) {
+            op_add(OP_GETS, 0, arg);
+        } else if (sscanf(line, "%15s", name) == 1 && strcmp(name, "getc") == 0) {
+            op_add(OP_GETC, 0, 0);
+        } else if (sscanf(line, "%15s", name) == 1 && strcmp(name, "tell") == 0) {
+            op_add(OP_TELL, 0, 0);
+        } else {
+            fprintf(stderr, "%s:%d: cannot parse operation\n", path, lineno);
+            fclose(in);
+            return -1;
+        }
+    }
+    fclose(in);
+    return 0;
+}
+
+// ===== REPLAY =====
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t hash_add(uint64_t h, const void *data, size_t n) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < n; i++) h = (h ^ p[i]) * 0x100000001B3ULL;
+    return h;
+}
+
+static void check(int ok, const char *what) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Replays every op and fills results[i] with a hash of what op i returned
+static uint64_t replay(const Stdio *impl, uint64_t *results, uint8_t *buf) {
+    memset(&card, 0, sizeof(card));
+
+    uint64_t start = now_ns();
+    FILE *f = impl->open();
+    if (!f) {
+        fprintf(stderr, "%s: cannot open %s\n", impl->label, CARD_PATH);
+        exit(1);
+    }
+
+    for (size_t i = 0; i < op_count; i++) {
+        const Op *op = &ops[i];
+        uint64_t h = 0xCBF29CE484222325ULL;
+        long value;
+
+        switch (op->kind) {
+            case OP_SEEK:
+                value = impl->seek(f, op->arg, op->whence);
+                h = hash_add(h, &value, sizeof(value));
+                break;
+            case OP_READ:
+                value = (long)impl->read(buf, 1, op->arg, f);
+                h = hash_add(hash_add(h, &value, sizeof(value)), buf, value);
+                break;
+            case OP_GETC:
+                value = impl->getc(f);
+                h = hash_add(h, &value, sizeof(value));
+                break;
+            case OP_GETS: {
+                char *s = impl->gets((char *)buf, (int)op->arg, f);
+                h = s ? hash_add(h, buf, strlen(s)) : hash_add(h, "NULL", 4);
+                break;
+            }
+            case OP_TELL:
+                value = impl->tell(f);
+                h = hash_add(h, &value, sizeof(value));
+                break;
+        }
+
+        // Position and EOF state after every op must agree as well
+        value = impl->eof(f);
+        results[i] = hash_add(h, &value, sizeof(value));
+    }
+
+    impl->close(f);
+    return now_ns() - start;
+}
+
+// Fill SINK_PATH with 4 KB fwrites; returns the bytes fwrite accepted
+static size_t sink_write(FILE *f, const uint8_t *data, size_t size) {
+    size_t accepted = 0;
+    for (size_t off = 0; off < size; off += 4096) {
+        size_t n = size - off < 4096 ? size - off : 4096;
+        accepted += io_fwrite(data + off, 1, n, f);
+    }
+    return accepted;
+}
+
+static void check_writes(void) {
+    static uint8_t data[48 * 1024];
+    for (size_t i = 0; i < sizeof(data); i++) data[i] = (uint8_t)(i * 31 + 7);
+
+    sink_capacity = sizeof(sink_data);
+    FILE *f = io_fopen(SINK_PATH, "wb");
+    int ok = f && sink_write(f, data, sizeof(data)) == sizeof(data) && io_fclose(f) == 0;
+    check(ok && sink_size == sizeof(data) && memcmp(sink_data, data, sizeof(data)) == 0,
+          "short card writes are completed");
+    check(sink_drops == 1, "fclose drops the written file's cached stat");
+
+    // The data doesn't fit: fwrite or the flush after it has to fail
+    sink_capacity = sizeof(data) / 2;
+    f = io_fopen(SINK_PATH, "wb");
+    if (!f) {
+        check(0, "a full card fails the write");
+        return;
+    }
+    errno = 0;
+    size_t accepted = sink_write(f, data, sizeof(data));
+    int flushed = io_fflush(f);
+    int saved_errno = errno;
+    check((accepted < sizeof(data) || flushed == EOF) && io_ferror(f) && saved_errno == ENOSPC,
+          "a full card fails the write");
+    io_fclose(f);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        int value = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--file-kb") == 0) file_kb = value;
+        else if (strcmp(argv[i], "--assets") == 0) asset_count = value;
+        else if (strcmp(argv[i], "--buffer-kb") == 0) io_buffer_kb = value;
+        else if (strcmp(argv[i], "--newlib-buffer") == 0) newlib_buffer = value;
+        else if (strcmp(argv[i], "--storage-mbps") == 0) storage_mbps = value;
+        else if (strcmp(argv[i], "--access-us") == 0) access_us = value;
+        else if (strcmp(argv[i], "--trace") == 0) trace_path = argv[i + 1];
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (file_kb <= 0 || asset_count < 0 || newlib_buffer <= 0 || storage_mbps <= 0 || access_us < 0) {
+        fprintf(stderr, "invalid option value\n");
+        return 1;
+    }
+
+    card_init();
+    if (trace_path) {
+        if (pattern_load(trace_path) < 0) return 1;
+    } else {
+        pattern_generate();
+    }
+
+    // The largest read sizes the replay buffer
+    size_t buf_size = GETS_MAX;
+    for (size_t i = 0; i < op_count; i++) {
+        if (ops[i].kind == OP_READ && (size_t)ops[i].arg > buf_size) buf_size = ops[i].arg;
+    }
+    uint8_t *buf = malloc(buf_size);
+    uint64_t *results[IMPL_COUNT];
+    for (size_t i = 0; i < IMPL_COUNT; i++) results[i] = malloc(op_count * sizeof(uint64_t));
+
+    io_patch_init();
+
+    printf("\n%zu operations on a %d KB file (%s)\n", op_count, file_kb, trace_path ? trace_path : "generated");
+    printf("  %-20s %9s %9s %9s %10s %10s %9s\n", "", "card ops", "reads", "seeks", "KB moved",
+           "card ms", "host ms");
+
+    CardStats totals[IMPL_COUNT];
+    for (size_t i = 0; i < IMPL_COUNT; i++) {
+        uint64_t host_ns = replay(&implementations[i], results[i], buf);
+        totals[i] = card;
+        printf("  %-20s %9u %9u %9u %10llu %10llu %9.1f\n", implementations[i].label,
+               card.opens + card.reads + card.seeks, card.reads, card.seeks,
+               (unsigned long long)(card.bytes / 1024), (unsigned long long)(card.card_us / 1000),
+               host_ns / 1e6);
+    }
+
+    uint32_t before = totals[0].opens + totals[0].reads + totals[0].seeks;
+    uint32_t after = totals[1].opens + totals[1].reads + totals[1].seeks;
+    printf("  card calls saved: %u (%.1fx fewer), card time %.1fx lower\n", before - after,
+           after ? (double)before / after : 0.0,
+           totals[1].card_us ? (double)totals[0].card_us / totals[1].card_us : 0.0);
+
+    printf("\nChecks\n");
+    size_t mismatch = op_count;
+    for (size_t i = 0; i < op_count && mismatch == op_count; i++) {
+        if (results[0][i] != results[1][i]) mismatch = i;
+    }
+    check(mismatch == op_count, "io_patch matches host stdio op for op");
+    if (mismatch != op_count) printf("    first mismatch at op %zu\n", mismatch);
+    check(after <= before, "io_patch issues no more card calls");
+    check_writes();
+
+    io_stdio_report();
+
+    printf("%s\n", failures ? "FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
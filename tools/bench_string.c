@@ -0,0 +1,304 @@
+/*
+ * bench_string.c - String function benchmark for Fluffy Diver (Linux host)
+ * Differential test and benchmark for src/string_patch.c:
+ *
+ *   - every function is compared with glibc for string lengths
+ *     0..--max-len at all four word alignments of each argument (the
+ *     comparisons only need the same sign). Each string ends on the last
+ *     byte before a PROT_NONE page and, in a second pass, starts on the
+ *     first byte after one, so any read outside an aligned word that
+ *     holds string bytes faults.
+ *   - each function is timed at a few lengths against glibc and against a
+ *     byte-at-a-time loop like newlib's (glibc is vectorized, so the byte
+ *     loop is the fairer stand-in for what the game used before)
+ *
+ * Build: cc -O2 -Iinclude -o bench_string tools/bench_string.c src/string_patch.c
+ * Usage: bench_string [--max-len N] [--calls N]
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "string_patch.h"
+
+static int max_len = 300;
+static int calls = 2000000;
+static int failures = 0;
+
+static size_t page_size;
+static char *guarded; // Two guard pages around one usable page
+
+// ===== GUARDED BUFFERS =====
+
+static void guard_init(void) {
+    page_size = (size_t)sysconf(_SC_PAGESIZE);
+    char *map = mmap(NULL, page_size * 3, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED) {
+        perror("mmap");
+        exit(1);
+    }
+    mprotect(map, page_size, PROT_NONE);
+    mprotect(map + page_size * 2, page_size, PROT_NONE);
+    guarded = map + page_size;
+}
+
+// Place len bytes of text plus a terminator either so the terminator is the
+// page's last byte (at_end) or at the given word offset from its start
+static char *place(char *page, const char *text, size_t len, int align, int at_end) {
+    char *p = at_end ? page + page_size - (len + 1) : page + align;
+    memcpy(p, text, len);
+    p[len] = '\0';
+    return p;
+}
+
+// ===== DIFFERENTIAL TEST =====
+
+static int sign(int v) {
+    return (v > 0) - (v < 0);
+}
+
+static void report(int bad, const char *what) {
+    printf("  %-44s %s\n", what, bad ? "FAIL" : "ok");
+    if (bad) {
+        failures++;
+        printf("    %d mismatches\n", bad);
+    }
+}
+
+static void fill(char *text, size_t len, unsigned seed) {
+    for (size_t i = 0; i < len; i++) text[i] = 'a' + (char)((i * 7 + seed) % 26);
+}
+
+// Lengths and alignments for one string against a guard page
+static void test_single(int at_end) {
+    int bad_len = 0, bad_chr = 0;
+    char *text = malloc(max_len + 1);
+
+    for (int len = 0; len <= max_len; len++) {
+        fill(text, len, len);
+        for (int align = 0; align < 4; align++) {
+            char *s = place(guarded, text, len, align, at_end);
+
+            if (string_strlen(s) != strlen(s)) bad_len++;
+
+            // First byte, last byte, missing byte, the terminator, and a high byte
+            int probes[] = {len ? s[0] : 'q', len ? s[len - 1] : 'q', 'Z', 0, 0xE9, -23};
+            for (size_t i = 0; i < sizeof(probes) / sizeof(probes[0]); i++) {
+                if (string_strchr(s, probes[i]) != strchr(s, probes[i])) bad_chr++;
+            }
+            if (at_end) break; // The length fixes the alignment
+        }
+    }
+
+    char what[64];
+    snprintf(what, sizeof(what), "strlen, string %s a guard page", at_end ? "ending at" : "starting after");
+    report(bad_len, what);
+    snprintf(what, sizeof(what), "strchr, string %s a guard page", at_end ? "ending at" : "starting after");
+    report(bad_chr, what);
+    free(text);
+}
+
+// Pairs of strings: equal, differing at each position, and prefixes,
+// across all 16 alignment combinations
+static void test_pairs(void) {
+    int bad_cmp = 0, bad_ncmp = 0, bad_case = 0;
+    char *a_text = malloc(max_len + 2);
+    char *b_text = malloc(max_len + 2);
+    char *b_page = malloc(page_size * 2);
+
+    for (int len = 0; len <= max_len; len++) {
+        fill(a_text, len, 3);
+        // Mismatch positions: none, first, middle, last, plus a shorter b
+        int positions[] = {-1, 0, len / 2, len - 1, -2};
+        for (size_t pi = 0; pi < sizeof(positions) / sizeof(positions[0]); pi++) {
+            int pos = positions[pi];
+            if (pos >= len) continue;
+
+            size_t b_len = pos == -2 ? (size_t)(len / 2) : (size_t)len;
+            memcpy(b_text, a_text, b_len);
+            if (pos >= 0) b_text[pos] = (char)(pos & 1 ? 0xC1 : a_text[pos] + 1);
+
+            for (int align_a = 0; align_a < 4; align_a++) {
+                for (int align_b = 0; align_b < 4; align_b++) {
+                    char *a = place(guarded, a_text, len, align_a, 0);
+                    char *b = b_page + align_b;
+                    memcpy(b, b_text, b_len);
+                    b[b_len] = '\0';
+
+                    if (sign(string_strcmp(a, b)) != sign(strcmp(a, b))) bad_cmp++;
+                    if (sign(string_strcmp(b, a)) != sign(strcmp(b, a))) bad_cmp++;
+
+                    size_t limits[] = {0, 1, 3, 4, (size_t)len / 2, (size_t)len, (size_t)len + 5};
+                    for (size_t li = 0; li < sizeof(limits) / sizeof(limits[0]); li++) {
+                        size_t n = limits[li];
+                        if (sign(string_strncmp(a, b, n)) != sign(strncmp(a, b, n))) bad_ncmp++;
+                    }
+
+                    // Same letters in the other case must compare equal
+                    char *upper = b_page + page_size + align_b;
+                    for (size_t i = 0; i <= b_len; i++) {
+                        char c = b[i];
+                        upper[i] = (c >= 'a' && c <= 'z') ? c - 32 : c;
+                    }
+                    if (sign(string_strcasecmp(a, upper)) != sign(strcasecmp(a, upper))) bad_case++;
+                    if (sign(string_strcasecmp(upper, a)) != sign(strcasecmp(upper, a))) bad_case++;
+                }
+            }
+        }
+    }
+
+    report(bad_cmp, "strcmp, all alignment pairs");
+    report(bad_ncmp, "strncmp, all alignment pairs and limits");
+    report(bad_case, "strcasecmp, all alignment pairs");
+    free(a_text);
+    free(b_text);
+    free(b_page);
+}
+
+static void test_strstr(void) {
+    int bad = 0;
+    char *hay_text = malloc(max_len + 1);
+    char needle[64];
+
+    for (int len = 0; len <= max_len; len++) {
+        fill(hay_text, len, 11);
+        for (int align = 0; align < 4; align++) {
+            char *hay = place(guarded, hay_text, len, align, 0);
+
+            // Needles: empty, one byte, taken from the end, absent, near-miss, long
+            for (int n_len = 0; n_len < 40 && n_len <= len; n_len += n_len < 4 ? 1 : 7) {
+                memcpy(needle, hay + len - n_len, n_len);
+                needle[n_len] = '\0';
+                if (string_strstr(hay, needle) != strstr(hay, needle)) bad++;
+
+                if (n_len) {
+                    needle[n_len - 1] ^= 0x20;
+                    if (string_strstr(hay, needle) != strstr(hay, needle)) bad++;
+                }
+            }
+            if (string_strstr(hay, "zzz") != strstr(hay, "zzz")) bad++;
+        }
+    }
+    report(bad, "strstr, needles of 0-39 bytes");
+    free(hay_text);
+}
+
+// ===== BENCHMARK =====
+
+static size_t byte_strlen(const char *s) {
+    const char *p = s;
+    while (*p) p++;
+    return p - s;
+}
+
+static int byte_strcmp(const char *a, const char *b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return (unsigned char)*a - (unsigned char)*b;
+}
+
+static char *byte_strchr(const char *s, int c) {
+    for (;; s++) {
+        if (*s == (char)c) return (char *)s;
+        if (!*s) return NULL;
+    }
+}
+
+static int byte_strcasecmp(const char *a, const char *b) {
+    for (;; a++, b++) {
+        int ca = *(const unsigned char *)a, cb = *(const unsigned char *)b;
+        if (ca >= 'A' && ca <= 'Z') ca += 32;
+        if (cb >= 'A' && cb <= 'Z') cb += 32;
+        if (ca != cb || !ca) return ca - cb;
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// ns per evaluation of expr; glibc is called through volatile function
+// pointers below so the compiler can't fold the calls away
+#define TIME_CALLS(expr) ({ \
+    volatile uintptr_t sink = 0; \
+    uint64_t start = now_ns(); \
+    for (int i = 0; i < calls; i++) sink += (uintptr_t)(expr); \
+    (double)(now_ns() - start) / calls; \
+})
+
+static void benchmark(void) {
+    static const int lengths[] = {8, 32, 128, 1024};
+    char *a = malloc(2048), *b = malloc(2048), *b_upper = malloc(2048);
+
+    printf("\nBenchmark (%d calls, ns per call)\n", calls);
+    printf("  %-12s %6s %9s %9s %9s\n", "", "len", "byte", "glibc", "shim");
+
+    for (size_t li = 0; li < sizeof(lengths) / sizeof(lengths[0]); li++) {
+        int len = lengths[li];
+        fill(a, len, 5);
+        a[len] = '\0';
+        memcpy(b, a, len + 1);
+        for (int i = 0; i <= len; i++) b_upper[i] = (a[i] >= 'a' && a[i] <= 'z') ? a[i] - 32 : a[i];
+
+        // The unaligned second argument is the common case for strcmp
+        char *b_odd = b + 1024 + 1;
+        memcpy(b_odd, a, len + 1);
+
+        size_t (*volatile strlen_p)(const char *) = strlen;
+        char *(*volatile strchr_p)(const char *, int) = strchr;
+        int (*volatile strcmp_p)(const char *, const char *) = strcmp;
+        int (*volatile strcasecmp_p)(const char *, const char *) = strcasecmp;
+
+        printf("  %-12s %6d %9.2f %9.2f %9.2f\n", "strlen", len, TIME_CALLS(byte_strlen(a)),
+               TIME_CALLS(strlen_p(a)), TIME_CALLS(string_strlen(a)));
+        printf("  %-12s %6d %9.2f %9.2f %9.2f\n", "strchr", len, TIME_CALLS(byte_strchr(a, '!')),
+               TIME_CALLS(strchr_p(a, '!')), TIME_CALLS(string_strchr(a, '!')));
+        printf("  %-12s %6d %9.2f %9.2f %9.2f\n", "strcmp", len, TIME_CALLS(byte_strcmp(a, b_odd)),
+               TIME_CALLS(strcmp_p(a, b_odd)), TIME_CALLS(string_strcmp(a, b_odd)));
+        printf("  %-12s %6d %9.2f %9.2f %9.2f\n", "strcasecmp", len, TIME_CALLS(byte_strcasecmp(a, b_upper)),
+               TIME_CALLS(strcasecmp_p(a, b_upper)), TIME_CALLS(string_strcasecmp(a, b_upper)));
+    }
+
+    free(a);
+    free(b);
+    free(b_upper);
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        int value = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--max-len") == 0) max_len = value;
+        else if (strcmp(argv[i], "--calls") == 0) calls = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    guard_init();
+    if (max_len < 0 || (size_t)max_len + 8 > page_size || calls <= 0) {
+        fprintf(stderr, "invalid length or call count\n");
+        return 1;
+    }
+
+    printf("Differential test against glibc (lengths 0-%d)\n", max_len);
+    test_single(1);
+    test_single(0);
+    test_pairs();
+    test_strstr();
+
+    benchmark();
+
+    printf("\n%s\n", failures ? "FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
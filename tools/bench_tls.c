@@ -0,0 +1,196 @@
+/*
+ * bench_tls.c - pthread TLS key benchmark for Fluffy Diver (Linux host)
+ * Times pthread_getspecific/setspecific through src/pthread_tls.c against
+ * the host's own pthread keys, for an inline key (below TLS_INLINE_KEYS)
+ * and an overflow key, with --threads threads hammering at once. It also
+ * checks that a deleted and re-created key reads back NULL and that
+ * destructors run when a thread exits.
+ *
+ * There is no TPIDRURO on the host, so the shims take their
+ * sceKernelGetTLSAddr fallback (a __thread array here); on the Vita the
+ * lookup is an MRC plus a load, so device numbers are lower still.
+ *
+ * Build: cc -O2 -Iinclude -Itools/host -o bench_tls tools/bench_tls.c src/pthread_tls.c -lpthread
+ * Usage: bench_tls [--threads N] [--iterations N]
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vitasdk.h"
+#include "pthread_patch.h"
+
+#define MAX_THREADS 16
+#define OVERFLOW_KEYS 40 // Enough keys that the last one lands past the inline block
+
+typedef struct {
+    const char *label;
+    int shim;
+    pthread_key_t key;
+} Case;
+
+static int thread_count = 4;
+static int iterations = 10000000;
+static int failures = 0;
+
+static pthread_barrier_t start_barrier;
+static volatile uint32_t destructor_calls = 0;
+
+// ===== LOADER STUBS =====
+
+void debugPrintf(const char *fmt, ...) {
+    (void)fmt;
+}
+
+// ===== BENCHMARK =====
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void check(int ok, const char *what) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// Returns hundredths of a ns per set+get pair
+static void *case_main(void *arg) {
+    const Case *c = arg;
+    uintptr_t sum = 0;
+
+    pthread_barrier_wait(&start_barrier);
+    uint64_t start = now_ns();
+    if (c->shim) {
+        for (int i = 0; i < iterations; i++) {
+            pthread_setspecific_fake(c->key, (void *)(uintptr_t)(i | 1));
+            sum += (uintptr_t)pthread_getspecific_fake(c->key);
+        }
+        tls_thread_exit();
+    } else {
+        for (int i = 0; i < iterations; i++) {
+            pthread_setspecific(c->key, (void *)(uintptr_t)(i | 1));
+            sum += (uintptr_t)pthread_getspecific(c->key);
+        }
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    // Keep the loop from being optimized away
+    if (sum == 1) printf(" ");
+    return (void *)(uintptr_t)(elapsed * 100 / iterations);
+}
+
+static void run_case(const Case *c) {
+    pthread_t threads[MAX_THREADS];
+    uint64_t total = 0, worst = 0;
+
+    pthread_barrier_init(&start_barrier, NULL, thread_count);
+    for (int i = 0; i < thread_count; i++) pthread_create(&threads[i], NULL, case_main, (void *)c);
+    for (int i = 0; i < thread_count; i++) {
+        void *ret;
+        pthread_join(threads[i], &ret);
+        uint64_t centi_ns = (uintptr_t)ret;
+        total += centi_ns;
+        if (centi_ns > worst) worst = centi_ns;
+    }
+    pthread_barrier_destroy(&start_barrier);
+
+    uint64_t avg = total / thread_count;
+    printf("  %-24s %6llu.%02llu %6llu.%02llu\n", c->label,
+           (unsigned long long)(avg / 100), (unsigned long long)(avg % 100),
+           (unsigned long long)(worst / 100), (unsigned long long)(worst % 100));
+}
+
+// ===== CORRECTNESS =====
+
+static void count_destructor(void *value) {
+    (void)value;
+    __atomic_add_fetch(&destructor_calls, 1, __ATOMIC_RELAXED);
+}
+
+static pthread_key_t exit_inline_key, exit_overflow_key;
+
+static void *exit_main(void *arg) {
+    (void)arg;
+    pthread_setspecific_fake(exit_inline_key, (void *)1);
+    pthread_setspecific_fake(exit_overflow_key, (void *)1);
+    tls_thread_exit();
+    return NULL;
+}
+
+static void run_checks(pthread_key_t *overflow_keys) {
+    pthread_key_t key;
+    check(pthread_key_create_fake(&key, NULL) == 0, "key_create");
+    pthread_setspecific_fake(key, (void *)0x1234);
+    check(pthread_getspecific_fake(key) == (void *)0x1234, "set/get round trip");
+
+    // The recycled index must not hand back the old value
+    pthread_key_delete_fake(key);
+    pthread_key_t again;
+    pthread_key_create_fake(&again, NULL);
+    check(again == key && pthread_getspecific_fake(again) == NULL, "re-created key reads NULL");
+    check(pthread_setspecific_fake(key + 1000, (void *)1) == EINVAL, "out-of-range key rejected");
+    pthread_key_delete_fake(again);
+
+    pthread_key_create_fake(&exit_inline_key, count_destructor);
+    exit_overflow_key = overflow_keys[OVERFLOW_KEYS - 1];
+    pthread_key_delete_fake(exit_overflow_key);
+    pthread_key_create_fake(&exit_overflow_key, count_destructor);
+
+    pthread_t threads[MAX_THREADS];
+    destructor_calls = 0;
+    for (int i = 0; i < thread_count; i++) pthread_create(&threads[i], NULL, exit_main, NULL);
+    for (int i = 0; i < thread_count; i++) pthread_join(threads[i], NULL);
+    check(destructor_calls == (uint32_t)thread_count * 2, "destructors run on thread exit");
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        int value = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--threads") == 0) thread_count = value;
+        else if (strcmp(argv[i], "--iterations") == 0) iterations = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (thread_count <= 0 || thread_count > MAX_THREADS || iterations <= 0) {
+        fprintf(stderr, "invalid thread or iteration count\n");
+        return 1;
+    }
+
+    tls_init();
+
+    // Fill the inline block so the last key lives in the overflow table
+    pthread_key_t overflow_keys[OVERFLOW_KEYS];
+    for (int i = 0; i < OVERFLOW_KEYS; i++) {
+        if (pthread_key_create_fake(&overflow_keys[i], NULL) != 0) {
+            fprintf(stderr, "key_create failed\n");
+            return 1;
+        }
+    }
+
+    pthread_key_t host_key;
+    pthread_key_create(&host_key, NULL);
+
+    Case cases[] = {
+        {"host pthread", 0, host_key},
+        {"shim, inline key", 1, overflow_keys[0]},
+        {"shim, overflow key", 1, overflow_keys[OVERFLOW_KEYS - 1]},
+    };
+
+    printf("%d threads, %d set+get pairs each\n", thread_count, iterations);
+    printf("  %-24s %9s %9s\n", "", "avg ns", "worst ns");
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) run_case(&cases[i]);
+
+    printf("\nChecks\n");
+    run_checks(overflow_keys);
+
+    printf("%s\n", failures ? "FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,368 @@
+/*
+ * bench_translate.c - Path translation benchmark for Fluffy Diver (Linux host)
+ * Measures fios_translate_path() in src/fios.c over a corpus of the paths
+ * the game opens and stats, in translations per second, from one thread and
+ * from --threads threads at once (translation writes into the caller's
+ * buffer, so it takes no lock). Then checks that:
+ *
+ *   - known paths translate as the built-in rules say (longest prefix wins)
+ *   - a '*' rule added at runtime fills its target from the path
+ *   - unmatched paths come back unchanged, and a short buffer gives -1
+ *   - every thread produced exactly the single-thread results
+ *
+ * --corpus replays recorded paths instead, one per line; --rules loads a
+ * redirects.txt on top of the built-in rules.
+ *
+ * Build: cc -O2 -Iinclude -Itools/host -o bench_translate tools/bench_translate.c src/fios.c -lpthread
+ * Usage: bench_translate [--rounds N] [--threads N] [--corpus FILE] [--rules FILE]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vitasdk.h"
+#include "asset_pack.h"
+#include "fios.h"
+#include "fios_index.h"
+#include "fios_sched.h"
+#include "fios_stats.h"
+
+#define MAX_THREADS 16
+#define GENERATED_PATHS 4096
+
+typedef struct {
+    const char *path;
+    const char *expected;
+} KnownPath;
+
+typedef struct {
+    uint64_t ns;
+    uint64_t hash;
+} RunResult;
+
+static int rounds = 200;
+static int thread_count = 4;
+static const char *corpus_path = NULL;
+static const char *rules_path = NULL;
+static int failures = 0;
+
+static char **corpus;
+static size_t corpus_count, corpus_capacity;
+
+static pthread_barrier_t start_barrier;
+
+static const KnownPath known[] = {
+    {"/android_asset/textures/fish.png", "ux0:data/fluffydiver/assets/textures/fish.png"},
+    {"assets/levels/level01.bin", "ux0:data/fluffydiver/assets/levels/level01.bin"},
+    {"/sdcard/Android/data/com.hotdog.fluffydiver/files/save0.dat", "ux0:data/fluffydiver/files/save0.dat"},
+    {"/sdcard/DCIM/shot.png", "ux0:data/fluffydiver/sdcard/DCIM/shot.png"},
+    {"/data/data/com.hotdog.fluffydiver/shared_prefs/game.xml", "ux0:data/fluffydiver/shared_prefs/game.xml"},
+    {"/data/local/tmp/x", "ux0:data/fluffydiver/data/local/tmp/x"},
+    {"/mods/ocean/textures/coral.png", "ux0:data/fluffydiver/mods/ocean/tex/coral.png"},
+    {"ux0:data/fluffydiver/assets/fonts/main.ttf", "ux0:data/fluffydiver/assets/fonts/main.ttf"},
+    {"libs/armeabi-v7a/libFluffyDiver.so", "libs/armeabi-v7a/libFluffyDiver.so"},
+};
+#define KNOWN_COUNT (sizeof(known) / sizeof(known[0]))
+
+// ===== LOADER STUBS =====
+
+void debugPrintf(const char *fmt, ...) {
+}
+
+int asset_pack_init(const char *path) {
+    return -1;
+}
+
+void asset_pack_close(void) {
+}
+
+const AssetPackEntry *asset_pack_find(const char *name) {
+    return NULL;
+}
+
+FILE *asset_pack_fopen(const AssetPackEntry *entry) {
+    return NULL;
+}
+
+FILE *io_fopen(const char *path, const char *mode) {
+    return NULL;
+}
+
+void fios_index_init(void) {
+}
+
+void fios_index_invalidate(const char *translated) {
+}
+
+int fios_index_stat(const char *translated, int64_t *size) {
+    return -1;
+}
+
+int fios_index_list(const char *translated, FiosIndexVisit visit, void *ctx) {
+    return -1;
+}
+
+int fios_index_list_pack(const char *dir, FiosIndexVisit visit, void *ctx) {
+    return -1;
+}
+
+int fios_stats_enabled(void) {
+    return 0;
+}
+
+int fios_stats_file(const char *path) {
+    return -1;
+}
+
+uint64_t fios_stats_begin(void) {
+    return 0;
+}
+
+void fios_stats_record(int id, FiosOp op, uint64_t bytes, uint64_t start) {
+}
+
+void fios_stats_record_path(const char *path, FiosOp op, uint64_t bytes, uint64_t start) {
+}
+
+void fios_sched_set_thread_class(int thid, FiosClass cls) {
+}
+
+void fios_sched_thread_exit(int thid) {
+}
+
+void fios_sched_boost(int thid, int on) {
+}
+
+int fios_sched_pwrite(int fd, const void *buf, uint32_t size, int64_t offset) {
+    return -1;
+}
+
+// Every directory a rule targets exists; nothing else does
+int sceIoGetstat(const char *file, SceIoStat *stat) {
+    memset(stat, 0, sizeof(*stat));
+    stat->st_mode = SCE_S_IFDIR;
+    return 0;
+}
+
+SceUID sceIoOpen(const char *file, int flags, int mode) { return -1; }
+int sceIoClose(SceUID fd) { return -1; }
+SceSSize sceIoRead(SceUID fd, void *data, SceSize size) { return -1; }
+SceSSize sceIoWrite(SceUID fd, const void *data, SceSize size) { return -1; }
+int sceIoSyncByFd(SceUID fd, int flag) { return -1; }
+SceUID sceIoDopen(const char *dirname) { return -1; }
+int sceIoDread(SceUID fd, SceIoDirent *dir) { return -1; }
+int sceIoDclose(SceUID fd) { return -1; }
+int sceIoMkdir(const char *dir, int mode) { return 0; }
+int sceIoRemove(const char *file) { return -1; }
+int sceIoRename(const char *oldname, const char *newname) { return -1; }
+int sceIoDevctl(const char *dev, unsigned int cmd, void *indata, int inlen, void *outdata, int outlen) { return -1; }
+
+// ===== CORPUS =====
+
+static void corpus_add(const char *path) {
+    if (corpus_count == corpus_capacity) {
+        corpus_capacity = corpus_capacity ? corpus_capacity * 2 : 1024;
+        corpus = realloc(corpus, corpus_capacity * sizeof(char *));
+    }
+    corpus[corpus_count] = strdup(path);
+    if (!corpus || !corpus[corpus_count]) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+    corpus_count++;
+}
+
+// The mix a level load produces: mostly asset probes, some save and
+// preference paths, and a few paths no rule touches
+static void corpus_generate(void) {
+    static const char *dirs[] = {"textures", "sounds", "levels", "fonts", "shaders", "textures/ui"};
+    static const char *exts[] = {"png", "ogg", "bin", "ttf", "glsl", "png"};
+    char path[FIOS_PATH_MAX];
+
+    for (int i = 0; i < GENERATED_PATHS; i++) {
+        int d = i % 6;
+        switch (i % 16) {
+            case 0:
+                snprintf(path, sizeof(path), "/sdcard/Android/data/com.hotdog.fluffydiver/files/save%d.dat", i % 4);
+                break;
+            case 1:
+                snprintf(path, sizeof(path), "/data/data/com.hotdog.fluffydiver/shared_prefs/prefs%d.xml", i % 3);
+                break;
+            case 2:
+                snprintf(path, sizeof(path), "/storage/emulated/0/Android/data/com.hotdog.fluffydiver/cache/t%d", i);
+                break;
+            case 3:
+                snprintf(path, sizeof(path), "ux0:data/fluffydiver/assets/%s/item_%04d.%s", dirs[d], i, exts[d]);
+                break;
+            case 4:
+                snprintf(path, sizeof(path), "/mods/pack%d/textures/fish_%03d.png", i % 5, i % 200);
+                break;
+            case 5:
+            case 6:
+            case 7:
+                snprintf(path, sizeof(path), "assets/%s/item_%04d.%s", dirs[d], i, exts[d]);
+                break;
+            default:
+                snprintf(path, sizeof(path), "/android_asset/%s/item_%04d.%s", dirs[d], i, exts[d]);
+                break;
+        }
+        corpus_add(path);
+    }
+}
+
+static int corpus_load(const char *path) {
+    FILE *in = fopen(path, "r");
+    if (!in) {
+        perror(path);
+        return -1;
+    }
+
+    char line[FIOS_PATH_MAX + 2];
+    while (fgets(line, sizeof(line), in)) {
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[0]) corpus_add(line);
+    }
+    fclose(in);
+    return corpus_count ? 0 : -1;
+}
+
+// ===== BENCHMARK =====
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void check(int ok, const char *what) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+// FNV-1a over every translation of the first round, then timing only
+static void *translate_main(void *arg) {
+    RunResult *result = arg;
+    char out[FIOS_PATH_MAX];
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (size_t i = 0; i < corpus_count; i++) {
+        int len = fios_translate_path(corpus[i], out, sizeof(out));
+        for (int j = 0; j < len; j++) hash = (hash ^ (uint8_t)out[j]) * 0x100000001B3ULL;
+        hash = (hash ^ (uint32_t)len) * 0x100000001B3ULL;
+    }
+    result->hash = hash;
+
+    if (thread_count > 1) pthread_barrier_wait(&start_barrier);
+    volatile int sink = 0;
+    uint64_t start = now_ns();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < corpus_count; i++) sink += fios_translate_path(corpus[i], out, sizeof(out));
+    }
+    result->ns = now_ns() - start;
+    return NULL;
+}
+
+static void print_rate(const char *label, int threads, uint64_t ns) {
+    double translations = (double)corpus_count * rounds * threads;
+    printf("  %-24s %9.1f %12.0f\n", label, ns / translations * threads, translations / (ns / 1e9));
+}
+
+static uint64_t run_single(void) {
+    RunResult result;
+    int saved = thread_count;
+    thread_count = 1;
+    translate_main(&result);
+    thread_count = saved;
+    print_rate("1 thread", 1, result.ns);
+    return result.hash;
+}
+
+static int run_threads(uint64_t expected_hash) {
+    pthread_t threads[MAX_THREADS];
+    RunResult results[MAX_THREADS];
+
+    pthread_barrier_init(&start_barrier, NULL, thread_count);
+    for (int i = 0; i < thread_count; i++) pthread_create(&threads[i], NULL, translate_main, &results[i]);
+
+    uint64_t slowest = 0;
+    int matching = 1;
+    for (int i = 0; i < thread_count; i++) {
+        pthread_join(threads[i], NULL);
+        if (results[i].ns > slowest) slowest = results[i].ns;
+        if (results[i].hash != expected_hash) matching = 0;
+    }
+    pthread_barrier_destroy(&start_barrier);
+
+    char label[32];
+    snprintf(label, sizeof(label), "%d threads", thread_count);
+    print_rate(label, thread_count, slowest);
+    return matching;
+}
+
+// ===== CORRECTNESS =====
+
+static void check_known(void) {
+    char out[FIOS_PATH_MAX];
+    int bad = 0;
+
+    for (size_t i = 0; i < KNOWN_COUNT; i++) {
+        int len = fios_translate_path(known[i].path, out, sizeof(out));
+        if (len != (int)strlen(known[i].expected) || strcmp(out, known[i].expected) != 0) {
+            printf("    %s -> %s (expected %s)\n", known[i].path, out, known[i].expected);
+            bad++;
+        }
+    }
+    check(bad == 0, "known paths translate per the rules");
+
+    const char *path = "/android_asset/textures/fish.png";
+    size_t need = strlen(known[0].expected) + 1;
+    check(fios_translate_path(path, out, need - 1) == -1 && out[0] == '\0', "short buffer rejected");
+    check(fios_translate_path(path, out, need) == (int)need - 1, "exact-size buffer accepted");
+    check(fios_translate_path(NULL, out, sizeof(out)) == -1, "NULL path rejected");
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--rounds") == 0) rounds = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--threads") == 0) thread_count = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "--corpus") == 0) corpus_path = argv[i + 1];
+        else if (strcmp(argv[i], "--rules") == 0) rules_path = argv[i + 1];
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (rounds <= 0 || thread_count <= 0 || thread_count > MAX_THREADS) {
+        fprintf(stderr, "invalid round or thread count\n");
+        return 1;
+    }
+
+    if (fios_init() < 0) return 1;
+    if (fios_add_redirect("/mods/*/textures/", "ux0:data/fluffydiver/mods/*/tex/") < 0) return 1;
+    if (rules_path && fios_load_redirects(rules_path) < 0) return 1;
+
+    if (corpus_path) {
+        if (corpus_load(corpus_path) < 0) {
+            fprintf(stderr, "%s: no paths\n", corpus_path);
+            return 1;
+        }
+    } else {
+        corpus_generate();
+    }
+
+    printf("\n%zu paths (%s), %d rounds\n", corpus_count, corpus_path ? corpus_path : "generated", rounds);
+    printf("  %-24s %9s %12s\n", "", "ns/path", "paths/s");
+    uint64_t hash = run_single();
+    int matching = run_threads(hash);
+
+    printf("\nChecks\n");
+    if (!rules_path) check_known();
+    check(matching, "threads match the single-thread results");
+
+    fios_cleanup();
+    printf("%s\n", failures ? "FAILED" : "All checks passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,361 @@
+/*
+ * vitasdk.h - Minimal Linux stand-in for the Vita SDK
+ * Just enough of the kernel API (lightweight mutexes and condition
+ * variables, semaphores, threads, the process clock) to build loader
+ * modules such as src/fios_sched.c and src/fios.c into host tests and
+ * benchmarks.
+ * The sceIo* calls are only declared: a benchmark that needs them defines
+ * them as its simulated device.
+ */
+
+#ifndef __HOST_VITASDK_H__
+#define __HOST_VITASDK_H__
+
+// fopencookie, for funopen below; only takes effect if this comes first
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+
+typedef int SceUID;
+typedef unsigned int SceSize;
+typedef int SceSSize;
+typedef unsigned int SceUInt;
+typedef unsigned int SceUInt32;
+typedef uint64_t SceUInt64;
+typedef int64_t SceOff;
+
+#define SCE_KERNEL_CPU_MASK_USER_0 0x10000
+#define SCE_KERNEL_CPU_MASK_USER_1 0x20000
+#define SCE_KERNEL_CPU_MASK_USER_2 0x40000
+
+#define SCE_KERNEL_ERROR_WAIT_TIMEOUT ((int)0x80028005)
+
+#define SCE_O_RDONLY 0x0001
+#define SCE_O_WRONLY 0x0002
+#define SCE_O_RDWR   (SCE_O_RDONLY | SCE_O_WRONLY)
+#define SCE_O_NBLOCK 0x0004
+#define SCE_O_APPEND 0x0100
+#define SCE_O_CREAT  0x0200
+#define SCE_O_TRUNC  0x0400
+#define SCE_O_EXCL   0x0800
+
+#define SCE_SEEK_SET 0
+#define SCE_SEEK_CUR 1
+#define SCE_SEEK_END 2
+
+#define SCE_S_IFMT  0xF000
+#define SCE_S_IFDIR 0x1000
+#define SCE_S_IFREG 0x2000
+#define SCE_S_ISDIR(m) (((m) & SCE_S_IFMT) == SCE_S_IFDIR)
+#define SCE_S_ISREG(m) (((m) & SCE_S_IFMT) == SCE_S_IFREG)
+
+typedef struct {
+    pthread_mutex_t mutex;
+} SceKernelLwMutexWork;
+
+typedef struct {
+    pthread_cond_t cond;
+    SceKernelLwMutexWork *mutex;
+} SceKernelLwCondWork;
+
+typedef struct {
+    SceUInt64 quad;
+} SceKernelSysClock;
+
+// Only the fields the loader reads
+typedef struct {
+    SceSize size;
+    SceKernelSysClock runClocks;
+} SceKernelThreadInfo;
+
+typedef struct {
+    SceUInt64 tick;
+} SceRtcTick;
+
+// Only the fields the loader reads
+typedef struct {
+    unsigned int st_mode;
+    unsigned int st_attr;
+    SceOff st_size;
+} SceIoStat;
+
+typedef struct {
+    SceIoStat d_stat;
+    char d_name[256];
+    void *d_private;
+    int dummy;
+} SceIoDirent;
+
+typedef struct {
+    SceOff max_size;
+    SceOff free_size;
+    SceSize cluster_size;
+    void *unk;
+} SceIoDevInfo;
+
+typedef int (*SceKernelThreadEntry)(SceSize args, void *argp);
+
+typedef struct {
+    SceKernelThreadEntry entry;
+    pthread_t handle;
+} HostThread;
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int count;
+    int max;
+    int deleted;
+} HostSema;
+
+static inline SceUInt64 sceKernelGetProcessTimeWide(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (SceUInt64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static inline int sceKernelDelayThread(SceUInt32 us) {
+    if (us == 0) return sched_yield();
+    return usleep(us);
+}
+
+// Kernel TLS slots; each translation unit that calls this gets its own array
+static __thread void *host_tls_slots[0x100];
+
+static inline void *sceKernelGetTLSAddr(int slot) {
+    return &host_tls_slots[slot & 0xFF];
+}
+
+static inline int sceKernelGetThreadId(void) {
+    return (int)syscall(SYS_gettid);
+}
+
+// Thread ids are Linux tids, so any thread's CPU clock can be read
+static inline int sceKernelGetThreadInfo(SceUID thid, SceKernelThreadInfo *info) {
+    struct timespec ts;
+    clockid_t clock = (~(clockid_t)thid << 3) | 6; // Per-thread CPUCLOCK_SCHED
+    if (clock_gettime(clock, &ts) != 0) return -1;
+    info->runClocks.quad = (SceUInt64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    return 0;
+}
+
+// Microseconds since 0001-01-01
+static inline int sceRtcGetCurrentTick(SceRtcTick *tick) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    tick->tick = 62135596800000000ULL + (SceUInt64)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    return 0;
+}
+
+static inline int sceKernelCreateLwMutex(SceKernelLwMutexWork *work, const char *name,
+                                         unsigned attr, int count, void *opt) {
+    return pthread_mutex_init(&work->mutex, NULL) == 0 ? 0 : -1;
+}
+
+static inline int sceKernelLockLwMutex(SceKernelLwMutexWork *work, int count, unsigned *timeout) {
+    return pthread_mutex_lock(&work->mutex) == 0 ? 0 : -1;
+}
+
+static inline int sceKernelUnlockLwMutex(SceKernelLwMutexWork *work, int count) {
+    return pthread_mutex_unlock(&work->mutex) == 0 ? 0 : -1;
+}
+
+static inline int sceKernelDeleteLwMutex(SceKernelLwMutexWork *work) {
+    return pthread_mutex_destroy(&work->mutex) == 0 ? 0 : -1;
+}
+
+static inline int sceKernelCreateLwCond(SceKernelLwCondWork *work, const char *name, unsigned attr,
+                                        SceKernelLwMutexWork *mutex, void *opt) {
+    work->mutex = mutex;
+    return pthread_cond_init(&work->cond, NULL) == 0 ? 0 : -1;
+}
+
+// Timeout is relative, in microseconds
+static inline int sceKernelWaitLwCond(SceKernelLwCondWork *work, SceUInt32 *timeout) {
+    if (!timeout) return pthread_cond_wait(&work->cond, &work->mutex->mutex) == 0 ? 0 : -1;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    uint64_t ns = ts.tv_nsec + (uint64_t)*timeout * 1000;
+    ts.tv_sec += ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return pthread_cond_timedwait(&work->cond, &work->mutex->mutex, &ts) == 0
+               ? 0 : SCE_KERNEL_ERROR_WAIT_TIMEOUT;
+}
+
+static inline int sceKernelSignalLwCond(SceKernelLwCondWork *work) {
+    return pthread_cond_signal(&work->cond) == 0 ? 0 : -1;
+}
+
+static inline int sceKernelSignalLwCondAll(SceKernelLwCondWork *work) {
+    return pthread_cond_broadcast(&work->cond) == 0 ? 0 : -1;
+}
+
+#define HOST_MAX_THREADS 16
+#define HOST_MAX_SEMAS 16
+
+static HostThread host_threads[HOST_MAX_THREADS];
+static int host_thread_count = 0;
+static HostSema host_semas[HOST_MAX_SEMAS];
+static int host_sema_count = 0;
+
+// Priorities and affinity are ignored; the uid indexes host_threads
+static inline SceUID sceKernelCreateThread(const char *name, SceKernelThreadEntry entry, int priority,
+                                           SceSize stack, unsigned attr, int cpu_mask, void *opt) {
+    if (host_thread_count == HOST_MAX_THREADS) return -1;
+    host_threads[host_thread_count].entry = entry;
+    return host_thread_count++;
+}
+
+static inline void *host_thread_start(void *arg) {
+    HostThread *t = arg;
+    t->entry(0, NULL);
+    return NULL;
+}
+
+// Threads stay joinable so sceKernelWaitThreadEnd can wait for them
+static inline int sceKernelStartThread(SceUID thid, SceSize args, void *argp) {
+    HostThread *t = &host_threads[thid];
+    return pthread_create(&t->handle, NULL, host_thread_start, t) == 0 ? 0 : -1;
+}
+
+static inline int sceKernelWaitThreadEnd(SceUID thid, int *stat, SceUInt *timeout) {
+    return pthread_join(host_threads[thid].handle, NULL) == 0 ? 0 : -1;
+}
+
+static inline int sceKernelDeleteThread(SceUID thid) {
+    return 0;
+}
+
+static inline int sceKernelExitDeleteThread(int status) {
+    pthread_exit(NULL);
+}
+
+// Semaphores are never reused; a deleted one fails its waiters
+static inline SceUID sceKernelCreateSema(const char *name, SceUInt attr, int init, int max, void *opt) {
+    if (host_sema_count == HOST_MAX_SEMAS) return -1;
+    HostSema *s = &host_semas[host_sema_count];
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->cond, NULL);
+    s->count = init;
+    s->max = max;
+    s->deleted = 0;
+    return host_sema_count++;
+}
+
+static inline int sceKernelDeleteSema(SceUID semaid) {
+    HostSema *s = &host_semas[semaid];
+    pthread_mutex_lock(&s->mutex);
+    s->deleted = 1;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return 0;
+}
+
+static inline int sceKernelSignalSema(SceUID semaid, int signal) {
+    HostSema *s = &host_semas[semaid];
+    pthread_mutex_lock(&s->mutex);
+    int ok = !s->deleted && s->count + signal <= s->max;
+    if (ok) s->count += signal;
+    pthread_cond_broadcast(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return ok ? 0 : -1;
+}
+
+// Timeouts are not supported
+static inline int sceKernelWaitSema(SceUID semaid, int signal, SceUInt *timeout) {
+    HostSema *s = &host_semas[semaid];
+    pthread_mutex_lock(&s->mutex);
+    while (!s->deleted && s->count < signal) pthread_cond_wait(&s->cond, &s->mutex);
+    int ok = !s->deleted;
+    if (ok) s->count -= signal;
+    pthread_mutex_unlock(&s->mutex);
+    return ok ? 0 : -1;
+}
+
+// newlib's fpos_t is a plain offset and it builds streams from callbacks
+// with funopen; glibc has a struct fpos_t and fopencookie instead
+#define fpos_t long
+
+#ifdef __USE_GNU
+typedef struct {
+    void *cookie;
+    int (*read)(void *cookie, char *buf, int n);
+    int (*write)(void *cookie, const char *buf, int n);
+    fpos_t (*seek)(void *cookie, fpos_t offset, int whence);
+    int (*close)(void *cookie);
+} HostFunopen;
+
+static inline ssize_t host_funopen_read(void *arg, char *buf, size_t size) {
+    HostFunopen *f = arg;
+    return f->read ? f->read(f->cookie, buf, size > 0x7FFFFFFF ? 0x7FFFFFFF : (int)size) : -1;
+}
+
+static inline ssize_t host_funopen_write(void *arg, const char *buf, size_t size) {
+    HostFunopen *f = arg;
+    return f->write ? f->write(f->cookie, buf, size > 0x7FFFFFFF ? 0x7FFFFFFF : (int)size) : -1;
+}
+
+static inline int host_funopen_seek(void *arg, off64_t *offset, int whence) {
+    HostFunopen *f = arg;
+    fpos_t pos = f->seek ? f->seek(f->cookie, (fpos_t)*offset, whence) : -1;
+    if (pos < 0) return -1;
+    *offset = pos;
+    return 0;
+}
+
+static inline int host_funopen_close(void *arg) {
+    HostFunopen *f = arg;
+    int ret = f->close ? f->close(f->cookie) : 0;
+    free(f);
+    return ret;
+}
+
+static inline FILE *funopen(const void *cookie, int (*readfn)(void *, char *, int),
+                            int (*writefn)(void *, const char *, int),
+                            fpos_t (*seekfn)(void *, fpos_t, int), int (*closefn)(void *)) {
+    HostFunopen *f = malloc(sizeof(HostFunopen));
+    if (!f) return NULL;
+    *f = (HostFunopen){(void *)cookie, readfn, writefn, seekfn, closefn};
+
+    cookie_io_functions_t funcs = {
+        .read = host_funopen_read,
+        .write = host_funopen_write,
+        .seek = host_funopen_seek,
+        .close = host_funopen_close,
+    };
+    FILE *file = fopencookie(f, writefn ? (readfn ? "r+" : "w") : "r", funcs);
+    if (!file) free(f);
+    return file;
+}
+#endif
+
+// Defined by the benchmark
+SceUID sceIoOpen(const char *file, int flags, int mode);
+int sceIoClose(SceUID fd);
+SceSSize sceIoRead(SceUID fd, void *data, SceSize size);
+SceSSize sceIoWrite(SceUID fd, const void *data, SceSize size);
+SceOff sceIoLseek(SceUID fd, SceOff offset, int whence);
+SceSSize sceIoPread(SceUID fd, void *data, SceSize size, SceOff offset);
+SceSSize sceIoPwrite(SceUID fd, const void *data, SceSize size, SceOff offset);
+int sceIoSyncByFd(SceUID fd, int flag);
+int sceIoGetstat(const char *file, SceIoStat *stat);
+SceUID sceIoDopen(const char *dirname);
+int sceIoDread(SceUID fd, SceIoDirent *dir);
+int sceIoDclose(SceUID fd);
+int sceIoMkdir(const char *dir, int mode);
+int sceIoRemove(const char *file);
+int sceIoRename(const char *oldname, const char *newname);
+int sceIoDevctl(const char *dev, unsigned int cmd, void *indata, int inlen, void *outdata, int outlen);
+
+#endif // __HOST_VITASDK_H__
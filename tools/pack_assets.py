@@ -0,0 +1,195 @@
+#!/usr/bin/env python3
+"""
+pack_assets.py - Build the Fluffy Diver asset pack (assets.pak)
+
+Packs every file under an extracted APK assets/ directory into a single
+archive read by src/asset_pack.c. Copy the result to
+ux0:data/fluffydiver/assets.pak; loose files under assets/ are still used
+for anything not in the pack.
+
+With --compress, assets larger than one chunk are stored as independently
+deflated chunks behind a seek table, so the game can seek and read them
+while inflating only the chunks it touches.
+
+Byte-identical files are stored once: every name for the same content
+points at one blob, and the game caches it once for all of them.
+
+Usage: pack_assets.py [--align N] [--compress] [--level N] [--chunk-size N]
+                      ASSETS_DIR OUTPUT
+"""
+
+import argparse
+import hashlib
+import os
+import struct
+import sys
+import zlib
+
+MAGIC = 0x4B504446  # "FDPK"
+VERSION = 2
+DEFLATE = 0x1
+CHUNKED = 0x2
+
+# Must match ASSET_PACK_CHUNK_MAX in include/asset_pack.h
+CHUNK_MAX = 256 * 1024
+
+HEADER = struct.Struct("<8I")
+ENTRY = struct.Struct("<6I")
+
+# Already-compressed formats gain nothing from deflate
+STORED_EXTENSIONS = {".png", ".jpg", ".jpeg", ".ogg", ".mp3", ".m4a", ".zip", ".pvr.ccz", ".gz"}
+
+# Deflated copies must save at least this fraction to be kept
+MIN_SAVING = 0.10
+
+
+def fnv1a(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def align_up(value, alignment):
+    return (value + alignment - 1) // alignment * alignment
+
+
+def collect(root):
+    files = []
+    for dirpath, dirnames, filenames in os.walk(root):
+        dirnames.sort()
+        for filename in sorted(filenames):
+            path = os.path.join(dirpath, filename)
+            name = os.path.relpath(path, root).replace(os.sep, "/")
+            files.append((name, path))
+    return files
+
+
+def should_compress(name):
+    lower = name.lower()
+    return not any(lower.endswith(ext) for ext in STORED_EXTENSIONS)
+
+
+def deflate_chunked(raw, level, chunk_size):
+    """Seek table plus chunks; chunks that don't shrink are stored as-is."""
+    chunks = []
+    for start in range(0, len(raw), chunk_size):
+        piece = raw[start:start + chunk_size]
+        packed = zlib.compress(piece, level)
+        chunks.append(packed if len(packed) < len(piece) else piece)
+
+    table = [4 * (len(chunks) + 1)]
+    for chunk in chunks:
+        table.append(table[-1] + len(chunk))
+    return struct.pack("<%dI" % len(table), *table) + b"".join(chunks)
+
+
+def encode(name, raw, compress, level, chunk_size):
+    if not compress or not should_compress(name):
+        return raw, 0
+
+    if chunk_size and len(raw) > chunk_size:
+        data, flags = deflate_chunked(raw, level, chunk_size), CHUNKED
+    else:
+        data, flags = zlib.compress(raw, level), DEFLATE
+
+    if len(data) <= len(raw) * (1.0 - MIN_SAVING):
+        return data, flags
+    return raw, 0
+
+
+def build(root, output, align, compress, level, chunk_size):
+    files = collect(root)
+    entries = []
+    for name, path in files:
+        encoded = name.encode("utf-8")
+        entries.append({"name": encoded, "hash": fnv1a(encoded), "path": path})
+
+    # The reader binary-searches on the hash, then compares names
+    entries.sort(key=lambda e: (e["hash"], e["name"]))
+
+    names = bytearray()
+    for e in entries:
+        e["name_offset"] = len(names)
+        names += e["name"] + b"\0"
+
+    toc_offset = HEADER.size
+    names_offset = toc_offset + ENTRY.size * len(entries)
+    offset = align_up(names_offset + len(names), align)
+
+    raw_total = 0
+    stored_total = 0
+    chunked = 0
+    blobs = {}  # Content digest -> entry fields of the first copy
+    aliases = 0
+    saved = 0
+    raw_saved = 0
+    with open(output, "wb") as out:
+        out.seek(offset)
+        for e in entries:
+            with open(e["path"], "rb") as f:
+                raw = f.read()
+            raw_total += len(raw)
+
+            digest = hashlib.sha256(raw).digest()
+            blob = blobs.get(digest)
+            if blob is not None:
+                e.update(blob)
+                aliases += 1
+                saved += blob["size"]
+                raw_saved += blob["raw_size"]
+                continue
+
+            data, flags = encode(e["name"].decode("utf-8"), raw, compress, level, chunk_size)
+            chunked += flags == CHUNKED
+
+            out.seek(offset)
+            out.write(data)
+            e.update(offset=offset, size=len(data), raw_size=len(raw), flags=flags)
+            blobs[digest] = {k: e[k] for k in ("offset", "size", "raw_size", "flags")}
+            offset = align_up(offset + len(data), align)
+
+            stored_total += len(data)
+
+        if offset > 0xFFFFFFFF:
+            sys.exit("error: pack exceeds 4 GB")
+
+        out.seek(0)
+        out.write(HEADER.pack(MAGIC, VERSION, len(entries), toc_offset,
+                              names_offset, len(names), align, chunk_size if compress else 0))
+        for e in entries:
+            out.write(ENTRY.pack(e["hash"], e["name_offset"], e["offset"],
+                                 e["size"], e["raw_size"], e["flags"]))
+        out.write(names)
+        out.truncate(offset)
+
+    print("%s: %d assets (%d chunked), %d KB -> %d KB stored, %d KB pack"
+          % (output, len(entries), chunked, raw_total // 1024, stored_total // 1024, offset // 1024))
+    print("  %d duplicates share %d blobs: %d KB saved on disk, %d KB in the game's cache"
+          % (aliases, len(blobs), saved // 1024, raw_saved // 1024))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build the Fluffy Diver asset pack")
+    parser.add_argument("assets_dir", help="extracted APK assets/ directory")
+    parser.add_argument("output", help="pack file to write (assets.pak)")
+    parser.add_argument("--align", type=int, default=64, help="data alignment in bytes (default 64)")
+    parser.add_argument("--compress", action="store_true", help="deflate entries that shrink by 10%% or more")
+    parser.add_argument("--level", type=int, default=9, help="zlib level for --compress (default 9)")
+    parser.add_argument("--chunk-size", type=int, default=64 * 1024,
+                        help="chunk larger assets for random access with --compress, 0 to deflate them "
+                             "whole (default 65536)")
+    args = parser.parse_args()
+
+    if args.align <= 0 or args.align & (args.align - 1):
+        parser.error("--align must be a power of two")
+    if args.chunk_size < 0 or args.chunk_size > CHUNK_MAX:
+        parser.error("--chunk-size must be between 0 and %d" % CHUNK_MAX)
+    if not os.path.isdir(args.assets_dir):
+        parser.error("%s is not a directory" % args.assets_dir)
+
+    build(args.assets_dir, args.output, args.align, args.compress, args.level, args.chunk_size)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,284 @@
+/*
+ * test_atomic.c - Atomics stress test for Fluffy Diver (Linux host)
+ * Hammers src/atomic_patch.c from several threads and checks that every
+ * operation behaved as one indivisible step:
+ *
+ *   - fetch_add / __sync_fetch_and_add counters at widths 1, 2, 4 and 8
+ *     end on the exact total (modulo the width)
+ *   - CAS increments through the libatomic signature (ptr, expected,
+ *     desired, success, failure) hand out every old value exactly once
+ *   - exchange returns each token stored exactly once (no lost or
+ *     duplicated values)
+ *   - 8-byte loads never observe a torn store
+ *   - the generic (locked) path keeps a 12-byte struct consistent
+ *
+ * Build: cc -O2 -Iinclude -Itools/host -o test_atomic tools/test_atomic.c src/atomic_patch.c -lpthread
+ * Usage: test_atomic [--threads N] [--iterations N]
+ */
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vitasdk.h"
+#include "atomic_patch.h"
+
+#define MAX_THREADS 64
+
+// Same entry point, called the way the game's libatomic import does
+typedef int (*CompareExchange4)(volatile void *ptr, void *expected, uint32_t desired, int success, int failure);
+typedef int (*CompareExchange8)(volatile void *ptr, void *expected, uint64_t desired, int success, int failure);
+
+typedef struct {
+    uint32_t a, b, c; // Invariant: b == a * 2, c == a * 3
+} Triple;
+
+static int thread_count = 8;
+static int iterations = 200000;
+static int failures = 0;
+
+static pthread_barrier_t start_barrier;
+static volatile int readers_stop = 0;
+
+// Shared state, padded apart so each test contends on one line
+static volatile uint8_t counter_1 __attribute__((aligned(64)));
+static volatile uint16_t counter_2 __attribute__((aligned(64)));
+static volatile uint32_t counter_4 __attribute__((aligned(64)));
+static volatile uint64_t counter_8 __attribute__((aligned(64)));
+static volatile uint32_t sync_counter __attribute__((aligned(64)));
+static volatile uint32_t cas_counter_4 __attribute__((aligned(64)));
+static volatile uint64_t cas_counter_8 __attribute__((aligned(64)));
+static volatile uint32_t exchange_slot __attribute__((aligned(64)));
+static volatile uint64_t torn_slot __attribute__((aligned(64)));
+static volatile Triple triple __attribute__((aligned(64)));
+
+static uint32_t *cas_seen_4;
+static uint64_t *cas_seen_8;
+static uint32_t *exchange_seen;
+
+static void check(int ok, const char *what) {
+    printf("  %-44s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+static void run_threads(void *(*fn)(void *)) {
+    pthread_t threads[MAX_THREADS];
+    pthread_barrier_init(&start_barrier, NULL, thread_count);
+    for (intptr_t i = 0; i < thread_count; i++) pthread_create(&threads[i], NULL, fn, (void *)i);
+    for (int i = 0; i < thread_count; i++) pthread_join(threads[i], NULL);
+    pthread_barrier_destroy(&start_barrier);
+}
+
+// ===== COUNTERS =====
+
+static void *counter_main(void *arg) {
+    pthread_barrier_wait(&start_barrier);
+    for (int i = 0; i < iterations; i++) {
+        atomic_fetch_add_1(&counter_1, 1, __ATOMIC_RELAXED);
+        atomic_fetch_add_2(&counter_2, 1, __ATOMIC_ACQ_REL);
+        atomic_add_fetch_4(&counter_4, 1, __ATOMIC_SEQ_CST);
+        atomic_fetch_add_8(&counter_8, 1, __ATOMIC_RELAXED);
+        atomic_sync_fetch_and_add_4(&sync_counter, 1);
+    }
+    return NULL;
+}
+
+static void test_counters(void) {
+    uint64_t total = (uint64_t)thread_count * iterations;
+    run_threads(counter_main);
+    check(atomic_load_1(&counter_1, __ATOMIC_SEQ_CST) == (uint8_t)total, "fetch_add_1 total");
+    check(atomic_load_2(&counter_2, __ATOMIC_SEQ_CST) == (uint16_t)total, "fetch_add_2 total");
+    check(atomic_load_4(&counter_4, __ATOMIC_SEQ_CST) == (uint32_t)total, "add_fetch_4 total");
+    check(atomic_load_8(&counter_8, __ATOMIC_SEQ_CST) == total, "fetch_add_8 total");
+    check(sync_counter == (uint32_t)total, "__sync_fetch_and_add_4 total");
+}
+
+// ===== COMPARE-EXCHANGE =====
+
+// Each successful CAS claims the old value it replaced; a linearizable
+// counter hands out 0..total-1 exactly once
+static void *cas_main(void *arg) {
+    CompareExchange4 cas4 = (CompareExchange4)&atomic_compare_exchange_4;
+    CompareExchange8 cas8 = (CompareExchange8)&atomic_compare_exchange_8;
+    pthread_barrier_wait(&start_barrier);
+
+    for (int i = 0; i < iterations; i++) {
+        uint32_t expected4 = atomic_load_4(&cas_counter_4, __ATOMIC_RELAXED);
+        while (!cas4(&cas_counter_4, &expected4, expected4 + 1, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+        }
+        __atomic_fetch_add(&cas_seen_4[expected4], 1, __ATOMIC_RELAXED);
+
+        uint64_t expected8 = atomic_load_8(&cas_counter_8, __ATOMIC_RELAXED);
+        while (!cas8(&cas_counter_8, &expected8, expected8 + 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        }
+        __atomic_fetch_add(&cas_seen_8[expected8], 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+static void test_compare_exchange(void) {
+    uint64_t total = (uint64_t)thread_count * iterations;
+    cas_seen_4 = calloc(total, sizeof(uint32_t));
+    cas_seen_8 = calloc(total, sizeof(uint64_t));
+    if (!cas_seen_4 || !cas_seen_8) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    run_threads(cas_main);
+
+    int unique_4 = 1, unique_8 = 1;
+    for (uint64_t i = 0; i < total; i++) {
+        if (cas_seen_4[i] != 1) unique_4 = 0;
+        if (cas_seen_8[i] != 1) unique_8 = 0;
+    }
+    check(cas_counter_4 == (uint32_t)total && unique_4, "compare_exchange_4 claims each value once");
+    check(cas_counter_8 == total && unique_8, "compare_exchange_8 claims each value once");
+
+    // A failed exchange must report the current value and leave it alone
+    uint32_t expected = 12345;
+    uint32_t before = cas_counter_4;
+    int swapped = atomic_compare_exchange_4(&cas_counter_4, &expected, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+    check(!swapped && expected == before && cas_counter_4 == before, "failed compare_exchange_4 reports current");
+
+    free(cas_seen_4);
+    free(cas_seen_8);
+}
+
+// ===== EXCHANGE =====
+
+// Tokens are thread * iterations + i + 1 (0 is the initial value). Every
+// token stored must come back from exactly one exchange, or be the final value.
+static void *exchange_main(void *arg) {
+    uint32_t base = (uint32_t)(intptr_t)arg * iterations;
+    pthread_barrier_wait(&start_barrier);
+    for (int i = 0; i < iterations; i++) {
+        uint32_t old = atomic_exchange_4(&exchange_slot, base + i + 1, __ATOMIC_ACQ_REL);
+        __atomic_fetch_add(&exchange_seen[old], 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+static void test_exchange(void) {
+    uint64_t total = (uint64_t)thread_count * iterations;
+    exchange_seen = calloc(total + 1, sizeof(uint32_t));
+    if (!exchange_seen) {
+        fprintf(stderr, "out of memory\n");
+        exit(1);
+    }
+
+    run_threads(exchange_main);
+    exchange_seen[exchange_slot]++;
+
+    int ok = 1;
+    for (uint64_t i = 0; i <= total; i++) {
+        if (exchange_seen[i] != 1) ok = 0;
+    }
+    check(ok, "exchange_4 returns each token once");
+    free(exchange_seen);
+}
+
+// ===== TORN 8-BYTE ACCESS =====
+
+// Writers store values whose halves match; any mismatch is a torn access
+static void *torn_main(void *arg) {
+    int reader = (intptr_t)arg & 1;
+    int torn = 0;
+    pthread_barrier_wait(&start_barrier);
+
+    if (reader) {
+        while (!readers_stop) {
+            uint64_t v = atomic_load_8(&torn_slot, __ATOMIC_ACQUIRE);
+            if ((uint32_t)v != (uint32_t)(v >> 32)) torn++;
+        }
+    } else {
+        for (int i = 0; i < iterations; i++) {
+            uint32_t half = (uint32_t)(intptr_t)arg * iterations + i;
+            atomic_store_8(&torn_slot, ((uint64_t)half << 32) | half, __ATOMIC_RELEASE);
+        }
+        readers_stop = 1;
+    }
+    return (void *)(intptr_t)torn;
+}
+
+static void test_torn(void) {
+    pthread_t threads[MAX_THREADS];
+    int count = thread_count < 2 ? 2 : thread_count;
+    intptr_t torn = 0;
+
+    readers_stop = 0;
+    pthread_barrier_init(&start_barrier, NULL, count);
+    for (intptr_t i = 0; i < count; i++) pthread_create(&threads[i], NULL, torn_main, (void *)i);
+    for (int i = 0; i < count; i++) {
+        void *ret;
+        pthread_join(threads[i], &ret);
+        torn += (intptr_t)ret;
+    }
+    pthread_barrier_destroy(&start_barrier);
+    check(torn == 0, "load_8 / store_8 never torn");
+}
+
+// ===== GENERIC PATH =====
+
+static void *generic_main(void *arg) {
+    pthread_barrier_wait(&start_barrier);
+    int broken = 0;
+    for (int i = 0; i < iterations / 4; i++) {
+        Triple expected, desired;
+        atomic_load_generic(sizeof(Triple), &triple, &expected, __ATOMIC_SEQ_CST);
+        if (expected.b != expected.a * 2 || expected.c != expected.a * 3) broken++;
+        do {
+            desired.a = expected.a + 1;
+            desired.b = desired.a * 2;
+            desired.c = desired.a * 3;
+        } while (!atomic_compare_exchange_generic(sizeof(Triple), &triple, &expected, &desired,
+                                                  __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+    }
+    return (void *)(intptr_t)broken;
+}
+
+static void test_generic(void) {
+    pthread_t threads[MAX_THREADS];
+    intptr_t broken = 0;
+
+    pthread_barrier_init(&start_barrier, NULL, thread_count);
+    for (intptr_t i = 0; i < thread_count; i++) pthread_create(&threads[i], NULL, generic_main, (void *)i);
+    for (int i = 0; i < thread_count; i++) {
+        void *ret;
+        pthread_join(threads[i], &ret);
+        broken += (intptr_t)ret;
+    }
+    pthread_barrier_destroy(&start_barrier);
+
+    check(!atomic_is_lock_free(sizeof(Triple), &triple), "12-byte object takes the locked path");
+    check(broken == 0, "generic load never sees a partial update");
+    check(triple.a == (uint32_t)(thread_count * (iterations / 4)) && triple.c == triple.a * 3,
+          "generic compare_exchange total");
+}
+
+int main(int argc, char **argv) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        int value = atoi(argv[i + 1]);
+        if (strcmp(argv[i], "--threads") == 0) thread_count = value;
+        else if (strcmp(argv[i], "--iterations") == 0) iterations = value;
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (thread_count <= 0 || thread_count > MAX_THREADS || iterations <= 0) {
+        fprintf(stderr, "invalid thread or iteration count\n");
+        return 1;
+    }
+
+    printf("%d threads, %d iterations each\n", thread_count, iterations);
+    test_counters();
+    test_compare_exchange();
+    test_exchange();
+    test_torn();
+    test_generic();
+
+    printf("%s\n", failures ? "FAILED" : "All tests passed");
+    return failures ? 1 : 0;
+}